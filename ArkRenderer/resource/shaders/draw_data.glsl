@@ -0,0 +1,15 @@
+// std430 mirror of MeshBatch::DrawData, one entry per mesh of the batch. Indexed by the base instance of the
+// indirect command, which MeshBatch sets to the mesh index.
+struct DrawData
+{
+    mat4 model;
+    // UV offset in xy and extent in zw
+    vec4 uvTransform;
+    // ARB_bindless_texture handle of the albedo texture, zero without bindless
+    uvec2 albedo;
+    uvec2 padding;
+};
+layout (std430, binding = 2) readonly buffer DrawBuffer
+{
+    DrawData draws[];
+};
@@ -0,0 +1,13 @@
+// std430 mirror of RenderSystem::ObjectUniforms, one entry per instance of an instanced draw. RenderSystem binds the
+// draw's range of the object ring here, so gl_InstanceID indexes it directly.
+struct InstanceData
+{
+    // For packed meshes the dequantization transform is folded in
+    mat4 model;
+    // UV offset in xy and extent in zw
+    vec4 uvTransform;
+};
+layout (std430, binding = 3) readonly buffer InstanceBuffer
+{
+    InstanceData instances[];
+};
@@ -0,0 +1,30 @@
+#version 460 core
+// Instanced variant of model_loading_packedvs.glsl, the model matrix and UV transform come from the instance data
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec2 texCoords;
+layout (location = 2) in vec2 octNormal;
+layout (location = 3) in vec2 octTangent;
+out vec2 TexCoords;
+// Object space. The model matrix also carries the non-uniform dequantization scale, so it must not be applied to these
+out vec3 Normal;
+out vec3 Tangent;
+#include "uniform_blocks.glsl"
+#include "instance_data.glsl"
+
+vec3 OctDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main()
+{
+    InstanceData instance = instances[gl_InstanceID];
+    TexCoords = instance.uvTransform.xy + texCoords * instance.uvTransform.zw;
+    Normal = OctDecode(octNormal);
+    Tangent = OctDecode(octTangent);
+    gl_Position = viewProjection * instance.model * vec4(position, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 460 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec2 texCoords;
+layout (location = 2) in vec3 normal;
+layout (location = 3) in vec3 tangent;
+out vec2 TexCoords;
+#include "uniform_blocks.glsl"
+#include "instance_data.glsl"
+void main()
+{
+    TexCoords = texCoords;
+    gl_Position = viewProjection * instances[gl_InstanceID].model * vec4(position, 1.0);
+}
@@ -0,0 +1,29 @@
+#version 460 core
+// VertexLayout::Packed. Attributes arrive normalized: position and texCoords in [0, 1], octahedral vectors in [-1, 1].
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec2 texCoords;
+layout (location = 2) in vec2 octNormal;
+layout (location = 3) in vec2 octTangent;
+out vec2 TexCoords;
+// Object space. model also carries the non-uniform dequantization scale, so it must not be applied to these
+out vec3 Normal;
+out vec3 Tangent;
+// model has the mesh dequantization transform folded in
+#include "uniform_blocks.glsl"
+
+vec3 OctDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main()
+{
+    TexCoords = uvTransform.xy + texCoords * uvTransform.zw;
+    Normal = OctDecode(octNormal);
+    Tangent = OctDecode(octTangent);
+    gl_Position = viewProjection * model * vec4(position, 1.0);
+}
\ No newline at end of file
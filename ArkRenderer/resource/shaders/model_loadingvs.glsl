@@ -4,11 +4,9 @@ layout (location = 1) in vec2 texCoords;
 layout (location = 2) in vec3 normal;
 layout (location = 3) in vec3 tangent;
 out vec2 TexCoords;
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "uniform_blocks.glsl"
 void main()
 {
     TexCoords = texCoords;
-    gl_Position = projection * view * model * vec4(position, 1.0);
+    gl_Position = viewProjection * model * vec4(position, 1.0);
 }
\ No newline at end of file
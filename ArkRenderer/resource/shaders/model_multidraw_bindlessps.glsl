@@ -0,0 +1,10 @@
+#version 460 core
+#extension GL_ARB_bindless_texture : require
+out vec4 FragColor;
+in vec2 TexCoords;
+flat in uint DrawIndex;
+#include "draw_data.glsl"
+void main()
+{
+    FragColor = texture(sampler2D(draws[DrawIndex].albedo), TexCoords);
+}
@@ -0,0 +1,15 @@
+#version 460 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec2 texCoords;
+layout (location = 2) in vec3 normal;
+layout (location = 3) in vec3 tangent;
+out vec2 TexCoords;
+flat out uint DrawIndex;
+#include "uniform_blocks.glsl"
+#include "draw_data.glsl"
+void main()
+{
+    DrawIndex = uint(gl_BaseInstance);
+    TexCoords = texCoords;
+    gl_Position = viewProjection * draws[DrawIndex].model * vec4(position, 1.0);
+}
@@ -0,0 +1,12 @@
+#version 460 core
+// Depth only, like shadowdepthvs.glsl but with the model matrix from the ObjectData block
+layout (location = 0) in vec3 position;
+
+#include "uniform_blocks.glsl"
+
+out float VertexDepth;
+
+void main() {
+    gl_Position = viewProjection * model * vec4(position, 1.0);
+    VertexDepth = gl_Position.z;
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+// std140 blocks shared by the shaders, mirrored by FrameUniforms and ObjectUniforms in RenderSystem.h
+// Updated once per frame
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
+// Per draw, bound by range from a ring buffer
+layout (std140, binding = 1) uniform ObjectData
+{
+    // For packed meshes the dequantization transform is folded in
+    mat4 model;
+    // UV offset in xy and extent in zw
+    vec4 uvTransform;
+};
@@ -83,6 +83,18 @@ float AABB::GetLongestEdge() const { return glm::compMax(GetDiagonal()); }
 
 float AABB::GetShortestEdge() const { return glm::compMin(GetDiagonal()); }
 
+AABB AABB::Transformed(const glm::mat4& transform) const {
+	if (IsNull()) return *this;
+
+	const auto center{ glm::vec3(transform * glm::vec4(GetCenter(), 1.0f)) };
+	const auto halfExtent{ GetDiagonal() * 0.5f };
+	glm::vec3 extent{ 0.0f };
+	for (auto col = 0; col < 3; ++col) {
+		extent += glm::abs(glm::vec3(transform[col])) * halfExtent[col];
+	}
+	return AABB(center - extent, center + extent);
+}
+
 glm::vec3 AABB::GetCenter() const {
 	if (!IsNull()) {
 		glm::vec3 d = GetDiagonal();
@@ -4,6 +4,7 @@
 #define IAUNS_GLM_AABB_HPP
 
 #include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
 
 /// Standalone axis aligned bounding box implemented built on top of GLM.
 class AABB {
@@ -20,6 +21,7 @@ public:
 	AABB(const glm::vec3& p1, const glm::vec3& p2);
 
 	AABB(const AABB& aabb);
+	AABB& operator=(const AABB& aabb) = default;
 
 	/// Set the AABB as NULL (not set).
 	void SetNull() {
@@ -61,6 +63,10 @@ public:
 	///                    be the center of the AABB.
 	void Scale(const glm::vec3& scale, const glm::vec3& origin);
 
+	/// Returns the AABB enclosing this one after an affine \p transform (Arvo's method).
+	/// A NULL AABB stays NULL.
+	AABB Transformed(const glm::mat4& transform) const;
+
 	/// Retrieves the center of the AABB.
 	glm::vec3 GetCenter() const;
 
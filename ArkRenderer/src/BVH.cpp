@@ -0,0 +1,400 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+constexpr std::uint32_t NO_PARENT{ std::numeric_limits<std::uint32_t>::max() };
+
+/***********************************************************************************/
+static float halfSurfaceArea(const glm::vec3& min, const glm::vec3& max) {
+	const auto d{ glm::max(max - min, glm::vec3(0.0f)) };
+	return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+/***********************************************************************************/
+void BVH::Build(const std::vector<AABB>& bounds) {
+	const auto count{ static_cast<std::uint32_t>(bounds.size()) };
+	m_primitiveMin.resize(count);
+	m_primitiveMax.resize(count);
+	m_primitiveIndices.clear();
+	m_primitiveIndices.reserve(count);
+	m_unbounded.clear();
+	for (std::uint32_t i = 0; i < count; ++i) {
+		// Null boxes have no place in the tree, a point at the origin would get them culled with it
+		if (bounds[i].IsNull()) {
+			m_primitiveMin[i] = glm::vec3(1.0f);
+			m_primitiveMax[i] = glm::vec3(-1.0f);
+			m_unbounded.push_back(i);
+			continue;
+		}
+		m_primitiveMin[i] = bounds[i].GetMin();
+		m_primitiveMax[i] = bounds[i].GetMax();
+		m_primitiveIndices.push_back(i);
+	}
+	m_primitiveLeaf.assign(count, NO_PARENT);
+
+	m_nodes.clear();
+	m_parents.clear();
+	m_anyDirty = false;
+	m_rebuildPending = false;
+	const auto treeCount{ static_cast<std::uint32_t>(m_primitiveIndices.size()) };
+	if (treeCount == 0) {
+		m_dirty.clear();
+		return;
+	}
+
+	// A binary tree with leaves of at least one primitive never has more than 2n - 1 nodes
+	m_nodes.reserve(static_cast<std::size_t>(treeCount) * 2 - 1);
+	m_parents.reserve(static_cast<std::size_t>(treeCount) * 2 - 1);
+	m_nodes.emplace_back();
+	m_parents.push_back(NO_PARENT);
+	Subdivide(0, 0, treeCount, 0);
+	m_dirty.assign(m_nodes.size(), 0);
+}
+
+/***********************************************************************************/
+void BVH::ComputeLeafBounds(Node& node) const {
+	node.Min = glm::vec3(std::numeric_limits<float>::max());
+	node.Max = glm::vec3(std::numeric_limits<float>::lowest());
+	for (auto i = node.LeftOrFirst; i < node.LeftOrFirst + node.Count; ++i) {
+		const auto primitive{ m_primitiveIndices[i] };
+		node.Min = glm::min(node.Min, m_primitiveMin[primitive]);
+		node.Max = glm::max(node.Max, m_primitiveMax[primitive]);
+	}
+}
+
+/***********************************************************************************/
+void BVH::Subdivide(const std::uint32_t nodeIndex, const std::uint32_t first, const std::uint32_t count,
+                    const std::uint32_t depth) {
+	// Nodes are appended while recursing, so never hold a reference across the recursive calls
+	{
+		auto& node{ m_nodes[nodeIndex] };
+		node.LeftOrFirst = first;
+		node.Count = count;
+		ComputeLeafBounds(node);
+	}
+	for (auto i = first; i < first + count; ++i) {
+		m_primitiveLeaf[m_primitiveIndices[i]] = nodeIndex;
+	}
+	if (count == 1) {
+		return;
+	}
+
+	glm::vec3 centroidMin{ std::numeric_limits<float>::max() }, centroidMax{ std::numeric_limits<float>::lowest() };
+	for (auto i = first; i < first + count; ++i) {
+		const auto primitive{ m_primitiveIndices[i] };
+		const auto centroid{ (m_primitiveMin[primitive] + m_primitiveMax[primitive]) * 0.5f };
+		centroidMin = glm::min(centroidMin, centroid);
+		centroidMax = glm::max(centroidMax, centroid);
+	}
+
+	struct Bin {
+		glm::vec3 Min{ std::numeric_limits<float>::max() };
+		glm::vec3 Max{ std::numeric_limits<float>::lowest() };
+		std::uint32_t Count{ 0 };
+	};
+
+	// Cost of a split relative to one box traversal. Leaves cost one intersection per primitive.
+	auto bestCost{ std::numeric_limits<float>::max() };
+	auto bestAxis{ -1 };
+	std::uint32_t bestSplit{ 0 };
+	for (auto axis = 0; axis < 3 && depth < MAX_SAH_DEPTH; ++axis) {
+		const auto extent{ centroidMax[axis] - centroidMin[axis] };
+		if (extent <= 0.0f) {
+			continue;
+		}
+
+		std::array<Bin, BIN_COUNT> bins{};
+		const auto scale{ static_cast<float>(BIN_COUNT) / extent };
+		for (auto i = first; i < first + count; ++i) {
+			const auto primitive{ m_primitiveIndices[i] };
+			const auto centroid{ (m_primitiveMin[primitive][axis] + m_primitiveMax[primitive][axis]) * 0.5f };
+			const auto b{ std::min(BIN_COUNT - 1, static_cast<std::uint32_t>((centroid - centroidMin[axis]) * scale)) };
+			bins[b].Min = glm::min(bins[b].Min, m_primitiveMin[primitive]);
+			bins[b].Max = glm::max(bins[b].Max, m_primitiveMax[primitive]);
+			++bins[b].Count;
+		}
+
+		// Sweep from both sides so every split plane between bins is evaluated in linear time
+		std::array<float, BIN_COUNT - 1> leftArea{}, rightArea{};
+		std::array<std::uint32_t, BIN_COUNT - 1> leftCount{}, rightCount{};
+		Bin left, right;
+		for (std::uint32_t i = 0; i < BIN_COUNT - 1; ++i) {
+			left.Min = glm::min(left.Min, bins[i].Min);
+			left.Max = glm::max(left.Max, bins[i].Max);
+			left.Count += bins[i].Count;
+			leftCount[i] = left.Count;
+			leftArea[i] = left.Count > 0 ? halfSurfaceArea(left.Min, left.Max) : 0.0f;
+
+			const auto r{ BIN_COUNT - 1 - i };
+			right.Min = glm::min(right.Min, bins[r].Min);
+			right.Max = glm::max(right.Max, bins[r].Max);
+			right.Count += bins[r].Count;
+			rightCount[r - 1] = right.Count;
+			rightArea[r - 1] = right.Count > 0 ? halfSurfaceArea(right.Min, right.Max) : 0.0f;
+		}
+
+		for (std::uint32_t i = 0; i < BIN_COUNT - 1; ++i) {
+			const auto cost{ leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i] };
+			if (leftCount[i] > 0 && rightCount[i] > 0 && cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i + 1;
+			}
+		}
+	}
+
+	const auto& node{ m_nodes[nodeIndex] };
+	const auto nodeArea{ halfSurfaceArea(node.Min, node.Max) };
+	const auto leafCost{ static_cast<float>(count) * nodeArea };
+	// Split cost in the same units as leafCost: one traversal step plus the children's expected intersections
+	const auto splitCost{ nodeArea + bestCost };
+	if (count <= MAX_LEAF_SIZE && (bestAxis < 0 || splitCost >= leafCost || depth >= MAX_SAH_DEPTH)) {
+		return;
+	}
+
+	auto* begin{ m_primitiveIndices.data() + first };
+	auto* end{ begin + count };
+	auto* middle{ begin + count / 2 };
+	if (bestAxis >= 0) {
+		const auto extent{ centroidMax[bestAxis] - centroidMin[bestAxis] };
+		const auto scale{ static_cast<float>(BIN_COUNT) / extent };
+		const auto axis{ bestAxis };
+		const auto splitMin{ centroidMin[axis] };
+		middle = std::partition(begin, end, [&](const std::uint32_t primitive) {
+			const auto centroid{ (m_primitiveMin[primitive][axis] + m_primitiveMax[primitive][axis]) * 0.5f };
+			return std::min(BIN_COUNT - 1, static_cast<std::uint32_t>((centroid - splitMin) * scale)) < bestSplit;
+		});
+	}
+	// Identical centroids give SAH nothing to work with (and deep nodes skip it), halve the range so leaves stay small
+	if (middle == begin || middle == end) {
+		middle = begin + count / 2;
+	}
+
+	const auto leftCount{ static_cast<std::uint32_t>(middle - begin) };
+	const auto leftChild{ static_cast<std::uint32_t>(m_nodes.size()) };
+	m_nodes[nodeIndex].LeftOrFirst = leftChild;
+	m_nodes[nodeIndex].Count = 0;
+	m_nodes.emplace_back();
+	m_nodes.emplace_back();
+	m_parents.push_back(nodeIndex);
+	m_parents.push_back(nodeIndex);
+
+	Subdivide(leftChild, first, leftCount, depth + 1);
+	Subdivide(leftChild + 1, first + leftCount, count - leftCount, depth + 1);
+}
+
+/***********************************************************************************/
+void BVH::UpdatePrimitive(const std::uint32_t primitive, const AABB& bounds) {
+	const auto unbounded{ m_primitiveLeaf[primitive] == NO_PARENT };
+	m_primitiveMin[primitive] = bounds.IsNull() ? glm::vec3(1.0f) : bounds.GetMin();
+	m_primitiveMax[primitive] = bounds.IsNull() ? glm::vec3(-1.0f) : bounds.GetMax();
+	if (bounds.IsNull() != unbounded) {
+		m_rebuildPending = true;
+		return;
+	}
+	if (unbounded) {
+		return;
+	}
+
+	// Mark the path to the root, stopping where another update already did
+	for (auto node = m_primitiveLeaf[primitive]; node != NO_PARENT && !m_dirty[node]; node = m_parents[node]) {
+		m_dirty[node] = 1;
+	}
+	m_anyDirty = true;
+}
+
+/***********************************************************************************/
+std::size_t BVH::Refit() {
+	if (m_rebuildPending) {
+		std::vector<AABB> bounds;
+		bounds.reserve(GetPrimitiveCount());
+		for (std::uint32_t i = 0; i < GetPrimitiveCount(); ++i) {
+			bounds.push_back(GetPrimitiveBounds(i));
+		}
+		Build(bounds);
+		return m_nodes.size();
+	}
+	if (!m_anyDirty) {
+		return 0;
+	}
+
+	// Children always come after their parent, so walking backwards finishes both children before the parent
+	std::size_t refitCount{ 0 };
+	for (auto i = m_nodes.size(); i-- > 0;) {
+		if (!m_dirty[i]) {
+			continue;
+		}
+		auto& node{ m_nodes[i] };
+		if (node.IsLeaf()) {
+			ComputeLeafBounds(node);
+		}
+		else {
+			const auto& left{ m_nodes[node.LeftOrFirst] };
+			const auto& right{ m_nodes[node.LeftOrFirst + 1] };
+			node.Min = glm::min(left.Min, right.Min);
+			node.Max = glm::max(left.Max, right.Max);
+		}
+		m_dirty[i] = 0;
+		++refitCount;
+	}
+	m_anyDirty = false;
+	return refitCount;
+}
+
+/***********************************************************************************/
+void BVH::AppendSubtree(const std::uint32_t nodeIndex, std::vector<std::uint32_t>& out) const {
+	// Leaves of a subtree cover one contiguous range of the primitive index list. Find it from the outermost leaves.
+	auto leftmost{ nodeIndex };
+	while (!m_nodes[leftmost].IsLeaf()) {
+		leftmost = m_nodes[leftmost].LeftOrFirst;
+	}
+	auto rightmost{ nodeIndex };
+	while (!m_nodes[rightmost].IsLeaf()) {
+		rightmost = m_nodes[rightmost].LeftOrFirst + 1;
+	}
+	const auto first{ m_nodes[leftmost].LeftOrFirst };
+	const auto last{ m_nodes[rightmost].LeftOrFirst + m_nodes[rightmost].Count };
+	out.insert(out.end(), m_primitiveIndices.begin() + first, m_primitiveIndices.begin() + last);
+}
+
+/***********************************************************************************/
+void BVH::QueryFrustum(const Frustum& frustum, std::vector<std::uint32_t>& inside,
+                       std::vector<std::uint32_t>& boundary) const {
+	inside.insert(inside.end(), m_unbounded.begin(), m_unbounded.end());
+	if (m_nodes.empty()) {
+		return;
+	}
+
+	std::uint32_t stack[MAX_DEPTH + 1];
+	auto stackSize{ 0 };
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const auto nodeIndex{ stack[--stackSize] };
+		const auto& node{ m_nodes[nodeIndex] };
+		const auto containment{ frustum.Classify(node.Min, node.Max) };
+		if (containment == Frustum::Containment::Outside) {
+			continue;
+		}
+		if (containment == Frustum::Containment::Inside) {
+			AppendSubtree(nodeIndex, inside);
+			continue;
+		}
+		if (node.IsLeaf()) {
+			boundary.insert(boundary.end(), m_primitiveIndices.begin() + node.LeftOrFirst,
+			                m_primitiveIndices.begin() + node.LeftOrFirst + node.Count);
+			continue;
+		}
+		stack[stackSize++] = node.LeftOrFirst + 1;
+		stack[stackSize++] = node.LeftOrFirst;
+	}
+}
+
+/***********************************************************************************/
+void BVH::QueryFrustum(const Frustum& frustum, std::vector<std::uint32_t>& visible) const {
+	std::vector<std::uint32_t> boundary;
+	QueryFrustum(frustum, visible, boundary);
+	for (const auto primitive : boundary) {
+		if (frustum.Classify(m_primitiveMin[primitive], m_primitiveMax[primitive]) != Frustum::Containment::Outside) {
+			visible.push_back(primitive);
+		}
+	}
+}
+
+/***********************************************************************************/
+void BVH::QuerySphere(const glm::vec3& center, const float radius, std::vector<std::uint32_t>& out) const {
+	out.insert(out.end(), m_unbounded.begin(), m_unbounded.end());
+	if (m_nodes.empty()) {
+		return;
+	}
+
+	const auto overlaps = [&center, radiusSq = radius * radius](const glm::vec3& min, const glm::vec3& max) {
+		const auto closest{ glm::clamp(center, min, max) };
+		const auto d{ closest - center };
+		return glm::dot(d, d) <= radiusSq;
+	};
+
+	std::uint32_t stack[MAX_DEPTH + 1];
+	auto stackSize{ 0 };
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const auto& node{ m_nodes[stack[--stackSize]] };
+		if (!overlaps(node.Min, node.Max)) {
+			continue;
+		}
+		if (!node.IsLeaf()) {
+			stack[stackSize++] = node.LeftOrFirst + 1;
+			stack[stackSize++] = node.LeftOrFirst;
+			continue;
+		}
+		for (auto i = node.LeftOrFirst; i < node.LeftOrFirst + node.Count; ++i) {
+			const auto primitive{ m_primitiveIndices[i] };
+			if (overlaps(m_primitiveMin[primitive], m_primitiveMax[primitive])) {
+				out.push_back(primitive);
+			}
+		}
+	}
+}
+
+/***********************************************************************************/
+std::optional<BVH::RayHit> BVH::Raycast(const glm::vec3& origin, const glm::vec3& direction,
+                                        const float maxDistance) const {
+	if (m_nodes.empty()) {
+		return std::nullopt;
+	}
+
+	// Slab test. Division by a zero component gives +-inf, which the min/max below handle.
+	const auto inverseDirection{ 1.0f / direction };
+	const auto intersect = [&](const glm::vec3& min, const glm::vec3& max, const float closest) {
+		const auto t0{ (min - origin) * inverseDirection };
+		const auto t1{ (max - origin) * inverseDirection };
+		const auto tNear{ glm::min(t0, t1) };
+		const auto tFar{ glm::max(t0, t1) };
+		const auto enter{ std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f)) };
+		const auto exit{ std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, closest)) };
+		return enter <= exit ? enter : std::numeric_limits<float>::max();
+	};
+
+	std::optional<RayHit> hit;
+	auto closest{ maxDistance };
+	std::uint32_t stack[MAX_DEPTH + 1];
+	auto stackSize{ 0 };
+	if (intersect(m_nodes[0].Min, m_nodes[0].Max, closest) == std::numeric_limits<float>::max()) {
+		return hit;
+	}
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const auto& node{ m_nodes[stack[--stackSize]] };
+		if (node.IsLeaf()) {
+			for (auto i = node.LeftOrFirst; i < node.LeftOrFirst + node.Count; ++i) {
+				const auto primitive{ m_primitiveIndices[i] };
+				const auto t{ intersect(m_primitiveMin[primitive], m_primitiveMax[primitive], closest) };
+				if (t != std::numeric_limits<float>::max() && t <= closest) {
+					closest = t;
+					hit = RayHit{ primitive, t };
+				}
+			}
+			continue;
+		}
+
+		// Visit the nearer child first so the closest hit shrinks the search early
+		auto nearChild{ node.LeftOrFirst };
+		auto farChild{ node.LeftOrFirst + 1 };
+		auto nearT{ intersect(m_nodes[nearChild].Min, m_nodes[nearChild].Max, closest) };
+		auto farT{ intersect(m_nodes[farChild].Min, m_nodes[farChild].Max, closest) };
+		if (farT < nearT) {
+			std::swap(nearChild, farChild);
+			std::swap(nearT, farT);
+		}
+		if (farT != std::numeric_limits<float>::max()) {
+			stack[stackSize++] = farChild;
+		}
+		if (nearT != std::numeric_limits<float>::max()) {
+			stack[stackSize++] = nearChild;
+		}
+	}
+	return hit;
+}
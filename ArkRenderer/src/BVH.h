@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include <glm/vec3.hpp>
+
+#include "AABB.h"
+#include "Frustum.h"
+
+// Bounding volume hierarchy over world-space primitive bounds, built top-down with binned SAH.
+// Primitives are plain ids (the index of their bounds in Build), the owner maps them back to meshes. Primitives with
+// null bounds, e.g. meshes that never computed theirs, are kept out of the tree and count as unbounded: frustum and
+// sphere queries always report them, rays never hit them.
+// Nodes live in one flat array with both children of a node next to each other, and every child is stored
+// after its parent, so refits are a single reverse sweep.
+class BVH
+{
+public:
+	struct Node
+	{
+		glm::vec3 Min;
+		// Leaf: first entry in the primitive index list. Inner node: index of the left child, the right one follows it.
+		std::uint32_t LeftOrFirst{ 0 };
+		glm::vec3 Max;
+		// Number of primitives in a leaf, 0 for inner nodes
+		std::uint32_t Count{ 0 };
+
+		[[nodiscard]] bool IsLeaf() const noexcept { return Count > 0; }
+	};
+
+	struct RayHit
+	{
+		std::uint32_t Primitive{ 0 };
+		// Distance along the ray to where it enters the primitive's bounds, 0 if it starts inside
+		float Distance{ 0.0f };
+	};
+
+	static constexpr std::uint32_t BIN_COUNT{ 12 };
+	static constexpr std::uint32_t MAX_LEAF_SIZE{ 4 };
+	// Past this depth nodes are split at the median instead of by SAH, which bounds the traversal stacks
+	static constexpr std::uint32_t MAX_SAH_DEPTH{ 32 };
+	static constexpr std::uint32_t MAX_DEPTH{ 64 };
+
+	// Rebuilds the tree from scratch. Primitive i is bounds[i].
+	void Build(const std::vector<AABB>& bounds);
+	// Changes one primitive's bounds. The tree is only consistent again after the next Refit, which rebuilds it if the
+	// primitive went from null to bounded bounds or back.
+	void UpdatePrimitive(std::uint32_t primitive, const AABB& bounds);
+	// Recomputes the bounds of every node above a primitive updated since the last refit. Returns the number of
+	// nodes touched. The topology stays the same, so rebuild when primitives have moved far.
+	std::size_t Refit();
+
+	// Appends primitives whose subtree lies entirely inside the frustum to inside, and those in leaves crossing a
+	// plane to boundary, so the caller can test the latter precisely (e.g. in one Frustum::Cull batch).
+	void QueryFrustum(const Frustum& frustum, std::vector<std::uint32_t>& inside, std::vector<std::uint32_t>& boundary) const;
+	// Appends every primitive whose bounds are at least partially inside the frustum
+	void QueryFrustum(const Frustum& frustum, std::vector<std::uint32_t>& visible) const;
+	// Appends every primitive whose bounds overlap the sphere
+	void QuerySphere(const glm::vec3& center, float radius, std::vector<std::uint32_t>& out) const;
+	// Closest primitive whose bounds the ray hits within maxDistance. direction does not need to be normalized,
+	// distances are in units of its length.
+	[[nodiscard]] std::optional<RayHit> Raycast(const glm::vec3& origin, const glm::vec3& direction,
+	                                            float maxDistance) const;
+
+	[[nodiscard]] const auto& GetNodes() const noexcept { return m_nodes; }
+	[[nodiscard]] std::size_t GetPrimitiveCount() const noexcept { return m_primitiveMin.size(); }
+	// Null for unbounded primitives
+	[[nodiscard]] AABB GetPrimitiveBounds(const std::uint32_t primitive) const {
+		return m_primitiveMin[primitive].x > m_primitiveMax[primitive].x ? AABB()
+			: AABB(m_primitiveMin[primitive], m_primitiveMax[primitive]);
+	}
+
+private:
+	void Subdivide(std::uint32_t nodeIndex, std::uint32_t first, std::uint32_t count, std::uint32_t depth);
+	void ComputeLeafBounds(Node& node) const;
+	void AppendSubtree(std::uint32_t nodeIndex, std::vector<std::uint32_t>& out) const;
+
+	std::vector<Node> m_nodes;
+	std::vector<std::uint32_t> m_parents;
+	// Node dirty flags for the next refit
+	std::vector<std::uint8_t> m_dirty;
+	bool m_anyDirty{ false };
+	// A primitive moved in or out of the tree, the next refit rebuilds
+	bool m_rebuildPending{ false };
+	// Leaves reference ranges of this list, which is permuted during the build
+	std::vector<std::uint32_t> m_primitiveIndices;
+	std::vector<std::uint32_t> m_primitiveLeaf;
+	// Unbounded primitives store min > max
+	std::vector<glm::vec3> m_primitiveMin, m_primitiveMax;
+	// Primitives with null bounds, not in any leaf
+	std::vector<std::uint32_t> m_unbounded;
+};
@@ -41,6 +41,7 @@ void ArkEngine::Execute()
 {
 	float deltaTime = 0.0f;
 	float lastFrame = 0.0f;
+	float lastStatsReport = 0.0f;
 	while (!m_window.ShouldClose())
 	{
 		float currentFrame = static_cast<float>(glfwGetTime());
@@ -51,6 +52,20 @@ void ArkEngine::Execute()
 		m_camera.Update(deltaTime);
 		m_renderer.Render(m_camera);
 		m_window.SwapBuffers();
+		if (currentFrame - lastStatsReport >= 1.0f)
+		{
+			const auto& culling = m_renderer.GetCullingStats();
+			std::cout << "Frustum culling: " << culling.Visible << " meshes visible, " << culling.Culled << " culled\n";
+			const auto& queue = m_renderer.GetRenderQueueStats();
+			if (queue.Packets > 0)
+			{
+				std::cout << "Render queue: " << queue.Packets << " draws sorted, " << queue.Binds << " binds, "
+					<< queue.BindsAvoided << " redundant binds skipped\n";
+				const auto& draws = m_renderer.GetDrawStats();
+				std::cout << "Draw calls: " << draws.DrawCalls << ", " << draws.Instances << " meshes drawn instanced\n";
+			}
+			lastStatsReport = currentFrame;
+		}
 	}
 	Shutdown();
 }
@@ -2,6 +2,10 @@
 #include <iostream>
 #include <GLFW/glfw3.h>
 #include <array>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
 #include "../ResourceManager.h"
 #include <glm/gtx/string_cast.hpp>
 #include "../Graphics/ShaderStage.h"
@@ -9,6 +13,7 @@
 #include "../Graphics/GLShaderProgramFactory.h"
 #include "../Model.h"
 #include "../Camera.h"
+#include "../Input.h"
 
 void RenderSystem::SetDefaultState()
 {
@@ -38,55 +43,170 @@ void RenderSystem::Init()
 		std::cerr << "Failed to start GLAD.";
 		std::abort();
 	}
+	Graphics::GLShaderProgramFactory::InitParallelCompile(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+	MeshBatch::InitBindlessTextures(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
 	CompileShader();
+	m_shaderReloader.Start();
 	SetupTextureSamplers();
+	SetupUniformBuffers();
 	SetupScreenQuad();
-	auto& modelShader = m_shaderCache.at("ModelShader");
-	modelShader.Bind();
-	modelShader.SetUniformi("diffuseMap", 1);
-	auto model = ResourceManager::GetInstance().GetModel("backpack", "resource/models/backpack/backpack.obj");
+	for (const auto& [name, shader] : m_shaderCache)
+	{
+		InitShaderUniforms(name);
+	}
+	auto model = ResourceManager::GetInstance().GetModel("backpack", "resource/models/backpack/backpack.obj", m_sceneLayout);
 	model->Translate(glm::vec3(0.0f, 0.0f, 0.0f));
 	model->Scale(glm::vec3(1.0f, 1.0f, 1.0f));
 	m_models.emplace_back(model);
-	
+	std::cout << "Texture disk cache: " << ResourceManager::GetInstance().GetNumTextureCacheHits() << " hits, "
+		<< ResourceManager::GetInstance().GetNumTextureCacheMisses() << " misses\n";
+	std::cout << "Textures resident: " << ResourceManager::GetInstance().GetNumLoadedTextures() << " ("
+		<< ResourceManager::GetInstance().GetTextureBytesResident() / 1024 << " KiB), duplicate loads avoided: "
+		<< ResourceManager::GetInstance().GetNumDuplicateTexturesAvoided() << "\n";
+	std::cout << "Buffers resident: " << GLBuffer::GetNumLive() << " (" << GLBuffer::GetBytesLive() / 1024 << " KiB)\n";
 
 }
 
 void RenderSystem::Render(const Camera& camera)
 {
 	SetDefaultState();
+	UpdateFrameUniforms(camera);
+	if (Input::GetInstance().IsKeyPressed(GLFW_KEY_F2))
+	{
+		BenchmarkVertexLayouts(camera);
+	}
+	if (Input::GetInstance().IsKeyPressed(GLFW_KEY_F3))
+	{
+		BenchmarkBVH(camera);
+	}
+	if (Input::GetInstance().IsKeyPressed(GLFW_KEY_F4))
+	{
+		BenchmarkUniformUpdates(camera);
+	}
+	if (Input::GetInstance().IsKeyPressed(GLFW_KEY_F5))
+	{
+		BenchmarkMultiDraw(camera);
+	}
+	if (Input::GetInstance().IsKeyPressed(GLFW_KEY_F6))
+	{
+		m_useMultiDraw = !m_useMultiDraw;
+		std::cout << "Multi-draw indirect: " << (m_useMultiDraw ? "on" : "off") << "\n";
+	}
+	if (Input::GetInstance().IsKeyPressed(GLFW_KEY_F7))
+	{
+		m_useInstancing = !m_useInstancing;
+		std::cout << "Instancing: " << (m_useInstancing ? "on" : "off") << "\n";
+	}
+	if (Input::GetInstance().IsKeyPressed(GLFW_KEY_F8))
+	{
+		BenchmarkInstancing(camera);
+	}
+	// Edited shaders are swapped in between frames, a frame always draws with a complete program
+	for (const auto& name : m_shaderReloader.Update(m_shaderCache))
+	{
+		InitShaderUniforms(name);
+	}
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	auto& modelShader = m_shaderCache.at("ModelShader");
-	modelShader.Bind();
-	modelShader.SetUniform("view", camera.GetViewMatrix());
-	modelShader.SetUniform("projection", camera.GetProjMatrix(1024, 768));
-	RenderModelsWithTextures(modelShader, m_models.cbegin(), m_models.cend());
+	CullMeshes(camera.GetProjMatrix(1024, 768) * camera.GetViewMatrix(), m_models.cbegin(), m_models.cend());
+	if (m_useMultiDraw && UpdateMeshBatch())
+	{
+		GetMultiDrawShader().Bind();
+		glBindSampler(1, m_samplerPBRTextures);
+		m_meshBatch.Draw(m_models, m_meshVisibility);
+		glBindSampler(1, 0);
+		m_renderQueue.Clear();
+		m_drawStats = {};
+	}
+	else
+	{
+		auto& modelShader = m_shaderCache.at(m_sceneLayout == VertexLayout::Packed ? "PackedModelShader" : "ModelShader");
+		RenderModelsWithTextures(modelShader, camera.GetPosition(), m_models.cbegin(), m_models.cend(),
+			m_useInstancing ? &GetInstancedShader() : nullptr);
+	}
+	m_objectUniforms.EndFrame();
 	//RenderQuad();
 }
 
 void RenderSystem::CompileShader()
 {
 	m_shaderCache.clear();
-	std::vector<Graphics::ShaderStage> stages;
-	Graphics::ShaderStage stage{
-		"resource/shaders/model_loadingvs.glsl", "vertex"
-	};
-	stages.emplace_back(stage);
-	stages.emplace_back(Graphics::ShaderStage{
-		"resource/shaders/model_loadingps.glsl", "fragment"
-	});
-	const std::string name = "ModelShader";
-	auto shaderProgram{
-		Graphics::GLShaderProgramFactory::CreateShaderProgram(name, stages)
-	};
+	std::vector<std::array<std::string, 3>> programs{{
+		{ "ModelShader", "resource/shaders/model_loadingvs.glsl", "resource/shaders/model_loadingps.glsl" },
+		{ "PackedModelShader", "resource/shaders/model_loading_packedvs.glsl", "resource/shaders/model_loadingps.glsl" },
+		{ "MultiDrawModelShader", "resource/shaders/model_multidrawvs.glsl", "resource/shaders/model_loadingps.glsl" },
+		{ "InstancedModelShader", "resource/shaders/model_instancedvs.glsl", "resource/shaders/model_loadingps.glsl" },
+		{ "PackedInstancedModelShader", "resource/shaders/model_instanced_packedvs.glsl", "resource/shaders/model_loadingps.glsl" },
+		{ "DepthShader", "resource/shaders/shadowdepthvs.glsl", "resource/shaders/shadowdepthps.glsl" },
+		{ "DepthBlockShader", "resource/shaders/shadowdepth_blockvs.glsl", "resource/shaders/shadowdepthps.glsl" }
+	}};
+	// Requires the extension in the shader, so it is only built where the driver has it
+	if (MeshBatch::HasBindlessTextures())
+	{
+		programs.push_back({ "MultiDrawBindlessModelShader", "resource/shaders/model_multidrawvs.glsl",
+			"resource/shaders/model_multidraw_bindlessps.glsl" });
+	}
+	// Every program is handed to the driver before any result is read, so with parallel compile they build
+	// concurrently
+	const auto start{ std::chrono::high_resolution_clock::now() };
+	std::vector<Graphics::PendingShaderProgram> pendingPrograms;
+	for (const auto& [name, vertexPath, fragmentPath] : programs)
+	{
+		std::vector<Graphics::ShaderStage> stages;
+		stages.emplace_back(Graphics::ShaderStage{ vertexPath, "vertex" });
+		stages.emplace_back(Graphics::ShaderStage{ fragmentPath, "fragment" });
+		m_shaderReloader.Watch(name, stages);
+		std::cout << "Building shader program " << name << std::endl;
+		const auto sources{ Graphics::GLShaderProgramFactory::LoadShaderSources(stages) };
+		if (sources)
+		{
+			pendingPrograms.push_back(Graphics::GLShaderProgramFactory::BeginShaderProgram(name, sources.value()));
+		}
+	}
+	for (auto& pending : pendingPrograms)
+	{
+		auto shaderProgram{ Graphics::GLShaderProgramFactory::FinishShaderProgram(pending) };
+		if (shaderProgram)
+		{
+			m_shaderCache.try_emplace(pending.m_programName, std::move(shaderProgram.value()));
+		}
+	}
+	const std::chrono::duration<double, std::milli> elapsed{ std::chrono::high_resolution_clock::now() - start };
+	const auto& binaryStats{ Graphics::GLShaderProgramFactory::GetProgramBinaryStats() };
+	std::cout << "Shaders: " << m_shaderCache.size() << " of " << programs.size() << " programs built in "
+		<< elapsed.count() << " ms\n";
+	std::cout << "Program binary cache: " << binaryStats.Hits << " hits, " << binaryStats.Misses << " misses ("
+		<< binaryStats.Rejected << " rejected by the driver), " << binaryStats.MillisecondsSaved << " ms saved\n";
+}
 
-	if (shaderProgram)
+void RenderSystem::InitShaderUniforms(const std::string& name)
+{
+	if (name == "ModelShader" || name == "PackedModelShader" || name == "MultiDrawModelShader" ||
+		name == "InstancedModelShader" || name == "PackedInstancedModelShader")
 	{
-		m_shaderCache.try_emplace(name, std::move(shaderProgram.value()));
-		// value_or for default and remove if-check?
+		auto& modelShader = m_shaderCache.at(name);
+		modelShader.Bind();
+		modelShader.SetUniformi("diffuseMap", 1);
 	}
 }
 
+void RenderSystem::SetupUniformBuffers()
+{
+	static_assert(sizeof(FrameUniforms) == 208 && sizeof(ObjectUniforms) == 80, "Uniform structs must match std140");
+	m_frameUniformBuffer.Init(sizeof(FrameUniforms), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	m_objectUniforms.Init(OBJECT_UNIFORM_RING_SIZE);
+}
+
+void RenderSystem::UpdateFrameUniforms(const Camera& camera)
+{
+	FrameUniforms frame;
+	frame.View = camera.GetViewMatrix();
+	frame.Projection = camera.GetProjMatrix(1024, 768);
+	frame.ViewProjection = frame.Projection * frame.View;
+	frame.CameraPosition = glm::vec4(camera.GetPosition(), 1.0f);
+	m_frameUniformBuffer.Update(0, sizeof(FrameUniforms), &frame);
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, m_frameUniformBuffer.GetId());
+}
+
 void RenderSystem::SetupScreenQuad()
 {
 	const std::array<Vertex, 4> screenQuadVertices{
@@ -97,15 +217,9 @@ void RenderSystem::SetupScreenQuad()
 		Vertex({1.0f, -1.0f, 0.0f}, {1.0f, 0.0f})
 	};
 	m_quadVao.Init();
-	m_quadVao.Bind();
-	m_quadVao.AttachBuffer(GLVertexArray::BufferType::Array,
-	                       sizeof(Vertex) * screenQuadVertices.size(),
-	                       GLVertexArray::DrawMode::Static,
-	                       screenQuadVertices.data());
-	m_quadVao.EnableAttribute(0, 3, sizeof(Vertex), nullptr);
-	m_quadVao.EnableAttribute(1, 2, sizeof(Vertex),
-	                          reinterpret_cast<void*>(offsetof(
-		                          Vertex, m_texCoords)));
+	m_quadVao.AttachBuffer(0, sizeof(Vertex) * screenQuadVertices.size(), screenQuadVertices.data(), sizeof(Vertex));
+	m_quadVao.SetAttribute(0, 3, offsetof(Vertex, m_position), 0);
+	m_quadVao.SetAttribute(1, 2, offsetof(Vertex, m_texCoords), 0);
 }
 
 void RenderSystem::RenderQuad() const
@@ -121,14 +235,21 @@ void RenderSystem::RenderModelsNoTextures(GLShaderProgram& shader,
 const
 {
 	auto begin{renderListBegin};
+	const auto modelUniform{ shader.GetUniformHandle("model") };
 
 	while (begin != renderListEnd)
 	{
-		shader.SetUniform("model", (*begin)->GetModelMatrix());
+		const auto modelMatrix{ (*begin)->GetModelMatrix() };
+		shader.SetUniform(modelUniform, modelMatrix);
 		const auto& meshes{(*begin)->GetMeshes()};
 		for (const auto& mesh : meshes)
 		{
-			mesh.m_vao.Bind();
+			if (mesh.m_layout == VertexLayout::Packed)
+			{
+				shader.SetUniform(modelUniform, modelMatrix * mesh.m_dequantize);
+			}
+			// Only the position stream is needed without textures
+			mesh.m_positionVao.Bind();
 			glDrawElements(GL_TRIANGLES, static_cast<int>(mesh.m_indexCount),
 			               GL_UNSIGNED_INT, nullptr);
 			glBindTexture(GL_TEXTURE_2D, 0);
@@ -138,32 +259,518 @@ const
 	}
 }
 
-void RenderSystem::RenderModelsWithTextures(GLShaderProgram& shader, RenderListIterator renderListBegin, RenderListIterator renderListEnd) const
+void RenderSystem::UpdateSceneBvh(RenderListIterator renderListBegin, RenderListIterator renderListEnd)
+{
+	const auto modelCount{ static_cast<std::size_t>(std::distance(renderListBegin, renderListEnd)) };
+	auto rebuild{ modelCount != m_bvhModels.size() };
+	for (std::size_t m = 0; m < modelCount && !rebuild; ++m) {
+		// A model that gained or lost meshes shifts the primitive ids of every mesh after it
+		rebuild = renderListBegin[m].get() != m_bvhModels[m] || renderListBegin[m]->GetMeshes().size() != m_bvhMeshCounts[m];
+	}
+
+	if (rebuild) {
+		std::vector<AABB> bounds;
+		m_bvhModels.clear();
+		m_bvhMeshCounts.clear();
+		m_bvhTransformVersions.clear();
+		for (auto model = renderListBegin; model != renderListEnd; ++model) {
+			const auto modelMatrix{ (*model)->GetModelMatrix() };
+			for (const auto& mesh : (*model)->GetMeshes()) {
+				bounds.push_back(mesh.m_aabb.Transformed(modelMatrix));
+			}
+			m_bvhModels.push_back(model->get());
+			m_bvhMeshCounts.push_back((*model)->GetMeshes().size());
+			m_bvhTransformVersions.push_back((*model)->GetTransformVersion());
+		}
+		m_sceneBvh.Build(bounds);
+		return;
+	}
+
+	std::uint32_t firstMesh{ 0 };
+	for (std::size_t m = 0; m < modelCount; ++m) {
+		const auto& model{ renderListBegin[m] };
+		const auto& meshes{ model->GetMeshes() };
+		if (model->GetTransformVersion() != m_bvhTransformVersions[m]) {
+			const auto modelMatrix{ model->GetModelMatrix() };
+			for (std::uint32_t i = 0; i < meshes.size(); ++i) {
+				m_sceneBvh.UpdatePrimitive(firstMesh + i, meshes[i].m_aabb.Transformed(modelMatrix));
+			}
+			m_bvhTransformVersions[m] = model->GetTransformVersion();
+		}
+		firstMesh += static_cast<std::uint32_t>(meshes.size());
+	}
+	m_sceneBvh.Refit();
+}
+
+void RenderSystem::CullMeshes(const glm::mat4& viewProjection, RenderListIterator renderListBegin, RenderListIterator renderListEnd)
 {
+	UpdateSceneBvh(renderListBegin, renderListEnd);
+
+	const Frustum frustum(viewProjection);
+	m_bvhInside.clear();
+	m_bvhBoundary.clear();
+	m_sceneBvh.QueryFrustum(frustum, m_bvhInside, m_bvhBoundary);
+
+	m_meshBounds.Clear();
+	for (const auto mesh : m_bvhBoundary) {
+		m_meshBounds.Push(m_sceneBvh.GetPrimitiveBounds(mesh));
+	}
+	frustum.Cull(m_meshBounds, m_boundaryVisibility);
+
+	m_meshVisibility.assign(m_sceneBvh.GetPrimitiveCount(), 0);
+	for (const auto mesh : m_bvhInside) {
+		m_meshVisibility[mesh] = 1;
+	}
+	for (std::size_t i = 0; i < m_bvhBoundary.size(); ++i) {
+		m_meshVisibility[m_bvhBoundary[i]] = m_boundaryVisibility[i];
+	}
+
+	m_cullingStats.Visible = static_cast<std::size_t>(std::count(m_meshVisibility.cbegin(), m_meshVisibility.cend(), 1));
+	m_cullingStats.Culled = m_meshVisibility.size() - m_cullingStats.Visible;
+}
+
+bool RenderSystem::UpdateMeshBatch()
+{
+	if (m_meshBatch.IsBuiltFrom(m_models))
+	{
+		return true;
+	}
+	if (!m_meshBatch.Build(m_models, m_samplerPBRTextures))
+	{
+		// Mixed or packed layouts, stay on the per-mesh loop until toggled again
+		std::cout << "Multi-draw indirect: scene can't be batched, drawing mesh by mesh\n";
+		m_useMultiDraw = false;
+		return false;
+	}
+	return true;
+}
+
+GLShaderProgram& RenderSystem::GetMultiDrawShader()
+{
+	return m_shaderCache.at(m_meshBatch.IsBindless() ? "MultiDrawBindlessModelShader" : "MultiDrawModelShader");
+}
+
+GLShaderProgram& RenderSystem::GetInstancedShader()
+{
+	return m_shaderCache.at(m_sceneLayout == VertexLayout::Packed ? "PackedInstancedModelShader" : "InstancedModelShader");
+}
+
+void RenderSystem::RenderModelsWithTextures(GLShaderProgram& shader, const glm::vec3& eye,
+                                            RenderListIterator renderListBegin, RenderListIterator renderListEnd,
+                                            GLShaderProgram* instancedShader)
+{
+	m_renderQueue.Clear();
+	m_queuedMeshes.clear();
+	std::uint32_t meshIndex{ 0 };
+	for (auto model = renderListBegin; model != renderListEnd; ++model) {
+		const auto modelMatrix{ (*model)->GetModelMatrix() };
+		for (const auto& mesh : (*model)->GetMeshes()) {
+			// Render list mesh indices are the primitive ids of the scene BVH, which holds the world-space bounds
+			const auto primitive{ meshIndex++ };
+			if (!m_meshVisibility[primitive]) {
+				continue;
+			}
+			RenderQueue::Packet packet;
+			packet.Program = shader.GetProgramId();
+			packet.Material = mesh.Material->GetParameterTexture(PBRMaterial::ALBEDO);
+			packet.Mesh = mesh.m_vao.GetId();
+			packet.Depth = glm::distance(eye, m_sceneBvh.GetPrimitiveBounds(primitive).GetCenter());
+			packet.Blended = mesh.Material->GetAlphaMask() != 0 || mesh.Material->GetAlphaValue() < 1.0f;
+			packet.Payload = static_cast<std::uint32_t>(m_queuedMeshes.size());
+			m_queuedMeshes.emplace_back(&mesh,
+				mesh.m_layout == VertexLayout::Packed ? modelMatrix * mesh.m_dequantize : modelMatrix);
+			m_renderQueue.Push(packet);
+		}
+	}
+	m_renderQueue.Sort();
+
 	glBindSampler(m_samplerPBRTextures, 1);
 	//glBindSampler(m_samplerPBRTextures, 5);
 	//glBindSampler(m_samplerPBRTextures, 6);
+	glActiveTexture(GL_TEXTURE1);
 
-	auto begin{ renderListBegin };
-
-	while (begin != renderListEnd) {
-		shader.SetUniform("model", (*begin)->GetModelMatrix());
-		const auto& meshes{ (*begin)->GetMeshes() };
-		for (const auto& mesh : meshes) {
-			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, mesh.Material->GetParameterTexture(PBRMaterial::ALBEDO));
-			//glActiveTexture(GL_TEXTURE1);
-			//glBindTexture(GL_TEXTURE_2D, mesh.Material->GetParameterTexture(PBRMaterial::NORMAL));
-			//glActiveTexture(GL_TEXTURE2);
-			//glBindTexture(GL_TEXTURE_2D, mesh.Material->GetParameterTexture(PBRMaterial::ROUGHNESS));
-
-			mesh.m_vao.Bind();
-			glDrawElements(GL_TRIANGLES, static_cast<int>(mesh.m_indexCount), GL_UNSIGNED_INT, nullptr);
-			glBindTexture(GL_TEXTURE_2D, 0);
+	m_drawStats = {};
+	GLuint boundProgram{ 0 }, boundTexture{ 0 }, boundVao{ 0 };
+	const auto& packets{ m_renderQueue.GetSortedPackets() };
+	for (std::size_t first = 0; first < packets.size();) {
+		const auto& packet{ packets[first] };
+		// The sort keeps packets of one program, texture and mesh together, blended ones only when they are also
+		// adjacent in depth, so drawing a run in order as instances changes nothing on screen
+		auto last{ first + 1 };
+		if (instancedShader) {
+			while (last < packets.size() && last - first < MAX_INSTANCES_PER_DRAW && packets[last].Program == packet.Program
+				&& packets[last].Material == packet.Material && packets[last].Mesh == packet.Mesh) {
+				++last;
+			}
 		}
-		
-		++begin;
+		const auto instanceCount{ static_cast<GLsizei>(last - first) };
+		const auto* mesh{ m_queuedMeshes[packet.Payload].first };
+		const auto program{ instanceCount > 1 ? instancedShader->GetProgramId() : packet.Program };
+		if (m_renderQueue.Bind(boundProgram, program)) {
+			glUseProgram(program);
+		}
+		if (instanceCount > 1) {
+			m_instanceData.clear();
+			for (auto i = first; i < last; ++i) {
+				const auto& [instanceMesh, modelMatrix] { m_queuedMeshes[packets[i].Payload] };
+				m_instanceData.push_back({ modelMatrix, instanceMesh->m_uvTransform });
+			}
+			const auto size{ static_cast<GLsizeiptr>(m_instanceData.size() * sizeof(ObjectUniforms)) };
+			m_objectUniforms.BindStorageRange(INSTANCE_DATA_BINDING, m_objectUniforms.Push(m_instanceData.data(), size),
+				size);
+		}
+		else {
+			const ObjectUniforms object{ m_queuedMeshes[packet.Payload].second, mesh->m_uvTransform };
+			m_objectUniforms.BindRange(OBJECT_UNIFORM_BINDING, m_objectUniforms.Push(object), sizeof(ObjectUniforms));
+		}
+		if (m_renderQueue.Bind(boundTexture, packet.Material)) {
+			glBindTexture(GL_TEXTURE_2D, packet.Material);
+		}
+		//glActiveTexture(GL_TEXTURE1);
+		//glBindTexture(GL_TEXTURE_2D, mesh.Material->GetParameterTexture(PBRMaterial::NORMAL));
+		//glActiveTexture(GL_TEXTURE2);
+		//glBindTexture(GL_TEXTURE_2D, mesh.Material->GetParameterTexture(PBRMaterial::ROUGHNESS));
+		if (m_renderQueue.Bind(boundVao, packet.Mesh)) {
+			mesh->m_vao.Bind();
+		}
+		if (instanceCount > 1) {
+			glDrawElementsInstanced(GL_TRIANGLES, static_cast<int>(mesh->m_indexCount), GL_UNSIGNED_INT, nullptr,
+				instanceCount);
+			m_drawStats.Instances += instanceCount;
+		}
+		else {
+			glDrawElements(GL_TRIANGLES, static_cast<int>(mesh->m_indexCount), GL_UNSIGNED_INT, nullptr);
+		}
+		++m_drawStats.DrawCalls;
+		first = last;
 	}
+	glBindTexture(GL_TEXTURE_2D, 0);
 	glBindSampler(m_samplerPBRTextures, 0);
 	
 }
+
+void RenderSystem::BenchmarkVertexLayouts(const Camera& camera)
+{
+	constexpr auto iterations = 32;
+	auto& depthShader = m_shaderCache.at("DepthShader");
+	depthShader.Bind();
+	depthShader.SetUniform("lightSpaceMatrix", camera.GetProjMatrix(1024, 768) * camera.GetViewMatrix());
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+	GLuint query;
+	glGenQueries(1, &query);
+	for (const auto layout : { VertexLayout::Interleaved, VertexLayout::SplitPosition, VertexLayout::Packed })
+	{
+		// Load the scene again in the layout under test, the mesh cache keeps this cheap
+		std::vector<ModelPtr> models;
+		for (const auto& model : m_models)
+		{
+			models.push_back(std::make_shared<Model>(model->GetSourcePath(), "VertexLayoutBenchmark", false, false, layout));
+		}
+
+		std::size_t bytesPerPass{ 0 };
+		glBeginQuery(GL_TIME_ELAPSED, query);
+		for (auto i = 0; i < iterations; ++i)
+		{
+			glClear(GL_DEPTH_BUFFER_BIT);
+			bytesPerPass = 0;
+			for (std::size_t m = 0; m < models.size(); ++m)
+			{
+				const auto modelMatrix{ m_models[m]->GetModelMatrix() };
+				for (const auto& mesh : models[m]->GetMeshes())
+				{
+					depthShader.SetUniform("modelMatrix", modelMatrix * mesh.m_dequantize);
+					mesh.m_positionVao.Bind();
+					glDrawElements(GL_TRIANGLES, static_cast<int>(mesh.m_indexCount), GL_UNSIGNED_INT, nullptr);
+					bytesPerPass += mesh.m_vertexCount * mesh.GetPositionStride();
+				}
+			}
+		}
+		glEndQuery(GL_TIME_ELAPSED);
+
+		GLuint64 elapsedNs{ 0 };
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNs);
+		const auto* layoutName{ layout == VertexLayout::Interleaved ? "interleaved" :
+			layout == VertexLayout::SplitPosition ? "split position" : "packed" };
+		std::cout << "Depth pass, " << layoutName << " layout: " << bytesPerPass / 1024 << " KiB vertex stream, "
+			<< static_cast<double>(elapsedNs) / iterations / 1.0e6 << " ms GPU per pass\n";
+
+		for (auto& model : models)
+		{
+			model->Delete();
+		}
+	}
+	glDeleteQueries(1, &query);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void RenderSystem::BenchmarkUniformUpdates(const Camera& camera)
+{
+	constexpr std::size_t targetDraws = 20000;
+	using Clock = std::chrono::steady_clock;
+	const auto elapsedMs = [](const Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+
+	std::vector<std::pair<const Mesh*, glm::mat4>> draws;
+	for (const auto& model : m_models)
+	{
+		const auto modelMatrix{ model->GetModelMatrix() };
+		for (const auto& mesh : model->GetMeshes())
+		{
+			draws.emplace_back(&mesh, modelMatrix * mesh.m_dequantize);
+		}
+	}
+	if (draws.empty())
+	{
+		return;
+	}
+	// Enough passes over the scene to make the per-draw cost stand out from timer noise
+	const auto passes{ std::max<std::size_t>(1, targetDraws / draws.size()) };
+
+	const auto run = [&](const char* name, GLShaderProgram& shader, const auto& setModel) {
+		shader.Bind();
+		glFinish();
+		const auto start{ Clock::now() };
+		for (std::size_t pass = 0; pass < passes; ++pass)
+		{
+			glClear(GL_DEPTH_BUFFER_BIT);
+			for (const auto& [mesh, modelMatrix] : draws)
+			{
+				setModel(shader, modelMatrix);
+				mesh->m_positionVao.Bind();
+				glDrawElements(GL_TRIANGLES, static_cast<int>(mesh->m_indexCount), GL_UNSIGNED_INT, nullptr);
+			}
+		}
+		const auto submitMs{ elapsedMs(start) };
+		glFinish();
+		std::cout << "Uniform updates, " << name << ": " << submitMs * 1000.0 / (passes * draws.size())
+			<< " us CPU per draw over " << passes * draws.size() << " draws, " << elapsedMs(start)
+			<< " ms including GPU\n";
+	};
+
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	auto& depthShader = m_shaderCache.at("DepthShader");
+	depthShader.Bind();
+	depthShader.SetUniform("lightSpaceMatrix", camera.GetProjMatrix(1024, 768) * camera.GetViewMatrix());
+	run("by name", depthShader, [](GLShaderProgram& shader, const glm::mat4& modelMatrix) {
+		shader.SetUniform("modelMatrix", modelMatrix);
+	});
+	const auto modelUniform{ depthShader.GetUniformHandle("modelMatrix") };
+	run("by handle", depthShader, [modelUniform](GLShaderProgram& shader, const glm::mat4& modelMatrix) {
+		shader.SetUniform(modelUniform, modelMatrix);
+	});
+	// Same depth pass, the view projection comes from the FrameData block
+	run("ring buffer", m_shaderCache.at("DepthBlockShader"), [this](GLShaderProgram&, const glm::mat4& modelMatrix) {
+		const ObjectUniforms object{ modelMatrix, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f) };
+		m_objectUniforms.BindRange(OBJECT_UNIFORM_BINDING, m_objectUniforms.Push(object), sizeof(ObjectUniforms));
+	});
+	m_objectUniforms.EndFrame();
+	std::cout << "Uniform ring: " << m_objectUniforms.GetNumStalls() << " stalls waiting for the GPU so far\n";
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void RenderSystem::BenchmarkMultiDraw(const Camera& camera)
+{
+	constexpr auto frames = 64;
+	using Clock = std::chrono::steady_clock;
+	const auto elapsedMs = [](const Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+	if (!UpdateMeshBatch())
+	{
+		return;
+	}
+	// Both paths draw the same visible set
+	CullMeshes(camera.GetProjMatrix(1024, 768) * camera.GetViewMatrix(), m_models.cbegin(), m_models.cend());
+
+	const auto run = [&](const char* name, const auto& drawScene) {
+		glFinish();
+		const auto start{ Clock::now() };
+		std::size_t drawCalls{ 0 };
+		for (auto i = 0; i < frames; ++i)
+		{
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			drawCalls = drawScene();
+			m_objectUniforms.EndFrame();
+		}
+		const auto submitMs{ elapsedMs(start) };
+		glFinish();
+		std::cout << "Textured pass, " << name << ": " << submitMs / frames << " ms CPU, " << elapsedMs(start) / frames
+			<< " ms including GPU per frame, " << drawCalls << " draw calls\n";
+	};
+
+	auto& modelShader = m_shaderCache.at("ModelShader");
+	run("mesh by mesh", [&]() {
+		RenderModelsWithTextures(modelShader, camera.GetPosition(), m_models.cbegin(), m_models.cend());
+		return m_cullingStats.Visible;
+	});
+	run(m_meshBatch.IsBindless() ? "multi-draw, bindless" : "multi-draw, split by texture", [&]() {
+		GetMultiDrawShader().Bind();
+		glBindSampler(1, m_samplerPBRTextures);
+		m_meshBatch.Draw(m_models, m_meshVisibility);
+		glBindSampler(1, 0);
+		return m_meshBatch.GetNumMultiDraws();
+	});
+	std::cout << "Multi-draw: " << m_meshBatch.GetNumCommands() << " commands in " << m_meshBatch.GetNumMultiDraws()
+		<< " glMultiDrawElementsIndirect calls\n";
+}
+
+void RenderSystem::BenchmarkInstancing(const Camera& camera)
+{
+	constexpr auto copies = 10000;
+	constexpr auto frames = 64;
+	using Clock = std::chrono::steady_clock;
+	const auto elapsedMs = [](const Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+	if (m_models.empty() || m_models.front()->GetMeshes().empty())
+	{
+		return;
+	}
+	Model cube("resource/models/cube/cube.obj", "InstancingBenchmark", false, false, m_sceneLayout);
+	if (cube.GetMeshes().empty())
+	{
+		return;
+	}
+	// cube.obj has no material of its own, the copies borrow the scene's first one. They share the cube's buffers.
+	Mesh cubeMesh{ cube.GetMeshes().front() };
+	cubeMesh.Material = m_models.front()->GetMeshes().front().Material;
+
+	// A wall of cubes facing the camera, far enough away that most of it is in view
+	const auto view{ camera.GetViewMatrix() };
+	const glm::vec3 right{ view[0][0], view[1][0], view[2][0] };
+	const glm::vec3 up{ view[0][1], view[1][1], view[2][1] };
+	const glm::vec3 front{ -view[0][2], -view[1][2], -view[2][2] };
+	const auto side{ static_cast<int>(std::ceil(std::sqrt(static_cast<float>(copies)))) };
+	constexpr auto spacing{ 1.0f };
+	constexpr auto scale{ 0.3f };
+	const auto center{ camera.GetPosition() + front * (0.75f * spacing * side) };
+	std::vector<ModelPtr> models;
+	models.reserve(copies);
+	for (auto i = 0; i < copies; ++i)
+	{
+		const auto offset{ (static_cast<float>(i % side) - 0.5f * side) * spacing * right +
+			(static_cast<float>(i / side) - 0.5f * side) * spacing * up };
+		auto model{ std::make_shared<Model>() };
+		model->AttachMesh(cubeMesh);
+		model->Scale(glm::vec3(scale));
+		// The model matrix scales the translation as well
+		model->Translate((center + offset) / scale);
+		models.push_back(std::move(model));
+	}
+	CullMeshes(camera.GetProjMatrix(1024, 768) * camera.GetViewMatrix(), models.cbegin(), models.cend());
+
+	auto& modelShader = m_shaderCache.at(m_sceneLayout == VertexLayout::Packed ? "PackedModelShader" : "ModelShader");
+	for (const auto instanced : { false, true })
+	{
+		glFinish();
+		const auto start{ Clock::now() };
+		for (auto i = 0; i < frames; ++i)
+		{
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			RenderModelsWithTextures(modelShader, camera.GetPosition(), models.cbegin(), models.cend(),
+				instanced ? &GetInstancedShader() : nullptr);
+			m_objectUniforms.EndFrame();
+		}
+		const auto submitMs{ elapsedMs(start) };
+		glFinish();
+		std::cout << "Textured pass, " << copies << " cubes " << (instanced ? "instanced" : "mesh by mesh") << ": "
+			<< submitMs / frames << " ms CPU, " << elapsedMs(start) / frames << " ms including GPU per frame, "
+			<< m_drawStats.DrawCalls << " draw calls for " << m_cullingStats.Visible << " visible cubes\n";
+	}
+	// The copies only referenced its buffers. The next frame's culling rebuilds the BVH over the render list.
+	cube.Delete();
+}
+
+void RenderSystem::BenchmarkBVH(const Camera& camera) const
+{
+	constexpr auto primitiveCount = 100000;
+	constexpr auto queryCount = 1000;
+	using Clock = std::chrono::steady_clock;
+	const auto elapsedMs = [](const Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+
+	// Boxes scattered around the camera, roughly the size of props in a large level
+	std::mt19937 rng{ 1337 };
+	std::uniform_real_distribution<float> position{ -500.0f, 500.0f };
+	std::uniform_real_distribution<float> size{ 0.25f, 4.0f };
+	const auto eye{ camera.GetPosition() };
+	std::vector<AABB> bounds;
+	bounds.reserve(primitiveCount);
+	for (auto i = 0; i < primitiveCount; ++i)
+	{
+		const glm::vec3 center{ eye.x + position(rng), eye.y + position(rng) * 0.1f, eye.z + position(rng) };
+		const glm::vec3 halfExtent{ size(rng), size(rng), size(rng) };
+		bounds.emplace_back(center - halfExtent, center + halfExtent);
+	}
+
+	BVH bvh;
+	auto start{ Clock::now() };
+	bvh.Build(bounds);
+	std::cout << "BVH build: " << primitiveCount << " primitives, " << bvh.GetNodes().size() << " nodes in "
+		<< elapsedMs(start) << " ms\n";
+
+	// Move a tenth of the boxes a little, as animated objects would between frames
+	std::uniform_int_distribution<std::uint32_t> pick{ 0, primitiveCount - 1 };
+	std::uniform_real_distribution<float> offset{ -1.0f, 1.0f };
+	start = Clock::now();
+	for (auto i = 0; i < primitiveCount / 10; ++i)
+	{
+		const auto primitive{ pick(rng) };
+		const glm::vec3 delta{ offset(rng), offset(rng), offset(rng) };
+		bvh.UpdatePrimitive(primitive, AABB(bounds[primitive].GetMin() + delta, bounds[primitive].GetMax() + delta));
+	}
+	const auto refitNodes{ bvh.Refit() };
+	std::cout << "BVH refit: " << primitiveCount / 10 << " moved primitives, " << refitNodes << " nodes in "
+		<< elapsedMs(start) << " ms\n";
+
+	const Frustum frustum(camera.GetProjMatrix(1024, 768) * camera.GetViewMatrix());
+	std::vector<std::uint32_t> inside, boundary;
+	std::size_t visible{ 0 };
+	start = Clock::now();
+	for (auto i = 0; i < queryCount; ++i)
+	{
+		inside.clear();
+		boundary.clear();
+		bvh.QueryFrustum(frustum, inside, boundary);
+		visible += inside.size() + boundary.size();
+	}
+	const auto frustumMs{ elapsedMs(start) };
+
+	// Brute force reference: the batch test over every box, as done before the hierarchy
+	AABBBatch batch;
+	for (const auto& box : bounds)
+	{
+		batch.Push(box);
+	}
+	std::vector<std::uint8_t> visibility;
+	start = Clock::now();
+	for (auto i = 0; i < queryCount; ++i)
+	{
+		frustum.Cull(batch, visibility);
+	}
+	std::cout << "BVH frustum query: " << frustumMs * 1000.0 / queryCount << " us (" << visible / queryCount
+		<< " candidates), flat batch cull: " << elapsedMs(start) * 1000.0 / queryCount << " us\n";
+
+	std::uniform_real_distribution<float> direction{ -1.0f, 1.0f };
+	std::size_t hits{ 0 };
+	start = Clock::now();
+	for (auto i = 0; i < queryCount; ++i)
+	{
+		const glm::vec3 rayDirection{ direction(rng), direction(rng) * 0.1f, direction(rng) };
+		hits += bvh.Raycast(eye, rayDirection, 1000.0f).has_value();
+	}
+	std::cout << "BVH raycast: " << elapsedMs(start) * 1000.0 / queryCount << " us per ray, " << hits << "/"
+		<< queryCount << " hit\n";
+
+	std::vector<std::uint32_t> overlaps;
+	start = Clock::now();
+	for (auto i = 0; i < queryCount; ++i)
+	{
+		overlaps.clear();
+		bvh.QuerySphere(bounds[pick(rng)].GetCenter(), 10.0f, overlaps);
+	}
+	std::cout << "BVH sphere query: " << elapsedMs(start) * 1000.0 / queryCount << " us per query\n";
+}
@@ -3,7 +3,13 @@
 #include "../Model.h"
 #include <unordered_map>
 #include "../Graphics/GLShaderProgram.h"
+#include "../Graphics/ShaderHotReloader.h"
 #include "../Graphics/GLVertexArray.h"
+#include "../Graphics/GLUniformRing.h"
+#include "../Frustum.h"
+#include "../BVH.h"
+#include "../MeshBatch.h"
+#include "../RenderQueue.h"
 class Camera;
 
 class RenderSystem
@@ -13,25 +19,132 @@ public:
 	RenderSystem() = default;
 	void Init();
 	void Render(const Camera& camera);
+
+	struct CullingStats
+	{
+		std::size_t Visible{ 0 };
+		std::size_t Culled{ 0 };
+	};
+	// Mesh counts from the last frame's frustum culling
+	[[nodiscard]] const auto& GetCullingStats() const noexcept { return m_cullingStats; }
+	// Packets and binds of the last frame's textured pass, empty when it was drawn through the mesh batch
+	[[nodiscard]] const auto& GetRenderQueueStats() const noexcept { return m_renderQueue.GetStats(); }
+
+	struct DrawStats
+	{
+		std::size_t DrawCalls{ 0 };
+		// Meshes drawn as instances of a glDrawElementsInstanced call
+		std::size_t Instances{ 0 };
+	};
+	// Draw calls of the last frame's textured pass when it was drawn through the render queue
+	[[nodiscard]] const auto& GetDrawStats() const noexcept { return m_drawStats; }
 private:
+	// std140 mirrors of the blocks in uniform_blocks.glsl
+	struct FrameUniforms
+	{
+		glm::mat4 View;
+		glm::mat4 Projection;
+		glm::mat4 ViewProjection;
+		glm::vec4 CameraPosition;
+	};
+	struct ObjectUniforms
+	{
+		glm::mat4 Model;
+		glm::vec4 UvTransform;
+	};
+	static constexpr GLuint FRAME_UNIFORM_BINDING{ 0 };
+	static constexpr GLuint OBJECT_UNIFORM_BINDING{ 1 };
+	// Shader storage binding of the instance data in instance_data.glsl
+	static constexpr GLuint INSTANCE_DATA_BINDING{ 3 };
+	// Longest run of meshes drawn by one instanced call, keeps a call's instance data well inside the object ring
+	static constexpr std::size_t MAX_INSTANCES_PER_DRAW{ 16384 };
+	// Room for a few frames of per-draw data, about 32k draws at the usual 256 byte offset alignment
+	static constexpr GLsizeiptr OBJECT_UNIFORM_RING_SIZE{ 8 * 1024 * 1024 };
+
 	// Screen-quad
 	GLVertexArray m_quadVao;
 	std::vector<ModelPtr> m_models;
+	// Vertex layout the scene is loaded with. VertexLayout::Packed renders with PackedModelShader.
+	VertexLayout m_sceneLayout{ VertexLayout::SplitPosition };
 	// Texture samplers
 	GLuint m_samplerPBRTextures{ 0 };
+	// FrameData block, written once per frame
+	GLBuffer m_frameUniformBuffer;
+	// ObjectData blocks, one per draw
+	GLUniformRing m_objectUniforms;
+	// Visible meshes of the textured pass in state and depth order, the packet payload indexes m_queuedMeshes
+	RenderQueue m_renderQueue;
+	std::vector<std::pair<const Mesh*, glm::mat4>> m_queuedMeshes;
+	// Instance data of the current instanced draw, reused between draws
+	std::vector<ObjectUniforms> m_instanceData;
+	DrawStats m_drawStats;
+	// Draw runs of the queue that share program, texture and mesh with one glDrawElementsInstanced. Toggled with F7.
+	bool m_useInstancing{ true };
+	// The render list merged for multi-draw indirect, rebuilt when the list changes
+	MeshBatch m_meshBatch;
+	// Draw the scene through m_meshBatch instead of one glDrawElements per mesh. Toggled with F6, cleared if the
+	// scene can't be batched.
+	bool m_useMultiDraw{ true };
+
 
+	// World-space mesh bounds and their visibility, in render list order
+	AABBBatch m_meshBounds;
+	std::vector<std::uint8_t> m_meshVisibility;
+	CullingStats m_cullingStats;
+	// Hierarchy over every mesh in the render list, primitive ids are render list mesh indices
+	BVH m_sceneBvh;
+	// Models the hierarchy was built from, their mesh counts and the transform version their bounds were last refit at
+	std::vector<const Model*> m_bvhModels;
+	std::vector<std::size_t> m_bvhMeshCounts;
+	std::vector<std::uint32_t> m_bvhTransformVersions;
+	// Query results and the precise test of boundary meshes, reused every frame
+	std::vector<std::uint32_t> m_bvhInside, m_bvhBoundary;
+	std::vector<std::uint8_t> m_boundaryVisibility;
 
 	// Setup texture samplers
 	void SetupTextureSamplers();
 	void SetDefaultState();
 	// Compiled shader cache
 	std::unordered_map<std::string, GLShaderProgram> m_shaderCache;
+	// Rebuilds the programs in m_shaderCache when their sources are edited
+	Graphics::ShaderHotReloader m_shaderReloader;
 	void CompileShader();
+	// Sets the uniforms that stay constant for the lifetime of a program
+	void InitShaderUniforms(const std::string& name);
+	// Creates the uniform buffers behind the FrameData and ObjectData blocks
+	void SetupUniformBuffers();
+	void UpdateFrameUniforms(const Camera& camera);
 	// Configure NDC screen quad
 	void SetupScreenQuad();
 	void RenderQuad() const;
 	// Render models without binding textures (for a depth or shadow pass perhaps)
 	void RenderModelsNoTextures(GLShaderProgram& shader, RenderListIterator renderListBegin, RenderListIterator renderListEnd) const;
-	// Render models contained in the renderlist
-	void RenderModelsWithTextures(GLShaderProgram& shader, RenderListIterator renderListBegin, RenderListIterator renderListEnd) const;
+	// Times a depth-only pass over the scene with every VertexLayout and logs the vertex bytes fetched (F2)
+	void BenchmarkVertexLayouts(const Camera& camera);
+	// Times draw submission with the model matrix set by uniform name, by UniformHandle and from the ObjectData
+	// ring, and logs the CPU cost per draw (F4)
+	void BenchmarkUniformUpdates(const Camera& camera);
+	// Builds and times the BVH over a synthetic scene: build, refit and frustum/ray/sphere queries (F3)
+	void BenchmarkBVH(const Camera& camera) const;
+	// Rebuilds the scene BVH when the render list changed, otherwise refits the meshes of models that moved
+	void UpdateSceneBvh(RenderListIterator renderListBegin, RenderListIterator renderListEnd);
+	// Culls the renderlist through the scene BVH. Meshes in subtrees fully inside the frustum are accepted as a whole,
+	// the ones in leaves crossing a plane are tested in one batch. Runs before any draws are issued.
+	void CullMeshes(const glm::mat4& viewProjection, RenderListIterator renderListBegin, RenderListIterator renderListEnd);
+	// Rebuilds m_meshBatch if m_models changed since it was built. Returns false if the scene can't be batched.
+	bool UpdateMeshBatch();
+	// Program m_meshBatch draws with
+	GLShaderProgram& GetMultiDrawShader();
+	// Times the textured pass drawn mesh by mesh and through m_meshBatch, CPU submission and total (F5)
+	void BenchmarkMultiDraw(const Camera& camera);
+	// Program instanced draws of the scene layout use
+	GLShaderProgram& GetInstancedShader();
+	// Times the textured pass over 10000 copies of cube.obj drawn mesh by mesh and instanced (F8)
+	void BenchmarkInstancing(const Camera& camera);
+	// Render models contained in the renderlist with shader, which is bound here. Skips the meshes culled by the last
+	// CullMeshes call on the same list and draws the rest through m_renderQueue, skipping binds of state already bound.
+	// Given instancedShader, consecutive packets with the same program, texture and mesh are drawn as instances of one
+	// glDrawElementsInstanced with that program, reading their matrices from the object ring.
+	void RenderModelsWithTextures(GLShaderProgram& shader, const glm::vec3& eye, RenderListIterator renderListBegin,
+		RenderListIterator renderListEnd, GLShaderProgram* instancedShader = nullptr);
 };
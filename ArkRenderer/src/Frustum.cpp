@@ -0,0 +1,96 @@
+#include "Frustum.h"
+
+#include <cmath>
+#include <limits>
+#include <glm/geometric.hpp>
+
+/***********************************************************************************/
+void AABBBatch::Clear() noexcept {
+	m_boxes.Clear();
+}
+
+/***********************************************************************************/
+void AABBBatch::Push(const AABB& box, const glm::mat4& transform) {
+	Push(box.Transformed(transform));
+}
+
+/***********************************************************************************/
+void AABBBatch::Push(const AABB& worldBox) {
+	glm::vec3 center{ 0.0f };
+	// Not infinity: 0 * inf would turn into NaN for planes parallel to an axis
+	glm::vec3 extent{ std::numeric_limits<float>::max() };
+	if (!worldBox.IsNull()) {
+		center = worldBox.GetCenter();
+		extent = worldBox.GetDiagonal() * 0.5f;
+	}
+	m_boxes.Push(center, extent);
+}
+
+/***********************************************************************************/
+Frustum::Frustum(const glm::mat4& viewProjection) {
+	// Gribb/Hartmann: each plane is the last row of the matrix plus or minus one of the others
+	const auto row = [&viewProjection](const int i) {
+		return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	};
+	m_planes[Left] = row(3) + row(0);
+	m_planes[Right] = row(3) - row(0);
+	m_planes[Bottom] = row(3) + row(1);
+	m_planes[Top] = row(3) - row(1);
+	m_planes[Near] = row(3) + row(2);
+	m_planes[Far] = row(3) - row(2);
+
+	for (auto& plane : m_planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+}
+
+/***********************************************************************************/
+Frustum::Containment Frustum::Classify(const glm::vec3& min, const glm::vec3& max) const {
+	const auto center{ (min + max) * 0.5f };
+	const auto extent{ (max - min) * 0.5f };
+	auto result{ Containment::Inside };
+	for (const auto& plane : m_planes) {
+		const auto normal{ glm::vec3(plane) };
+		const auto distance{ glm::dot(normal, center) + plane.w };
+		const auto radius{ glm::dot(glm::abs(normal), extent) };
+		if (distance + radius < 0.0f) {
+			return Containment::Outside;
+		}
+		if (distance - radius < 0.0f) {
+			result = Containment::Intersecting;
+		}
+	}
+	return result;
+}
+
+/***********************************************************************************/
+bool Frustum::Intersects(const AABB& box) const {
+	if (box.IsNull()) {
+		return true;
+	}
+
+	const auto center{ box.GetCenter() };
+	const auto extent{ box.GetDiagonal() * 0.5f };
+	for (const auto& plane : m_planes) {
+		const auto normal{ glm::vec3(plane) };
+		if (glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), extent) < 0.0f) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/***********************************************************************************/
+bool Frustum::Intersects(const glm::vec3& center, const float radius) const {
+	for (const auto& plane : m_planes) {
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/***********************************************************************************/
+std::size_t Frustum::Cull(const AABBBatch& boxes, std::vector<std::uint8_t>& visible) const {
+	return boxes.m_boxes.Cull(m_planes, visible);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include <Ark/BoxBatch.hpp>
+
+#include "AABB.h"
+
+// World-space AABBs for the batch frustum test. Storage and the SSE test are the shared Ark::BoxBatch.
+class AABBBatch {
+public:
+	void Clear() noexcept;
+	// Appends box after transforming it to world space. A null box is stored as infinitely large so it is never culled.
+	void Push(const AABB& box, const glm::mat4& transform);
+	// Appends a box that is already in world space
+	void Push(const AABB& worldBox);
+	[[nodiscard]] auto Size() const noexcept { return m_boxes.Size(); }
+
+private:
+	friend class Frustum;
+	Ark::BoxBatch m_boxes;
+};
+
+// View frustum as six inward facing, normalized planes extracted from an OpenGL (-1..1 depth) view-projection matrix.
+class Frustum {
+public:
+	enum Plane { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	enum class Containment { Outside, Intersecting, Inside };
+	// Classifies the box [min, max]. Inside means no plane crosses it, so its contents need no further tests.
+	[[nodiscard]] Containment Classify(const glm::vec3& min, const glm::vec3& max) const;
+
+	// True if box is at least partially inside. Conservative: boxes crossing two planes near a corner pass.
+	[[nodiscard]] bool Intersects(const AABB& box) const;
+	[[nodiscard]] bool Intersects(const glm::vec3& center, const float radius) const;
+
+	// Tests every box in the batch against the six planes, see Ark::BoxBatch::Cull. Returns the number of visible boxes.
+	std::size_t Cull(const AABBBatch& boxes, std::vector<std::uint8_t>& visible) const;
+
+	[[nodiscard]] const auto& GetPlanes() const noexcept { return m_planes; }
+
+private:
+	// xyz is the normal, w the distance. Points p with dot(xyz, p) + w >= 0 are on the inside.
+	std::array<glm::vec4, PlaneCount> m_planes;
+};
@@ -0,0 +1,28 @@
+#include "GLBuffer.h"
+
+void GLBuffer::Init(const std::size_t size, const void* data, const GLbitfield flags) noexcept
+{
+	glCreateBuffers(1, &m_buffer);
+	// Zero sized storage is an error, empty meshes still get a valid buffer
+	m_size = size;
+	glNamedBufferStorage(m_buffer, size > 0 ? static_cast<GLsizeiptr>(size) : 1, size > 0 ? data : nullptr, flags);
+	++s_numLive;
+	s_bytesLive += m_size;
+}
+
+void GLBuffer::Update(const GLintptr offset, const std::size_t size, const void* data) const noexcept
+{
+	glNamedBufferSubData(m_buffer, offset, static_cast<GLsizeiptr>(size), data);
+}
+
+void GLBuffer::Delete() noexcept
+{
+	if (m_buffer != 0)
+	{
+		glDeleteBuffers(1, &m_buffer);
+		--s_numLive;
+		s_bytesLive -= m_size;
+	}
+	m_buffer = 0;
+	m_size = 0;
+}
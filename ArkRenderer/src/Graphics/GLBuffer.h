@@ -0,0 +1,31 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+
+// Buffer object with immutable storage, created and edited through direct state access so nothing has to be bound.
+// A plain handle: copies refer to the same buffer and Delete frees it for all of them.
+class GLBuffer
+{
+public:
+	// Allocates size bytes, filled from data unless it is null. flags are glNamedBufferStorage flags: 0 for data
+	// that never changes, GL_DYNAMIC_STORAGE_BIT to allow Update.
+	void Init(const std::size_t size, const void* data, const GLbitfield flags = 0) noexcept;
+	// Needs GL_DYNAMIC_STORAGE_BIT
+	void Update(const GLintptr offset, const std::size_t size, const void* data) const noexcept;
+	void Delete() noexcept;
+
+	[[nodiscard]] auto GetId() const noexcept { return m_buffer; }
+	[[nodiscard]] auto GetSize() const noexcept { return m_size; }
+	[[nodiscard]] bool IsValid() const noexcept { return m_buffer != 0; }
+
+	// Buffers created through GLBuffer and not deleted yet, across the whole program
+	[[nodiscard]] static auto GetNumLive() noexcept { return s_numLive; }
+	[[nodiscard]] static auto GetBytesLive() noexcept { return s_bytesLive; }
+
+private:
+	GLuint m_buffer{ 0 };
+	std::size_t m_size{ 0 };
+
+	static inline std::size_t s_numLive{ 0 };
+	static inline std::size_t s_bytesLive{ 0 };
+};
@@ -0,0 +1,130 @@
+#include "GLProgramBinaryCache.h"
+
+#include <fstream>
+#include <iostream>
+
+const static std::filesystem::path PROGRAM_BINARY_DIR{ std::filesystem::current_path() / "resource/cache/programs" };
+
+// "APRG"
+constexpr std::uint32_t PROGRAM_BINARY_MAGIC{ 0x47525041 };
+
+struct ProgramBinaryHeader
+{
+	std::uint32_t Magic{ PROGRAM_BINARY_MAGIC };
+	std::uint32_t Version{ Graphics::GLProgramBinaryCache::VERSION };
+	std::uint64_t Key{ 0 };
+	std::uint32_t Format{ 0 };
+	std::uint32_t Size{ 0 };
+	double ColdBuildMs{ 0.0 };
+};
+
+/***********************************************************************************/
+// 64-bit FNV-1a, spelled out because std::hash gives no guarantee of staying the same between runs
+static std::uint64_t hashBytes(std::uint64_t hash, const void* data, const std::size_t size)
+{
+	const auto* bytes{ static_cast<const unsigned char*>(data) };
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+	}
+	return hash;
+}
+
+/***********************************************************************************/
+static std::uint64_t hashString(const std::uint64_t hash, const std::string& str)
+{
+	// The length goes in first so consecutive strings can't run into each other
+	const auto length{ static_cast<std::uint64_t>(str.size()) };
+	return hashBytes(hashBytes(hash, &length, sizeof(length)), str.data(), str.size());
+}
+
+namespace Graphics
+{
+	/***********************************************************************************/
+	bool GLProgramBinaryCache::IsSupported()
+	{
+		GLint numFormats{ 0 };
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+		return numFormats > 0;
+	}
+
+	/***********************************************************************************/
+	std::uint64_t GLProgramBinaryCache::BuildKey(const std::vector<ShaderSource>& sources)
+	{
+		std::uint64_t key{ 0xCBF29CE484222325ull };
+		for (const auto name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+		{
+			const auto* value{ reinterpret_cast<const char*>(glGetString(name)) };
+			key = hashString(key, value ? value : "");
+		}
+		for (const auto& source : sources)
+		{
+			key = hashString(hashString(key, source.m_type), source.m_code);
+		}
+		return key;
+	}
+
+	/***********************************************************************************/
+	std::optional<GLProgramBinaryCache::Entry> GLProgramBinaryCache::Load(const std::string& programName,
+		const std::uint64_t key)
+	{
+		std::ifstream in(BuildCachePath(programName), std::ios::binary);
+		ProgramBinaryHeader header;
+		if (!in || !in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		{
+			return std::nullopt;
+		}
+		// Anything that does not match exactly is treated as a stale entry and rebuilt by the caller
+		if (header.Magic != PROGRAM_BINARY_MAGIC || header.Version != VERSION || header.Key != key ||
+			header.Size == 0)
+		{
+			return std::nullopt;
+		}
+
+		Entry entry;
+		entry.Format = header.Format;
+		entry.ColdBuildMs = header.ColdBuildMs;
+		entry.Binary.resize(header.Size);
+		if (!in.read(entry.Binary.data(), header.Size))
+		{
+			std::cerr << "Program Binary Cache: Truncated cache file for " << programName << '\n';
+			return std::nullopt;
+		}
+		return std::make_optional(std::move(entry));
+	}
+
+	/***********************************************************************************/
+	void GLProgramBinaryCache::Save(const std::string& programName, const std::uint64_t key, const Entry& entry)
+	{
+		if (!std::filesystem::exists(PROGRAM_BINARY_DIR))
+		{
+			if (!std::filesystem::create_directories(PROGRAM_BINARY_DIR))
+			{
+				std::cerr << "Failed to create program binary cache directory: " << PROGRAM_BINARY_DIR << '\n';
+				return;
+			}
+		}
+
+		const auto target{ BuildCachePath(programName) };
+		std::ofstream out(target, std::ios::binary);
+		if (!out)
+		{
+			std::cerr << "Program Binary Cache: Failed to open " << target << " for writing\n";
+			return;
+		}
+
+		ProgramBinaryHeader header;
+		header.Key = key;
+		header.Format = entry.Format;
+		header.Size = static_cast<std::uint32_t>(entry.Binary.size());
+		header.ColdBuildMs = entry.ColdBuildMs;
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(entry.Binary.data(), entry.Binary.size());
+	}
+
+	/***********************************************************************************/
+	std::filesystem::path GLProgramBinaryCache::BuildCachePath(const std::string& programName)
+	{
+		return PROGRAM_BINARY_DIR / (programName + ".bin");
+	}
+}; // namespace Graphics
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "ShaderStage.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Graphics
+{
+	// On-disk cache of linked programs as returned by glGetProgramBinary, one file per program name. An entry is
+	// only valid for the exact preprocessed sources and GL vendor, renderer and version it was built with, and the
+	// driver may still reject it, after an update for instance.
+	class GLProgramBinaryCache
+	{
+	public:
+		// Bump whenever the file layout changes
+		static constexpr std::uint32_t VERSION{ 1 };
+
+		struct Entry
+		{
+			GLenum Format{ 0 };
+			std::vector<char> Binary;
+			// Time it took to build the program from source, kept for the cold/warm comparison
+			double ColdBuildMs{ 0.0 };
+		};
+
+		// False if the driver offers no binary formats, nothing is cached then
+		static bool IsSupported();
+		// Hash of the sources, in stage order, and of the GL vendor, renderer and version strings
+		static std::uint64_t BuildKey(const std::vector<ShaderSource>& sources);
+
+		// Returns the binary stored for programName, or nothing if it is missing, stale or corrupt
+		static std::optional<Entry> Load(const std::string& programName, std::uint64_t key);
+		static void Save(const std::string& programName, std::uint64_t key, const Entry& entry);
+
+	private:
+		static std::filesystem::path BuildCachePath(const std::string& programName);
+	};
+}; // namespace Graphics
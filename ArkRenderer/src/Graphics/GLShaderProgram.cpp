@@ -126,3 +126,74 @@ GLShaderProgram& GLShaderProgram::SetUniform(const std::string& uniformName,
 
 	return *this;
 }
+
+/***********************************************************************************/
+UniformHandle GLShaderProgram::GetUniformHandle(const std::string& uniformName) const
+{
+	const auto uniform{ m_uniforms.find(uniformName) };
+	return { uniform != m_uniforms.cend() ? uniform->second : -1 };
+}
+
+/***********************************************************************************/
+GLShaderProgram& GLShaderProgram::SetUniform(const UniformHandle uniform, const int value)
+{
+	glUniform1i(uniform.Location, value);
+
+	return *this;
+}
+
+/***********************************************************************************/
+GLShaderProgram& GLShaderProgram::SetUniform(const UniformHandle uniform, const float value)
+{
+	glUniform1f(uniform.Location, value);
+
+	return *this;
+}
+
+/***********************************************************************************/
+GLShaderProgram& GLShaderProgram::SetUniform(const UniformHandle uniform, const glm::ivec2& value)
+{
+	glUniform2iv(uniform.Location, 1, &value[0]);
+
+	return *this;
+}
+
+/***********************************************************************************/
+GLShaderProgram& GLShaderProgram::SetUniform(const UniformHandle uniform, const glm::vec2& value)
+{
+	glUniform2f(uniform.Location, value.x, value.y);
+
+	return *this;
+}
+
+/***********************************************************************************/
+GLShaderProgram& GLShaderProgram::SetUniform(const UniformHandle uniform, const glm::vec3& value)
+{
+	glUniform3f(uniform.Location, value.x, value.y, value.z);
+
+	return *this;
+}
+
+/***********************************************************************************/
+GLShaderProgram& GLShaderProgram::SetUniform(const UniformHandle uniform, const glm::vec4& value)
+{
+	glUniform4f(uniform.Location, value.x, value.y, value.z, value.w);
+
+	return *this;
+}
+
+/***********************************************************************************/
+GLShaderProgram& GLShaderProgram::SetUniform(const UniformHandle uniform, const glm::mat3x3& value)
+{
+	glUniformMatrix3fv(uniform.Location, 1, GL_FALSE, value_ptr(value));
+
+	return *this;
+}
+
+/***********************************************************************************/
+GLShaderProgram& GLShaderProgram::SetUniform(const UniformHandle uniform, const glm::mat4x4& value)
+{
+	glUniformMatrix4fv(uniform.Location, 1, GL_FALSE, value_ptr(value));
+
+	return *this;
+}
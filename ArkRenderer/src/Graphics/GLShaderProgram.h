@@ -5,6 +5,16 @@
 #include <unordered_map>
 #include <string>
 
+// Location of a uniform resolved once by GLShaderProgram::GetUniformHandle, so per-draw updates skip the name lookup.
+// Only valid for the program it came from: a program rebuilt by hot reload needs new handles. Setting an invalid
+// handle is a no-op, as it is in GL.
+struct UniformHandle
+{
+	GLint Location{ -1 };
+
+	[[nodiscard]] bool IsValid() const noexcept { return Location >= 0; }
+};
+
 class GLShaderProgram
 {
 private:
@@ -25,18 +35,8 @@ public:
 		other.m_programId = 0;
 	}
 
+	// Swaps, so the program replaced is deleted along with other
 	GLShaderProgram& operator=(GLShaderProgram&& other) noexcept
-	{
-		if (this != &other)
-		{
-			m_programId = other.m_programId;
-			m_uniforms = std::move(other.m_uniforms);
-			m_programName = std::move(other.m_programName);
-		}
-		return *this;
-	}
-
-	GLShaderProgram& operator=(GLShaderProgram other) noexcept
 	{
 		std::swap(m_uniforms, other.m_uniforms);
 		std::swap(m_programId, other.m_programId);
@@ -66,5 +66,15 @@ public:
 	GLShaderProgram& SetUniform(const std::string& uniformName,
 	                            const glm::mat4x4& value);
 
+	[[nodiscard]] UniformHandle GetUniformHandle(const std::string& uniformName) const;
+	GLShaderProgram& SetUniform(const UniformHandle uniform, const int value);
+	GLShaderProgram& SetUniform(const UniformHandle uniform, const float value);
+	GLShaderProgram& SetUniform(const UniformHandle uniform, const glm::ivec2& value);
+	GLShaderProgram& SetUniform(const UniformHandle uniform, const glm::vec2& value);
+	GLShaderProgram& SetUniform(const UniformHandle uniform, const glm::vec3& value);
+	GLShaderProgram& SetUniform(const UniformHandle uniform, const glm::vec4& value);
+	GLShaderProgram& SetUniform(const UniformHandle uniform, const glm::mat3x3& value);
+	GLShaderProgram& SetUniform(const UniformHandle uniform, const glm::mat4x4& value);
+
 	[[nodiscard]] auto GetProgramName() const noexcept { return m_programName; }
 };
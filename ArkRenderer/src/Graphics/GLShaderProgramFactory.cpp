@@ -1,14 +1,30 @@
 #include "GLShaderProgramFactory.h"
+#include "GLProgramBinaryCache.h"
 
 #include <glad/glad.h>
-#include "../ResourceManager.h"
 #include <fmt/core.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <iostream>
 #include <unordered_map>
 
+// GL_KHR_parallel_shader_compile, not part of the generated GLAD loader. The ARB variant uses the same values.
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
 namespace Graphics
 {
+	// Set by InitParallelCompile
+	bool ParallelCompile{ false };
+	ProgramBinaryStats BinaryStats;
+
 	bool ValidateProgram(const unsigned int id) {
 		int success{ GL_FALSE };
 		int logLength{ -1 };
@@ -79,52 +95,258 @@ namespace Graphics
 		return CheckShaderError(id, "PROGRAM");
 	}
 
-	std::optional<GLShaderProgram> GLShaderProgramFactory::CreateShaderProgram(
-		const std::string& programName, const std::vector<ShaderStage>& stages)
+	// Appends the file at path to source with its #include "file" lines replaced by the included files. Files already
+	// in included are skipped, so each file is expanded once per stage and include cycles end.
+	bool ExpandIncludes(const std::filesystem::path& path, std::vector<std::filesystem::path>& included,
+	                    std::string& source)
 	{
-		std::cout << "Building shader program " << programName << std::endl;
-		std::vector<unsigned int> shaderIds;
-		bool success = true;
-		for (auto& stage : stages)
-		{
-			auto id = glCreateShader(TYPE2_GL_ENUM.at(stage.m_type));
-			shaderIds.push_back(id);
-			auto shaderCode{ ResourceManager::GetInstance().LoadTextFile(stage.m_filePath) };
-			if (!CompileStage(id, shaderCode, stage.m_type))
+		const auto file{ path.lexically_normal() };
+		if (std::find(included.cbegin(), included.cend(), file) != included.cend())
+		{
+			return true;
+		}
+		included.push_back(file);
+
+		std::ifstream in(file, std::ios::in);
+		if (!in)
+		{
+			std::cerr << "[ERROR]::SHADER SOURCE NOT FOUND: " << file.string() << std::endl;
+			return false;
+		}
+		std::string line;
+		while (std::getline(in, line))
+		{
+			const auto first{ line.find_first_not_of(" \t") };
+			if (first == std::string::npos || line.compare(first, 8, "#include") != 0)
 			{
-				success = false;
-				break;
+				source += line;
+				source += '\n';
+				continue;
+			}
+			const auto open{ line.find('"', first + 8) };
+			const auto close{ open == std::string::npos ? open : line.find('"', open + 1) };
+			if (close == std::string::npos)
+			{
+				std::cerr << "[ERROR]::MALFORMED SHADER INCLUDE in " << file.string() << ": " << line << std::endl;
+				return false;
+			}
+			if (!ExpandIncludes(file.parent_path() / line.substr(open + 1, close - open - 1), included, source))
+			{
+				return false;
 			}
 		}
-		if (!success)
+		return !in.bad();
+	}
+
+	void SaveProgramBinary(const PendingShaderProgram& pending)
+	{
+		GLProgramBinaryCache::Entry entry;
+		// Wall time since BeginShaderProgram, an upper bound when several programs build concurrently
+		const std::chrono::duration<double, std::milli> buildMs{
+			std::chrono::high_resolution_clock::now() - pending.m_start
+		};
+		entry.ColdBuildMs = buildMs.count();
+		GLint length{ 0 };
+		glGetProgramiv(pending.m_programId, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+		{
+			return;
+		}
+		entry.Binary.resize(length);
+		glGetProgramBinary(pending.m_programId, length, &length, &entry.Format, entry.Binary.data());
+		entry.Binary.resize(length);
+		GLProgramBinaryCache::Save(pending.m_programName, pending.m_binaryKey, entry);
+	}
+
+	std::optional<GLShaderProgram> GLShaderProgramFactory::CreateShaderProgram(
+		const std::string& programName, const std::vector<ShaderStage>& stages)
+	{
+		std::cout << "Building shader program " << programName << std::endl;
+		const auto sources{ LoadShaderSources(stages) };
+		if (!sources)
 		{
 			std::cerr << "Shader Compilation failed\n";
-			for (const auto id : shaderIds)
+			return std::nullopt;
+		}
+		auto pending{ BeginShaderProgram(programName, sources.value()) };
+		return FinishShaderProgram(pending);
+	}
+
+	bool GLShaderProgramFactory::InitParallelCompile(GLADloadproc loader)
+	{
+		GLint numExtensions{ 0 };
+		glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+		const char* entryPoint{ nullptr };
+		for (GLint i = 0; i < numExtensions && !entryPoint; ++i)
+		{
+			const std::string_view extension{ reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)) };
+			if (extension == "GL_KHR_parallel_shader_compile")
 			{
-				glDeleteShader(id);
+				entryPoint = "glMaxShaderCompilerThreadsKHR";
 			}
-			return std::nullopt;
+			else if (extension == "GL_ARB_parallel_shader_compile")
+			{
+				entryPoint = "glMaxShaderCompilerThreadsARB";
+			}
+		}
+		const auto maxShaderCompilerThreads{
+			entryPoint ? reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(loader(entryPoint)) : nullptr
+		};
+		ParallelCompile = maxShaderCompilerThreads != nullptr;
+		if (ParallelCompile)
+		{
+			// Let the driver pick the number of compiler threads
+			maxShaderCompilerThreads(0xFFFFFFFF);
+		}
+		std::cout << "Parallel shader compile: " << (ParallelCompile ? entryPoint : "not supported") << "\n";
+		return ParallelCompile;
+	}
+
+	bool GLShaderProgramFactory::HasParallelCompile()
+	{
+		return ParallelCompile;
+	}
+
+	std::optional<std::string> GLShaderProgramFactory::LoadShaderSource(const std::filesystem::path& path,
+		std::vector<std::filesystem::path>* dependencies)
+	{
+		std::vector<std::filesystem::path> included;
+		std::string source;
+		const bool success{ ExpandIncludes(path, included, source) };
+		if (dependencies)
+		{
+			dependencies->insert(dependencies->end(), included.cbegin(), included.cend());
 		}
-		const unsigned int programId = glCreateProgram();
-		for (const auto id : shaderIds)
+		return success ? std::make_optional(std::move(source)) : std::nullopt;
+	}
+
+	std::optional<std::vector<ShaderSource>> GLShaderProgramFactory::LoadShaderSources(
+		const std::vector<ShaderStage>& stages, std::vector<std::filesystem::path>* dependencies)
+	{
+		std::vector<ShaderSource> sources;
+		for (const auto& stage : stages)
 		{
-			glAttachShader(programId, id);
+			auto code{ LoadShaderSource(stage.m_filePath, dependencies) };
+			if (!code)
+			{
+				return std::nullopt;
+			}
+			sources.push_back({ stage.m_type, std::move(code.value()) });
 		}
-		if (!LinkProgram(programId) || !ValidateProgram(programId))
+		return sources;
+	}
+
+	PendingShaderProgram GLShaderProgramFactory::BeginShaderProgram(const std::string& programName,
+		const std::vector<ShaderSource>& sources)
+	{
+		PendingShaderProgram pending;
+		pending.m_programName = programName;
+		pending.m_programId = glCreateProgram();
+		pending.m_start = std::chrono::high_resolution_clock::now();
+		if (GLProgramBinaryCache::IsSupported())
 		{
-			for (const auto id : shaderIds)
+			pending.m_binaryKey = GLProgramBinaryCache::BuildKey(sources);
+			if (const auto entry{ GLProgramBinaryCache::Load(programName, pending.m_binaryKey) })
 			{
-				glDetachShader(programId, id);
-				glDeleteShader(id);
+				glProgramBinary(pending.m_programId, entry->Format, entry->Binary.data(),
+				                static_cast<GLsizei>(entry->Binary.size()));
+				GLint linked{ GL_FALSE };
+				glGetProgramiv(pending.m_programId, GL_LINK_STATUS, &linked);
+				if (linked == GL_TRUE)
+				{
+					const std::chrono::duration<double, std::milli> loadMs{
+						std::chrono::high_resolution_clock::now() - pending.m_start
+					};
+					++BinaryStats.Hits;
+					BinaryStats.MillisecondsSaved += std::max(0.0, entry->ColdBuildMs - loadMs.count());
+					pending.m_fromBinary = true;
+					return pending;
+				}
+				// Usually a driver update, the binary is replaced once the program is built from source
+				std::cout << "Program binary for " << programName << " rejected by the driver, building from source\n";
+				++BinaryStats.Rejected;
+				glDeleteProgram(pending.m_programId);
+				pending.m_programId = glCreateProgram();
 			}
-			glDeleteProgram(programId);
+			++BinaryStats.Misses;
+			glProgramParameteri(pending.m_programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+		for (const auto& source : sources)
+		{
+			const auto id = glCreateShader(TYPE2_GL_ENUM.at(source.m_type));
+			Compile(id, source.m_code.c_str());
+			glAttachShader(pending.m_programId, id);
+			pending.m_shaderIds.push_back(id);
+			pending.m_shaderTypes.push_back(source.m_type);
+		}
+		// Linking fails anyway if a stage did not compile, FinishShaderProgram reports the compile errors first
+		glLinkProgram(pending.m_programId);
+		return pending;
+	}
+
+	bool GLShaderProgramFactory::IsShaderProgramReady(const PendingShaderProgram& pending)
+	{
+		if (!ParallelCompile)
+		{
+			return true;
+		}
+		// A linked program implies its stages finished compiling
+		GLint complete{ GL_FALSE };
+		glGetProgramiv(pending.m_programId, GL_COMPLETION_STATUS_KHR, &complete);
+		return complete == GL_TRUE;
+	}
+
+	std::optional<GLShaderProgram> GLShaderProgramFactory::FinishShaderProgram(PendingShaderProgram& pending)
+	{
+		bool compiled = true;
+		for (std::size_t i = 0; i < pending.m_shaderIds.size(); ++i)
+		{
+			compiled = CheckShaderError(pending.m_shaderIds[i], pending.m_shaderTypes[i]) && compiled;
+		}
+		if (!compiled)
+		{
+			std::cerr << "Shader Compilation failed\n";
+			DiscardShaderProgram(pending);
+			return std::nullopt;
+		}
+		if (!CheckShaderError(pending.m_programId, "PROGRAM") || !ValidateProgram(pending.m_programId))
+		{
 			std::cerr << "Shader Link failed\n";
+			DiscardShaderProgram(pending);
 			return std::nullopt;
 		}
-		for (const auto id : shaderIds) {
-			glDetachShader(programId, id);
+		for (const auto id : pending.m_shaderIds) {
+			glDetachShader(pending.m_programId, id);
 			glDeleteShader(id);
 		}
-		return std::make_optional<GLShaderProgram>({ programName, programId });
+		if (pending.m_binaryKey != 0 && !pending.m_fromBinary)
+		{
+			SaveProgramBinary(pending);
+		}
+		const auto programId{ std::exchange(pending.m_programId, 0u) };
+		pending.m_shaderIds.clear();
+		pending.m_shaderTypes.clear();
+		return std::make_optional<GLShaderProgram>({ pending.m_programName, programId });
+	}
+
+	void GLShaderProgramFactory::DiscardShaderProgram(PendingShaderProgram& pending)
+	{
+		for (const auto id : pending.m_shaderIds)
+		{
+			glDetachShader(pending.m_programId, id);
+			glDeleteShader(id);
+		}
+		if (pending.m_programId != 0)
+		{
+			glDeleteProgram(pending.m_programId);
+		}
+		pending.m_programId = 0;
+		pending.m_shaderIds.clear();
+		pending.m_shaderTypes.clear();
+	}
+
+	const ProgramBinaryStats& GLShaderProgramFactory::GetProgramBinaryStats()
+	{
+		return BinaryStats;
 	}
 }
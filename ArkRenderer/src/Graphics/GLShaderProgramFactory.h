@@ -3,11 +3,37 @@
 #include "GLShaderProgram.h"
 #include "ShaderStage.h"
 
+#include <chrono>
+#include <filesystem>
 #include <optional>
 #include <vector>
 
 namespace Graphics
 {
+	// Program whose stages were handed to the driver but whose compile and link results were not checked yet
+	struct PendingShaderProgram
+	{
+		std::string m_programName;
+		GLuint m_programId{ 0 };
+		std::vector<GLuint> m_shaderIds;
+		std::vector<std::string> m_shaderTypes;
+		// Key of the sources in the program binary cache, 0 when binaries are not cached
+		std::uint64_t m_binaryKey{ 0 };
+		// Loaded from the program binary cache, there are no stages to check then
+		bool m_fromBinary{ false };
+		std::chrono::high_resolution_clock::time_point m_start;
+	};
+
+	struct ProgramBinaryStats
+	{
+		std::size_t Hits{ 0 };
+		// Rejected binaries count as misses too
+		std::size_t Misses{ 0 };
+		std::size_t Rejected{ 0 };
+		// Cold build time of the programs loaded from binaries minus the time spent loading them
+		double MillisecondsSaved{ 0.0 };
+	};
+
 	class GLShaderProgramFactory
 	{
 	public:
@@ -15,5 +41,33 @@ namespace Graphics
 			const std::string& programName,
 			const std::vector<ShaderStage>& stages
 		);
+
+		// Turns on GL_KHR_parallel_shader_compile (or the ARB variant) if the context has it, so compiles and links
+		// run on driver threads and IsShaderProgramReady can be polled instead of blocking. Call once after GLAD is
+		// loaded.
+		static bool InitParallelCompile(GLADloadproc loader);
+		static bool HasParallelCompile();
+
+		// Reads a stage and expands its #include "file" directives, paths being relative to the including file.
+		// A file is expanded once per stage. Every file read, the stage itself included, is appended to dependencies
+		// when given. Returns nullopt if a file can't be read.
+		static std::optional<std::string> LoadShaderSource(const std::filesystem::path& path,
+			std::vector<std::filesystem::path>* dependencies = nullptr);
+		static std::optional<std::vector<ShaderSource>> LoadShaderSources(const std::vector<ShaderStage>& stages,
+			std::vector<std::filesystem::path>* dependencies = nullptr);
+
+		// Loads the program from the program binary cache when an entry for the exact sources exists and the driver
+		// accepts it. Otherwise starts compiling and linking, without waiting on the results.
+		static PendingShaderProgram BeginShaderProgram(const std::string& programName,
+			const std::vector<ShaderSource>& sources);
+		// True once the results of the program can be read without stalling. Always true without parallel compile.
+		static bool IsShaderProgramReady(const PendingShaderProgram& pending);
+		// Checks the compile and link results and hands the program over. Programs built from source are stored in
+		// the program binary cache. Logs the errors and deletes everything on failure.
+		static std::optional<GLShaderProgram> FinishShaderProgram(PendingShaderProgram& pending);
+		// Drops a program that is no longer wanted
+		static void DiscardShaderProgram(PendingShaderProgram& pending);
+
+		static const ProgramBinaryStats& GetProgramBinaryStats();
 	};
 }; // namespace Graphics
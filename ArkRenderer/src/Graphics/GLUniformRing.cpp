@@ -0,0 +1,135 @@
+#include "GLUniformRing.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+void GLUniformRing::Init(const GLsizeiptr size) noexcept
+{
+	constexpr GLbitfield flags{ GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT };
+	m_size = size;
+	glCreateBuffers(1, &m_buffer);
+	glNamedBufferStorage(m_buffer, m_size, nullptr, flags);
+	m_mapped = static_cast<unsigned char*>(glMapNamedBufferRange(m_buffer, 0, m_size, flags));
+	GLint uniformAlignment{ 0 }, storageAlignment{ 0 };
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+	// Both are powers of two, so the larger one satisfies either binding
+	const auto alignment{ std::max(uniformAlignment, storageAlignment) };
+	m_alignment = alignment > 0 ? alignment : m_alignment;
+}
+
+void GLUniformRing::Delete() noexcept
+{
+	for (const auto& fence : m_fences)
+	{
+		glDeleteSync(fence.Sync);
+	}
+	m_fences.clear();
+	if (m_buffer != 0)
+	{
+		glUnmapNamedBuffer(m_buffer);
+		glDeleteBuffers(1, &m_buffer);
+	}
+	m_buffer = 0;
+	m_mapped = nullptr;
+	m_head = m_tail = 0;
+	m_full = m_unfenced = false;
+}
+
+GLintptr GLUniformRing::Push(const void* data, const GLsizeiptr size) noexcept
+{
+	assert(m_mapped && size <= m_size);
+
+	auto offset{ FindSpace(size) };
+	while (offset < 0)
+	{
+		// Everything in flight belongs to this frame, fence it so there is something to wait for. EndFrame may
+		// already retire that fence and free enough space.
+		if (m_fences.empty())
+		{
+			EndFrame();
+			offset = FindSpace(size);
+			if (offset >= 0 || m_fences.empty())
+			{
+				continue;
+			}
+		}
+		++m_stalls;
+		RetireOldest(true);
+		offset = FindSpace(size);
+	}
+
+	std::memcpy(m_mapped + offset, data, size);
+	m_head = offset + size;
+	m_full = m_head == m_tail;
+	m_unfenced = true;
+	return offset;
+}
+
+void GLUniformRing::BindRange(const GLuint index, const GLintptr offset, const GLsizeiptr size) const noexcept
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, index, m_buffer, offset, size);
+}
+
+void GLUniformRing::BindStorageRange(const GLuint index, const GLintptr offset, const GLsizeiptr size) const noexcept
+{
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, index, m_buffer, offset, size);
+}
+
+void GLUniformRing::EndFrame() noexcept
+{
+	if (m_unfenced)
+	{
+		m_fences.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), m_head });
+		m_unfenced = false;
+	}
+	// Give back the space of frames the GPU is already done with
+	while (!m_fences.empty() && RetireOldest(false))
+	{
+	}
+}
+
+GLintptr GLUniformRing::FindSpace(const GLsizeiptr size) const noexcept
+{
+	const auto aligned{ (m_head + m_alignment - 1) / m_alignment * m_alignment };
+	if (m_full)
+	{
+		return -1;
+	}
+	// Empty, or data in flight in [tail, head): free space is past head and before tail
+	if (m_head >= m_tail)
+	{
+		if (aligned + size <= m_size)
+		{
+			return aligned;
+		}
+		return m_head == m_tail || size <= m_tail ? 0 : -1;
+	}
+	// Wrapped, data in flight in [tail, end) and [0, head)
+	return aligned + size <= m_tail ? aligned : -1;
+}
+
+bool GLUniformRing::RetireOldest(const bool wait) noexcept
+{
+	const auto& fence{ m_fences.front() };
+	auto status{ glClientWaitSync(fence.Sync, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, 0) };
+	while (wait && status == GL_TIMEOUT_EXPIRED)
+	{
+		status = glClientWaitSync(fence.Sync, 0, 1000000000);
+	}
+	if (status == GL_TIMEOUT_EXPIRED)
+	{
+		return false;
+	}
+	glDeleteSync(fence.Sync);
+	m_tail = fence.End;
+	m_fences.pop_front();
+	// Later frames may fill the whole ring up to the retired one
+	m_full = m_tail == m_head && (!m_fences.empty() || m_unfenced);
+	// Nothing in flight, start over at the beginning so pushes don't wrap early
+	if (m_fences.empty() && !m_unfenced)
+	{
+		m_head = m_tail = 0;
+	}
+	return true;
+}
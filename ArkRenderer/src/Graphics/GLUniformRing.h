@@ -0,0 +1,57 @@
+#pragma once
+#include <glad/glad.h>
+#include <deque>
+
+// Persistently mapped uniform buffer handed out as a ring. Data pushed in a frame is written straight into the mapping
+// and bound by range, with no glBufferSubData or glUniform call per draw. Each frame is fenced by EndFrame and its
+// space is only reused once the GPU passed the fence. Offsets are aligned for uniform and shader storage ranges alike, so
+// arrays of per-draw data can be pushed and read as storage buffers.
+class GLUniformRing
+{
+public:
+	void Init(const GLsizeiptr size) noexcept;
+	void Delete() noexcept;
+
+	// Copies size bytes into the ring and returns their offset, aligned for glBindBufferRange. Waits for the GPU
+	// if the ring is full.
+	GLintptr Push(const void* data, const GLsizeiptr size) noexcept;
+	template <typename T>
+	GLintptr Push(const T& value) noexcept { return Push(&value, sizeof(T)); }
+	// Binds size bytes at offset to uniform block binding index
+	void BindRange(const GLuint index, const GLintptr offset, const GLsizeiptr size) const noexcept;
+	// Binds size bytes at offset to shader storage block binding index
+	void BindStorageRange(const GLuint index, const GLintptr offset, const GLsizeiptr size) const noexcept;
+	// Fences the data pushed since the last call. Call once per frame, after the draws that read it.
+	void EndFrame() noexcept;
+
+	[[nodiscard]] auto GetBufferId() const noexcept { return m_buffer; }
+	[[nodiscard]] auto GetSize() const noexcept { return m_size; }
+	// Times Push had to wait for the GPU
+	[[nodiscard]] auto GetNumStalls() const noexcept { return m_stalls; }
+
+private:
+	struct Fence
+	{
+		GLsync Sync{ nullptr };
+		// Head of the ring when the fence was inserted
+		GLintptr End{ 0 };
+	};
+
+	// Offset where size bytes fit without touching data in flight, or -1
+	GLintptr FindSpace(const GLsizeiptr size) const noexcept;
+	// Releases the space of the oldest frame once its fence signals. Returns false if it has not and wait is false.
+	bool RetireOldest(const bool wait) noexcept;
+
+	GLuint m_buffer{ 0 };
+	unsigned char* m_mapped{ nullptr };
+	GLsizeiptr m_size{ 0 };
+	GLintptr m_alignment{ 256 };
+	// Data is written at head and retired from tail. Equal offsets mean an empty ring unless m_full.
+	GLintptr m_head{ 0 };
+	GLintptr m_tail{ 0 };
+	bool m_full{ false };
+	// Data was pushed since the last EndFrame
+	bool m_unfenced{ false };
+	std::deque<Fence> m_fences;
+	std::size_t m_stalls{ 0 };
+};
@@ -2,16 +2,51 @@
 
 void GLVertexArray::Init() noexcept
 {
-	glGenVertexArrays(1, &m_vao);
+	glCreateVertexArrays(1, &m_vao);
 }
 
-void GLVertexArray::AttachBuffer(const BufferType type, const size_t size,
-                                 const DrawMode mode, const void* data) noexcept
+void GLVertexArray::SetAttribute(const GLuint index, const GLint size, const GLuint relativeOffset,
+                                 const GLuint binding) noexcept
 {
-	unsigned int buffer;
-	glGenBuffers(1, &buffer);
-	glBindBuffer(type, buffer);
-	glBufferData(type, size, data, mode);
+	SetAttribute(index, size, GL_FLOAT, false, relativeOffset, binding);
+}
+
+void GLVertexArray::SetAttribute(const GLuint index, const GLint size, const GLenum type, const bool normalized,
+                                 const GLuint relativeOffset, const GLuint binding) noexcept
+{
+	glEnableVertexArrayAttrib(m_vao, index);
+	glVertexArrayAttribFormat(m_vao, index, size, type, normalized ? GL_TRUE : GL_FALSE, relativeOffset);
+	glVertexArrayAttribBinding(m_vao, index, binding);
+}
+
+GLBuffer GLVertexArray::AttachBuffer(const GLuint binding, const std::size_t size, const void* data,
+                                     const GLsizei stride) noexcept
+{
+	GLBuffer buffer;
+	buffer.Init(size, data);
+	m_ownedBuffers.push_back(buffer);
+	SetVertexBuffer(binding, buffer, 0, stride);
+	return buffer;
+}
+
+GLBuffer GLVertexArray::AttachIndexBuffer(const std::size_t size, const void* data) noexcept
+{
+	GLBuffer buffer;
+	buffer.Init(size, data);
+	m_ownedBuffers.push_back(buffer);
+	SetIndexBuffer(buffer);
+	return buffer;
+}
+
+void GLVertexArray::SetVertexBuffer(const GLuint binding, const GLBuffer& buffer, const GLintptr offset,
+                                    const GLsizei stride) const noexcept
+{
+	glVertexArrayVertexBuffer(m_vao, binding, buffer.GetId(), offset, stride);
+}
+
+void GLVertexArray::SetIndexBuffer(const GLBuffer& buffer) const noexcept
+{
+	glVertexArrayElementBuffer(m_vao, buffer.GetId());
 }
 
 void GLVertexArray::Bind() const noexcept
@@ -21,13 +56,11 @@ void GLVertexArray::Bind() const noexcept
 
 void GLVertexArray::Delete() noexcept
 {
+	for (auto& buffer : m_ownedBuffers)
+	{
+		buffer.Delete();
+	}
+	m_ownedBuffers.clear();
 	glDeleteVertexArrays(1, &m_vao);
-}
-
-void GLVertexArray::EnableAttribute(const unsigned index, const int size,
-                                    const unsigned int offset,
-                                    const void* data) noexcept
-{
-	glEnableVertexAttribArray(index);
-	glVertexAttribPointer(index, size, GL_FLOAT, GL_FALSE, offset, data);
+	m_vao = 0;
 }
@@ -1,32 +1,42 @@
 #pragma once
 #include <glad/glad.h>
+#include <vector>
 
+#include "GLBuffer.h"
+
+// Vertex array object set up through direct state access. The attribute format is independent of the buffers: each
+// attribute reads from a binding point, and buffers are attached to binding points. Buffers created by AttachBuffer
+// and AttachIndexBuffer belong to the vertex array and are deleted with it, buffers set with SetVertexBuffer and
+// SetIndexBuffer are only referenced, which lets several vertex arrays share buffers or one vertex array format be
+// pointed at the buffers of many meshes.
 class GLVertexArray
 {
 public:
-	enum BufferType : int
-	{
-		Array = GL_ARRAY_BUFFER,
-		Element = GL_ELEMENT_ARRAY_BUFFER
-	};
-
-	enum DrawMode : int
-	{
-		Static = GL_STATIC_DRAW,
-		Dynamic = GL_DYNAMIC_DRAW,
-		Stream = GL_STREAM_DRAW
-	};
-
 	void Init() noexcept;
 
-	void AttachBuffer(const BufferType type, const size_t size,
-	                  const DrawMode mode, const void* data) noexcept;
+	// Attribute index reads size floats at relativeOffset within each vertex of binding
+	void SetAttribute(const GLuint index, const GLint size, const GLuint relativeOffset,
+	                  const GLuint binding) noexcept;
+	// Attribute stored as integers, e.g. quantized data. normalized maps them to [0, 1] or [-1, 1] in the shader.
+	void SetAttribute(const GLuint index, const GLint size, const GLenum type, const bool normalized,
+	                  const GLuint relativeOffset, const GLuint binding) noexcept;
+
+	// Creates an immutable buffer owned by this vertex array and attaches it to binding. The buffer is returned so
+	// other vertex arrays can reference it.
+	GLBuffer AttachBuffer(const GLuint binding, const std::size_t size, const void* data, const GLsizei stride) noexcept;
+	GLBuffer AttachIndexBuffer(const std::size_t size, const void* data) noexcept;
+	// Attaches a buffer owned elsewhere
+	void SetVertexBuffer(const GLuint binding, const GLBuffer& buffer, const GLintptr offset,
+	                     const GLsizei stride) const noexcept;
+	void SetIndexBuffer(const GLBuffer& buffer) const noexcept;
 
 	void Bind() const noexcept;
-	void EnableAttribute(const unsigned int index, const int size,
-	                     const unsigned int offset, const void* data) noexcept;
+	// Deletes the vertex array and the buffers it owns
 	void Delete() noexcept;
 
+	[[nodiscard]] auto GetId() const noexcept { return m_vao; }
+
 private:
 	unsigned int m_vao{0};
+	std::vector<GLBuffer> m_ownedBuffers;
 };
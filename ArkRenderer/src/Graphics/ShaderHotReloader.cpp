@@ -0,0 +1,185 @@
+#include "ShaderHotReloader.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace Graphics
+{
+	ShaderHotReloader::~ShaderHotReloader()
+	{
+		Stop();
+		// The context is usually gone by now, so programs still linking are left to it
+	}
+
+	void ShaderHotReloader::Watch(const std::string& programName, const std::vector<ShaderStage>& stages)
+	{
+		std::vector<std::filesystem::path> files;
+		for (const auto& stage : stages)
+		{
+			GLShaderProgramFactory::LoadShaderSource(stage.m_filePath, &files);
+		}
+		m_programs.push_back({ programName, stages, GetWriteTimes(files) });
+	}
+
+	void ShaderHotReloader::Start()
+	{
+		if (m_worker.joinable())
+		{
+			return;
+		}
+		m_stopping = false;
+		m_worker = std::thread([this]() {
+			std::unique_lock lock(m_mutex);
+			while (!m_wakeUp.wait_for(lock, POLL_INTERVAL, [this]() { return m_stopping; }))
+			{
+				lock.unlock();
+				Poll();
+				lock.lock();
+			}
+		});
+		std::cout << "Shader hot reload: watching " << m_programs.size() << " programs\n";
+	}
+
+	void ShaderHotReloader::Stop()
+	{
+		if (!m_worker.joinable())
+		{
+			return;
+		}
+		{
+			std::lock_guard lock(m_mutex);
+			m_stopping = true;
+		}
+		m_wakeUp.notify_one();
+		m_worker.join();
+	}
+
+	std::vector<std::string> ShaderHotReloader::Update(std::unordered_map<std::string, GLShaderProgram>& shaderCache)
+	{
+		std::unordered_map<std::string, std::vector<ShaderSource>> reloaded;
+		{
+			std::lock_guard lock(m_mutex);
+			reloaded.swap(m_reloaded);
+		}
+		for (auto& [name, sources] : reloaded)
+		{
+			// A newer edit supersedes a build still in flight
+			const auto linking{ m_linking.find(name) };
+			if (linking != m_linking.end())
+			{
+				GLShaderProgramFactory::DiscardShaderProgram(linking->second.Program);
+				m_linking.erase(linking);
+			}
+			m_linking.try_emplace(name, LinkingProgram{
+				GLShaderProgramFactory::BeginShaderProgram(name, sources), std::chrono::high_resolution_clock::now()
+			});
+		}
+
+		std::vector<std::string> swapped;
+		for (auto it = m_linking.begin(); it != m_linking.end();)
+		{
+			auto& [name, linking] = *it;
+			if (!GLShaderProgramFactory::IsShaderProgramReady(linking.Program))
+			{
+				++it;
+				continue;
+			}
+			auto program{ GLShaderProgramFactory::FinishShaderProgram(linking.Program) };
+			const std::chrono::duration<double, std::milli> elapsed{
+				std::chrono::high_resolution_clock::now() - linking.Start
+			};
+			if (program)
+			{
+				const auto cached{ shaderCache.find(name) };
+				if (cached != shaderCache.end())
+				{
+					cached->second = std::move(program.value());
+				}
+				else
+				{
+					shaderCache.try_emplace(name, std::move(program.value()));
+				}
+				std::cout << "Shader hot reload: " << name << " rebuilt in " << elapsed.count() << " ms\n";
+				swapped.push_back(name);
+			}
+			else
+			{
+				std::cout << "Shader hot reload: " << name << " failed, keeping the previous program\n";
+			}
+			it = m_linking.erase(it);
+		}
+		return swapped;
+	}
+
+	void ShaderHotReloader::Poll()
+	{
+		for (auto& program : m_programs)
+		{
+			bool changed{ false };
+			for (const auto& [path, writeTime] : program.Files)
+			{
+				std::error_code ec;
+				const auto current{ std::filesystem::last_write_time(path, ec) };
+				// A file missing for a moment is common while an editor saves, treat it as changed and let
+				// Reload retry until it is back
+				if (ec || current != writeTime)
+				{
+					changed = true;
+					break;
+				}
+			}
+			if (changed && Reload(program))
+			{
+				std::cout << "Shader hot reload: " << program.Name << " changed\n";
+			}
+		}
+	}
+
+	bool ShaderHotReloader::Reload(WatchedProgram& program)
+	{
+		// Times are taken before reading so an edit landing mid-read is picked up by the next poll
+		std::vector<std::filesystem::path> files;
+		for (const auto& [path, writeTime] : program.Files)
+		{
+			files.push_back(path);
+		}
+		auto writeTimes{ GetWriteTimes(files) };
+
+		files.clear();
+		auto sources{ GLShaderProgramFactory::LoadShaderSources(program.Stages, &files) };
+		if (!sources)
+		{
+			return false;
+		}
+		// The include set may have changed with the edit. Files new to the program get their current time.
+		for (const auto& [path, writeTime] : GetWriteTimes(files))
+		{
+			const auto known{ std::find_if(writeTimes.cbegin(), writeTimes.cend(),
+				[&path = path](const auto& file) { return file.first == path; }) };
+			if (known == writeTimes.cend())
+			{
+				writeTimes.emplace_back(path, writeTime);
+			}
+		}
+		writeTimes.erase(std::remove_if(writeTimes.begin(), writeTimes.end(), [&files](const auto& file) {
+			return std::find(files.cbegin(), files.cend(), file.first) == files.cend();
+		}), writeTimes.end());
+		program.Files = std::move(writeTimes);
+
+		std::lock_guard lock(m_mutex);
+		m_reloaded.insert_or_assign(program.Name, std::move(sources.value()));
+		return true;
+	}
+
+	std::vector<std::pair<std::filesystem::path, std::filesystem::file_time_type>> ShaderHotReloader::GetWriteTimes(
+		const std::vector<std::filesystem::path>& files)
+	{
+		std::vector<std::pair<std::filesystem::path, std::filesystem::file_time_type>> writeTimes;
+		for (const auto& file : files)
+		{
+			std::error_code ec;
+			writeTimes.emplace_back(file, std::filesystem::last_write_time(file, ec));
+		}
+		return writeTimes;
+	}
+}; // namespace Graphics
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "GLShaderProgram.h"
+#include "GLShaderProgramFactory.h"
+#include "ShaderStage.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Graphics
+{
+	// Watches the sources of shader programs, includes too, and rebuilds a program when one of its files changes.
+	// A worker thread polls the file times and reads and preprocesses the edited sources. The GL side runs in Update
+	// on the render thread: it starts the compile and link and, once the driver is done, swaps the program into the
+	// shader cache if it linked. Until then, or if the edit broke the shader, frames keep the previous program.
+	class ShaderHotReloader
+	{
+	public:
+		static constexpr std::chrono::milliseconds POLL_INTERVAL{ 250 };
+
+		ShaderHotReloader() = default;
+		~ShaderHotReloader();
+
+		ShaderHotReloader(const ShaderHotReloader&) = delete;
+		ShaderHotReloader& operator=(const ShaderHotReloader&) = delete;
+
+		// Adds a program built from stages. Only valid before Start.
+		void Watch(const std::string& programName, const std::vector<ShaderStage>& stages);
+		void Start();
+		void Stop();
+
+		// Starts building the programs the worker reloaded and swaps finished ones into shaderCache. Returns the
+		// names of the programs swapped in, whose uniforms are back to their defaults. Render thread only.
+		std::vector<std::string> Update(std::unordered_map<std::string, GLShaderProgram>& shaderCache);
+
+	private:
+		struct WatchedProgram
+		{
+			std::string Name;
+			std::vector<ShaderStage> Stages;
+			// Every file the program was last built from and its write time then
+			std::vector<std::pair<std::filesystem::path, std::filesystem::file_time_type>> Files;
+		};
+
+		struct LinkingProgram
+		{
+			PendingShaderProgram Program;
+			std::chrono::high_resolution_clock::time_point Start;
+		};
+
+		void Poll();
+		// Rereads a changed program. False if a file could not be read, the next poll retries then.
+		bool Reload(WatchedProgram& program);
+		static std::vector<std::pair<std::filesystem::path, std::filesystem::file_time_type>> GetWriteTimes(
+			const std::vector<std::filesystem::path>& files);
+
+		// Owned by the worker once started
+		std::vector<WatchedProgram> m_programs;
+		std::thread m_worker;
+
+		std::mutex m_mutex;
+		std::condition_variable m_wakeUp;
+		bool m_stopping{ false };
+		// Sources read by the worker and not yet picked up by Update, the latest edit of a program wins
+		std::unordered_map<std::string, std::vector<ShaderSource>> m_reloaded;
+
+		// Render thread only
+		std::unordered_map<std::string, LinkingProgram> m_linking;
+	};
+}; // namespace Graphics
@@ -24,4 +24,11 @@ namespace Graphics
 		std::string m_filePath;
 		std::string m_type;
 	};
+
+	// Preprocessed code of one stage, ready to be compiled
+	struct ShaderSource
+	{
+		std::string m_type;
+		std::string m_code;
+	};
 }; // namespace Graphics
@@ -1,33 +1,166 @@
 #include "Mesh.h"
 
 #include <iostream>
+#include <limits>
+#include <glm/ext/matrix_transform.hpp>
+
+#include <Ark/VertexPacking.hpp>
 
 Mesh::Mesh(const std::vector<Vertex>& vertices,
-           const std::vector<unsigned>& indices) : m_indexCount(indices.size())
+           const std::vector<unsigned>& indices, const VertexLayout layout) :
+	m_indexCount(indices.size()),
+	m_vertexCount(vertices.size()),
+	m_layout(layout)
 {
 	SetUp(vertices, indices);
 }
 
-Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, const PBRMaterialPtr& material) :
+Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, const PBRMaterialPtr& material,
+           const VertexLayout layout) :
 	m_indexCount(indices.size()),
+	m_vertexCount(vertices.size()),
+	m_layout(layout),
 	Material(material) {
 
 	SetUp(vertices, indices);
 }
 
+std::size_t Mesh::GetPositionStride() const noexcept
+{
+	switch (m_layout)
+	{
+	case VertexLayout::Interleaved:
+		return sizeof(Vertex);
+	case VertexLayout::Packed:
+		return sizeof(PackedPosition);
+	default:
+		return sizeof(glm::vec3);
+	}
+}
+
+std::size_t Mesh::GetVertexSize() const noexcept
+{
+	return m_layout == VertexLayout::Packed ? sizeof(PackedPosition) + sizeof(PackedVertexAttributes) : sizeof(Vertex);
+}
+
+void Mesh::SetUpVertexFormat(GLVertexArray& vao, const VertexLayout layout, const bool positionOnly)
+{
+	if (layout == VertexLayout::Interleaved)
+	{
+		vao.SetAttribute(0, 3, offsetof(Vertex, m_position), POSITION_BINDING);
+		if (!positionOnly)
+		{
+			vao.SetAttribute(1, 2, offsetof(Vertex, m_texCoords), POSITION_BINDING);
+			vao.SetAttribute(2, 3, offsetof(Vertex, m_normal), POSITION_BINDING);
+			vao.SetAttribute(3, 3, offsetof(Vertex, m_tangent), POSITION_BINDING);
+		}
+	}
+	else if (layout == VertexLayout::Packed)
+	{
+		vao.SetAttribute(0, 3, GL_UNSIGNED_SHORT, true, 0, POSITION_BINDING);
+		if (!positionOnly)
+		{
+			vao.SetAttribute(1, 2, GL_UNSIGNED_SHORT, true, offsetof(PackedVertexAttributes, m_texCoords), ATTRIBUTE_BINDING);
+			vao.SetAttribute(2, 2, GL_SHORT, true, offsetof(PackedVertexAttributes, m_normal), ATTRIBUTE_BINDING);
+			vao.SetAttribute(3, 2, GL_SHORT, true, offsetof(PackedVertexAttributes, m_tangent), ATTRIBUTE_BINDING);
+		}
+	}
+	else
+	{
+		vao.SetAttribute(0, 3, 0, POSITION_BINDING);
+		if (!positionOnly)
+		{
+			vao.SetAttribute(1, 2, offsetof(VertexAttributes, m_texCoords), ATTRIBUTE_BINDING);
+			vao.SetAttribute(2, 3, offsetof(VertexAttributes, m_normal), ATTRIBUTE_BINDING);
+			vao.SetAttribute(3, 3, offsetof(VertexAttributes, m_tangent), ATTRIBUTE_BINDING);
+		}
+	}
+}
+
 void Mesh::SetUp(const std::vector<Vertex>& vertices,
                  const std::vector<unsigned int>& indices)
 {
 	m_vao.Init();
-	m_vao.Bind();
-	m_vao.AttachBuffer(GLVertexArray::Array, vertices.size() * sizeof(Vertex),
-	                   GLVertexArray::DrawMode::Static, &vertices[0]);
-	m_vao.AttachBuffer(GLVertexArray::Element,
-	                   indices.size() * sizeof(unsigned int),
-	                   GLVertexArray::DrawMode::Static, &indices[0]);
-	constexpr auto vertexSize = sizeof(Vertex);
-	m_vao.EnableAttribute(0, 3, vertexSize, nullptr);
-	m_vao.EnableAttribute(1, 2, vertexSize, reinterpret_cast<void*>(offsetof(Vertex, m_texCoords)));
-	m_vao.EnableAttribute(2, 3, vertexSize, reinterpret_cast<void*>(offsetof(Vertex, m_normal)));
-	m_vao.EnableAttribute(3, 3, vertexSize, reinterpret_cast<void*>(offsetof(Vertex, m_tangent)));
-}
\ No newline at end of file
+	SetUpVertexFormat(m_vao, m_layout, false);
+	if (m_layout == VertexLayout::Interleaved)
+	{
+		m_positionBuffer = m_vao.AttachBuffer(POSITION_BINDING, vertices.size() * sizeof(Vertex), vertices.data(),
+		                                      sizeof(Vertex));
+	}
+	else if (m_layout == VertexLayout::Packed)
+	{
+		SetUpPacked(vertices);
+	}
+	else
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<VertexAttributes> attributes;
+		positions.reserve(vertices.size());
+		attributes.reserve(vertices.size());
+		for (const auto& vertex : vertices)
+		{
+			positions.push_back(vertex.m_position);
+			attributes.push_back({ vertex.m_texCoords, vertex.m_normal, vertex.m_tangent });
+		}
+
+		m_positionBuffer = m_vao.AttachBuffer(POSITION_BINDING, positions.size() * sizeof(glm::vec3),
+		                                      positions.data(), sizeof(glm::vec3));
+		m_attributeBuffer = m_vao.AttachBuffer(ATTRIBUTE_BINDING, attributes.size() * sizeof(VertexAttributes),
+		                                       attributes.data(), sizeof(VertexAttributes));
+	}
+	m_indexBuffer = m_vao.AttachIndexBuffer(indices.size() * sizeof(unsigned int), indices.data());
+
+	// Depth-only VAO sharing the position and index buffers
+	m_positionVao.Init();
+	SetUpVertexFormat(m_positionVao, m_layout, true);
+	m_positionVao.SetVertexBuffer(POSITION_BINDING, m_positionBuffer, 0, static_cast<GLsizei>(GetPositionStride()));
+	m_positionVao.SetIndexBuffer(m_indexBuffer);
+}
+
+void Mesh::SetUpPacked(const std::vector<Vertex>& vertices)
+{
+	AABB bounds;
+	glm::vec2 uvMin{ std::numeric_limits<float>::max() }, uvMax{ std::numeric_limits<float>::lowest() };
+	for (const auto& vertex : vertices)
+	{
+		bounds.Extend(vertex.m_position);
+		uvMin = glm::min(uvMin, vertex.m_texCoords);
+		uvMax = glm::max(uvMax, vertex.m_texCoords);
+	}
+	if (vertices.empty())
+	{
+		bounds.Extend(glm::vec3(0.0f));
+		uvMin = uvMax = glm::vec2(0.0f);
+	}
+
+	const Ark::VertexPacking::QuantizationRange<glm::vec3> positionRange(bounds.GetMin(), bounds.GetMax());
+	const Ark::VertexPacking::QuantizationRange<glm::vec2> uvRange(uvMin, uvMax);
+	m_dequantize = glm::scale(glm::translate(glm::mat4(1.0f), positionRange.offset), positionRange.extent);
+	m_uvTransform = glm::vec4(uvRange.offset, uvRange.extent);
+
+	std::vector<PackedPosition> positions;
+	std::vector<PackedVertexAttributes> attributes;
+	positions.reserve(vertices.size());
+	attributes.reserve(vertices.size());
+	for (const auto& vertex : vertices)
+	{
+		const auto position{ positionRange.Normalize(vertex.m_position) };
+		const auto texCoords{ uvRange.Normalize(vertex.m_texCoords) };
+		const auto normal{ Ark::VertexPacking::OctEncode(vertex.m_normal) };
+		const auto tangent{ Ark::VertexPacking::OctEncode(vertex.m_tangent) };
+		positions.push_back({ {
+			Ark::VertexPacking::QuantizeUnorm16(position.x),
+			Ark::VertexPacking::QuantizeUnorm16(position.y),
+			Ark::VertexPacking::QuantizeUnorm16(position.z),
+			0 } });
+		attributes.push_back({
+			{ Ark::VertexPacking::QuantizeUnorm16(texCoords.x), Ark::VertexPacking::QuantizeUnorm16(texCoords.y) },
+			{ normal.x, normal.y },
+			{ tangent.x, tangent.y } });
+	}
+
+	m_positionBuffer = m_vao.AttachBuffer(POSITION_BINDING, positions.size() * sizeof(PackedPosition),
+	                                      positions.data(), sizeof(PackedPosition));
+	m_attributeBuffer = m_vao.AttachBuffer(ATTRIBUTE_BINDING, attributes.size() * sizeof(PackedVertexAttributes),
+	                                       attributes.data(), sizeof(PackedVertexAttributes));
+}
@@ -3,25 +3,60 @@
 #include "Vertex.h"
 #include <vector>
 #include "PBRMaterial.h"
+#include "AABB.h"
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
 
 struct Mesh
 {
 public:
+	// Vertex buffer binding points. Interleaved meshes only use POSITION_BINDING, for all attributes.
+	static constexpr GLuint POSITION_BINDING{ 0 };
+	static constexpr GLuint ATTRIBUTE_BINDING{ 1 };
+
+	// Owns the vertex and index buffers
 	GLVertexArray m_vao;
+	// Binds only the position stream, for depth-only passes. Shares the buffers of m_vao.
+	GLVertexArray m_positionVao;
+	// The buffers of m_vao, so they can be copied into shared buffers. Interleaved meshes have no attribute buffer.
+	GLBuffer m_positionBuffer;
+	GLBuffer m_attributeBuffer;
+	GLBuffer m_indexBuffer;
 	const std::size_t m_indexCount;
+	const std::size_t m_vertexCount;
+	const VertexLayout m_layout;
 	PBRMaterialPtr Material;
+	// Object-space bounds of this mesh
+	AABB m_aabb;
+	// VertexLayout::Packed only. Maps quantized positions back to object space, fold it into the model matrix.
+	glm::mat4 m_dequantize{ 1.0f };
+	// VertexLayout::Packed only. UV offset in xy and extent in zw.
+	glm::vec4 m_uvTransform{ 0.0f, 0.0f, 1.0f, 1.0f };
 	Mesh(const std::vector<Vertex>& vertices,
-	     const std::vector<unsigned int>& indices);
+	     const std::vector<unsigned int>& indices,
+	     const VertexLayout layout = VertexLayout::SplitPosition);
 	Mesh(const std::vector<Vertex>& vertices,
-	     const std::vector<GLuint>& indices, const PBRMaterialPtr& material);
+	     const std::vector<GLuint>& indices, const PBRMaterialPtr& material,
+	     const VertexLayout layout = VertexLayout::SplitPosition);
 
 	[[nodiscard]] auto GetTriangleCount() const noexcept
 	{
 		return m_indexCount / 3;
 	}
 
+	// Bytes a depth-only pass fetches per vertex with this mesh's layout
+	[[nodiscard]] std::size_t GetPositionStride() const noexcept;
+	// Bytes of vertex data per vertex across all streams
+	[[nodiscard]] std::size_t GetVertexSize() const noexcept;
+
+	// Sets up the attribute format of layout on vao, without attaching buffers. With positionOnly only attribute 0
+	// is enabled. Every mesh of a layout can be drawn through one vertex array set up this way.
+	static void SetUpVertexFormat(GLVertexArray& vao, const VertexLayout layout, const bool positionOnly);
+
 	void Clear();
 private:
 	void SetUp(const std::vector<Vertex>& vertices,
 	           const std::vector<unsigned int>& indices);
+	// Quantizes vertices into a position and an attribute stream
+	void SetUpPacked(const std::vector<Vertex>& vertices);
 };
@@ -0,0 +1,230 @@
+#include "MeshBatch.h"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <string_view>
+#include <unordered_map>
+
+// GL_ARB_bindless_texture, not part of the generated GLAD loader
+typedef GLuint64 (APIENTRYP PFNGLGETTEXTURESAMPLERHANDLEARBPROC)(GLuint texture, GLuint sampler);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+
+// Set by InitBindlessTextures, all null without the extension
+PFNGLGETTEXTURESAMPLERHANDLEARBPROC GetTextureSamplerHandle{ nullptr };
+PFNGLMAKETEXTUREHANDLERESIDENTARBPROC MakeTextureHandleResident{ nullptr };
+PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC MakeTextureHandleNonResident{ nullptr };
+
+/***********************************************************************************/
+bool MeshBatch::InitBindlessTextures(GLADloadproc loader) {
+	GLint numExtensions{ 0 };
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+	bool supported{ false };
+	for (GLint i = 0; i < numExtensions && !supported; ++i) {
+		supported = std::string_view(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i))) ==
+			"GL_ARB_bindless_texture";
+	}
+	if (supported) {
+		GetTextureSamplerHandle = reinterpret_cast<PFNGLGETTEXTURESAMPLERHANDLEARBPROC>(
+			loader("glGetTextureSamplerHandleARB"));
+		MakeTextureHandleResident = reinterpret_cast<PFNGLMAKETEXTUREHANDLERESIDENTARBPROC>(
+			loader("glMakeTextureHandleResidentARB"));
+		MakeTextureHandleNonResident = reinterpret_cast<PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC>(
+			loader("glMakeTextureHandleNonResidentARB"));
+	}
+	std::cout << "Bindless textures: " << (HasBindlessTextures() ? "GL_ARB_bindless_texture" :
+		"not supported, multi-draws are split by texture") << "\n";
+	return HasBindlessTextures();
+}
+
+/***********************************************************************************/
+bool MeshBatch::HasBindlessTextures() noexcept {
+	return GetTextureSamplerHandle && MakeTextureHandleResident && MakeTextureHandleNonResident;
+}
+
+/***********************************************************************************/
+bool MeshBatch::Build(const std::vector<ModelPtr>& models, const GLuint sampler) {
+	Delete();
+
+	std::size_t vertexCount{ 0 }, indexCount{ 0 }, meshCount{ 0 };
+	const Mesh* first{ nullptr };
+	for (const auto& model : models) {
+		for (const auto& mesh : model->GetMeshes()) {
+			if (!first) {
+				first = &mesh;
+			}
+			if (mesh.m_layout != first->m_layout) {
+				return false;
+			}
+			vertexCount += mesh.m_vertexCount;
+			indexCount += mesh.m_indexCount;
+			++meshCount;
+		}
+	}
+	if (!first || first->m_layout == VertexLayout::Packed) {
+		return false;
+	}
+
+	// The source buffers are copied on the GPU, the meshes keep no vertex data on the CPU
+	const auto layout{ first->m_layout };
+	const auto positionStride{ first->GetPositionStride() };
+	m_vao.Init();
+	Mesh::SetUpVertexFormat(m_vao, layout, false);
+	const auto positions{ m_vao.AttachBuffer(Mesh::POSITION_BINDING, vertexCount * positionStride, nullptr,
+	                                         static_cast<GLsizei>(positionStride)) };
+	GLBuffer attributes;
+	if (layout != VertexLayout::Interleaved) {
+		attributes = m_vao.AttachBuffer(Mesh::ATTRIBUTE_BINDING, vertexCount * sizeof(VertexAttributes), nullptr,
+		                                sizeof(VertexAttributes));
+	}
+	const auto indices{ m_vao.AttachIndexBuffer(indexCount * sizeof(GLuint), nullptr) };
+
+	m_bindless = HasBindlessTextures();
+	std::unordered_map<GLuint, GLuint64> handles;
+	std::size_t baseVertex{ 0 }, firstIndex{ 0 };
+	m_drawData.reserve(meshCount);
+	m_meshCommands.reserve(meshCount);
+	m_albedoTextures.reserve(meshCount);
+	for (const auto& model : models) {
+		for (const auto& mesh : model->GetMeshes()) {
+			if (mesh.m_vertexCount > 0) {
+				glCopyNamedBufferSubData(mesh.m_positionBuffer.GetId(), positions.GetId(), 0,
+				                         baseVertex * positionStride, mesh.m_vertexCount * positionStride);
+				if (attributes.IsValid()) {
+					glCopyNamedBufferSubData(mesh.m_attributeBuffer.GetId(), attributes.GetId(), 0,
+					                         baseVertex * sizeof(VertexAttributes),
+					                         mesh.m_vertexCount * sizeof(VertexAttributes));
+				}
+			}
+			if (mesh.m_indexCount > 0) {
+				glCopyNamedBufferSubData(mesh.m_indexBuffer.GetId(), indices.GetId(), 0, firstIndex * sizeof(GLuint),
+				                         mesh.m_indexCount * sizeof(GLuint));
+			}
+
+			DrawCommand command;
+			command.Count = static_cast<GLuint>(mesh.m_indexCount);
+			command.FirstIndex = static_cast<GLuint>(firstIndex);
+			command.BaseVertex = static_cast<GLint>(baseVertex);
+			// Read back as gl_BaseInstance to find the DrawData
+			command.BaseInstance = static_cast<GLuint>(m_meshCommands.size());
+			m_meshCommands.push_back(command);
+
+			const auto albedo{ mesh.Material->GetParameterTexture(PBRMaterial::ALBEDO) };
+			DrawData drawData;
+			drawData.UvTransform = mesh.m_uvTransform;
+			if (m_bindless) {
+				// One handle per texture, materials often share them
+				auto handle{ handles.find(albedo) };
+				if (handle == handles.end()) {
+					handle = handles.emplace(albedo, GetTextureSamplerHandle(albedo, sampler)).first;
+					MakeTextureHandleResident(handle->second);
+					m_textureHandles.push_back(handle->second);
+				}
+				drawData.Albedo = handle->second;
+			}
+			m_drawData.push_back(drawData);
+			m_albedoTextures.push_back(albedo);
+
+			baseVertex += mesh.m_vertexCount;
+			firstIndex += mesh.m_indexCount;
+		}
+		m_models.push_back(model.get());
+	}
+
+	m_drawOrder.resize(meshCount);
+	std::iota(m_drawOrder.begin(), m_drawOrder.end(), 0u);
+	if (!m_bindless) {
+		std::stable_sort(m_drawOrder.begin(), m_drawOrder.end(), [this](const auto a, const auto b) {
+			return m_albedoTextures[a] < m_albedoTextures[b];
+		});
+	}
+
+	m_drawDataBuffer.Init(m_drawData.size() * sizeof(DrawData), m_drawData.data(), GL_DYNAMIC_STORAGE_BIT);
+	m_commandBuffer.Init(m_meshCommands.size() * sizeof(DrawCommand), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	m_frameCommands.reserve(meshCount);
+
+	std::cout << "Mesh batch: " << meshCount << " meshes, " << vertexCount << " vertices, " << indexCount / 3
+		<< " triangles, " << handles.size() << " bindless textures\n";
+	return true;
+}
+
+/***********************************************************************************/
+bool MeshBatch::IsBuiltFrom(const std::vector<ModelPtr>& models) const noexcept {
+	if (models.size() != m_models.size()) {
+		return false;
+	}
+	for (std::size_t m = 0; m < models.size(); ++m) {
+		if (models[m].get() != m_models[m]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/***********************************************************************************/
+void MeshBatch::Delete() {
+	for (const auto handle : m_textureHandles) {
+		MakeTextureHandleNonResident(handle);
+	}
+	m_textureHandles.clear();
+	m_vao.Delete();
+	m_drawDataBuffer.Delete();
+	m_commandBuffer.Delete();
+	m_drawData.clear();
+	m_meshCommands.clear();
+	m_albedoTextures.clear();
+	m_drawOrder.clear();
+	m_models.clear();
+	m_frameCommands.clear();
+	m_runs.clear();
+}
+
+/***********************************************************************************/
+void MeshBatch::Draw(const std::vector<ModelPtr>& models, const std::vector<std::uint8_t>& visibility) {
+	m_frameCommands.clear();
+	m_runs.clear();
+	if (IsEmpty()) {
+		return;
+	}
+
+	std::size_t meshIndex{ 0 };
+	for (const auto& model : models) {
+		const auto modelMatrix{ model->GetModelMatrix() };
+		for (std::size_t i = 0; i < model->GetMeshes().size(); ++i) {
+			m_drawData[meshIndex++].Model = modelMatrix;
+		}
+	}
+	m_drawDataBuffer.Update(0, m_drawData.size() * sizeof(DrawData), m_drawData.data());
+
+	for (const auto mesh : m_drawOrder) {
+		if (!visibility[mesh]) {
+			continue;
+		}
+		if (m_runs.empty() || (!m_bindless && m_runs.back().Texture != m_albedoTextures[mesh])) {
+			m_runs.push_back({ m_albedoTextures[mesh], m_frameCommands.size(), 0 });
+		}
+		m_frameCommands.push_back(m_meshCommands[mesh]);
+		++m_runs.back().Count;
+	}
+	if (m_frameCommands.empty()) {
+		return;
+	}
+	m_commandBuffer.Update(0, m_frameCommands.size() * sizeof(DrawCommand), m_frameCommands.data());
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, m_drawDataBuffer.GetId());
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer.GetId());
+	m_vao.Bind();
+	for (const auto& run : m_runs) {
+		if (!m_bindless) {
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, run.Texture);
+		}
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+		                            reinterpret_cast<const void*>(run.FirstCommand * sizeof(DrawCommand)), run.Count, 0);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	if (!m_bindless) {
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+}
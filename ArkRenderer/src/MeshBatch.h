@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include "Graphics/GLBuffer.h"
+#include "Graphics/GLVertexArray.h"
+#include "Model.h"
+
+// The meshes of a render list merged into one set of vertex and index buffers and drawn with
+// glMultiDrawElementsIndirect. Every mesh is one indirect command whose base instance indexes its DrawData in a
+// shader storage buffer, so the shader fetches the model matrix and material from there instead of per-draw
+// uniforms. With ARB_bindless_texture the albedo texture is a handle in DrawData and a pass is a single multi-draw.
+// Without it the commands are sorted by albedo texture and each run of one texture is its own multi-draw.
+// Packed meshes are not supported, their dequantization differs per mesh in the vertex format.
+class MeshBatch
+{
+public:
+	// std430 mirror of DrawData in draw_data.glsl
+	struct DrawData
+	{
+		glm::mat4 Model;
+		glm::vec4 UvTransform;
+		// Bindless handle of the albedo texture, 0 without bindless
+		GLuint64 Albedo{ 0 };
+		GLuint64 Padding{ 0 };
+	};
+	// Layout glMultiDrawElementsIndirect reads
+	struct DrawCommand
+	{
+		GLuint Count{ 0 };
+		GLuint InstanceCount{ 1 };
+		GLuint FirstIndex{ 0 };
+		GLint BaseVertex{ 0 };
+		GLuint BaseInstance{ 0 };
+	};
+	static constexpr GLuint DRAW_DATA_BINDING{ 2 };
+
+	// Loads the ARB_bindless_texture entry points if the driver has the extension. glad is generated without it.
+	static bool InitBindlessTextures(GLADloadproc loader);
+	[[nodiscard]] static bool HasBindlessTextures() noexcept;
+
+	// Copies the meshes of models into the shared buffers. sampler is baked into the bindless handles. Returns false,
+	// leaving the batch empty, if the meshes do not share one supported layout.
+	bool Build(const std::vector<ModelPtr>& models, GLuint sampler);
+	// True if the batch was built from exactly these models
+	[[nodiscard]] bool IsBuiltFrom(const std::vector<ModelPtr>& models) const noexcept;
+	void Delete();
+
+	// Draws the meshes flagged in visibility, given in render list mesh order, with the program bound by the caller.
+	// Model matrices are refreshed from models first, which must be the list the batch was built from. Without
+	// bindless textures the albedo texture is bound to unit 1.
+	void Draw(const std::vector<ModelPtr>& models, const std::vector<std::uint8_t>& visibility);
+
+	[[nodiscard]] bool IsEmpty() const noexcept { return m_meshCommands.empty(); }
+	// Draws need the bindless shader variant
+	[[nodiscard]] bool IsBindless() const noexcept { return m_bindless; }
+	// glMultiDrawElementsIndirect calls and commands issued by the last Draw
+	[[nodiscard]] auto GetNumMultiDraws() const noexcept { return m_runs.size(); }
+	[[nodiscard]] auto GetNumCommands() const noexcept { return m_frameCommands.size(); }
+
+private:
+	// Commands sharing one albedo texture, drawn by one glMultiDrawElementsIndirect
+	struct Run
+	{
+		GLuint Texture{ 0 };
+		std::size_t FirstCommand{ 0 };
+		GLsizei Count{ 0 };
+	};
+
+	// Owns the shared vertex and index buffers
+	GLVertexArray m_vao;
+	GLBuffer m_drawDataBuffer;
+	GLBuffer m_commandBuffer;
+
+	// Per mesh, in render list order
+	std::vector<DrawData> m_drawData;
+	std::vector<DrawCommand> m_meshCommands;
+	std::vector<GLuint> m_albedoTextures;
+	// Mesh indices in submission order, grouped by albedo texture without bindless
+	std::vector<std::uint32_t> m_drawOrder;
+	// Resident bindless handles, made non-resident by Delete
+	std::vector<GLuint64> m_textureHandles;
+	std::vector<const Model*> m_models;
+	// Materials are reached through m_textureHandles rather than texture binds
+	bool m_bindless{ false };
+
+	// Rebuilt by every Draw
+	std::vector<DrawCommand> m_frameCommands;
+	std::vector<Run> m_runs;
+};
@@ -0,0 +1,225 @@
+#include "MeshCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <type_traits>
+
+const static std::filesystem::path MESH_CACHE_DIR{ std::filesystem::current_path() / "resource/cache/meshes" };
+
+// "AMSH"
+constexpr std::uint32_t MESH_CACHE_MAGIC{ 0x48534D41 };
+
+struct MeshCacheHeader {
+	std::uint32_t Magic{ MESH_CACHE_MAGIC };
+	std::uint32_t Version{ MeshCache::VERSION };
+	std::uint32_t ImportFlags{ 0 };
+	std::uint32_t LoadMaterial{ 0 };
+	std::int64_t SourceMTime{ 0 };
+	double ColdLoadMs{ 0.0 };
+	std::uint32_t MeshCount{ 0 };
+	std::uint32_t VertexSize{ sizeof(Vertex) };
+};
+
+static_assert(std::is_trivially_copyable_v<Vertex>, "Vertex is written to the mesh cache as raw bytes");
+static_assert(std::is_trivially_copyable_v<MeshOptimizer::Report>, "Optimizer reports are written to the mesh cache as raw bytes");
+
+/***********************************************************************************/
+// Walks a file image that was read in one go. Every read is bounds checked so a truncated file is rejected.
+class CacheReader {
+public:
+	explicit CacheReader(const std::vector<char>& bytes) : m_bytes(bytes) {}
+
+	template <typename T>
+	bool Read(T& out) {
+		return ReadBytes(&out, sizeof(T));
+	}
+
+	bool ReadString(std::string& out) {
+		std::uint32_t length{ 0 };
+		if (!Read(length) || m_offset + length > m_bytes.size()) {
+			return false;
+		}
+		out.assign(m_bytes.data() + m_offset, length);
+		m_offset += length;
+		return true;
+	}
+
+	template <typename T>
+	bool ReadArray(std::vector<T>& out, const std::size_t count) {
+		out.resize(count);
+		return ReadBytes(out.data(), count * sizeof(T));
+	}
+
+private:
+	bool ReadBytes(void* dst, const std::size_t size) {
+		if (m_offset + size > m_bytes.size()) {
+			return false;
+		}
+		std::memcpy(dst, m_bytes.data() + m_offset, size);
+		m_offset += size;
+		return true;
+	}
+
+	const std::vector<char>& m_bytes;
+	std::size_t m_offset{ 0 };
+};
+
+/***********************************************************************************/
+template <typename T>
+void writePod(std::ofstream& out, const T& value) {
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/***********************************************************************************/
+void writeString(std::ofstream& out, const std::string& str) {
+	writePod(out, static_cast<std::uint32_t>(str.size()));
+	out.write(str.data(), str.size());
+}
+
+/***********************************************************************************/
+std::optional<std::int64_t> getSourceMTime(const std::filesystem::path& source) {
+	std::error_code ec;
+	const auto time{ std::filesystem::last_write_time(source, ec) };
+	if (ec) {
+		return std::nullopt;
+	}
+	return static_cast<std::int64_t>(time.time_since_epoch().count());
+}
+
+/***********************************************************************************/
+std::optional<std::vector<char>> readWholeFile(const std::filesystem::path& path) {
+	std::ifstream in(path, std::ios::binary | std::ios::ate);
+	if (!in) {
+		return std::nullopt;
+	}
+
+	const auto size{ static_cast<std::size_t>(in.tellg()) };
+	std::vector<char> bytes(size);
+	in.seekg(0);
+	if (!in.read(bytes.data(), size)) {
+		return std::nullopt;
+	}
+	return std::make_optional(std::move(bytes));
+}
+
+/***********************************************************************************/
+std::filesystem::path MeshCache::BuildCachePath(const Key& key) {
+	const auto sourceString{ key.Source.generic_string() };
+	const auto hash{ std::hash<std::string>{}(sourceString) };
+
+	std::ostringstream filename;
+	filename << key.Source.stem().string() << '_' << std::hex << hash << ".bin";
+	return MESH_CACHE_DIR / filename.str();
+}
+
+/***********************************************************************************/
+std::optional<MeshCache::Entry> MeshCache::Load(const Key& key) {
+	const auto mtime{ getSourceMTime(key.Source) };
+	if (!mtime) {
+		return std::nullopt;
+	}
+
+	const auto bytes{ readWholeFile(BuildCachePath(key)) };
+	if (!bytes) {
+		return std::nullopt;
+	}
+
+	CacheReader reader(bytes.value());
+	MeshCacheHeader header;
+	std::string source;
+	if (!reader.Read(header) || !reader.ReadString(source)) {
+		return std::nullopt;
+	}
+
+	// Anything that does not match exactly is treated as a stale entry and rebuilt by the caller
+	if (header.Magic != MESH_CACHE_MAGIC || header.Version != VERSION ||
+		header.VertexSize != sizeof(Vertex) ||
+		header.ImportFlags != key.ImportFlags ||
+		header.LoadMaterial != static_cast<std::uint32_t>(key.LoadMaterial) ||
+		header.SourceMTime != mtime.value() ||
+		source != key.Source.generic_string()) {
+		return std::nullopt;
+	}
+
+	Entry entry;
+	entry.ColdLoadMs = header.ColdLoadMs;
+	entry.Meshes.resize(header.MeshCount);
+
+	for (auto& mesh : entry.Meshes) {
+		std::uint32_t vertexCount{ 0 }, indexCount{ 0 };
+		glm::vec3 min, max;
+		const auto ok{ reader.Read(vertexCount) && reader.Read(indexCount) &&
+			reader.Read(min) && reader.Read(max) &&
+			reader.Read(mesh.Optimization) &&
+			reader.ReadString(mesh.MaterialName) &&
+			reader.ReadString(mesh.AlbedoPath) &&
+			reader.ReadString(mesh.MetallicPath) &&
+			reader.ReadString(mesh.NormalPath) &&
+			reader.ReadString(mesh.RoughnessPath) &&
+			reader.ReadString(mesh.AlphaMaskPath) &&
+			reader.ReadArray(mesh.Vertices, vertexCount) &&
+			reader.ReadArray(mesh.Indices, indexCount) };
+
+		if (!ok) {
+			std::cerr << "Mesh Cache: Truncated cache file for " << key.Source << '\n';
+			return std::nullopt;
+		}
+
+		// A null box is stored with min > max, keep it null on the way back in
+		if (min.x <= max.x) {
+			mesh.Bounds.Extend(min);
+			mesh.Bounds.Extend(max);
+		}
+	}
+
+	return std::make_optional(std::move(entry));
+}
+
+/***********************************************************************************/
+void MeshCache::Save(const Key& key, const Entry& entry) {
+	const auto mtime{ getSourceMTime(key.Source) };
+	if (!mtime) {
+		return;
+	}
+
+	if (!std::filesystem::exists(MESH_CACHE_DIR)) {
+		if (!std::filesystem::create_directories(MESH_CACHE_DIR)) {
+			std::cerr << "Failed to create mesh cache directory: " << MESH_CACHE_DIR << '\n';
+			return;
+		}
+	}
+
+	const auto target{ BuildCachePath(key) };
+	std::ofstream out(target, std::ios::binary);
+	if (!out) {
+		std::cerr << "Mesh Cache: Failed to open " << target << " for writing\n";
+		return;
+	}
+
+	MeshCacheHeader header;
+	header.ImportFlags = key.ImportFlags;
+	header.LoadMaterial = static_cast<std::uint32_t>(key.LoadMaterial);
+	header.SourceMTime = mtime.value();
+	header.ColdLoadMs = entry.ColdLoadMs;
+	header.MeshCount = static_cast<std::uint32_t>(entry.Meshes.size());
+	writePod(out, header);
+	writeString(out, key.Source.generic_string());
+
+	for (const auto& mesh : entry.Meshes) {
+		writePod(out, static_cast<std::uint32_t>(mesh.Vertices.size()));
+		writePod(out, static_cast<std::uint32_t>(mesh.Indices.size()));
+		writePod(out, mesh.Bounds.GetMin());
+		writePod(out, mesh.Bounds.GetMax());
+		writePod(out, mesh.Optimization);
+		writeString(out, mesh.MaterialName);
+		writeString(out, mesh.AlbedoPath);
+		writeString(out, mesh.MetallicPath);
+		writeString(out, mesh.NormalPath);
+		writeString(out, mesh.RoughnessPath);
+		writeString(out, mesh.AlphaMaskPath);
+		out.write(reinterpret_cast<const char*>(mesh.Vertices.data()), mesh.Vertices.size() * sizeof(Vertex));
+		out.write(reinterpret_cast<const char*>(mesh.Indices.data()), mesh.Indices.size() * sizeof(unsigned int));
+	}
+}
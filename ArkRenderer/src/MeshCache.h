@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "AABB.h"
+#include "MeshOptimizer.h"
+#include "Vertex.h"
+
+// CPU-side mesh data. Produced by Assimp on a cold load, or read back from the mesh cache on a warm load.
+struct MeshData
+{
+	std::vector<Vertex> Vertices;
+	std::vector<unsigned int> Indices;
+	AABB Bounds;
+	// Material name and texture paths relative to the model folder. MaterialName is empty if the mesh has no material.
+	std::string MaterialName;
+	std::string AlbedoPath;
+	std::string MetallicPath;
+	std::string NormalPath;
+	std::string RoughnessPath;
+	std::string AlphaMaskPath;
+	// Vertex cache statistics from the import-time optimization pass, kept so warm loads can report them too
+	MeshOptimizer::Report Optimization;
+};
+
+// Versioned on-disk cache of post-processed model data, so warm starts can skip Assimp entirely.
+// An entry is only valid for the exact source path, source mtime, import flags and material setting it was built with.
+class MeshCache
+{
+public:
+	// Bump whenever the file layout, Vertex or the import pipeline changes.
+	static constexpr std::uint32_t VERSION{ 2 };
+
+	struct Key
+	{
+		std::filesystem::path Source;
+		std::uint32_t ImportFlags{ 0 };
+		bool LoadMaterial{ false };
+	};
+
+	struct Entry
+	{
+		std::vector<MeshData> Meshes;
+		// Time spent in Assimp when the entry was built, kept for the cold/warm comparison.
+		double ColdLoadMs{ 0.0 };
+	};
+
+	// Returns the cached meshes for key, or nothing if the entry is missing, stale or corrupt.
+	static std::optional<Entry> Load(const Key& key);
+	static void Save(const Key& key, const Entry& entry);
+
+private:
+	static std::filesystem::path BuildCachePath(const Key& key);
+};
@@ -0,0 +1,67 @@
+#include "MeshOptimizer.h"
+
+#include <cstring>
+#include <unordered_map>
+
+/***********************************************************************************/
+MeshOptimizer::Report MeshOptimizer::Optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+	Report report;
+	report.VerticesBefore = static_cast<std::uint32_t>(vertices.size());
+	report.Before = Ark::MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+
+	JoinIdenticalVertices(vertices, indices);
+	if (!vertices.empty()) {
+		Ark::MeshOptimizer::OptimizeVertexCache(indices, vertices.size());
+		Ark::MeshOptimizer::OptimizeOverdraw(indices, &vertices[0].m_position, vertices.size(), sizeof(Vertex));
+		const auto fetchOrder{ Ark::MeshOptimizer::OptimizeVertexFetch(indices, vertices.size()) };
+
+		std::vector<Vertex> ordered;
+		ordered.reserve(fetchOrder.size());
+		for (const auto index : fetchOrder) {
+			ordered.push_back(vertices[index]);
+		}
+		vertices = std::move(ordered);
+	}
+
+	report.VerticesAfter = static_cast<std::uint32_t>(vertices.size());
+	report.After = Ark::MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+	return report;
+}
+
+/***********************************************************************************/
+void MeshOptimizer::JoinIdenticalVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+	// Vertex is plain floats without padding, so bitwise comparison is exact
+	struct VertexBytesHash {
+		std::size_t operator()(const Vertex& vertex) const {
+			const auto* bytes{ reinterpret_cast<const unsigned char*>(&vertex) };
+			std::uint64_t hash{ 14695981039346656037ull };
+			for (std::size_t i = 0; i < sizeof(Vertex); ++i) {
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+			}
+			return static_cast<std::size_t>(hash);
+		}
+	};
+	struct VertexBytesEqual {
+		bool operator()(const Vertex& lhs, const Vertex& rhs) const {
+			return std::memcmp(&lhs, &rhs, sizeof(Vertex)) == 0;
+		}
+	};
+
+	std::unordered_map<Vertex, unsigned int, VertexBytesHash, VertexBytesEqual> unique;
+	unique.reserve(vertices.size());
+	std::vector<unsigned int> remap(vertices.size());
+	std::vector<Vertex> joined;
+	joined.reserve(vertices.size());
+	for (std::size_t i = 0; i < vertices.size(); ++i) {
+		const auto [it, inserted] = unique.try_emplace(vertices[i], static_cast<unsigned int>(joined.size()));
+		if (inserted) {
+			joined.push_back(vertices[i]);
+		}
+		remap[i] = it->second;
+	}
+
+	for (auto& index : indices) {
+		index = remap[index];
+	}
+	vertices = std::move(joined);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <Ark/MeshOptimizer.hpp>
+
+#include "Vertex.h"
+
+// Import-time mesh optimization. Runs on freshly imported meshes before they are written to the mesh cache:
+// identical vertices are welded, then the shared Ark::MeshOptimizer reorders triangles for the post-transform
+// vertex cache and for overdraw, and vertices are compacted into the order the index buffer first fetches them.
+class MeshOptimizer
+{
+public:
+	using CacheStats = Ark::MeshOptimizer::CacheStats;
+
+	struct Report
+	{
+		CacheStats Before;
+		CacheStats After;
+		std::uint32_t VerticesBefore{ 0 };
+		std::uint32_t VerticesAfter{ 0 };
+	};
+
+	// Runs every stage in order and measures the index buffer before and after
+	static Report Optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+	// Merges bitwise identical vertices and rewrites indices to match
+	static void JoinIdenticalVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+};
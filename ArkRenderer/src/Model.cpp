@@ -1,5 +1,7 @@
 #include "Model.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <assimp/scene.h>
 #include <assimp/Importer.hpp>
@@ -8,7 +10,10 @@
 
 #include "ResourceManager.h"
 
-Model::Model(const std::string_view path, const std::string_view name, const bool flipWindingOrder, const bool loadMaterial)
+Model::Model(const std::string_view path, const std::string_view name, const bool flipWindingOrder, const bool loadMaterial,
+	const VertexLayout layout) :
+	m_sourcePath(path),
+	m_layout(layout)
 {
 	if (!LoadModel(path, flipWindingOrder, loadMaterial))
 	{
@@ -27,9 +32,7 @@ Model::Model(const std::vector<Vertex>& vertices, const std::vector<unsigned int
 
 bool Model::LoadModel(std::string_view path, bool flipWindingOrder, bool loadMaterial)
 {
-	Assimp::Importer importer;
-	const aiScene* scene = nullptr;
-	scene = importer.ReadFile(path.data(), aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+	constexpr unsigned int importFlags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
 	//if (flipWindingOrder) {
 	//	scene = importer.ReadFile(path.data(), aiProcess_Triangulate |
 	//		aiProcess_JoinIdenticalVertices |
@@ -57,6 +60,81 @@ bool Model::LoadModel(std::string_view path, bool flipWindingOrder, bool loadMat
 	//		aiProcess_OptimizeMeshes |
 	//		aiProcess_SplitLargeMeshes);
 	//}
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	const MeshCache::Key cacheKey{ std::filesystem::path(path), importFlags, loadMaterial };
+
+	auto cached = MeshCache::Load(cacheKey);
+	const bool warm = cached.has_value();
+	MeshCache::Entry entry;
+	if (warm)
+	{
+		entry = std::move(cached.value());
+	}
+	else if (!ImportWithAssimp(path, importFlags, loadMaterial, entry.Meshes))
+	{
+		return false;
+	}
+	const auto parsedTime = std::chrono::high_resolution_clock::now();
+
+	m_path = path.substr(0, path.find_last_of('/'));
+	m_path += "/";
+	if (loadMaterial)
+	{
+		PrefetchMaterialTextures(entry.Meshes);
+	}
+	for (const auto& meshData : entry.Meshes)
+	{
+		m_meshes.push_back(BuildMesh(meshData, loadMaterial));
+	}
+	const auto endTime = std::chrono::high_resolution_clock::now();
+
+	std::size_t vertexCount{ 0 }, vertexBytes{ 0 };
+	for (const auto& mesh : m_meshes)
+	{
+		vertexCount += mesh.m_vertexCount;
+		vertexBytes += mesh.m_vertexCount * mesh.GetVertexSize();
+	}
+	std::cout << "Vertex memory: " << vertexBytes / 1024 << " KiB for " << vertexCount << " vertices ("
+		<< (m_layout == VertexLayout::Packed ? "packed" : "float") << ", "
+		<< static_cast<double>(vertexCount * sizeof(Vertex)) / std::max<std::size_t>(vertexBytes, 1)
+		<< "x smaller than float vertices)\n";
+
+	// Triangle weighted so large meshes dominate like they do on the GPU
+	double triangles{ 0.0 }, acmrBefore{ 0.0 }, acmrAfter{ 0.0 };
+	for (const auto& meshData : entry.Meshes)
+	{
+		const auto meshTriangles = static_cast<double>(meshData.Indices.size() / 3);
+		triangles += meshTriangles;
+		acmrBefore += meshData.Optimization.Before.acmr * meshTriangles;
+		acmrAfter += meshData.Optimization.After.acmr * meshTriangles;
+	}
+	if (triangles > 0.0)
+	{
+		std::cout << "Mesh Optimizer: " << path << " ACMR " << acmrBefore / triangles << " -> " << acmrAfter / triangles
+			<< " over " << entry.Meshes.size() << " meshes\n";
+	}
+
+	const std::chrono::duration<double, std::milli> parseMs = parsedTime - startTime;
+	const std::chrono::duration<double, std::milli> totalMs = endTime - startTime;
+	if (warm)
+	{
+		std::cout << "Mesh Cache: warm load of " << path << " read " << parseMs.count() << " ms (Assimp cold load was "
+			<< entry.ColdLoadMs << " ms), " << totalMs.count() << " ms including upload\n";
+	}
+	else
+	{
+		std::cout << "Mesh Cache: cold load of " << path << " imported " << parseMs.count() << " ms, "
+			<< totalMs.count() << " ms including upload\n";
+		entry.ColdLoadMs = parseMs.count();
+		MeshCache::Save(cacheKey, entry);
+	}
+	return true;
+}
+
+bool Model::ImportWithAssimp(std::string_view path, unsigned int importFlags, bool loadMaterial, std::vector<MeshData>& outMeshes)
+{
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFile(path.data(), importFlags);
 	// Check loading model errors
 	if (!scene || scene->mFlags == AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
 	{
@@ -64,33 +142,40 @@ bool Model::LoadModel(std::string_view path, bool flipWindingOrder, bool loadMat
 		importer.FreeScene();
 		return false;
 	}
-	m_path = path.substr(0, path.find_last_of('/'));
-	m_path += "/";
-	ProcessNode(scene->mRootNode, scene, loadMaterial);
+	ProcessNode(scene->mRootNode, scene, loadMaterial, outMeshes);
 	importer.FreeScene();
+
+	// Stands in for aiProcess_JoinIdenticalVertices and aiProcess_ImproveCacheLocality, the result goes to the mesh cache
+	for (std::size_t i = 0; i < outMeshes.size(); ++i)
+	{
+		auto& mesh = outMeshes[i];
+		mesh.Optimization = MeshOptimizer::Optimize(mesh.Vertices, mesh.Indices);
+		const auto& report = mesh.Optimization;
+		std::cout << "Mesh Optimizer: mesh " << i << " ACMR " << report.Before.acmr << " -> " << report.After.acmr
+			<< ", ATVR " << report.Before.atvr << " -> " << report.After.atvr
+			<< ", vertices " << report.VerticesBefore << " -> " << report.VerticesAfter << "\n";
+	}
 	return true;
 }
 
-void Model::ProcessNode(aiNode* node, const aiScene* scene, bool loadMaterial)
+void Model::ProcessNode(aiNode* node, const aiScene* scene, bool loadMaterial, std::vector<MeshData>& outMeshes)
 {
 	for (auto i = 0; i < node->mNumMeshes; ++i)
 	{
 		auto* mesh = scene->mMeshes[node->mMeshes[i]];
-		m_meshes.push_back(ProcessMesh(mesh, scene, loadMaterial));
+		outMeshes.push_back(ProcessMesh(mesh, scene, loadMaterial));
 	}
 	for (auto i = 0; i < node->mNumChildren; i++)
 	{
-		ProcessNode(node->mChildren[i], scene, loadMaterial);
+		ProcessNode(node->mChildren[i], scene, loadMaterial, outMeshes);
 	}
 }
 
-Mesh Model::ProcessMesh(aiMesh* mesh, const aiScene* scene, bool loadMaterial)
+MeshData Model::ProcessMesh(aiMesh* mesh, const aiScene* scene, bool loadMaterial)
 {
-	std::vector<Vertex> vertices;
-	constexpr float minFloat = std::numeric_limits<float>::min();
-	constexpr float maxFloat = std::numeric_limits<float>::max();
-	glm::vec3 min(maxFloat, maxFloat, maxFloat);
-	glm::vec3 max = {minFloat, minFloat, minFloat};
+	MeshData data;
+	auto& vertices = data.Vertices;
+	vertices.reserve(mesh->mNumVertices);
 	for (auto i = 0; i < mesh->mNumVertices; ++i) {
 		Vertex vertex;
 
@@ -100,15 +185,7 @@ Mesh Model::ProcessMesh(aiMesh* mesh, const aiScene* scene, bool loadMaterial)
 			vertex.m_position.z = mesh->mVertices[i].z;
 
 			// Construct bounding box
-			if (vertex.m_position.x < min.x) min.x = vertex.m_position.x;
-			if (vertex.m_position.x > max.x) max.x = vertex.m_position.x;
-
-			if (vertex.m_position.y < min.y) min.y = vertex.m_position.y;
-			if (vertex.m_position.y > max.y) max.y = vertex.m_position.y;
-
-			if (vertex.m_position.z < min.z) min.z = vertex.m_position.z;
-			if (vertex.m_position.z > max.z) max.z = vertex.m_position.z;
-
+			data.Bounds.Extend(vertex.m_position);
 		}
 
 		if (mesh->HasNormals()) {
@@ -135,10 +212,9 @@ Mesh Model::ProcessMesh(aiMesh* mesh, const aiScene* scene, bool loadMaterial)
 
 		vertices.push_back(vertex);
 	}
-	m_aabb.Extend(min);
-	m_aabb.Extend(max);
 
-	std::vector<unsigned int> indices;
+	auto& indices = data.Indices;
+	indices.reserve(static_cast<std::size_t>(mesh->mNumFaces) * 3);
 	for (auto i = 0; i < mesh->mNumFaces; i++)
 	{
 		const auto face = mesh->mFaces[i];
@@ -153,11 +229,7 @@ Mesh Model::ProcessMesh(aiMesh* mesh, const aiScene* scene, bool loadMaterial)
 
 			aiString name;
 			mat->Get(AI_MATKEY_NAME, name);
-			// Is the material cached?
-			const auto cachedMaterial = ResourceManager::GetInstance().GetMaterial(name.C_Str());
-			if (cachedMaterial.has_value()) {
-				return Mesh(vertices, indices, cachedMaterial.value());
-			}
+			data.MaterialName = name.C_Str();
 
 			// Get the first texture for each texture type we need
 			// since there could be multiple textures per type
@@ -174,19 +246,65 @@ Mesh Model::ProcessMesh(aiMesh* mesh, const aiScene* scene, bool loadMaterial)
 			aiString aoPath;
 			mat->GetTexture(aiTextureType_LIGHTMAP, 0, &aoPath);
 			std::cout << "Ambient Opacity Path: " << aoPath.C_Str() << "\n";
-			const auto newMaterial = ResourceManager::GetInstance().CacheMaterial(name.C_Str(),
-				m_path + albedoPath.C_Str(),
-				"",
-				m_path + metallicPath.C_Str(),
-				m_path + normalPath.C_Str(),
-				m_path + roughnessPath.C_Str(),
-				m_path + alphaMaskPath.C_Str());
 
+			data.AlbedoPath = albedoPath.C_Str();
+			data.MetallicPath = metallicPath.C_Str();
+			data.NormalPath = normalPath.C_Str();
+			data.RoughnessPath = roughnessPath.C_Str();
+			data.AlphaMaskPath = alphaMaskPath.C_Str();
+		}
+	}
+	return data;
+}
+
+void Model::PrefetchMaterialTextures(const std::vector<MeshData>& meshes) const
+{
+	auto& resourceManager = ResourceManager::GetInstance();
+	std::vector<std::filesystem::path> paths;
+	for (const auto& data : meshes)
+	{
+		// Materials that are already cached will not load any textures
+		if (data.MaterialName.empty() || resourceManager.GetMaterial(data.MaterialName).has_value())
+		{
+			continue;
+		}
+		for (const auto* texture : { &data.AlbedoPath, &data.MetallicPath, &data.NormalPath, &data.RoughnessPath, &data.AlphaMaskPath })
+		{
+			if (!texture->empty())
+			{
+				paths.emplace_back(m_path + *texture);
+			}
+		}
+	}
+	resourceManager.PrefetchTextures(paths);
+}
+
+Mesh Model::BuildMesh(const MeshData& data, bool loadMaterial)
+{
+	m_aabb.Extend(data.Bounds);
+
+	PBRMaterialPtr material;
+	if (loadMaterial && !data.MaterialName.empty()) {
+		// Is the material cached?
+		const auto cachedMaterial = ResourceManager::GetInstance().GetMaterial(data.MaterialName);
+		if (cachedMaterial.has_value()) {
+			material = cachedMaterial.value();
+		}
+		else {
+			material = ResourceManager::GetInstance().CacheMaterial(data.MaterialName,
+				m_path + data.AlbedoPath,
+				"",
+				m_path + data.MetallicPath,
+				m_path + data.NormalPath,
+				m_path + data.RoughnessPath,
+				m_path + data.AlphaMaskPath);
 			++m_numMats;
-			return Mesh(vertices, indices, newMaterial);
 		}
 	}
-	return Mesh(vertices, indices);
+
+	Mesh mesh = material ? Mesh(data.Vertices, data.Indices, material, m_layout) : Mesh(data.Vertices, data.Indices, m_layout);
+	mesh.m_aabb = data.Bounds;
+	return mesh;
 }
 void Model::AttachMesh(const Mesh mesh) noexcept
 {
@@ -198,6 +316,7 @@ void Model::Delete()
 	for (auto& mesh : m_meshes)
 	{
 		mesh.m_vao.Delete();
+		mesh.m_positionVao.Delete();
 	}
 }
 
@@ -205,18 +324,21 @@ void Model::Delete()
 void Model::Scale(const glm::vec3& scale) {
 	m_scale = scale;
 	m_aabb.Scale(scale, glm::vec3(0.0f));
+	++m_transformVersion;
 }
 
 
 void Model::Rotate(const float radians, const glm::vec3& axis) {
 	m_radians = radians;
 	m_axis = axis;
+	++m_transformVersion;
 }
 
 
 void Model::Translate(const glm::vec3& pos) {
 	m_position = pos;
 	m_aabb.Translate(pos);
+	++m_transformVersion;
 }
 glm::mat4 Model::GetModelMatrix() const {
 	const auto scale = glm::scale(glm::mat4(1.0f), m_scale);
@@ -5,6 +5,7 @@
 #include "Vertex.h"
 #include "Mesh.h"
 #include "AABB.h"
+#include "MeshCache.h"
 struct aiScene;
 struct aiNode;
 struct aiMesh;
@@ -14,12 +15,14 @@ class Model
 public:
 	Model() = default;
 	Model(const std::string_view path, const std::string_view name,
-		const bool flipWindingOrder, const bool loadMaterial);
+		const bool flipWindingOrder, const bool loadMaterial,
+		const VertexLayout layout = VertexLayout::SplitPosition);
 	Model(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
 	virtual ~Model() = default;
 
-	[[nodiscard]] auto GetMeshes() const noexcept { return m_meshes; }
+	[[nodiscard]] const auto& GetMeshes() const noexcept { return m_meshes; }
 	[[nodiscard]] auto GetBoundingBox() const noexcept { return m_aabb; }
+	[[nodiscard]] const auto& GetSourcePath() const noexcept { return m_sourcePath; }
 	void AttachMesh(const Mesh mesh) noexcept;
 
 	// Transformations
@@ -27,21 +30,32 @@ public:
 	void Rotate(const float radians, const glm::vec3& axis);
 	void Translate(const glm::vec3& pos);
 	[[nodiscard]] glm::mat4 GetModelMatrix() const;
+	// Bumped by every transformation so spatial structures can tell when world-space bounds need a refit
+	[[nodiscard]] auto GetTransformVersion() const noexcept { return m_transformVersion; }
 	void Delete(); // Called by ResourceManager
 private:
 	bool LoadModel(std::string_view path, bool flipWindingOrder, bool loadMaterial);
-	void ProcessNode(aiNode* node, const aiScene* scene, bool loadMaterial);
-	Mesh ProcessMesh(aiMesh* mesh, const aiScene* scene, bool loadMaterial);
+	bool ImportWithAssimp(std::string_view path, unsigned int importFlags, bool loadMaterial, std::vector<MeshData>& outMeshes);
+	void ProcessNode(aiNode* node, const aiScene* scene, bool loadMaterial, std::vector<MeshData>& outMeshes);
+	MeshData ProcessMesh(aiMesh* mesh, const aiScene* scene, bool loadMaterial);
+	// Decodes every texture the meshes reference in parallel before they are uploaded one by one
+	void PrefetchMaterialTextures(const std::vector<MeshData>& meshes) const;
+	// Uploads mesh data to the GPU and resolves its material
+	Mesh BuildMesh(const MeshData& data, bool loadMaterial);
 	// Transformation data
-	glm::vec3 m_scale, m_position, m_axis;
-	float m_radians;
+	glm::vec3 m_scale{ 1.0f }, m_position{ 0.0f }, m_axis{ 0.0f, 1.0f, 0.0f };
+	float m_radians{ 0.0f };
+	std::uint32_t m_transformVersion{ 0 };
 	AABB m_aabb;
 	std::vector<Mesh> m_meshes;
 	// Model name
 	const std::string m_name;
 	// Location on disk holding model and textures
 	std::string m_path;
+	// File the model was loaded from
+	std::string m_sourcePath;
+	VertexLayout m_layout{ VertexLayout::SplitPosition };
 
-	std::size_t m_numMats;
+	std::size_t m_numMats{ 0 };
 };
 using ModelPtr = std::shared_ptr<Model>;
@@ -26,7 +26,7 @@ void PBRMaterial::Init(const std::string_view name,
 	m_materialTextures[NORMAL] = ResourceManager::GetInstance().LoadTexture(normalPath);
 	m_materialTextures[ROUGHNESS] = ResourceManager::GetInstance().LoadTexture(roughnessPath);
 
-	m_alpha = ResourceManager::GetInstance().LoadTexture(alphaMaskPath);
+	m_alphaMaskTexture = ResourceManager::GetInstance().LoadTexture(alphaMaskPath);
 }
 
 /***********************************************************************************/
@@ -49,6 +49,17 @@ void PBRMaterial::Init(const std::string_view name,
 	m_alpha = alpha;
 }
 
+/***********************************************************************************/
+void PBRMaterial::ReleaseTextures() {
+	for (auto& texture : m_materialTextures) {
+		ResourceManager::GetInstance().ReleaseTexture(texture);
+		texture = 0;
+	}
+
+	ResourceManager::GetInstance().ReleaseTexture(m_alphaMaskTexture);
+	m_alphaMaskTexture = 0;
+}
+
 /***********************************************************************************/
 unsigned int PBRMaterial::GetParameterTexture(const ParameterType parameter) const noexcept {
 	return m_materialTextures[parameter];
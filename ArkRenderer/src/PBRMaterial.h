@@ -42,6 +42,9 @@ public:
 
 	std::string_view Name;
 
+	// Hands the textures loaded by Init back to the ResourceManager
+	void ReleaseTextures();
+
 	unsigned int GetParameterTexture(const ParameterType parameter) const noexcept;
 	glm::vec3 GetParameterColor(const ParameterType parameter) const noexcept;
 
@@ -59,8 +62,8 @@ private:
 	std::array<unsigned int, 5> m_materialTextures;
 	std::array<glm::vec3, 5> m_materialColors;
 
-	float m_alpha;
-	unsigned int m_alphaMaskTexture;
+	float m_alpha{ 1.0f };
+	unsigned int m_alphaMaskTexture{ 0 };
 };
 
 using PBRMaterialPtr = std::shared_ptr<PBRMaterial>;
@@ -0,0 +1,47 @@
+#include "RenderQueue.h"
+
+namespace SortKey = Ark::SortKey;
+
+/***********************************************************************************/
+void RenderQueue::Clear() noexcept {
+	m_packets.clear();
+	m_sorted.clear();
+	m_stats = {};
+}
+
+/***********************************************************************************/
+void RenderQueue::Push(const Packet& packet) {
+	m_packets.push_back(packet);
+	++m_stats.Packets;
+}
+
+/***********************************************************************************/
+void RenderQueue::Sort() {
+	m_entries.clear();
+	m_entries.reserve(m_packets.size());
+	for (std::uint32_t i = 0; i < m_packets.size(); ++i) {
+		const auto& packet{ m_packets[i] };
+		const auto key{ SortKey::Encode(SortKey::MapId(m_programIds, packet.Program, SortKey::STATE_BITS),
+			SortKey::MapId(m_materialIds, packet.Material, SortKey::MATERIAL_BITS),
+			SortKey::MapId(m_meshIds, packet.Mesh, SortKey::MESH_BITS), packet.Depth, packet.Blended) };
+		m_entries.push_back({ key, i });
+	}
+	SortKey::RadixSort(m_entries, m_scratch);
+
+	m_sorted.clear();
+	m_sorted.reserve(m_entries.size());
+	for (const auto& entry : m_entries) {
+		m_sorted.push_back(m_packets[entry.index]);
+	}
+}
+
+/***********************************************************************************/
+bool RenderQueue::Bind(GLuint& bound, const GLuint next) noexcept {
+	if (bound == next) {
+		++m_stats.BindsAvoided;
+		return false;
+	}
+	bound = next;
+	++m_stats.Binds;
+	return true;
+}
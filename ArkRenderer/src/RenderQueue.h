@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+#include <Ark/SortKey.hpp>
+
+// Draw packets of one pass, ordered by the keys of Ark/SortKey.hpp with the program as the state field. GL names are
+// mapped to small ids, the draw loop compares the names themselves through Bind.
+class RenderQueue
+{
+public:
+	struct Packet
+	{
+		GLuint Program{ 0 };
+		// Texture the material binds
+		GLuint Material{ 0 };
+		// Vertex array
+		GLuint Mesh{ 0 };
+		// Distance from the camera, negative values count as 0
+		float Depth{ 0.0f };
+		bool Blended{ false };
+		// Caller data, e.g. an index into the meshes queued this frame
+		std::uint32_t Payload{ 0 };
+	};
+
+	struct Stats
+	{
+		std::size_t Packets{ 0 };
+		// Binds the draw loop issued, and the ones it skipped because the state was already bound
+		std::size_t Binds{ 0 };
+		std::size_t BindsAvoided{ 0 };
+	};
+
+	// Starts a new frame, the stats restart with it
+	void Clear() noexcept;
+	void Push(const Packet& packet);
+	// Orders the packets pushed since Clear by key
+	void Sort();
+	// Valid after Sort
+	[[nodiscard]] const auto& GetSortedPackets() const noexcept { return m_sorted; }
+
+	// For the draw loop: true if next differs from bound, which is then updated and the bind must be issued. False if
+	// the bind is redundant and can be skipped.
+	bool Bind(GLuint& bound, const GLuint next) noexcept;
+	[[nodiscard]] const auto& GetStats() const noexcept { return m_stats; }
+
+private:
+	std::vector<Packet> m_packets;
+	std::vector<Packet> m_sorted;
+	std::vector<Ark::SortKey::Entry> m_entries;
+	std::vector<Ark::SortKey::Entry> m_scratch;
+	std::unordered_map<GLuint, std::uint32_t> m_programIds;
+	std::unordered_map<GLuint, std::uint32_t> m_materialIds;
+	std::unordered_map<GLuint, std::uint32_t> m_meshIds;
+	Stats m_stats;
+};
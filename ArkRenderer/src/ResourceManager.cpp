@@ -5,6 +5,11 @@
 #include <fstream>
 #include <cassert>
 #include <string_view>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unordered_set>
+#include <algorithm>
 
 #include <stb_image.h>
 
@@ -12,14 +17,29 @@ const static std::filesystem::path COMPRESSED_TEX_DIR{ std::filesystem::current_
 
 using ImageBuffer = std::unique_ptr<unsigned char[]>;
 
-struct CompressedImageDesc {
+// Bump whenever the layout of the texture cache files changes
+constexpr std::uint32_t COMPRESSED_TEX_VERSION{ 1 };
+// "ATEX"
+constexpr std::uint32_t COMPRESSED_TEX_MAGIC{ 0x58455441 };
+
+struct CompressedMipLevel {
 	GLint width{ -1 };
 	GLint height{ -1 };
 	GLint size{ -1 };
-	GLint format{ -1 };
 	ImageBuffer data;
 };
 
+struct CompressedImageDesc {
+	GLint format{ -1 };
+	std::vector<CompressedMipLevel> levels;
+};
+
+// Write time and size of the image a cache entry was compressed from, an edited source no longer matches its entry
+struct TextureSourceStamp {
+	std::int64_t mtime{ 0 };
+	std::uint64_t size{ 0 };
+};
+
 /***********************************************************************************/
 void ResourceManager::ReleaseAllResources() {
 	// Delete cached meshes
@@ -29,8 +49,14 @@ void ResourceManager::ReleaseAllResources() {
 
 	// Deletes textures
 	for (auto& tex : m_textureCache) {
-		glDeleteTextures(1, &tex.second);
+		glDeleteTextures(1, &tex.second.Id);
 	}
+	m_textureCache.clear();
+	m_textureKeys.clear();
+	m_textureBytesResident = 0;
+
+	// Drop decoded images nobody uploaded
+	m_decodedImages.clear();
 }
 
 /***********************************************************************************/
@@ -81,13 +107,95 @@ unsigned int ResourceManager::LoadHDRI(const std::string_view path) const {
 }
 
 /***********************************************************************************/
-auto buildTextureCachePath(const std::filesystem::path& filenameNoExt) {
-	const std::filesystem::path filename{ filenameNoExt.string() + ".bin" };
-	return std::filesystem::path(COMPRESSED_TEX_DIR / filename);
+auto buildTextureCachePath(const std::filesystem::path& sourcePath) {
+	// Hash the full path so textures with the same file name in different folders get their own entry
+	std::ostringstream filename;
+	filename << sourcePath.stem().string() << '_' << std::hex << std::hash<std::string>{}(sourcePath.generic_string()) << ".bin";
+	return std::filesystem::path(COMPRESSED_TEX_DIR / filename.str());
+}
+
+/***********************************************************************************/
+// Identifies a texture by what it was loaded from and how, so different spellings of the same file share one entry
+std::string buildTextureKey(const std::filesystem::path& path, const bool useMipMaps, const bool useUnalignedUnpack) {
+	std::error_code ec;
+	auto canonical{ std::filesystem::weakly_canonical(path, ec) };
+	if (ec) {
+		canonical = path.lexically_normal();
+	}
+	return canonical.generic_string() + (useMipMaps ? "|mips" : "|nomips") + (useUnalignedUnpack ? "|unaligned" : "");
+}
+
+/***********************************************************************************/
+// Size in video memory of the levels of the bound texture
+std::size_t measureBoundTexture(const GLint levelCount, const int components) {
+	GLint compressed = GL_FALSE;
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+
+	std::size_t bytes{ 0 };
+	for (GLint i = 0; i < levelCount; ++i) {
+		if (compressed == GL_TRUE) {
+			GLint size{ 0 };
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+			bytes += size;
+		}
+		else {
+			GLint width{ 0 }, height{ 0 };
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_WIDTH, &width);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_HEIGHT, &height);
+			bytes += static_cast<std::size_t>(width) * height * components;
+		}
+	}
+	return bytes;
+}
+
+/***********************************************************************************/
+// Number of levels in a full mip chain down to 1x1
+GLint fullMipCount(const GLint width, const GLint height) {
+	GLint levels{ 1 };
+	for (auto size = std::max(width, height); size > 1; size >>= 1) {
+		++levels;
+	}
+	return levels;
+}
+
+/***********************************************************************************/
+std::optional<TextureSourceStamp> getTextureSourceStamp(const std::filesystem::path& source) {
+	std::error_code ec;
+	const auto time{ std::filesystem::last_write_time(source, ec) };
+	if (ec) {
+		return std::nullopt;
+	}
+	const auto size{ std::filesystem::file_size(source, ec) };
+	if (ec) {
+		return std::nullopt;
+	}
+	return TextureSourceStamp{ static_cast<std::int64_t>(time.time_since_epoch().count()), static_cast<std::uint64_t>(size) };
+}
+
+/***********************************************************************************/
+// Reads the header of a texture cache file. False if it is from another version or a different source image.
+bool readTextureCacheHeader(std::ifstream& in, const TextureSourceStamp& source) {
+	std::uint32_t magic{ 0 }, version{ 0 };
+	TextureSourceStamp stamp;
+	in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	in.read(reinterpret_cast<char*>(&version), sizeof(version));
+	in.read(reinterpret_cast<char*>(&stamp.mtime), sizeof(TextureSourceStamp::mtime));
+	in.read(reinterpret_cast<char*>(&stamp.size), sizeof(TextureSourceStamp::size));
+	return in && magic == COMPRESSED_TEX_MAGIC && version == COMPRESSED_TEX_VERSION && stamp.mtime == source.mtime && stamp.size == source.size;
+}
+
+/***********************************************************************************/
+bool isTextureCacheEntryCurrent(const std::filesystem::path& target, const std::filesystem::path& source) {
+	const auto stamp{ getTextureSourceStamp(source) };
+	if (!stamp) {
+		return false;
+	}
+	std::ifstream in(target, std::ios::binary);
+	return in && readTextureCacheHeader(in, stamp.value());
 }
 
 /***********************************************************************************/
-void saveCompressedImageToDisk(const std::filesystem::path& target, const CompressedImageDesc& desc) {
+void saveCompressedImageToDisk(const std::filesystem::path& target, const TextureSourceStamp& source, const CompressedImageDesc& desc) {
 	if (!std::filesystem::exists(COMPRESSED_TEX_DIR)) {
 		if (!std::filesystem::create_directories(COMPRESSED_TEX_DIR)) {
 			std::cerr << "Failed to create texture cache directory: " << COMPRESSED_TEX_DIR << '\n';
@@ -97,16 +205,24 @@ void saveCompressedImageToDisk(const std::filesystem::path& target, const Compre
 
 	std::ofstream out(target, std::ios::binary);
 	if (out) {
-		out.write((char*)(&desc.size), sizeof(CompressedImageDesc::size));
-		out.write((char*)(&desc.width), sizeof(CompressedImageDesc::width));
-		out.write((char*)(&desc.height), sizeof(CompressedImageDesc::height));
+		const auto levelCount{ static_cast<GLint>(desc.levels.size()) };
+		out.write((char*)(&COMPRESSED_TEX_MAGIC), sizeof(COMPRESSED_TEX_MAGIC));
+		out.write((char*)(&COMPRESSED_TEX_VERSION), sizeof(COMPRESSED_TEX_VERSION));
+		out.write((char*)(&source.mtime), sizeof(TextureSourceStamp::mtime));
+		out.write((char*)(&source.size), sizeof(TextureSourceStamp::size));
 		out.write((char*)(&desc.format), sizeof(CompressedImageDesc::format));
-		out.write((char*)(desc.data.get()), desc.size);
+		out.write((char*)(&levelCount), sizeof(levelCount));
+		for (const auto& level : desc.levels) {
+			out.write((char*)(&level.size), sizeof(CompressedMipLevel::size));
+			out.write((char*)(&level.width), sizeof(CompressedMipLevel::width));
+			out.write((char*)(&level.height), sizeof(CompressedMipLevel::height));
+			out.write((char*)(level.data.get()), level.size);
+		}
 	}
 }
 
 /***********************************************************************************/
-std::optional<CompressedImageDesc> loadCompressedImageFromDisk(const std::filesystem::path& target) {
+std::optional<CompressedImageDesc> loadCompressedImageFromDisk(const std::filesystem::path& target, const TextureSourceStamp& source) {
 	CompressedImageDesc desc;
 
 	std::ifstream in(target, std::ios::binary);
@@ -114,31 +230,220 @@ std::optional<CompressedImageDesc> loadCompressedImageFromDisk(const std::filesy
 		return std::nullopt;
 	}
 
-	in.read(reinterpret_cast<char*>(&desc.size), sizeof(CompressedImageDesc::size));
-	in.read(reinterpret_cast<char*>(&desc.width), sizeof(CompressedImageDesc::width));
-	in.read(reinterpret_cast<char*>(&desc.height), sizeof(CompressedImageDesc::height));
+	if (!readTextureCacheHeader(in, source)) {
+		return std::nullopt;
+	}
+
+	GLint levelCount{ 0 };
 	in.read(reinterpret_cast<char*>(&desc.format), sizeof(CompressedImageDesc::format));
+	in.read(reinterpret_cast<char*>(&levelCount), sizeof(levelCount));
+	if (!in || levelCount <= 0 || levelCount > 32) {
+		return std::nullopt;
+	}
+
+	desc.levels.resize(levelCount);
+	for (auto& level : desc.levels) {
+		in.read(reinterpret_cast<char*>(&level.size), sizeof(CompressedMipLevel::size));
+		in.read(reinterpret_cast<char*>(&level.width), sizeof(CompressedMipLevel::width));
+		in.read(reinterpret_cast<char*>(&level.height), sizeof(CompressedMipLevel::height));
+		if (!in || level.size <= 0) {
+			return std::nullopt;
+		}
+
+		level.data = std::make_unique<unsigned char[]>(level.size);
+		in.read(reinterpret_cast<char*>(level.data.get()), level.size);
+	}
 
-	desc.data = std::make_unique<unsigned char[]>(desc.size);
-	in.read(reinterpret_cast<char*>(desc.data.get()), desc.size);
+	if (!in) {
+		return std::nullopt;
+	}
 
 	return std::make_optional(std::move(desc));
 }
+
+/***********************************************************************************/
+// Uploads a cached mip chain. Returns 0 if the driver rejects the data, e.g. after a driver or GPU change.
+unsigned int uploadCompressedImage(const CompressedImageDesc& desc) {
+	// Clear stale errors so only failures from this upload are picked up below
+	while (glGetError() != GL_NO_ERROR) {}
+
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	for (GLint i = 0; i < static_cast<GLint>(desc.levels.size()); ++i) {
+		const auto& level{ desc.levels[i] };
+		glCompressedTexImage2D(GL_TEXTURE_2D, i, desc.format, level.width, level.height, 0, level.size, level.data.get());
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(desc.levels.size()) - 1);
+
+	if (glGetError() != GL_NO_ERROR) {
+		glDeleteTextures(1, &textureID);
+		return 0;
+	}
+	return textureID;
+}
+
+/***********************************************************************************/
+// Reads back the driver-compressed mip chain of the bound texture and writes it to the disk cache
+void saveBoundTextureToDisk(const std::filesystem::path& target, const TextureSourceStamp& source, const GLint levelCount) {
+	GLint compressed = GL_FALSE;
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+	if (compressed != GL_TRUE) {
+		// The driver chose an uncompressed format, nothing worth caching
+		return;
+	}
+
+	CompressedImageDesc desc;
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &desc.format);
+	desc.levels.resize(levelCount);
+	for (GLint i = 0; i < levelCount; ++i) {
+		auto& level{ desc.levels[i] };
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_WIDTH, &level.width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_HEIGHT, &level.height);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &level.size);
+		if (level.size <= 0) {
+			return;
+		}
+
+		level.data = std::make_unique<unsigned char[]>(level.size);
+		glGetCompressedTexImage(GL_TEXTURE_2D, i, level.data.get());
+	}
+
+	saveCompressedImageToDisk(target, source, desc);
+}
+
+/***********************************************************************************/
+void ResourceManager::PrefetchTextures(const std::vector<std::filesystem::path>& paths) {
+	// Skip empty texture slots, duplicates and anything that is already resident, decoded or cached on disk
+	std::vector<std::string> pending;
+	std::unordered_set<std::string> seen;
+	for (const auto& path : paths) {
+		auto key{ path.string() };
+		if (path.filename().empty() || m_textureCache.count(buildTextureKey(path, true, false)) || m_decodedImages.count(key) || !seen.insert(key).second) {
+			continue;
+		}
+		// Textures in the compressed disk cache are uploaded without decoding
+		if (isTextureCacheEntryCurrent(buildTextureCachePath(path), path)) {
+			continue;
+		}
+		pending.push_back(std::move(key));
+	}
+
+	if (pending.empty()) {
+		return;
+	}
+
+	struct DecodeResult {
+		DecodedImage Image;
+		double DecodeMs{ 0.0 };
+	};
+	std::vector<DecodeResult> results(pending.size());
+	std::atomic<std::size_t> next{ 0 };
+
+	// The flip flag is global state in stb_image, so it has to be set before any worker starts
+	stbi_set_flip_vertically_on_load(true);
+
+	const auto worker = [&pending, &results, &next]() {
+		for (auto i = next++; i < pending.size(); i = next++) {
+			const auto start{ std::chrono::high_resolution_clock::now() };
+			auto& image{ results[i].Image };
+			auto* data{ stbi_load(pending[i].c_str(), &image.Width, &image.Height, &image.Components, 0) };
+			image.Pixels = std::unique_ptr<unsigned char, void(*)(void*)>(data, stbi_image_free);
+			const std::chrono::duration<double, std::milli> elapsed{ std::chrono::high_resolution_clock::now() - start };
+			results[i].DecodeMs = elapsed.count();
+		}
+	};
+
+	const auto wallStart{ std::chrono::high_resolution_clock::now() };
+	const auto numThreads{ std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), pending.size()) };
+	std::vector<std::thread> workers;
+	workers.reserve(numThreads - 1);
+	for (std::size_t i = 1; i < numThreads; ++i) {
+		workers.emplace_back(worker);
+	}
+	// The calling thread decodes too instead of idling on join
+	worker();
+	for (auto& thread : workers) {
+		thread.join();
+	}
+	const std::chrono::duration<double, std::milli> wallMs{ std::chrono::high_resolution_clock::now() - wallStart };
+
+	double serialMs{ 0.0 };
+	for (std::size_t i = 0; i < pending.size(); ++i) {
+		serialMs += results[i].DecodeMs;
+		// Failed decodes are left to LoadTexture, which retries and reports the error
+		if (results[i].Image.Pixels) {
+			m_decodedImages.try_emplace(pending[i], std::move(results[i].Image));
+		}
+	}
+
+	std::cout << "Resource Manager: Decoded " << pending.size() << " textures on " << numThreads << " threads in "
+		<< wallMs.count() << " ms (serial decode time " << serialMs << " ms, saved " << serialMs - wallMs.count() << " ms)\n";
+}
+
+/***********************************************************************************/
 unsigned int ResourceManager::LoadTexture(const std::filesystem::path& path, const bool useMipMaps, const bool useUnalignedUnpack) {
 
 	if (path.filename().empty()) {
 		return 0;
 	}
-	stbi_set_flip_vertically_on_load(true);
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
+
+	// Check if texture is already loaded in memory
+	const auto key{ buildTextureKey(path, useMipMaps, useUnalignedUnpack) };
+	const auto cached = m_textureCache.find(key);
+	if (cached != m_textureCache.end()) {
+		++cached->second.RefCount;
+		++m_duplicateTexturesAvoided;
+		return cached->second.Id;
+	}
+
+	const auto compressedFilePath{ buildTextureCachePath(path) };
+	const auto sourceStamp{ getTextureSourceStamp(path) };
+
+	// Warm start: upload the GPU-compressed mip chain from disk, skipping both decode and mip generation
+	const auto compressedImage{ sourceStamp ? loadCompressedImageFromDisk(compressedFilePath, sourceStamp.value()) : std::nullopt };
+	if (compressedImage) {
+		const auto& baseLevel{ compressedImage.value().levels.front() };
+		const auto hasAllLevels{ !useMipMaps ||
+			static_cast<GLint>(compressedImage.value().levels.size()) == fullMipCount(baseLevel.width, baseLevel.height) };
+
+		if (hasAllLevels) {
+			const auto textureID{ uploadCompressedImage(compressedImage.value()) };
+			if (textureID != 0) {
+				++m_textureDiskCacheHits;
+				std::size_t bytes{ 0 };
+				for (const auto& level : compressedImage.value().levels) {
+					bytes += level.size;
+				}
+				m_textureBytesResident += bytes;
+				m_textureKeys.try_emplace(textureID, key);
+				return m_textureCache.try_emplace(key, TextureEntry{ textureID, 1, bytes }).first->second.Id;
+			}
+			std::cerr << "Resource Manager: Cached texture rejected by the driver, decoding " << path << " instead\n";
+		}
+	}
+	++m_textureDiskCacheMisses;
+
 	int width = 0, height = 0, nrComponents = 0;
-	std::cout << "Path to load " << path.string() << std::endl;
-	unsigned char* data = stbi_load(path.string().c_str(), &width, &height, &nrComponents, 0);
+	std::unique_ptr<unsigned char, void(*)(void*)> data{ nullptr, stbi_image_free };
+
+	// Use the pixels from PrefetchTextures if a worker already decoded this image
+	const auto decoded = m_decodedImages.find(path.string());
+	if (decoded != m_decodedImages.end()) {
+		width = decoded->second.Width;
+		height = decoded->second.Height;
+		nrComponents = decoded->second.Components;
+		data = std::move(decoded->second.Pixels);
+		m_decodedImages.erase(decoded);
+	}
+	else {
+		stbi_set_flip_vertically_on_load(true);
+		std::cout << "Path to load " << path.string() << std::endl;
+		data.reset(stbi_load(path.string().c_str(), &width, &height, &nrComponents, 0));
+	}
 	if (!data) {
 		std::cerr << "Failed to load texture: " << path << std::endl;
-		glDeleteTextures(1, &textureID);
-		stbi_image_free(data);
 		return 0;
 	}
 
@@ -149,6 +454,10 @@ unsigned int ResourceManager::LoadTexture(const std::filesystem::path& path, con
 		format = GL_RED;
 		internalFormat = GL_COMPRESSED_RED;
 		break;
+	case 2:
+		format = GL_RG;
+		internalFormat = GL_COMPRESSED_RG;
+		break;
 	case 3:
 		format = GL_RGB;
 		internalFormat = GL_COMPRESSED_RGB;
@@ -158,128 +467,58 @@ unsigned int ResourceManager::LoadTexture(const std::filesystem::path& path, con
 		internalFormat = GL_COMPRESSED_RGBA;
 		break;
 	}
+
+	if (useUnalignedUnpack) {
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	}
+
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
 	glBindTexture(GL_TEXTURE_2D, textureID);
 
 	//glHint(GL_TEXTURE_COMPRESSION_HINT, GL_DONT_CARE);
-	glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-	glGenerateMipmap(GL_TEXTURE_2D);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, data.get());
+	const auto levelCount{ useMipMaps ? fullMipCount(width, height) : 1 };
+	if (useMipMaps) {
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
 	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	stbi_image_free(data);
-	return m_textureCache.try_emplace(path.string(), textureID).first->second;
+
+	if (useUnalignedUnpack) {
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+
+	if (sourceStamp) {
+		saveBoundTextureToDisk(compressedFilePath, sourceStamp.value(), levelCount);
+	}
+
+	const auto bytes{ measureBoundTexture(levelCount, nrComponents) };
+	m_textureBytesResident += bytes;
+	m_textureKeys.try_emplace(textureID, key);
+	return m_textureCache.try_emplace(key, TextureEntry{ textureID, 1, bytes }).first->second.Id;
 }
 
 /***********************************************************************************/
-//unsigned int ResourceManager::LoadTexture(const std::filesystem::path& path, const bool useMipMaps, const bool useUnalignedUnpack) {
-//
-//	if (path.filename().empty()) {
-//		return 0;
-//	}
-//
-//	const auto compressedFilePath{ buildTextureCachePath(path.stem()) };
-//	const auto compressedImageExists{ std::filesystem::exists(compressedFilePath) };
-//	const std::filesystem::path pathToLoad = compressedImageExists ? compressedFilePath : path;
-//
-//	// Check if texture is already loaded in memory
-//	const auto val = m_textureCache.find(pathToLoad.string());
-//	if (val != m_textureCache.end()) {
-//		// Found it
-//		return val->second;
-//	}
-//
-//	if (useUnalignedUnpack) {
-//		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-//	}
-//
-//	unsigned int textureID;
-//	glGenTextures(1, &textureID);
-//	
-//	if (!compressedImageExists) {
-//
-//		const auto desc{ loadCompressedImageFromDisk(compressedFilePath) };
-//		if (!desc) {
-//			return 0;
-//		}
-//
-//		glBindTexture(GL_TEXTURE_2D, textureID);
-//		glCompressedTexImage2D(
-//			GL_TEXTURE_2D,
-//			0,
-//			desc.value().format,
-//			desc.value().width,
-//			desc.value().height,
-//			0,
-//			desc.value().size,
-//			desc.value().data.get()
-//		);
-//
-//	}
-//	else {
-//		int width = 0, height = 0, nrComponents = 0;
-//		std::cout << "Path to load " << pathToLoad.string() << std::endl;
-//		unsigned char* data = stbi_load(pathToLoad.string().c_str(), &width, &height, &nrComponents, 0);
-//		if (!data) {
-//			std::cerr << "Failed to load texture: " << path << std::endl;
-//			glDeleteTextures(1, &textureID);
-//			stbi_image_free(data);
-//			return 0;
-//		}
-//
-//		GLenum format = 0;
-//		GLenum internalFormat = 0;
-//		switch (nrComponents) {
-//		case 1:
-//			format = GL_RED;
-//			internalFormat = GL_COMPRESSED_RED;
-//			break;
-//		case 3:
-//			format = GL_RGB;
-//			internalFormat = GL_COMPRESSED_RGB;
-//			break;
-//		case 4:
-//			format = GL_RGBA;
-//			internalFormat = GL_COMPRESSED_RGBA;
-//			break;
-//		}
-//		std::cout << "nrComponents: " << nrComponents << "\n";
-//		glBindTexture(GL_TEXTURE_2D, textureID);
-//
-//		//glHint(GL_TEXTURE_COMPRESSION_HINT, GL_DONT_CARE);
-//		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-//
-//		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-//		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-//		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-//		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-//		stbi_image_free(data);
-//
-//		GLint compressed = GL_FALSE;
-//		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
-//		if (compressed == GL_TRUE) {
-//			CompressedImageDesc desc;
-//			desc.height = height;
-//			desc.width = width;
-//			glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &desc.size);
-//			glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &desc.format);
-//
-//			desc.data = std::make_unique<unsigned char[]>(desc.size);
-//			glGetCompressedTexImage(GL_TEXTURE_2D, 0, (GLvoid*)desc.data.get());
-//
-//			saveCompressedImageToDisk(compressedFilePath, desc);
-//		}
-//	}
-//
-//	if (useMipMaps) {
-//		glGenerateMipmap(GL_TEXTURE_2D);
-//	}
-//
-//	if (useUnalignedUnpack) {
-//		glPixelStorei(GL_UNPACK_ALIGNMENT, 0);
-//	}
-//	return m_textureCache.try_emplace(path.string(), textureID).first->second;
-//}
+void ResourceManager::ReleaseTexture(const unsigned int textureID) {
+	const auto key = m_textureKeys.find(textureID);
+	if (key == m_textureKeys.end()) {
+		return;
+	}
+
+	auto& entry{ m_textureCache.at(key->second) };
+	if (--entry.RefCount > 0) {
+		return;
+	}
+
+	glDeleteTextures(1, &entry.Id);
+	m_textureBytesResident -= entry.Bytes;
+	m_textureCache.erase(key->second);
+	m_textureKeys.erase(key);
+}
 
 /***********************************************************************************/
 std::vector<char> ResourceManager::LoadBinaryFile(const std::string_view path) const {
@@ -300,14 +539,14 @@ std::vector<char> ResourceManager::LoadBinaryFile(const std::string_view path) c
 }
 
 /***********************************************************************************/
-ModelPtr ResourceManager::GetModel(const std::string_view name, const std::string_view path) {
+ModelPtr ResourceManager::GetModel(const std::string_view name, const std::string_view path, const VertexLayout layout) {
 
 	// Check if model is already loaded.
 	const auto val = m_modelCache.find(path.data());
 
 	if (val == m_modelCache.end()) {
 		// Load model, cache it, and return a shared_ptr to it.
-		return m_modelCache.try_emplace(name.data(), std::make_shared<Model>(path, name, false, true)).first->second;
+		return m_modelCache.try_emplace(name.data(), std::make_shared<Model>(path, name, false, true, layout)).first->second;
 	}
 
 	return val->second;
@@ -347,8 +586,29 @@ void ResourceManager::UnloadModel(const std::string_view modelName) {
 	const auto model = m_modelCache.find(modelName.data());
 
 	if (model != m_modelCache.end()) {
-		model->second->Delete();
+		const auto unloaded{ model->second };
+		unloaded->Delete();
 
 		m_modelCache.erase(modelName.data());
+
+		// Free the materials that no other cached model uses, which in turn releases their textures
+		for (const auto& mesh : unloaded->GetMeshes()) {
+			if (!mesh.Material) {
+				continue;
+			}
+
+			const auto materialInUse = std::any_of(m_modelCache.cbegin(), m_modelCache.cend(), [&mesh](const auto& other) {
+				const auto& meshes{ other.second->GetMeshes() };
+				return std::any_of(meshes.cbegin(), meshes.cend(), [&mesh](const auto& m) { return m.Material == mesh.Material; });
+			});
+
+			const auto material = std::find_if(m_materialCache.begin(), m_materialCache.end(), [&mesh](const auto& cached) {
+				return cached.second == mesh.Material;
+			});
+			if (!materialInUse && material != m_materialCache.end()) {
+				material->second->ReleaseTextures();
+				m_materialCache.erase(material);
+			}
+		}
 	}
 }
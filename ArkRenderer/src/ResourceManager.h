@@ -5,6 +5,8 @@
 #include <unordered_map>
 #include <optional>
 #include <filesystem>
+#include <memory>
+#include <vector>
 
 #include "PBRMaterial.h"
 
@@ -27,12 +29,18 @@ public:
 	std::string LoadTextFile(const std::filesystem::path& path) const;
 	// Loads an HDR image and generates an OpenGL floating-point texture.
 	unsigned int LoadHDRI(const std::string_view path) const;
-	// Loads an image (if not cached) and generates an OpenGL texture.
+	// Loads an image (if not cached) and generates an OpenGL texture. Every call takes a reference on the texture.
 	unsigned int LoadTexture(const std::filesystem::path& path, const bool useMipMaps = true, const bool useUnalignedUnpack = false);
+	// Drops a reference taken by LoadTexture. The texture is deleted once nobody references it.
+	void ReleaseTexture(const unsigned int textureID);
+	// Decodes the given images on a pool of worker threads. LoadTexture picks the pixels up from here instead of
+	// decoding on the calling thread, so only the GL upload stays serial.
+	void PrefetchTextures(const std::vector<std::filesystem::path>& paths);
 	// Loads a binary file into a vector and returns it
 	std::vector<char> LoadBinaryFile(const std::string_view path) const;
 
-	ModelPtr GetModel(const std::string_view name, const std::string_view path);
+	ModelPtr GetModel(const std::string_view name, const std::string_view path,
+		const VertexLayout layout = VertexLayout::SplitPosition);
 	// Add a loaded model the the model cache
 	ModelPtr CacheModel(const std::string_view name, const Model model, const bool overwriteIfExists = false);
 
@@ -49,15 +57,43 @@ public:
 		const std::string_view alphaMaskPath);
 
 
-	// Removes a named model from cache.
+	// Removes a named model from cache, along with any material and texture no other cached model uses.
 	void UnloadModel(const std::string_view modelName);
 
 	auto GetNumLoadedTextures() const noexcept { return m_textureCache.size(); }
 	auto GetNumLoadedModels() const noexcept { return m_modelCache.size(); }
 	auto GetNumMaterials() const noexcept { return m_materialCache.size(); }
+	// Texture memory statistics
+	auto GetTextureBytesResident() const noexcept { return m_textureBytesResident; }
+	auto GetNumDuplicateTexturesAvoided() const noexcept { return m_duplicateTexturesAvoided; }
+	// Compressed texture disk cache statistics
+	auto GetNumTextureCacheHits() const noexcept { return m_textureDiskCacheHits; }
+	auto GetNumTextureCacheMisses() const noexcept { return m_textureDiskCacheMisses; }
 
 private:
+	// Pixels decoded by PrefetchTextures, waiting for the GL thread to upload them
+	struct DecodedImage {
+		int Width{ 0 };
+		int Height{ 0 };
+		int Components{ 0 };
+		std::unique_ptr<unsigned char, void(*)(void*)> Pixels{ nullptr, nullptr };
+	};
+
+	struct TextureEntry {
+		unsigned int Id{ 0 };
+		std::size_t RefCount{ 0 };
+		std::size_t Bytes{ 0 };
+	};
+
 	std::unordered_map<std::string, ModelPtr> m_modelCache;
-	std::unordered_map<std::string, unsigned int> m_textureCache;
+	std::unordered_map<std::string, DecodedImage> m_decodedImages;
+	// Keyed by canonical path plus load options
+	std::unordered_map<std::string, TextureEntry> m_textureCache;
+	std::unordered_map<unsigned int, std::string> m_textureKeys;
 	std::unordered_map<std::string, PBRMaterialPtr> m_materialCache;
+
+	std::size_t m_textureBytesResident{ 0 };
+	std::size_t m_duplicateTexturesAvoided{ 0 };
+	std::size_t m_textureDiskCacheHits{ 0 };
+	std::size_t m_textureDiskCacheMisses{ 0 };
 };
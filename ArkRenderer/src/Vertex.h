@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
@@ -23,4 +24,39 @@ struct Vertex
 	Vertex(const Vec3& position)
 		: m_position(position)
 	{}
-};
\ No newline at end of file
+};
+
+// How a mesh lays its vertex data out in GPU buffers
+enum class VertexLayout
+{
+	// One buffer of Vertex
+	Interleaved,
+	// Positions in a buffer of their own and the remaining attributes interleaved in a second one, so
+	// depth-only passes fetch 12 bytes per vertex instead of sizeof(Vertex)
+	SplitPosition,
+	// SplitPosition with quantized streams: unorm16 positions inside the mesh bounds, unorm16 UVs inside the
+	// mesh UV range and octahedral snorm16 normals and tangents. Needs the packed shader variants.
+	Packed
+};
+
+// Everything in Vertex but the position. Element of the attribute stream in VertexLayout::SplitPosition.
+struct VertexAttributes
+{
+	glm::vec2 m_texCoords;
+	glm::vec3 m_normal;
+	glm::vec3 m_tangent;
+};
+
+// Element of the position stream in VertexLayout::Packed. w is padding to keep the stream 8 byte aligned.
+struct PackedPosition
+{
+	std::uint16_t m_position[4];
+};
+
+// Element of the attribute stream in VertexLayout::Packed
+struct PackedVertexAttributes
+{
+	std::uint16_t m_texCoords[2];
+	std::int16_t m_normal[2];
+	std::int16_t m_tangent[2];
+};
@@ -16,9 +16,11 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
 
 layout (set = 1, binding = 1) uniform sampler2D diffuseMap;
 
+// SimplePushConstantData. The normal matrix is three columns so the block stays within 128 bytes.
 layout(push_constant) uniform Push {
-    mat4 modelMatrix; 
-    mat4 normalMatrix;
+    mat4 modelMatrix;
+    mat3x4 normalMatrix;
+    vec4 uvTransform;
 } push;
 
 
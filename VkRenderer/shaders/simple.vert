@@ -25,9 +25,11 @@ layout(set = 1, binding = 0) uniform GameObjectBufferData {
   mat4 normalMatrix;
 } gameObject;
 
+// SimplePushConstantData. The normal matrix is three columns so the block stays within 128 bytes.
 layout(push_constant) uniform Push {
-    mat4 modelMatrix; 
-    mat4 normalMatrix;
+    mat4 modelMatrix;
+    mat3x4 normalMatrix;
+    vec4 uvTransform;
 } push;
 
 
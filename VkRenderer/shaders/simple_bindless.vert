@@ -0,0 +1,54 @@
+#version 460
+#extension GL_KHR_vulkan_glsl : enable
+
+// Bindless variant of simple.vert: the per draw data comes from the frame's object buffer instead of push
+// constants, and the texture index is handed to the fragment shader.
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+layout (location = 3) out vec2 fragUv;
+layout (location = 4) flat out uint fragTextureIndex;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projection;
+    mat4 view;
+    vec4 ambientLightColor;
+    vec3 lightPosition;
+    vec4 lightColor;
+}ubo;
+
+// ArkBindlessResources::ObjectData
+struct ObjectData {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    vec4 uvTransform;
+    uint textureIndex;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+// Draws either push their index with firstInstance 0, or push 0 and pass their index as firstInstance, which
+// is what the indirect commands written by cull.comp do
+layout(push_constant) uniform Push {
+    uint objectIndex;
+} push;
+
+
+void main() {
+    ObjectData object = objects[push.objectIndex + gl_InstanceIndex];
+    vec4 positionWorld = object.modelMatrix * vec4(position, 1.0);
+    gl_Position = ubo.projection * ubo.view * positionWorld;
+
+    fragNormalWorld = normalize(mat3(object.normalMatrix) * normal);
+    fragPosWorld = positionWorld.xyz;
+    fragColor = color;
+    fragUv = uv;
+    fragTextureIndex = object.textureIndex;
+}
\ No newline at end of file
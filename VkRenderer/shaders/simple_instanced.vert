@@ -0,0 +1,35 @@
+#version 460
+#extension GL_KHR_vulkan_glsl : enable
+
+// Instanced variant of simple.vert: the matrices are per instance attributes read from the frame's instance
+// buffer (SimpleRenderSystem's InstanceData), so one draw covers every object of a batch.
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+layout(location = 4) in mat4 instanceModelMatrix;
+layout(location = 8) in mat4 instanceNormalMatrix;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+layout (location = 3) out vec2 fragUv;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projection;
+    mat4 view;
+    vec4 ambientLightColor;
+    vec3 lightPosition;
+    vec4 lightColor;
+}ubo;
+
+
+void main() {
+    vec4 positionWorld = instanceModelMatrix * vec4(position, 1.0);
+    gl_Position = ubo.projection * ubo.view * positionWorld;
+
+    fragNormalWorld = normalize(mat3(instanceNormalMatrix) * normal);
+    fragPosWorld = positionWorld.xyz;
+    fragColor = color;
+    fragUv = uv;
+}
@@ -0,0 +1,53 @@
+#version 460
+#extension GL_KHR_vulkan_glsl : enable
+
+// ArkModel::VertexLayout::Packed. Attributes arrive normalized: position and uv in [0, 1] inside the model
+// ranges, color in [0, 1] and the octahedral normal in [-1, 1].
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec2 octNormal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+layout (location = 3) out vec2 fragUv;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projection;
+    mat4 view;
+    vec4 ambientLightColor;
+    vec3 lightPosition;
+    vec4 lightColor;
+}ubo;
+
+layout(set = 1, binding = 0) uniform GameObjectBufferData {
+  mat4 modelMatrix;
+  mat4 normalMatrix;
+} gameObject;
+
+// SimplePushConstantData. modelMatrix has the dequantization transform folded in, uvTransform holds the UV
+// offset (xy) and extent (zw).
+layout(push_constant) uniform Push {
+    mat4 modelMatrix;
+    mat3x4 normalMatrix;
+    vec4 uvTransform;
+} push;
+
+vec3 OctDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+    gl_Position = ubo.projection * ubo.view * positionWorld;
+
+    fragNormalWorld = normalize(mat3(push.normalMatrix) * OctDecode(octNormal));
+    fragPosWorld = positionWorld.xyz;
+    fragColor = color;
+    fragUv = push.uvTransform.xy + uv * push.uvTransform.zw;
+}
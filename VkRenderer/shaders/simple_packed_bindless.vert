@@ -0,0 +1,61 @@
+#version 460
+#extension GL_KHR_vulkan_glsl : enable
+
+// Bindless variant of simple_packed.vert, reading the matrices and UV transform from ObjectData
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec2 octNormal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+layout (location = 3) out vec2 fragUv;
+layout (location = 4) flat out uint fragTextureIndex;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projection;
+    mat4 view;
+    vec4 ambientLightColor;
+    vec3 lightPosition;
+    vec4 lightColor;
+}ubo;
+
+// ArkBindlessResources::ObjectData. modelMatrix has the dequantization transform folded in, uvTransform holds the
+// UV offset (xy) and extent (zw).
+struct ObjectData {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    vec4 uvTransform;
+    uint textureIndex;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+// Draws either push their index with firstInstance 0, or push 0 and pass their index as firstInstance, which
+// is what the indirect commands written by cull.comp do
+layout(push_constant) uniform Push {
+    uint objectIndex;
+} push;
+
+vec3 OctDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    ObjectData object = objects[push.objectIndex + gl_InstanceIndex];
+    vec4 positionWorld = object.modelMatrix * vec4(position, 1.0);
+    gl_Position = ubo.projection * ubo.view * positionWorld;
+
+    fragNormalWorld = normalize(mat3(object.normalMatrix) * OctDecode(octNormal));
+    fragPosWorld = positionWorld.xyz;
+    fragColor = color;
+    fragUv = object.uvTransform.xy + uv * object.uvTransform.zw;
+    fragTextureIndex = object.textureIndex;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#version 460
+#extension GL_KHR_vulkan_glsl : enable
+
+// Instanced variant of simple_packed.vert. The per instance data is SimpleRenderSystem's InstanceData: the model
+// matrix has the dequantization transform folded in and the UV transform holds the UV offset (xy) and extent (zw).
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec2 octNormal;
+layout(location = 3) in vec2 uv;
+layout(location = 4) in mat4 instanceModelMatrix;
+layout(location = 8) in mat4 instanceNormalMatrix;
+layout(location = 12) in vec4 instanceUvTransform;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+layout (location = 3) out vec2 fragUv;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projection;
+    mat4 view;
+    vec4 ambientLightColor;
+    vec3 lightPosition;
+    vec4 lightColor;
+}ubo;
+
+vec3 OctDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    vec4 positionWorld = instanceModelMatrix * vec4(position, 1.0);
+    gl_Position = ubo.projection * ubo.view * positionWorld;
+
+    fragNormalWorld = normalize(mat3(instanceNormalMatrix) * OctDecode(octNormal));
+    fragPosWorld = positionWorld.xyz;
+    fragColor = color;
+    fragUv = instanceUvTransform.xy + uv * instanceUvTransform.zw;
+}
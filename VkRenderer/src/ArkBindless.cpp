@@ -0,0 +1,101 @@
+#include "ArkBindless.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace Ark
+{
+  ArkBindlessResources::ArkBindlessResources(ArkDevice& device, uint32_t framesInFlight)
+    : m_arkDevice{device}, m_maxTextures{std::min(MAX_TEXTURES, device.MaxBindlessSampledImages())}
+  {
+    assert(device.SupportsDescriptorIndexing() && "Bindless resources need descriptor indexing");
+
+    m_setLayout = ArkDescriptorSetLayout::Builder(m_arkDevice)
+                  .AddBinding(OBJECT_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                  .AddBinding(TEXTURE_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                              VK_SHADER_STAGE_FRAGMENT_BIT, m_maxTextures)
+                  .SetBindingFlags(TEXTURE_BINDING, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+                                   VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT)
+                  .Build();
+    m_pool = ArkDescriptorPool::Builder(m_arkDevice)
+             .SetMaxSets(framesInFlight)
+             .AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, framesInFlight)
+             .AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_maxTextures * framesInFlight)
+             .SetPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT)
+             .Build();
+
+    m_objectBuffers.resize(framesInFlight);
+    m_descriptorSets.resize(framesInFlight);
+    for (uint32_t i = 0; i < framesInFlight; i++)
+    {
+      m_objectBuffers[i] = std::make_unique<ArkBuffer>(
+        m_arkDevice,
+        sizeof(ObjectData),
+        MAX_OBJECTS,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+      m_objectBuffers[i]->Map();
+
+      auto bufferInfo = m_objectBuffers[i]->DescriptorInfo();
+      if (!ArkDescriptorWriter(*m_setLayout, *m_pool)
+           .WriteBuffer(OBJECT_BINDING, &bufferInfo)
+           .Build(m_descriptorSets[i]))
+      {
+        throw std::runtime_error("failed to allocate bindless descriptor set!");
+      }
+    }
+  }
+
+  uint32_t ArkBindlessResources::RegisterTexture(const Texture& texture)
+  {
+    auto it = m_textureIndices.find(texture.GetImageView());
+    if (it != m_textureIndices.end())
+    {
+      return it->second;
+    }
+    if (m_textureIndices.size() >= m_maxTextures)
+    {
+      throw std::runtime_error("bindless texture array is full!");
+    }
+
+    const auto index = static_cast<uint32_t>(m_textureIndices.size());
+    auto imageInfo = texture.GetImageInfo();
+    for (auto& set : m_descriptorSets)
+    {
+      ArkDescriptorWriter(*m_setLayout, *m_pool)
+        .WriteImageArrayElement(TEXTURE_BINDING, index, &imageInfo)
+        .Overwrite(set);
+    }
+    m_textureIndices.emplace(texture.GetImageView(), index);
+    return index;
+  }
+
+  ArkBindlessResources::ObjectData* ArkBindlessResources::GetObjectData(int frameIndex) const
+  {
+    return static_cast<ObjectData*>(m_objectBuffers[frameIndex]->GetMappedMemory());
+  }
+
+  void ArkBindlessResources::WriteObject(int frameIndex, uint32_t index, ArkGameObject& obj)
+  {
+    assert(index < MAX_OBJECTS && "Object index outside of the object buffer");
+    auto& data = GetObjectData(frameIndex)[index];
+    data.modelMatrix = obj.GetModelMatrix();
+    data.normalMatrix = obj.GetNormalMatrix();
+    data.uvTransform = obj.m_model->GetUvTransform();
+    if (obj.m_model->GetLayout() == ArkModel::VertexLayout::Packed)
+    {
+      data.modelMatrix = data.modelMatrix * obj.m_model->GetDequantizeMatrix();
+    }
+    data.textureIndex = RegisterTexture(*obj.m_diffuseMap);
+  }
+
+  void ArkBindlessResources::FlushObjectData(int frameIndex, uint32_t count)
+  {
+    if (count > 0)
+    {
+      m_objectBuffers[frameIndex]->Flush(sizeof(ObjectData) * count, 0);
+    }
+  }
+}
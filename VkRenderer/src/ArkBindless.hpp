@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ArkDevice.hpp"
+#include "ArkBuffer.hpp"
+#include "ArkDescriptors.hpp"
+#include "ArkGameObject.hpp"
+#include "Texture.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Ark
+{
+  // Descriptors for the bindless render path: every registered texture in one sampled image array, and the
+  // per draw data of a frame in one storage buffer. Draws only push the index of their ObjectData, so a frame
+  // binds a single set. Needs ArkDevice::SupportsDescriptorIndexing.
+  class ArkBindlessResources
+  {
+  public:
+    static constexpr uint32_t OBJECT_BINDING = 0;
+    static constexpr uint32_t TEXTURE_BINDING = 1;
+    // Clamped to the device's update-after-bind limit
+    static constexpr uint32_t MAX_TEXTURES = 4096;
+    static constexpr uint32_t MAX_OBJECTS = 128 * 1024;
+
+    // std430 layout of ObjectData in the bindless shaders
+    struct ObjectData
+    {
+      glm::mat4 modelMatrix{1.f};
+      glm::mat4 normalMatrix{1.f};
+      // UV offset (xy) and extent (zw) of packed models
+      glm::vec4 uvTransform{0.f, 0.f, 1.f, 1.f};
+      uint32_t textureIndex{0};
+      uint32_t padding[3]{};
+    };
+
+    ArkBindlessResources(ArkDevice& device, uint32_t framesInFlight);
+
+    ArkBindlessResources(const ArkBindlessResources&) = delete;
+    ArkBindlessResources& operator=(const ArkBindlessResources&) = delete;
+
+    VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_setLayout->GetDescriptorSetLayout(); }
+    VkDescriptorSet GetDescriptorSet(int frameIndex) const { return m_descriptorSets[frameIndex]; }
+
+    // Index of the texture in the array, written to every frame's set on first use. The array is update-after-bind
+    // and partially bound, so new textures can be added while earlier frames are in flight. Textures have to stay
+    // alive as long as the resources do.
+    uint32_t RegisterTexture(const Texture& texture);
+    uint32_t GetTextureCount() const { return static_cast<uint32_t>(m_textureIndices.size()); }
+
+    // Persistently mapped, MAX_OBJECTS entries. Written while recording the frame, then flushed.
+    ObjectData* GetObjectData(int frameIndex) const;
+    void FlushObjectData(int frameIndex, uint32_t count);
+    // Fills entry index of the frame's object data from the object's transform, model and diffuse map
+    void WriteObject(int frameIndex, uint32_t index, ArkGameObject& obj);
+    VkDescriptorBufferInfo GetObjectBufferInfo(int frameIndex) const
+    {
+      return m_objectBuffers[frameIndex]->DescriptorInfo();
+    }
+
+  private:
+    ArkDevice& m_arkDevice;
+    uint32_t m_maxTextures;
+    std::unique_ptr<ArkDescriptorSetLayout> m_setLayout;
+    std::unique_ptr<ArkDescriptorPool> m_pool;
+    std::vector<std::unique_ptr<ArkBuffer>> m_objectBuffers{};
+    std::vector<VkDescriptorSet> m_descriptorSets{};
+    std::unordered_map<VkImageView, uint32_t> m_textureIndices{};
+  };
+}
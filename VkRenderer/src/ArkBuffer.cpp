@@ -43,18 +43,20 @@ namespace Ark {
         m_memoryPropertyFlags{ memoryPropertyFlags } {
         m_alignmentSize = GetAlignment(instanceSize, minOffsetAlignment);
         m_bufferSize = m_alignmentSize * instanceCount;
-        device.CreateBuffer(m_bufferSize, usageFlags, memoryPropertyFlags, m_buffer, m_memory);
+        device.CreateBuffer(m_bufferSize, usageFlags, memoryPropertyFlags, m_buffer, m_allocation);
     }
 
     ArkBuffer::~ArkBuffer() {
         Unmap();
         vkDestroyBuffer(m_arkDevice.Device(), m_buffer, nullptr);
-        vkFreeMemory(m_arkDevice.Device(), m_memory, nullptr);
+        m_arkDevice.Allocator().Free(m_allocation);
     }
 
     /**
      * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
      *
+     * @note Host visible memory blocks are mapped once by the allocator, so this only points into that mapping
+     *
      * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
      * buffer range.
      * @param offset (Optional) Byte offset from beginning
@@ -62,20 +64,21 @@ namespace Ark {
      * @return VkResult of the buffer mapping call
      */
     VkResult ArkBuffer::Map(VkDeviceSize size, VkDeviceSize offset) {
-        assert(m_buffer && m_memory && "Called map on buffer before create");
-        return vkMapMemory(m_arkDevice.Device(), m_memory, offset, size, 0, &m_mapped);
+        assert(m_buffer && m_allocation.IsValid() && "Called map on buffer before create");
+        if (!m_allocation.mapped) {
+            return VK_ERROR_MEMORY_MAP_FAILED;
+        }
+        m_mapped = static_cast<char*>(m_allocation.mapped) + offset;
+        return VK_SUCCESS;
     }
 
     /**
      * Unmap a mapped memory range
      *
-     * @note Does not return a result as vkUnmapMemory can't fail
+     * @note The block stays mapped until the allocator releases it
      */
     void ArkBuffer::Unmap() {
-        if (m_mapped) {
-            vkUnmapMemory(m_arkDevice.Device(), m_memory);
-            m_mapped = nullptr;
-        }
+        m_mapped = nullptr;
     }
 
     /**
@@ -112,12 +115,7 @@ namespace Ark {
      * @return VkResult of the flush call
      */
     VkResult ArkBuffer::Flush(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = m_memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkFlushMappedMemoryRanges(m_arkDevice.Device(), 1, &mappedRange);
+        return m_arkDevice.Allocator().Flush(m_allocation, offset, size);
     }
 
     /**
@@ -132,12 +130,7 @@ namespace Ark {
      * @return VkResult of the invalidate call
      */
     VkResult ArkBuffer::Invalidate(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = m_memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkInvalidateMappedMemoryRanges(m_arkDevice.Device(), 1, &mappedRange);
+        return m_arkDevice.Allocator().Invalidate(m_allocation, offset, size);
     }
 
     /**
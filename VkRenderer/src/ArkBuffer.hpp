@@ -46,7 +46,7 @@ namespace Ark {
         ArkDevice& m_arkDevice;
         void* m_mapped = nullptr;
         VkBuffer m_buffer = VK_NULL_HANDLE;
-        VkDeviceMemory m_memory = VK_NULL_HANDLE;
+        ArkAllocation m_allocation{};
 
         VkDeviceSize m_bufferSize;
         uint32_t m_instanceCount;
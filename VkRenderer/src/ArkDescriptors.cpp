@@ -1,7 +1,9 @@
 #include "ArkDescriptors.hpp"
 
 // std
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <stdexcept>
 
 namespace Ark
@@ -23,20 +25,34 @@ namespace Ark
     return *this;
   }
 
+  ArkDescriptorSetLayout::Builder& ArkDescriptorSetLayout::Builder::SetBindingFlags(
+    uint32_t binding, VkDescriptorBindingFlagsEXT flags)
+  {
+    assert(m_bindings.count(binding) == 1 && "Binding flags set before the binding was added");
+    m_bindingFlags[binding] = flags;
+    return *this;
+  }
+
   std::unique_ptr<ArkDescriptorSetLayout> ArkDescriptorSetLayout::Builder::Build() const
   {
-    return std::make_unique<ArkDescriptorSetLayout>(m_arkDevice, m_bindings);
+    return std::make_unique<ArkDescriptorSetLayout>(m_arkDevice, m_bindings, m_bindingFlags);
   }
 
   // *************** Descriptor Set Layout *********************
   ArkDescriptorSetLayout::ArkDescriptorSetLayout(
-    ArkDevice& arkDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
+    ArkDevice& arkDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+    const std::unordered_map<uint32_t, VkDescriptorBindingFlagsEXT>& bindingFlags)
     : m_arkDevice{arkDevice}, m_bindings{bindings}
   {
     std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+    std::vector<VkDescriptorBindingFlagsEXT> setLayoutBindingFlags{};
+    bool updateAfterBind = false;
     for (auto& kv : bindings)
     {
       setLayoutBindings.push_back(kv.second);
+      auto flags = bindingFlags.find(kv.first);
+      setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
+      updateAfterBind |= (setLayoutBindingFlags.back() & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT) != 0;
     }
 
     VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
@@ -44,6 +60,20 @@ namespace Ark
     descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
     descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
 
+    // Only chained when used, so layouts without flags don't depend on descriptor indexing
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+    if (!bindingFlags.empty())
+    {
+      descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+    }
+    if (updateAfterBind)
+    {
+      descriptorSetLayoutInfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    }
+
     if (vkCreateDescriptorSetLayout(
       arkDevice.Device(),
       &descriptorSetLayoutInfo,
@@ -193,6 +223,26 @@ namespace Ark
       return *this;
   }
 
+  ArkDescriptorWriter& ArkDescriptorWriter::WriteImageArrayElement(
+      uint32_t binding, uint32_t arrayElement, VkDescriptorImageInfo* imageInfo) {
+      assert(m_setLayout.m_bindings.count(binding) == 1 && "Layout does not contain specified binding");
+
+      auto& bindingDescription = m_setLayout.m_bindings[binding];
+
+      assert(arrayElement < bindingDescription.descriptorCount && "Array element out of binding range");
+
+      VkWriteDescriptorSet write{};
+      write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      write.descriptorType = bindingDescription.descriptorType;
+      write.dstBinding = binding;
+      write.dstArrayElement = arrayElement;
+      write.pImageInfo = imageInfo;
+      write.descriptorCount = 1;
+
+      m_writes.push_back(write);
+      return *this;
+  }
+
   bool ArkDescriptorWriter::Build(VkDescriptorSet& set) {
       bool success = m_pool.AllocateDescriptor(m_setLayout.GetDescriptorSetLayout(), set);
       if (!success) {
@@ -208,4 +258,226 @@ namespace Ark
       }
       vkUpdateDescriptorSets(m_pool.m_arkDevice.Device(), m_writes.size(), m_writes.data(), 0, nullptr);
   }
+
+  // *************** Descriptor Cache Key *********************
+
+  namespace
+  {
+    // Non-dispatchable handles are pointers or 64 bit integers depending on the platform
+    template <typename T>
+    uint64_t HandleBits(T handle)
+    {
+      uint64_t bits = 0;
+      std::memcpy(&bits, &handle, sizeof(handle));
+      return bits;
+    }
+
+    void HashCombine(size_t& seed, uint64_t value)
+    {
+      seed ^= std::hash<uint64_t>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+  }
+
+  ArkDescriptorCache::Key& ArkDescriptorCache::Key::WriteBuffer(
+    uint32_t binding, const VkDescriptorBufferInfo& bufferInfo)
+  {
+    assert(m_setLayout->m_bindings.count(binding) == 1 && "Layout does not contain specified binding");
+    assert(m_entryCount < MAX_BINDINGS && "Too many bindings in descriptor cache key");
+    auto& entry = m_entries[m_entryCount++];
+    entry.binding = binding;
+    entry.isImage = false;
+    entry.bufferInfo = bufferInfo;
+    return *this;
+  }
+
+  ArkDescriptorCache::Key& ArkDescriptorCache::Key::WriteImage(
+    uint32_t binding, const VkDescriptorImageInfo& imageInfo)
+  {
+    assert(m_setLayout->m_bindings.count(binding) == 1 && "Layout does not contain specified binding");
+    assert(m_entryCount < MAX_BINDINGS && "Too many bindings in descriptor cache key");
+    auto& entry = m_entries[m_entryCount++];
+    entry.binding = binding;
+    entry.isImage = true;
+    entry.imageInfo = imageInfo;
+    return *this;
+  }
+
+  bool ArkDescriptorCache::Key::operator==(const Key& other) const
+  {
+    if (m_setLayout != other.m_setLayout || m_entryCount != other.m_entryCount)
+    {
+      return false;
+    }
+    for (uint32_t i = 0; i < m_entryCount; i++)
+    {
+      const auto& a = m_entries[i];
+      const auto& b = other.m_entries[i];
+      if (a.binding != b.binding || a.isImage != b.isImage)
+      {
+        return false;
+      }
+      if (a.isImage)
+      {
+        if (a.imageInfo.sampler != b.imageInfo.sampler || a.imageInfo.imageView != b.imageInfo.imageView ||
+          a.imageInfo.imageLayout != b.imageInfo.imageLayout)
+        {
+          return false;
+        }
+      }
+      else if (a.bufferInfo.buffer != b.bufferInfo.buffer || a.bufferInfo.offset != b.bufferInfo.offset ||
+        a.bufferInfo.range != b.bufferInfo.range)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  size_t ArkDescriptorCache::Key::Hash() const
+  {
+    size_t seed = std::hash<const void*>{}(m_setLayout);
+    for (uint32_t i = 0; i < m_entryCount; i++)
+    {
+      const auto& entry = m_entries[i];
+      HashCombine(seed, entry.binding);
+      if (entry.isImage)
+      {
+        HashCombine(seed, HandleBits(entry.imageInfo.sampler));
+        HashCombine(seed, HandleBits(entry.imageInfo.imageView));
+        HashCombine(seed, entry.imageInfo.imageLayout);
+      }
+      else
+      {
+        HashCombine(seed, HandleBits(entry.bufferInfo.buffer));
+        HashCombine(seed, entry.bufferInfo.offset);
+        HashCombine(seed, entry.bufferInfo.range);
+      }
+    }
+    return seed;
+  }
+
+  // *************** Descriptor Cache *********************
+
+  ArkDescriptorCache::ArkDescriptorCache(ArkDevice& arkDevice, uint32_t framesInFlight)
+    : m_arkDevice{arkDevice}, m_retainFrames{std::max<uint64_t>(MIN_RETAIN_FRAMES, framesInFlight + 1)}
+  {
+  }
+
+  VkDescriptorSet ArkDescriptorCache::Get(const Key& key)
+  {
+    m_stats.requests++;
+    auto it = m_sets.find(key);
+    if (it != m_sets.end())
+    {
+      it->second.lastUsedFrame = m_frame;
+      return it->second.set;
+    }
+
+    const VkDescriptorSetLayout setLayout = key.m_setLayout->GetDescriptorSetLayout();
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    auto& freeSets = m_freeSets[setLayout];
+    if (!freeSets.empty())
+    {
+      set = freeSets.back();
+      freeSets.pop_back();
+    }
+    else if (!AllocateSet(setLayout, set))
+    {
+      throw std::runtime_error("failed to allocate cached descriptor set!");
+    }
+
+    std::array<VkWriteDescriptorSet, MAX_BINDINGS> writes{};
+    for (uint32_t i = 0; i < key.m_entryCount; i++)
+    {
+      const auto& entry = key.m_entries[i];
+      auto& write = writes[i];
+      write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      write.dstSet = set;
+      write.dstBinding = entry.binding;
+      write.descriptorType = key.m_setLayout->m_bindings.at(entry.binding).descriptorType;
+      write.descriptorCount = 1;
+      if (entry.isImage)
+      {
+        write.pImageInfo = &entry.imageInfo;
+      }
+      else
+      {
+        write.pBufferInfo = &entry.bufferInfo;
+      }
+    }
+    vkUpdateDescriptorSets(m_arkDevice.Device(), key.m_entryCount, writes.data(), 0, nullptr);
+    m_stats.updates++;
+
+    m_sets.emplace(key, CachedSet{set, m_frame});
+    m_stats.cachedSets = m_sets.size();
+    return set;
+  }
+
+  void ArkDescriptorCache::NextFrame()
+  {
+    m_frame++;
+    // A sweep every retain period bounds how long an unused set lingers to twice that
+    if (m_frame % m_retainFrames == 0)
+    {
+      RecycleUnused();
+    }
+    m_stats.requests = 0;
+    m_stats.allocations = 0;
+    m_stats.updates = 0;
+    m_stats.cachedSets = m_sets.size();
+  }
+
+  bool ArkDescriptorCache::References(VkBuffer buffer) const
+  {
+    for (const auto& [key, cached] : m_sets)
+    {
+      for (uint32_t i = 0; i < key.m_entryCount; i++)
+      {
+        if (!key.m_entries[i].isImage && key.m_entries[i].bufferInfo.buffer == buffer)
+        {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  bool ArkDescriptorCache::AllocateSet(VkDescriptorSetLayout setLayout, VkDescriptorSet& set)
+  {
+    if (!m_pools.empty() && m_pools.back()->AllocateDescriptor(setLayout, set))
+    {
+      m_stats.allocations++;
+      return true;
+    }
+    // Older pools are full, since sets are never freed back to them individually
+    m_pools.push_back(ArkDescriptorPool::Builder(m_arkDevice)
+                      .SetMaxSets(SETS_PER_POOL)
+                      .AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SETS_PER_POOL * 2)
+                      .AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SETS_PER_POOL)
+                      .AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SETS_PER_POOL * 2)
+                      .Build());
+    if (!m_pools.back()->AllocateDescriptor(setLayout, set))
+    {
+      return false;
+    }
+    m_stats.allocations++;
+    return true;
+  }
+
+  void ArkDescriptorCache::RecycleUnused()
+  {
+    for (auto it = m_sets.begin(); it != m_sets.end();)
+    {
+      // Frames in flight are within the retain period, so the GPU is done with these sets
+      if (m_frame - it->second.lastUsedFrame >= m_retainFrames)
+      {
+        m_freeSets[it->first.m_setLayout->GetDescriptorSetLayout()].push_back(it->second.set);
+        it = m_sets.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <memory>
 #include <unordered_map>
 
@@ -22,15 +23,20 @@ namespace Ark
         VkDescriptorType descriptorType,
         VkShaderStageFlags stageFlags,
         uint32_t count = 1);
+      // Descriptor indexing flags of a binding added before. Update-after-bind bindings need a pool created with
+      // VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT.
+      Builder& SetBindingFlags(uint32_t binding, VkDescriptorBindingFlagsEXT flags);
       std::unique_ptr<ArkDescriptorSetLayout> Build() const;
 
     private:
       ArkDevice& m_arkDevice;
       std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> m_bindings{};
+      std::unordered_map<uint32_t, VkDescriptorBindingFlagsEXT> m_bindingFlags{};
     };
 
     ArkDescriptorSetLayout(
-      ArkDevice& arkDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+      ArkDevice& arkDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+      const std::unordered_map<uint32_t, VkDescriptorBindingFlagsEXT>& bindingFlags = {});
     ~ArkDescriptorSetLayout();
     ArkDescriptorSetLayout(const ArkDescriptorSetLayout&) = delete;
     ArkDescriptorSetLayout& operator=(const ArkDescriptorSetLayout&) = delete;
@@ -43,6 +49,7 @@ namespace Ark
     std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> m_bindings;
 
     friend class ArkDescriptorWriter;
+    friend class ArkDescriptorCache;
   };
 
   class ArkDescriptorPool
@@ -97,6 +104,9 @@ namespace Ark
 
     ArkDescriptorWriter& WriteBuffer(uint32_t binding, VkDescriptorBufferInfo* bufferInfo);
     ArkDescriptorWriter& WriteImage(uint32_t binding, VkDescriptorImageInfo* imageInfo);
+    // Writes one element of an array binding
+    ArkDescriptorWriter& WriteImageArrayElement(uint32_t binding, uint32_t arrayElement,
+                                                VkDescriptorImageInfo* imageInfo);
 
     bool Build(VkDescriptorSet& set);
     void Overwrite(VkDescriptorSet& set);
@@ -106,4 +116,92 @@ namespace Ark
     ArkDescriptorPool& m_pool;
     std::vector<VkWriteDescriptorSet> m_writes;
   };
+
+  // Hands out descriptor sets that persist across frames, keyed by their layout and the resources they point to.
+  // A key seen before returns the same set without any allocation or update, so per object sets are only written
+  // when an input changes. Sets left unused for a while are recycled for new keys, and pools are added as needed.
+  // Resources have to outlive the sets referencing them, References tells whether a buffer is still cached.
+  class ArkDescriptorCache
+  {
+  public:
+    static constexpr uint32_t MAX_BINDINGS = 8;
+    static constexpr uint32_t SETS_PER_POOL = 256;
+    // Sets unused for this many frames are recycled, as long as that is more than the frames in flight
+    static constexpr uint64_t MIN_RETAIN_FRAMES = 120;
+
+    class Key
+    {
+    public:
+      explicit Key(ArkDescriptorSetLayout& setLayout) : m_setLayout{&setLayout}
+      {
+      }
+
+      Key& WriteBuffer(uint32_t binding, const VkDescriptorBufferInfo& bufferInfo);
+      Key& WriteImage(uint32_t binding, const VkDescriptorImageInfo& imageInfo);
+
+      bool operator==(const Key& other) const;
+      size_t Hash() const;
+
+    private:
+      struct Entry
+      {
+        uint32_t binding{0};
+        bool isImage{false};
+        VkDescriptorBufferInfo bufferInfo{};
+        VkDescriptorImageInfo imageInfo{};
+      };
+
+      ArkDescriptorSetLayout* m_setLayout;
+      std::array<Entry, MAX_BINDINGS> m_entries{};
+      uint32_t m_entryCount{0};
+
+      friend class ArkDescriptorCache;
+    };
+
+    // Counts since the last NextFrame call, plus the number of cached sets
+    struct Stats
+    {
+      uint32_t requests{0};
+      uint32_t allocations{0};
+      uint32_t updates{0};
+      size_t cachedSets{0};
+    };
+
+    ArkDescriptorCache(ArkDevice& arkDevice, uint32_t framesInFlight);
+    ArkDescriptorCache(const ArkDescriptorCache&) = delete;
+    ArkDescriptorCache& operator=(const ArkDescriptorCache&) = delete;
+
+    VkDescriptorSet Get(const Key& key);
+    // Call once per frame, after the fence of the frame being recorded has been waited on
+    void NextFrame();
+    // True while a cached set points at buffer. Sets stop doing so once they are recycled, MIN_RETAIN_FRAMES or more
+    // after their last use.
+    bool References(VkBuffer buffer) const;
+
+    const Stats& GetStats() const { return m_stats; }
+
+  private:
+    struct KeyHash
+    {
+      size_t operator()(const Key& key) const { return key.Hash(); }
+    };
+
+    struct CachedSet
+    {
+      VkDescriptorSet set;
+      uint64_t lastUsedFrame;
+    };
+
+    bool AllocateSet(VkDescriptorSetLayout setLayout, VkDescriptorSet& set);
+    void RecycleUnused();
+
+    ArkDevice& m_arkDevice;
+    uint64_t m_retainFrames;
+    uint64_t m_frame{0};
+    std::vector<std::unique_ptr<ArkDescriptorPool>> m_pools{};
+    std::unordered_map<Key, CachedSet, KeyHash> m_sets{};
+    // Recycled sets by layout, rewritten before they are handed out again
+    std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> m_freeSets{};
+    Stats m_stats{};
+  };
 }
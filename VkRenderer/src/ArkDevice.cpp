@@ -1,5 +1,8 @@
 #include "ArkDevice.hpp"
+#include "ArkUploadManager.hpp"
+#include "ArkPipelineCache.hpp"
 // std headers
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -57,12 +60,18 @@ namespace Ark
     CreateSurface();
     PickPhysicalDevice();
     CreateLogicalDevice();
+    m_allocator = std::make_unique<ArkMemoryAllocator>(m_physicalDevice, m_device);
     CreateCommandPool();
+    m_uploader = std::make_unique<ArkUploadManager>(*this);
+    m_pipelineCache = std::make_unique<ArkPipelineCache>(*this, ArkPipelineCache::DEFAULT_PATH);
   }
 
   ArkDevice::~ArkDevice()
   {
+    m_pipelineCache.reset();
+    m_uploader.reset();
     vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    m_allocator.reset();
     vkDestroyDevice(m_device, nullptr);
 
     if (enableValidationLayers)
@@ -94,6 +103,19 @@ namespace Ark
     createInfo.pApplicationInfo = &appInfo;
 
     auto extensions = GetRequiredExtensions();
+    // Needed to query descriptor indexing support on a 1.0 instance
+    uint32_t availableCount = 0;
+    vkEnumerateInstanceExtensionProperties(nullptr, &availableCount, nullptr);
+    std::vector<VkExtensionProperties> available(availableCount);
+    vkEnumerateInstanceExtensionProperties(nullptr, &availableCount, available.data());
+    for (const auto& extension : available)
+    {
+      if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0)
+      {
+        extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+        m_hasPhysicalDeviceProperties2 = true;
+      }
+    }
     createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
     createInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -132,11 +154,21 @@ namespace Ark
     std::vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(m_instance, &deviceCount, devices.data());
 
+    // Prefer a discrete GPU, but take any suitable device otherwise, e.g. lavapipe for testing
     for (const auto& device : devices)
     {
-      if (IsDeviceSuitable(device))
+      if (!IsDeviceSuitable(device))
+      {
+        continue;
+      }
+      VkPhysicalDeviceProperties deviceProperties;
+      vkGetPhysicalDeviceProperties(device, &deviceProperties);
+      if (m_physicalDevice == VK_NULL_HANDLE || deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
       {
         m_physicalDevice = device;
+      }
+      if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+      {
         break;
       }
     }
@@ -156,6 +188,10 @@ namespace Ark
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = {indices.m_graphicsFamily, indices.m_presentFamily};
+    if (indices.m_transferFamilyHasValue)
+    {
+      uniqueQueueFamilies.insert(indices.m_transferFamily);
+    }
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -168,8 +204,34 @@ namespace Ark
       queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(m_physicalDevice, &supportedFeatures);
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    // Both needed for GPU generated draws: many draws per indirect call, each selecting its object by firstInstance
+    m_multiDrawIndirect = supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance;
+    deviceFeatures.multiDrawIndirect = m_multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = m_multiDrawIndirect;
+
+    QueryDescriptorIndexingSupport();
+    std::vector<const char*> enabledExtensions = deviceExtensions;
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    if (m_descriptorIndexing)
+    {
+      enabledExtensions.insert(enabledExtensions.end(), descriptorIndexingExtensions.begin(),
+                               descriptorIndexingExtensions.end());
+      indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+      indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+      indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+      indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    }
+    m_drawIndirectCount = m_multiDrawIndirect &&
+      CheckDeviceExtensionSupport(m_physicalDevice, {VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME});
+    if (m_drawIndirectCount)
+    {
+      enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -178,8 +240,9 @@ namespace Ark
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
+    createInfo.pNext = m_descriptorIndexing ? &indexingFeatures : nullptr;
 
     // might not really be necessary anymore because device specific validation layers
     // have been deprecated
@@ -198,8 +261,22 @@ namespace Ark
       throw std::runtime_error("failed to create logical device!");
     }
 
+    if (m_drawIndirectCount)
+    {
+      m_cmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+        vkGetDeviceProcAddr(m_device, "vkCmdDrawIndexedIndirectCountKHR"));
+      m_drawIndirectCount = m_cmdDrawIndexedIndirectCount != nullptr;
+    }
+    std::cout << "multi draw indirect: " << (m_multiDrawIndirect ? "supported" : "not supported")
+      << ", draw indirect count: " << (m_drawIndirectCount ? "supported" : "not supported") << std::endl;
+
     vkGetDeviceQueue(m_device, indices.m_graphicsFamily, 0, &m_graphicsQueue);
     vkGetDeviceQueue(m_device, indices.m_presentFamily, 0, &m_presentQueue);
+    if (indices.m_transferFamilyHasValue)
+    {
+      vkGetDeviceQueue(m_device, indices.m_transferFamily, 0, &m_transferQueue);
+      std::cout << "dedicated transfer queue family: " << indices.m_transferFamily << std::endl;
+    }
   }
 
   void ArkDevice::CreateCommandPool()
@@ -225,9 +302,6 @@ namespace Ark
   bool ArkDevice::IsDeviceSuitable(VkPhysicalDevice device)
   {
     QueueFamilyIndices indices = FindQueueFamilies(device);
-    VkPhysicalDeviceProperties deviceProperties;
-    vkGetPhysicalDeviceProperties(device, &deviceProperties);
-    if (deviceProperties.deviceType != VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) return false;
     bool extensionsSupported = CheckDeviceExtensionSupport(device);
 
     bool swapChainAdequate = false;
@@ -341,6 +415,11 @@ namespace Ark
   }
 
   bool ArkDevice::CheckDeviceExtensionSupport(VkPhysicalDevice device)
+  {
+    return CheckDeviceExtensionSupport(device, deviceExtensions);
+  }
+
+  bool ArkDevice::CheckDeviceExtensionSupport(VkPhysicalDevice device, const std::vector<const char*>& extensions)
   {
     uint32_t extensionCount;
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
@@ -348,7 +427,7 @@ namespace Ark
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
     for (const auto& extension : availableExtensions)
     {
@@ -358,6 +437,54 @@ namespace Ark
     return requiredExtensions.empty();
   }
 
+  void ArkDevice::QueryDescriptorIndexingSupport()
+  {
+    m_descriptorIndexing = false;
+    m_maxBindlessSampledImages = 0;
+    if (!m_hasPhysicalDeviceProperties2 ||
+      !CheckDeviceExtensionSupport(m_physicalDevice, descriptorIndexingExtensions))
+    {
+      return;
+    }
+    auto getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+      vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceFeatures2KHR"));
+    auto getProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2KHR>(
+      vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceProperties2KHR"));
+    if (getFeatures2 == nullptr || getProperties2 == nullptr)
+    {
+      return;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    VkPhysicalDeviceFeatures2KHR features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+    features.pNext = &indexingFeatures;
+    getFeatures2(m_physicalDevice, &features);
+
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties = {};
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2KHR deviceProperties = {};
+    deviceProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+    deviceProperties.pNext = &indexingProperties;
+    getProperties2(m_physicalDevice, &deviceProperties);
+
+    m_descriptorIndexing = indexingFeatures.shaderSampledImageArrayNonUniformIndexing &&
+      indexingFeatures.runtimeDescriptorArray && indexingFeatures.descriptorBindingPartiallyBound &&
+      indexingFeatures.descriptorBindingSampledImageUpdateAfterBind;
+    if (m_descriptorIndexing)
+    {
+      // Bindless textures are combined image samplers, which count against the sampler limits as well
+      m_maxBindlessSampledImages = std::min({
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+        indexingProperties.maxDescriptorSetUpdateAfterBindSamplers
+      });
+    }
+    std::cout << "descriptor indexing: " << (m_descriptorIndexing ? "supported" : "not supported") << std::endl;
+  }
+
   QueueFamilyIndices ArkDevice::FindQueueFamilies(VkPhysicalDevice device)
   {
     QueueFamilyIndices indices;
@@ -391,6 +518,22 @@ namespace Ark
       i++;
     }
 
+    // Prefer a family that only does transfers (the DMA engines), then any without graphics
+    for (const VkQueueFlags excluded : {VkQueueFlags{VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT},
+                                        VkQueueFlags{VK_QUEUE_GRAPHICS_BIT}})
+    {
+      for (uint32_t family = 0; family < queueFamilyCount && !indices.m_transferFamilyHasValue; family++)
+      {
+        const auto& queueFamily = queueFamilies[family];
+        if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+          !(queueFamily.queueFlags & excluded))
+        {
+          indices.m_transferFamily = family;
+          indices.m_transferFamilyHasValue = true;
+        }
+      }
+    }
+
     return indices;
   }
 
@@ -456,7 +599,7 @@ namespace Ark
   }
 
   void ArkDevice::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
-                               VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+                               VkBuffer& buffer, ArkAllocation& bufferAllocation)
   {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -472,17 +615,8 @@ namespace Ark
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(m_device, buffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-    {
-      throw std::runtime_error("failed to allocate vertex buffer memory!");
-    }
-
-    vkBindBufferMemory(m_device, buffer, bufferMemory, 0);
+    bufferAllocation = m_allocator->Allocate(memRequirements, properties, ArkMemoryAllocator::ResourceKind::LINEAR);
+    vkBindBufferMemory(m_device, buffer, bufferAllocation.memory, bufferAllocation.offset);
   }
 
   VkCommandBuffer ArkDevice::BeginSingleTimeCommands()
@@ -513,9 +647,16 @@ namespace Ark
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(m_graphicsQueue);
+    // Wait for this submission only, not for everything else on the queue
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    vkCreateFence(m_device, &fenceInfo, nullptr, &fence);
+
+    vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, fence);
+    vkWaitForFences(m_device, 1, &fence, VK_TRUE, UINT64_MAX);
 
+    vkDestroyFence(m_device, fence, nullptr);
     vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
   }
 
@@ -555,7 +696,7 @@ namespace Ark
   }
 
   void ArkDevice::CreateImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties,
-                                      VkImage& image, VkDeviceMemory& imageMemory)
+                                      VkImage& image, ArkAllocation& imageAllocation)
   {
     if (vkCreateImage(m_device, &imageInfo, nullptr, &image) != VK_SUCCESS)
     {
@@ -565,17 +706,12 @@ namespace Ark
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(m_device, image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-    {
-      throw std::runtime_error("failed to allocate image memory!");
-    }
+    const auto kind = imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL
+                        ? ArkMemoryAllocator::ResourceKind::OPTIMAL
+                        : ArkMemoryAllocator::ResourceKind::LINEAR;
+    imageAllocation = m_allocator->Allocate(memRequirements, properties, kind);
 
-    if (vkBindImageMemory(m_device, image, imageMemory, 0) != VK_SUCCESS)
+    if (vkBindImageMemory(m_device, image, imageAllocation.memory, imageAllocation.offset) != VK_SUCCESS)
     {
       throw std::runtime_error("failed to bind image memory!");
     }
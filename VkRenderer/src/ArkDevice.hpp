@@ -1,13 +1,18 @@
 #pragma once
 
 #include "WindowSystem.hpp"
+#include "ArkMemoryAllocator.hpp"
 
 // std lib headers
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace Ark
 {
+  class ArkUploadManager;
+  class ArkPipelineCache;
+
   struct SwapChainSupportDetails
   {
     VkSurfaceCapabilitiesKHR m_capabilities;
@@ -19,8 +24,11 @@ namespace Ark
   {
     uint32_t m_graphicsFamily;
     uint32_t m_presentFamily;
+    // Transfer-only family that copies can run on alongside graphics work, if the device has one
+    uint32_t m_transferFamily;
     bool m_graphicsFamilyHasValue = false;
     bool m_presentFamilyHasValue = false;
+    bool m_transferFamilyHasValue = false;
 
     bool IsComplete()
     {
@@ -51,6 +59,28 @@ namespace Ark
     VkSurfaceKHR Surface() { return m_surface; }
     VkQueue GraphicsQueue() { return m_graphicsQueue; }
     VkQueue PresentQueue() { return m_presentQueue; }
+    // VK_NULL_HANDLE without a dedicated transfer queue family
+    VkQueue TransferQueue() { return m_transferQueue; }
+    ArkMemoryAllocator& Allocator() { return *m_allocator; }
+    ArkUploadManager& Uploader() { return *m_uploader; }
+    // Pass GetCache() to every pipeline creation, and report its duration with RecordCreation
+    ArkPipelineCache& PipelineCache() { return *m_pipelineCache; }
+    // VK_EXT_descriptor_indexing with non-uniform indexing into partially bound, update-after-bind sampled image
+    // arrays, which the bindless render path needs
+    bool SupportsDescriptorIndexing() const { return m_descriptorIndexing; }
+    // Size limit of an update-after-bind combined image sampler array, 0 without descriptor indexing
+    uint32_t MaxBindlessSampledImages() const { return m_maxBindlessSampledImages; }
+    // multiDrawIndirect and drawIndirectFirstInstance, both enabled when supported
+    bool SupportsMultiDrawIndirect() const { return m_multiDrawIndirect; }
+    // VK_KHR_draw_indirect_count, for draws whose count a shader wrote
+    bool SupportsDrawIndirectCount() const { return m_drawIndirectCount; }
+    void CmdDrawIndexedIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset,
+                                     VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount,
+                                     uint32_t stride)
+    {
+      m_cmdDrawIndexedIndirectCount(commandBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount,
+                                    stride);
+    }
 
     SwapChainSupportDetails GetSwapChainSupport()
     {
@@ -68,8 +98,10 @@ namespace Ark
                                  VkFormatFeatureFlags features);
 
     // Buffer Helper Functions
+    // Memory comes from the device's allocator, release it with Allocator().Free after destroying the resource
     void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
-                      VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+                      VkBuffer& buffer, ArkAllocation& bufferAllocation);
+    // Blocking one-off submissions. Prefer Uploader() for resource uploads, which batches them.
     VkCommandBuffer BeginSingleTimeCommands();
     void EndSingleTimeCommands(VkCommandBuffer commandBuffer);
     void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -77,7 +109,7 @@ namespace Ark
                            uint32_t layerCount);
 
     void CreateImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties,
-                             VkImage& image, VkDeviceMemory& imageMemory);
+                             VkImage& image, ArkAllocation& imageAllocation);
 
     VkPhysicalDeviceProperties properties;
     void TransitionImageLayout(
@@ -103,6 +135,8 @@ namespace Ark
     void PopulateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
     void HasGlfwRequiredInstanceExtensions();
     bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
+    bool CheckDeviceExtensionSupport(VkPhysicalDevice device, const std::vector<const char*>& extensions);
+    void QueryDescriptorIndexingSupport();
     SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device);
 
     VkInstance m_instance;
@@ -112,11 +146,25 @@ namespace Ark
     VkCommandPool m_commandPool;
 
     VkDevice m_device;
+    std::unique_ptr<ArkMemoryAllocator> m_allocator;
+    std::unique_ptr<ArkUploadManager> m_uploader;
+    std::unique_ptr<ArkPipelineCache> m_pipelineCache;
     VkSurfaceKHR m_surface;
     VkQueue m_graphicsQueue;
     VkQueue m_presentQueue;
+    VkQueue m_transferQueue = VK_NULL_HANDLE;
+    bool m_hasPhysicalDeviceProperties2 = false;
+    bool m_descriptorIndexing = false;
+    uint32_t m_maxBindlessSampledImages = 0;
+    bool m_multiDrawIndirect = false;
+    bool m_drawIndirectCount = false;
+    PFN_vkCmdDrawIndexedIndirectCountKHR m_cmdDrawIndexedIndirectCount = nullptr;
 
     const std::vector<const char*> validationLayers = {"VK_LAYER_KHRONOS_validation"};
     const std::vector<const char*> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    // Enabled on top of deviceExtensions when the device supports them
+    const std::vector<const char*> descriptorIndexingExtensions = {
+      VK_KHR_MAINTENANCE3_EXTENSION_NAME, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME
+    };
   };
 } // namespace lve
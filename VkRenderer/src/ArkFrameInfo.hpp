@@ -25,7 +25,7 @@ namespace Ark
     VkCommandBuffer commandBuffer;
     ArkCamera& camera;
     VkDescriptorSet globalDescriptorSet;
-    ArkDescriptorPool& frameDescriptorPool;  // pool of descriptors that is cleared each frame
-    ArkGameObject::Map& gameObjects;
+    ArkDescriptorCache& descriptorCache;  // per object sets that persist across frames
+    std::vector<ArkGameObject>& gameObjects;  // dense, owned by the ArkGameObjectManager
   };
 }
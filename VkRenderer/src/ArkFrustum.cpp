@@ -0,0 +1,54 @@
+#include "ArkFrustum.hpp"
+
+// std
+#include <cmath>
+
+namespace Ark
+{
+  ArkFrustum::ArkFrustum(const glm::mat4& viewProjection)
+  {
+    // Gribb/Hartmann: each plane is the last row of the matrix plus or minus one of the others. With 0..1 depth
+    // the near plane is the third row alone.
+    const auto row = [&viewProjection](int i)
+    {
+      return glm::vec4{viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]};
+    };
+    m_planes[LEFT] = row(3) + row(0);
+    m_planes[RIGHT] = row(3) - row(0);
+    m_planes[BOTTOM] = row(3) + row(1);
+    m_planes[TOP] = row(3) - row(1);
+    m_planes[NEAR_PLANE] = row(2);
+    m_planes[FAR_PLANE] = row(3) - row(2);
+
+    for (auto& plane : m_planes)
+    {
+      plane /= glm::length(glm::vec3(plane));
+    }
+  }
+
+  bool ArkFrustum::Intersects(const glm::vec3& min, const glm::vec3& max) const
+  {
+    const glm::vec3 center = (min + max) * 0.5f;
+    const glm::vec3 extent = (max - min) * 0.5f;
+    for (const auto& plane : m_planes)
+    {
+      const glm::vec3 normal{plane};
+      if (glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), extent) < 0.0f) return false;
+    }
+    return true;
+  }
+
+  bool ArkFrustum::Intersects(const glm::vec3& center, float radius) const
+  {
+    for (const auto& plane : m_planes)
+    {
+      if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) return false;
+    }
+    return true;
+  }
+
+  size_t ArkFrustum::Cull(const BoxBatch& boxes, std::vector<uint8_t>& visible) const
+  {
+    return boxes.Cull(m_planes, visible);
+  }
+}
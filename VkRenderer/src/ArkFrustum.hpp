@@ -0,0 +1,40 @@
+#pragma once
+
+//libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <Ark/BoxBatch.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace Ark
+{
+  // View frustum as six inward facing, normalized planes extracted from a Vulkan (0..1 depth) view-projection matrix
+  class ArkFrustum
+  {
+  public:
+    enum Plane { LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+
+    // The batch layout and its SSE test are shared with ArkRenderer's Frustum
+    using BoxBatch = Ark::BoxBatch;
+
+    explicit ArkFrustum(const glm::mat4& viewProjection);
+
+    // True if the world-space box is at least partially inside. Conservative near frustum corners.
+    bool Intersects(const glm::vec3& min, const glm::vec3& max) const;
+    bool Intersects(const glm::vec3& center, float radius) const;
+
+    // Tests every box in the batch against the six planes, see BoxBatch::Cull. Returns the number of visible boxes.
+    size_t Cull(const BoxBatch& boxes, std::vector<uint8_t>& visible) const;
+
+    const std::array<glm::vec4, PLANE_COUNT>& GetPlanes() const { return m_planes; }
+
+  private:
+    // xyz is the normal, w the distance. Points p with dot(xyz, p) + w >= 0 are on the inside.
+    std::array<glm::vec4, PLANE_COUNT> m_planes{};
+  };
+}
@@ -1,10 +1,14 @@
 #include "ArkGameObject.hpp"
+#include "ArkDescriptors.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 #include <numeric>
 
 namespace Ark
 {
-  glm::mat4 TransformComponent::Mat4()
+  glm::mat4 TransformComponent::Mat4() const
   {
     const float c3 = glm::cos(rotation.z);
     const float s3 = glm::sin(rotation.z);
@@ -20,7 +24,7 @@ namespace Ark
     };
   }
 
-  glm::mat3 TransformComponent::NormalMat()
+  glm::mat3 TransformComponent::NormalMat() const
   {
     const float c3 = glm::cos(rotation.z);
     const float s3 = glm::sin(rotation.z);
@@ -28,51 +32,206 @@ namespace Ark
     const float s2 = glm::sin(rotation.x);
     const float c1 = glm::cos(rotation.y);
     const float s1 = glm::sin(rotation.y);
+    // Inverse transpose of Mat4's upper 3x3, which is the rotation with each column divided by its scale
     const glm::vec3 invScale = 1.0f / scale;
     return glm::mat3{
-      {invScale.x * (c1 * c3 + s1 * s2 * s3), scale.x * (c2 * s3), scale.x * (c1 * s2 * s3 - c3 * s1)},
-      {invScale.y * (c3 * s1 * s2 - c1 * s3), scale.y * (c2 * c3), scale.y * (c1 * c3 * s2 + s1 * s3)},
-      {invScale.z * (c2 * s1), scale.z * (-s2), scale.z * (c1 * c2)}
+      {invScale.x * (c1 * c3 + s1 * s2 * s3), invScale.x * (c2 * s3), invScale.x * (c1 * s2 * s3 - c3 * s1)},
+      {invScale.y * (c3 * s1 * s2 - c1 * s3), invScale.y * (c2 * c3), invScale.y * (c1 * c3 * s2 + s1 * s3)},
+      {invScale.z * (c2 * s1), invScale.z * (-s2), invScale.z * (c1 * c2)}
     };
   }
 
 
-  ArkGameObjectManager::ArkGameObjectManager(ArkDevice& device) {
+  ArkGameObjectManager::ArkGameObjectManager(ArkDevice& device) : m_arkDevice{device} {
     // including nonCoherentAtomSize allows us to flush a specific index at once
-    int alignment = std::lcm(
+    m_bufferAlignment = std::lcm(
       device.properties.limits.nonCoherentAtomSize,
       device.properties.limits.minUniformBufferOffsetAlignment);
-    for (uint32_t i = 0; i < m_uboBuffers.size(); i++) {
-      m_uboBuffers[i] = std::make_unique<ArkBuffer>(
-        device,
-        sizeof(GameObjectBufferData),
-        ArkGameObjectManager::MAX_GAME_OBJECTS,
-        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-        alignment);
-      m_uboBuffers[i]->Map();
+    for (int i = 0; i < static_cast<int>(m_uboBuffers.size()); i++) {
+      GrowBuffer(i, INITIAL_BUFFER_CAPACITY);
     }
 
     m_textureDefault = Texture::CreateTextureFromFile(device, "textures/missing.png");
   }
 
+  ArkGameObject& ArkGameObjectManager::CreateGameObject(const TransformComponent& transform) {
+    uint32_t slotIndex;
+    if (!m_freeSlots.empty()) {
+      slotIndex = m_freeSlots.back();
+      m_freeSlots.pop_back();
+    }
+    else {
+      assert(m_slots.size() < MAX_GAME_OBJECTS && "Max game object count exceeded!");
+      slotIndex = static_cast<uint32_t>(m_slots.size());
+      m_slots.emplace_back();
+      m_pendingFrames.push_back(0);
+    }
+    auto& slot = m_slots[slotIndex];
+    slot.dense = static_cast<uint32_t>(m_objects.size());
+    const ArkGameObject::IdType id = slot.generation << ArkGameObject::INDEX_BITS | slotIndex;
+
+    m_objects.push_back(ArkGameObject{id, *this});
+    m_denseToSlot.push_back(slotIndex);
+    m_transforms.Add(transform);
+    auto& gameObject = m_objects.back();
+    gameObject.m_diffuseMap = m_textureDefault;
+    return gameObject;
+  }
+
+  void ArkGameObjectManager::DestroyGameObject(ArkGameObject::IdType id) {
+    if (!IsAlive(id)) return;
+    const uint32_t slotIndex = id & ArkGameObject::INDEX_MASK;
+    auto& slot = m_slots[slotIndex];
+    const uint32_t dense = slot.dense;
+    const auto last = static_cast<uint32_t>(m_objects.size() - 1);
+    if (dense != last) {
+      m_objects[dense] = std::move(m_objects[last]);
+      m_denseToSlot[dense] = m_denseToSlot[last];
+      m_slots[m_denseToSlot[dense]].dense = dense;
+    }
+    m_objects.pop_back();
+    m_denseToSlot.pop_back();
+    m_transforms.Remove(dense);
+
+    slot.dense = ArkGameObject::INVALID_ID;
+    // Wraps around after as many reuses of the slot as fit the generation bits
+    slot.generation = (slot.generation + 1) & (ArkGameObject::INVALID_ID >> ArkGameObject::INDEX_BITS);
+    m_freeSlots.push_back(slotIndex);
+  }
+
+  bool ArkGameObjectManager::IsAlive(ArkGameObject::IdType id) const {
+    return GetSlot(id) != nullptr;
+  }
+
+  ArkGameObject* ArkGameObjectManager::Find(ArkGameObject::IdType id) {
+    const Slot* slot = GetSlot(id);
+    return slot ? &m_objects[slot->dense] : nullptr;
+  }
+
+  void ArkGameObjectManager::Reserve(size_t count) {
+    m_objects.reserve(count);
+    m_denseToSlot.reserve(count);
+    m_transforms.Reserve(count);
+  }
+
+  const ArkGameObjectManager::Slot* ArkGameObjectManager::GetSlot(ArkGameObject::IdType id) const {
+    const uint32_t slotIndex = id & ArkGameObject::INDEX_MASK;
+    if (id == ArkGameObject::INVALID_ID || slotIndex >= m_slots.size()) return nullptr;
+    const Slot& slot = m_slots[slotIndex];
+    if (slot.dense == ArkGameObject::INVALID_ID || slot.generation != id >> ArkGameObject::INDEX_BITS) return nullptr;
+    return &slot;
+  }
+
+  size_t ArkGameObjectManager::UpdateTransforms() {
+    m_updatedIndices.clear();
+    const size_t count = m_transforms.UpdateMatrices(&m_updatedIndices);
+    for (const uint32_t dense : m_updatedIndices) {
+      const uint32_t slotIndex = m_denseToSlot[dense];
+      for (size_t frame = 0; frame < m_pendingSlots.size(); frame++) {
+        const auto bit = static_cast<uint8_t>(1u << frame);
+        if (!(m_pendingFrames[slotIndex] & bit)) {
+          m_pendingFrames[slotIndex] |= bit;
+          m_pendingSlots[frame].push_back(slotIndex);
+        }
+      }
+    }
+    return count;
+  }
+
   void ArkGameObjectManager::UpdateBuffer(int frameIndex) {
-    // copy model matrix and normal matrix for each gameObj into
-    // buffer for this frame
-    for (auto& kv : m_gameObjects) {
-      auto& obj = kv.second;
+    auto& buffer = m_uboBuffers[frameIndex];
+    if (buffer->GetInstanceCount() < m_slots.size()) {
+      GrowBuffer(frameIndex, std::max(static_cast<uint32_t>(m_slots.size()), 2 * buffer->GetInstanceCount()));
+    }
+    // copy model matrix and normal matrix of each gameObj changed since this
+    // buffer was last written
+    auto& pending = m_pendingSlots[frameIndex];
+    const auto bit = static_cast<uint8_t>(1u << frameIndex);
+    // Flushing the whole buffer is cheaper than many small ranges once a good part of it changed
+    const bool flushAll = pending.size() > buffer->GetInstanceCount() / 8;
+    for (const uint32_t slotIndex : pending) {
+      m_pendingFrames[slotIndex] &= ~bit;
+      const uint32_t dense = m_slots[slotIndex].dense;
+      if (dense == ArkGameObject::INVALID_ID) continue;
       GameObjectBufferData data{};
-      data.modelMatrix = obj.m_transform.Mat4();
-      data.normalMatrix = obj.m_transform.NormalMat();
-      m_uboBuffers[frameIndex]->WriteToIndex(&data, kv.first);
+      data.modelMatrix = m_transforms.GetModelMatrix(dense);
+      data.normalMatrix = m_transforms.GetNormalMatrix(dense);
+      buffer->WriteToIndex(&data, static_cast<int>(slotIndex));
+      if (!flushAll) {
+        buffer->FlushIndex(static_cast<int>(slotIndex));
+      }
+    }
+    if (flushAll) {
+      buffer->Flush();
     }
-    m_uboBuffers[frameIndex]->Flush();
+    pending.clear();
+  }
+
+  void ArkGameObjectManager::ReleaseRetiredBuffers(const ArkDescriptorCache& descriptorCache) {
+    m_frame++;
+    m_retiredBuffers.erase(
+      std::remove_if(m_retiredBuffers.begin(), m_retiredBuffers.end(), [&](const RetiredBuffer& retired) {
+        return m_frame - retired.retiredFrame >= ArkSwapChain::MAX_FRAMES_IN_FLIGHT &&
+          !descriptorCache.References(retired.buffer->GetBuffer());
+      }),
+      m_retiredBuffers.end());
+  }
+
+  void ArkGameObjectManager::GrowBuffer(int frameIndex, uint32_t capacity) {
+    auto grown = std::make_unique<ArkBuffer>(
+      m_arkDevice,
+      sizeof(GameObjectBufferData),
+      capacity,
+      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+      m_bufferAlignment);
+    grown->Map();
+    auto& buffer = m_uboBuffers[frameIndex];
+    if (buffer) {
+      // Clean objects are not written again, so carry their matrices over
+      std::memcpy(grown->GetMappedMemory(), buffer->GetMappedMemory(), buffer->GetBufferSize());
+      grown->Flush(buffer->GetBufferSize(), 0);
+      m_retiredBuffers.push_back({std::move(buffer), m_frame});
+    }
+    buffer = std::move(grown);
   }
 
   VkDescriptorBufferInfo ArkGameObject::GetBufferInfo(int frameIndex) {
-    return m_gameObjectManger.GetBufferInfoForGameObject(frameIndex, m_id);
+    return m_gameObjectManger->GetBufferInfoForGameObject(frameIndex, m_id);
+  }
+
+  TransformComponent ArkGameObject::GetTransform() const {
+    return m_gameObjectManger->m_transforms.Get(GetDenseIndex());
+  }
+
+  void ArkGameObject::SetTransform(const TransformComponent& transform) {
+    m_gameObjectManger->m_transforms.Set(GetDenseIndex(), transform);
+  }
+
+  void ArkGameObject::SetTranslation(const glm::vec3& translation) {
+    m_gameObjectManger->m_transforms.SetTranslation(GetDenseIndex(), translation);
+  }
+
+  void ArkGameObject::SetRotation(const glm::vec3& rotation) {
+    m_gameObjectManger->m_transforms.SetRotation(GetDenseIndex(), rotation);
+  }
+
+  void ArkGameObject::SetScale(const glm::vec3& scale) {
+    m_gameObjectManger->m_transforms.SetScale(GetDenseIndex(), scale);
+  }
+
+  const glm::mat4& ArkGameObject::GetModelMatrix() const {
+    return m_gameObjectManger->m_transforms.GetModelMatrix(GetDenseIndex());
+  }
+
+  const glm::mat4& ArkGameObject::GetNormalMatrix() const {
+    return m_gameObjectManger->m_transforms.GetNormalMatrix(GetDenseIndex());
+  }
+
+  uint32_t ArkGameObject::GetDenseIndex() const {
+    return m_gameObjectManger->m_slots[m_id & INDEX_MASK].dense;
   }
 
-  ArkGameObject::ArkGameObject(IdType objId, const ArkGameObjectManager& manager)
-    : m_id{ objId }, m_gameObjectManger{ manager } {}
+  ArkGameObject::ArkGameObject(IdType objId, ArkGameObjectManager& manager)
+    : m_id{ objId }, m_gameObjectManger{ &manager } {}
 }
@@ -1,15 +1,20 @@
 #pragma once
 #include "ArkModel.hpp"
+#include "ArkTransformStore.hpp"
 #include "Texture.hpp"
 
 // libs
 #include <glm/gtc/matrix_transform.hpp>
-#include <unordered_map>
+
+// std
+#include <array>
+#include <vector>
 
 #include "ArkSwapChain.hpp"
 
 namespace Ark
 {
+  class ArkDescriptorCache;
   class ArkGameObjectManager;
 
   struct TransformComponent
@@ -21,8 +26,8 @@ namespace Ark
     // Matrix corrsponds to Translate * Ry * Rx * Rz * Scale
     // Rotations correspond to Tait-bryan angles of Y(1), X(2), Z(3)
     // https://en.wikipedia.org/wiki/Euler_angles#Rotation_matrix
-    glm::mat4 Mat4();
-    glm::mat3 NormalMat();
+    glm::mat4 Mat4() const;
+    glm::mat3 NormalMat() const;
   };
 
   struct GameObjectBufferData {
@@ -33,33 +38,52 @@ namespace Ark
   class ArkGameObject
   {
   public:
-    using IdType = unsigned int;
-    using Map = std::unordered_map<IdType, ArkGameObject>;
+    // Slot index in the low INDEX_BITS, generation of the slot in the rest
+    using IdType = uint32_t;
+    static constexpr uint32_t INDEX_BITS = 20;
+    static constexpr IdType INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static constexpr IdType INVALID_ID = ~0u;
 
     ArkGameObject(ArkGameObject&&) = default;
+    ArkGameObject& operator=(ArkGameObject&&) = default;
     ArkGameObject(const ArkGameObject&) = delete;
     ArkGameObject& operator=(const ArkGameObject&) = delete;
-    ArkGameObject& operator=(ArkGameObject&&) = delete;
 
     IdType GetId() const { return m_id; }
 
     VkDescriptorBufferInfo GetBufferInfo(int frameIndex);
 
+    // The transform lives in the manager's ArkTransformStore, setting it marks the object dirty
+    TransformComponent GetTransform() const;
+    void SetTransform(const TransformComponent& transform);
+    void SetTranslation(const glm::vec3& translation);
+    void SetRotation(const glm::vec3& rotation);
+    void SetScale(const glm::vec3& scale);
+    // As of the last ArkGameObjectManager::UpdateTransforms
+    const glm::mat4& GetModelMatrix() const;
+    const glm::mat4& GetNormalMatrix() const;
+
     std::shared_ptr<ArkModel> m_model{};
     glm::vec3 m_color{};
-    TransformComponent m_transform{};
     std::shared_ptr<Texture> m_diffuseMap = VK_NULL_HANDLE;
   private:
-    ArkGameObject(const IdType objId, const ArkGameObjectManager& manager);
+    ArkGameObject(const IdType objId, ArkGameObjectManager& manager);
+    uint32_t GetDenseIndex() const;
     IdType m_id;
-    const ArkGameObjectManager& m_gameObjectManger;
+    ArkGameObjectManager* m_gameObjectManger;
     friend class ArkGameObjectManager;
   };
 
+  // Owns every game object. Objects are stored densely, in creation order until one is destroyed, and their
+  // transforms in an ArkTransformStore at the same index. Ids stay valid across creation and destruction of other
+  // objects, references do not: keep ids and look objects up again with Find.
   class ArkGameObjectManager
   {
   public:
-    static constexpr int MAX_GAME_OBJECTS = 1000;
+    // The last index is left out so no id equals ArkGameObject::INVALID_ID
+    static constexpr uint32_t MAX_GAME_OBJECTS = ArkGameObject::INDEX_MASK;
+    // Objects the per frame buffers start with, they double whenever the slots outgrow them
+    static constexpr uint32_t INITIAL_BUFFER_CAPACITY = 1024;
 
     ArkGameObjectManager(ArkDevice& device);
     ArkGameObjectManager(const ArkGameObjectManager&) = delete;
@@ -67,30 +91,68 @@ namespace Ark
     ArkGameObjectManager(ArkGameObjectManager&&) = delete;
     ArkGameObjectManager& operator=(ArkGameObjectManager&&) = delete;
 
-    ArkGameObject& CreateGameObject()
-    {
-      assert(m_currentId < MAX_GAME_OBJECTS && "Max game object count exceeded!");
-      auto gameObject = ArkGameObject{ m_currentId++, *this};
-      auto gameObjectId = gameObject.GetId();
-      gameObject.m_diffuseMap = m_textureDefault;
-      m_gameObjects.emplace(gameObjectId, std::move(gameObject));
-      return m_gameObjects.at(gameObjectId);
-    }
+    ArkGameObject& CreateGameObject(const TransformComponent& transform = {});
+    // The object's id becomes invalid, and its slot is reused with a new generation
+    void DestroyGameObject(ArkGameObject::IdType id);
+    bool IsAlive(ArkGameObject::IdType id) const;
+    // nullptr for ids of destroyed objects
+    ArkGameObject* Find(ArkGameObject::IdType id);
+    void Reserve(size_t count);
 
+    std::vector<ArkGameObject>& GetObjects() { return m_objects; }
+    size_t GetObjectCount() const { return m_objects.size(); }
+    ArkTransformStore& GetTransforms() { return m_transforms; }
 
-    VkDescriptorBufferInfo GetBufferInfoForGameObject(
-      int frameIndex, ArkGameObject::IdType gameObjectId) const
+    VkDescriptorBufferInfo GetBufferInfoForGameObject(int frameIndex, ArkGameObject::IdType gameObjectId) const
     {
-      return m_uboBuffers[frameIndex]->DescriptorInfoForIndex(gameObjectId);
+      return m_uboBuffers[frameIndex]->DescriptorInfoForIndex(gameObjectId & ArkGameObject::INDEX_MASK);
     }
 
+    // Recomputes the matrices of objects whose transform changed since the last call. Call once per frame before
+    // rendering. Returns the number of objects updated.
+    size_t UpdateTransforms();
+    // Writes the matrices updated since this frame's buffer was last written, growing the buffer if needed. Must
+    // only be called once the frame's previous commands have completed.
     void UpdateBuffer(int frameIndex);
-
-    ArkGameObject::Map m_gameObjects{};
-    std::vector<std::unique_ptr<ArkBuffer>> m_uboBuffers{ArkSwapChain::MAX_FRAMES_IN_FLIGHT};
+    // Destroys buffers replaced by a larger one once MAX_FRAMES_IN_FLIGHT frames have passed and no set cached by
+    // descriptorCache refers to them any more. Call once per frame.
+    void ReleaseRetiredBuffers(const ArkDescriptorCache& descriptorCache);
 
   private:
-    ArkGameObject::IdType m_currentId = 0;
+    struct Slot
+    {
+      // Index into m_objects, INVALID_ID while the slot is free
+      uint32_t dense{ArkGameObject::INVALID_ID};
+      uint32_t generation{0};
+    };
+
+    const Slot* GetSlot(ArkGameObject::IdType id) const;
+    void GrowBuffer(int frameIndex, uint32_t capacity);
+
+    ArkDevice& m_arkDevice;
+    VkDeviceSize m_bufferAlignment;
+    std::vector<ArkGameObject> m_objects{};
+    ArkTransformStore m_transforms{};
+    std::vector<uint32_t> m_denseToSlot{};
+    std::vector<Slot> m_slots{};
+    std::vector<uint32_t> m_freeSlots{};
+
+    // Slots whose matrices still have to be written to a frame's buffer, with one bit per frame in m_pendingFrames
+    std::array<std::vector<uint32_t>, ArkSwapChain::MAX_FRAMES_IN_FLIGHT> m_pendingSlots{};
+    std::vector<uint8_t> m_pendingFrames{};
+    std::vector<uint32_t> m_updatedIndices{};
+    // Indexed by slot
+    std::vector<std::unique_ptr<ArkBuffer>> m_uboBuffers{ArkSwapChain::MAX_FRAMES_IN_FLIGHT};
+    // Buffers replaced by a larger one, with the frame they were replaced on. Kept alive while cached descriptor sets
+    // may still refer to them.
+    struct RetiredBuffer
+    {
+      std::unique_ptr<ArkBuffer> buffer;
+      uint64_t retiredFrame;
+    };
+    std::vector<RetiredBuffer> m_retiredBuffers{};
+    uint64_t m_frame{0};
     std::shared_ptr<Texture> m_textureDefault;
+    friend class ArkGameObject;
   };
 }
@@ -0,0 +1,410 @@
+#include "ArkMemoryAllocator.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace Ark
+{
+  namespace
+  {
+    VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+      return (value + alignment - 1) / alignment * alignment;
+    }
+
+    VkDeviceSize AlignDown(VkDeviceSize value, VkDeviceSize alignment)
+    {
+      return value / alignment * alignment;
+    }
+  }
+
+  ArkMemoryBlockMetadata::ArkMemoryBlockMetadata(VkDeviceSize size) : m_size{size}
+  {
+    InsertFreeRange(0, size);
+  }
+
+  bool ArkMemoryBlockMetadata::Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+  {
+    // Ranges are visited smallest first, the first one still large enough after aligning its start is the best fit
+    for (auto candidate = m_freeBySize.lower_bound(size); candidate != m_freeBySize.end(); ++candidate)
+    {
+      const VkDeviceSize rangeOffset = candidate->second;
+      const VkDeviceSize rangeSize = candidate->first;
+      const VkDeviceSize alignedOffset = AlignUp(rangeOffset, alignment);
+      const VkDeviceSize padding = alignedOffset - rangeOffset;
+      if (padding + size > rangeSize)
+      {
+        continue;
+      }
+
+      EraseFreeRange(m_freeByOffset.find(rangeOffset));
+      if (padding > 0)
+      {
+        InsertFreeRange(rangeOffset, padding);
+      }
+      if (padding + size < rangeSize)
+      {
+        InsertFreeRange(alignedOffset + size, rangeSize - padding - size);
+      }
+      offset = alignedOffset;
+      m_used += size;
+      ++m_allocationCount;
+      return true;
+    }
+    return false;
+  }
+
+  void ArkMemoryBlockMetadata::Free(VkDeviceSize offset, VkDeviceSize size)
+  {
+    assert(m_allocationCount > 0 && "Freeing from an empty block");
+    m_used -= size;
+    --m_allocationCount;
+
+    auto next = m_freeByOffset.lower_bound(offset);
+    if (next != m_freeByOffset.begin())
+    {
+      auto previous = std::prev(next);
+      if (previous->first + previous->second == offset)
+      {
+        offset = previous->first;
+        size += previous->second;
+        EraseFreeRange(previous);
+      }
+    }
+    if (next != m_freeByOffset.end() && offset + size == next->first)
+    {
+      size += next->second;
+      EraseFreeRange(next);
+    }
+    InsertFreeRange(offset, size);
+  }
+
+  VkDeviceSize ArkMemoryBlockMetadata::GetLargestFreeRange() const
+  {
+    return m_freeBySize.empty() ? 0 : m_freeBySize.rbegin()->first;
+  }
+
+  void ArkMemoryBlockMetadata::InsertFreeRange(VkDeviceSize offset, VkDeviceSize size)
+  {
+    m_freeByOffset.emplace(offset, size);
+    m_freeBySize.emplace(size, offset);
+  }
+
+  void ArkMemoryBlockMetadata::EraseFreeRange(std::map<VkDeviceSize, VkDeviceSize>::iterator range)
+  {
+    auto [first, last] = m_freeBySize.equal_range(range->second);
+    for (; first != last; ++first)
+    {
+      if (first->second == range->first)
+      {
+        m_freeBySize.erase(first);
+        break;
+      }
+    }
+    m_freeByOffset.erase(range);
+  }
+
+  ArkMemoryAllocator::ArkMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device) : m_device{device}
+  {
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+    m_pools.resize(m_memoryProperties.memoryTypeCount * static_cast<uint32_t>(ResourceKind::COUNT));
+  }
+
+  ArkMemoryAllocator::~ArkMemoryAllocator()
+  {
+    for (auto& pool : m_pools)
+    {
+      for (auto& block : pool.blocks)
+      {
+        if (block)
+        {
+          assert(block->metadata.IsEmpty() && "Memory block still in use at allocator destruction");
+          FreeDeviceMemory(block->memory, block->mapped);
+        }
+      }
+    }
+    assert(m_dedicatedCount == 0 && "Dedicated allocation still in use at allocator destruction");
+  }
+
+  ArkAllocation ArkMemoryAllocator::Allocate(const VkMemoryRequirements& requirements,
+                                             VkMemoryPropertyFlags properties, ResourceKind kind)
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    ArkAllocation allocation{};
+    allocation.memoryType = FindMemoryType(requirements.memoryTypeBits, properties);
+    allocation.pool = allocation.memoryType * static_cast<uint32_t>(ResourceKind::COUNT) + static_cast<uint32_t>(kind);
+    allocation.size = requirements.size;
+
+    // Anything larger than half a block would mostly waste the rest of it
+    const VkDeviceSize blockSize = GetBlockSize(allocation.memoryType);
+    if (requirements.size > blockSize / 2)
+    {
+      void* mapped = nullptr;
+      allocation.memory = AllocateDeviceMemory(requirements.size, allocation.memoryType, mapped);
+      allocation.mapped = mapped;
+      allocation.block = DEDICATED;
+      ++m_dedicatedCount;
+      m_dedicatedBytes += requirements.size;
+      return allocation;
+    }
+
+    // Flush and invalidate widen ranges to whole atoms, so non-coherent sub-allocations must not share an atom
+    VkDeviceSize alignment = requirements.alignment;
+    const bool hostVisible =
+      m_memoryProperties.memoryTypes[allocation.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    if (hostVisible && !IsCoherent(allocation.memoryType))
+    {
+      alignment = std::max(alignment, m_nonCoherentAtomSize);
+      allocation.size = AlignUp(requirements.size, m_nonCoherentAtomSize);
+    }
+
+    auto& blocks = m_pools[allocation.pool].blocks;
+    allocation.block = DEDICATED;
+    for (uint32_t i = 0; i < blocks.size(); i++)
+    {
+      if (blocks[i] && blocks[i]->metadata.Allocate(allocation.size, alignment, allocation.offset))
+      {
+        allocation.block = i;
+        break;
+      }
+    }
+
+    if (allocation.block == DEDICATED)
+    {
+      void* mapped = nullptr;
+      const VkDeviceMemory memory = AllocateDeviceMemory(blockSize, allocation.memoryType, mapped);
+      auto block = std::make_unique<Block>(Block{memory, mapped, ArkMemoryBlockMetadata{blockSize}});
+      block->metadata.Allocate(allocation.size, alignment, allocation.offset);
+
+      // Reuse the slot of a released block so block indices of live allocations stay valid
+      auto slot = std::find(blocks.begin(), blocks.end(), nullptr);
+      allocation.block = static_cast<uint32_t>(slot - blocks.begin());
+      if (slot == blocks.end())
+      {
+        blocks.push_back(std::move(block));
+      }
+      else
+      {
+        *slot = std::move(block);
+      }
+    }
+
+    const auto& block = *blocks[allocation.block];
+    allocation.memory = block.memory;
+    if (block.mapped)
+    {
+      allocation.mapped = static_cast<char*>(block.mapped) + allocation.offset;
+    }
+    return allocation;
+  }
+
+  void ArkMemoryAllocator::Free(ArkAllocation& allocation)
+  {
+    if (!allocation.IsValid())
+    {
+      return;
+    }
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    if (allocation.block == DEDICATED)
+    {
+      FreeDeviceMemory(allocation.memory, allocation.mapped);
+      --m_dedicatedCount;
+      m_dedicatedBytes -= allocation.size;
+      allocation = ArkAllocation{};
+      return;
+    }
+
+    auto& blocks = m_pools[allocation.pool].blocks;
+    auto& block = blocks[allocation.block];
+    block->metadata.Free(allocation.offset, allocation.size);
+    if (block->metadata.IsEmpty())
+    {
+      const auto liveBlocks = std::count_if(blocks.begin(), blocks.end(), [](const auto& b) { return b != nullptr; });
+      if (liveBlocks > 1)
+      {
+        FreeDeviceMemory(block->memory, block->mapped);
+        block.reset();
+      }
+    }
+    allocation = ArkAllocation{};
+  }
+
+  VkResult ArkMemoryAllocator::Flush(const ArkAllocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+  {
+    if (IsCoherent(allocation.memoryType))
+    {
+      return VK_SUCCESS;
+    }
+    std::lock_guard<std::mutex> lock{m_mutex};
+    const VkMappedMemoryRange range = GetMappedRange(allocation, offset, size);
+    return vkFlushMappedMemoryRanges(m_device, 1, &range);
+  }
+
+  VkResult ArkMemoryAllocator::Invalidate(const ArkAllocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+  {
+    if (IsCoherent(allocation.memoryType))
+    {
+      return VK_SUCCESS;
+    }
+    std::lock_guard<std::mutex> lock{m_mutex};
+    const VkMappedMemoryRange range = GetMappedRange(allocation, offset, size);
+    return vkInvalidateMappedMemoryRanges(m_device, 1, &range);
+  }
+
+  uint32_t ArkMemoryAllocator::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+  {
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++)
+    {
+      if ((typeFilter & (1 << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+      {
+        return i;
+      }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+  }
+
+  ArkMemoryAllocator::Stats ArkMemoryAllocator::GetStats() const
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    Stats stats{};
+    stats.dedicatedCount = m_dedicatedCount;
+    stats.allocationCount = m_dedicatedCount;
+    stats.bytesReserved = m_dedicatedBytes;
+    stats.bytesUsed = m_dedicatedBytes;
+    VkDeviceSize bytesFree = 0;
+    VkDeviceSize bytesFragmented = 0;
+    for (const auto& pool : m_pools)
+    {
+      for (const auto& block : pool.blocks)
+      {
+        if (!block)
+        {
+          continue;
+        }
+        const auto& metadata = block->metadata;
+        ++stats.blockCount;
+        stats.allocationCount += metadata.GetAllocationCount();
+        stats.bytesReserved += metadata.GetSize();
+        stats.bytesUsed += metadata.GetUsed();
+        stats.freeRangeCount += metadata.GetFreeRangeCount();
+        stats.largestFreeRange = std::max(stats.largestFreeRange, metadata.GetLargestFreeRange());
+        bytesFree += metadata.GetSize() - metadata.GetUsed();
+        bytesFragmented += metadata.GetSize() - metadata.GetUsed() - metadata.GetLargestFreeRange();
+      }
+    }
+    stats.deviceMemoryCount = stats.blockCount + stats.dedicatedCount;
+    if (bytesFree > 0)
+    {
+      stats.fragmentation = static_cast<float>(bytesFragmented) / static_cast<float>(bytesFree);
+    }
+    return stats;
+  }
+
+  void ArkMemoryAllocator::PrintReport(std::ostream& out) const
+  {
+    const Stats stats = GetStats();
+    out << "Device memory: " << stats.allocationCount << " allocations in " << stats.deviceMemoryCount
+      << " vkAllocateMemory calls (" << stats.blockCount << " blocks, " << stats.dedicatedCount << " dedicated), "
+      << stats.bytesUsed / 1024 << " / " << stats.bytesReserved / 1024 << " KiB used, fragmentation "
+      << stats.fragmentation << "\n";
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+    for (uint32_t p = 0; p < m_pools.size(); p++)
+    {
+      const uint32_t memoryType = p / static_cast<uint32_t>(ResourceKind::COUNT);
+      const bool linear = p % static_cast<uint32_t>(ResourceKind::COUNT) == static_cast<uint32_t>(ResourceKind::LINEAR);
+      for (uint32_t b = 0; b < m_pools[p].blocks.size(); b++)
+      {
+        const auto& block = m_pools[p].blocks[b];
+        if (!block)
+        {
+          continue;
+        }
+        const auto& metadata = block->metadata;
+        const VkDeviceSize bytesFree = metadata.GetSize() - metadata.GetUsed();
+        const float fragmentation = bytesFree > 0
+                                      ? 1.0f - static_cast<float>(metadata.GetLargestFreeRange()) / bytesFree
+                                      : 0.0f;
+        out << "  type " << memoryType << (linear ? " linear" : " optimal") << " block " << b << ": "
+          << metadata.GetAllocationCount() << " allocations, " << metadata.GetUsed() / 1024 << " / "
+          << metadata.GetSize() / 1024 << " KiB used, " << metadata.GetFreeRangeCount()
+          << " free ranges, largest " << metadata.GetLargestFreeRange() / 1024 << " KiB, fragmentation "
+          << fragmentation << (block->mapped ? ", mapped" : "") << "\n";
+      }
+    }
+  }
+
+  VkDeviceSize ArkMemoryAllocator::GetBlockSize(uint32_t memoryType) const
+  {
+    const uint32_t heap = m_memoryProperties.memoryTypes[memoryType].heapIndex;
+    const VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[heap].size;
+    return heapSize <= SMALL_HEAP_SIZE ? AlignUp(heapSize / 8, 32) : DEFAULT_BLOCK_SIZE;
+  }
+
+  VkDeviceMemory ArkMemoryAllocator::AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void*& mapped)
+  {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to allocate device memory!");
+    }
+
+    mapped = nullptr;
+    if (m_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+      if (vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+      {
+        vkFreeMemory(m_device, memory, nullptr);
+        throw std::runtime_error("failed to map device memory!");
+      }
+    }
+    return memory;
+  }
+
+  void ArkMemoryAllocator::FreeDeviceMemory(VkDeviceMemory memory, void* mapped)
+  {
+    if (mapped)
+    {
+      vkUnmapMemory(m_device, memory);
+    }
+    vkFreeMemory(m_device, memory, nullptr);
+  }
+
+  VkMappedMemoryRange ArkMemoryAllocator::GetMappedRange(const ArkAllocation& allocation, VkDeviceSize offset,
+                                                         VkDeviceSize size) const
+  {
+    // Ranges of non-coherent memory have to start and end on nonCoherentAtomSize boundaries or at the memory's end
+    const VkDeviceSize memorySize = allocation.block == DEDICATED
+                                      ? allocation.size
+                                      : m_pools[allocation.pool].blocks[allocation.block]->metadata.GetSize();
+    const VkDeviceSize begin = allocation.offset + offset;
+    const VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : begin + size;
+
+    VkMappedMemoryRange mappedRange = {};
+    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    mappedRange.memory = allocation.memory;
+    mappedRange.offset = AlignDown(begin, m_nonCoherentAtomSize);
+    const VkDeviceSize alignedEnd = AlignUp(end, m_nonCoherentAtomSize);
+    mappedRange.size = alignedEnd >= memorySize ? VK_WHOLE_SIZE : alignedEnd - mappedRange.offset;
+    return mappedRange;
+  }
+
+  bool ArkMemoryAllocator::IsCoherent(uint32_t memoryType) const
+  {
+    return m_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  }
+}
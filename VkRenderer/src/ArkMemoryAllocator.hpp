@@ -0,0 +1,147 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace Ark
+{
+  // Range of device memory handed out by ArkMemoryAllocator. Resources are bound to memory at offset.
+  struct ArkAllocation
+  {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    // Start of the range in the persistently mapped block for host visible memory, nullptr otherwise
+    void* mapped = nullptr;
+    uint32_t memoryType = 0;
+    uint32_t pool = 0;
+    // Index of the block within its pool, or ArkMemoryAllocator::DEDICATED
+    uint32_t block = 0;
+
+    bool IsValid() const { return memory != VK_NULL_HANDLE; }
+  };
+
+  // Free space bookkeeping for one memory block. Free ranges are indexed by size for best fit allocation and by
+  // offset so a freed range merges with free neighbours on both sides.
+  class ArkMemoryBlockMetadata
+  {
+  public:
+    explicit ArkMemoryBlockMetadata(VkDeviceSize size);
+
+    // Finds the smallest free range that holds size bytes at alignment. Returns false if none does.
+    bool Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+    // Returns a range obtained from Allocate
+    void Free(VkDeviceSize offset, VkDeviceSize size);
+
+    VkDeviceSize GetSize() const { return m_size; }
+    VkDeviceSize GetUsed() const { return m_used; }
+    uint32_t GetAllocationCount() const { return m_allocationCount; }
+    size_t GetFreeRangeCount() const { return m_freeByOffset.size(); }
+    VkDeviceSize GetLargestFreeRange() const;
+    bool IsEmpty() const { return m_allocationCount == 0; }
+
+  private:
+    void InsertFreeRange(VkDeviceSize offset, VkDeviceSize size);
+    void EraseFreeRange(std::map<VkDeviceSize, VkDeviceSize>::iterator range);
+
+    VkDeviceSize m_size;
+    VkDeviceSize m_used{0};
+    uint32_t m_allocationCount{0};
+    // offset -> size
+    std::map<VkDeviceSize, VkDeviceSize> m_freeByOffset{};
+    // size -> offset
+    std::multimap<VkDeviceSize, VkDeviceSize> m_freeBySize{};
+  };
+
+  // Sub-allocates buffers and images from large VkDeviceMemory blocks instead of one vkAllocateMemory call per
+  // resource. Blocks are pooled per memory type and per resource kind: linear and optimal resources never share a
+  // block, which keeps them bufferImageGranularity apart. Host visible blocks stay mapped for their whole lifetime.
+  class ArkMemoryAllocator
+  {
+  public:
+    // Linear: buffers and linear tiling images. Optimal: optimal tiling images.
+    enum class ResourceKind : uint32_t { LINEAR, OPTIMAL, COUNT };
+
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+    // Heaps up to this size use an eighth of the heap per block instead
+    static constexpr VkDeviceSize SMALL_HEAP_SIZE = 1024ull * 1024 * 1024;
+    static constexpr uint32_t DEDICATED = UINT32_MAX;
+
+    struct Stats
+    {
+      uint32_t blockCount{0};
+      uint32_t dedicatedCount{0};
+      uint32_t allocationCount{0};
+      uint32_t deviceMemoryCount{0};
+      // Bytes allocated from the driver and the part of it handed out to resources
+      VkDeviceSize bytesReserved{0};
+      VkDeviceSize bytesUsed{0};
+      size_t freeRangeCount{0};
+      VkDeviceSize largestFreeRange{0};
+      // Share of free bytes outside the largest free range of their block. 0 means every block's free space is
+      // contiguous.
+      float fragmentation{0.0f};
+    };
+
+    ArkMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device);
+    ~ArkMemoryAllocator();
+
+    ArkMemoryAllocator(const ArkMemoryAllocator&) = delete;
+    ArkMemoryAllocator& operator=(const ArkMemoryAllocator&) = delete;
+
+    ArkAllocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+                           ResourceKind kind);
+    // Returns the range to its block and resets allocation. Blocks that become empty are released, except the
+    // last one of a pool.
+    void Free(ArkAllocation& allocation);
+
+    // Flush or invalidate [offset, offset + size) of the allocation, widened to nonCoherentAtomSize. No-ops for
+    // coherent memory.
+    VkResult Flush(const ArkAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+    VkResult Invalidate(const ArkAllocation& allocation, VkDeviceSize offset = 0,
+                        VkDeviceSize size = VK_WHOLE_SIZE);
+
+    uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+    Stats GetStats() const;
+    // Per pool block usage and free range layout
+    void PrintReport(std::ostream& out) const;
+
+  private:
+    struct Block
+    {
+      VkDeviceMemory memory;
+      void* mapped;
+      ArkMemoryBlockMetadata metadata;
+    };
+
+    struct Pool
+    {
+      std::vector<std::unique_ptr<Block>> blocks{};
+    };
+
+    VkDeviceSize GetBlockSize(uint32_t memoryType) const;
+    VkDeviceMemory AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void*& mapped);
+    void FreeDeviceMemory(VkDeviceMemory memory, void* mapped);
+    VkMappedMemoryRange GetMappedRange(const ArkAllocation& allocation, VkDeviceSize offset,
+                                       VkDeviceSize size) const;
+    bool IsCoherent(uint32_t memoryType) const;
+
+    VkDevice m_device;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+    VkDeviceSize m_nonCoherentAtomSize{1};
+    // One pool per memory type and resource kind, indexed memoryType * ResourceKind::COUNT + kind
+    std::vector<Pool> m_pools{};
+    uint32_t m_dedicatedCount{0};
+    VkDeviceSize m_dedicatedBytes{0};
+    mutable std::mutex m_mutex;
+  };
+}
@@ -0,0 +1,91 @@
+#include "ArkMeshBuffer.hpp"
+#include "ArkUploadManager.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace Ark
+{
+  ArkMeshBuffer::ArkMeshBuffer(ArkDevice& device, ArkModel::VertexLayout layout, uint32_t vertexCapacity,
+                               uint32_t indexCapacity)
+    : m_arkDevice{device}, m_layout{layout}, m_vertexCapacity{vertexCapacity}, m_indexCapacity{indexCapacity}
+  {
+    std::vector<uint32_t> strides;
+    switch (layout)
+    {
+    case ArkModel::VertexLayout::Interleaved:
+      strides = {sizeof(ArkModel::Vertex)};
+      break;
+    case ArkModel::VertexLayout::SplitPosition:
+      strides = {sizeof(glm::vec3), sizeof(ArkModel::VertexAttributes)};
+      break;
+    case ArkModel::VertexLayout::Packed:
+      strides = {sizeof(ArkModel::PackedPosition), sizeof(ArkModel::PackedVertexAttributes)};
+      break;
+    }
+    for (const uint32_t stride : strides)
+    {
+      m_vertexStreams.push_back(std::make_unique<ArkBuffer>(
+        m_arkDevice,
+        stride,
+        vertexCapacity,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+    }
+    m_indexBuffer = std::make_unique<ArkBuffer>(
+      m_arkDevice,
+      sizeof(uint32_t),
+      indexCapacity,
+      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  }
+
+  ArkMeshBuffer::Range ArkMeshBuffer::Allocate(uint32_t vertexCount, uint32_t indexCount)
+  {
+    if (vertexCount > m_vertexCapacity - m_vertexCount || indexCount > m_indexCapacity - m_indexCount)
+    {
+      throw std::runtime_error("mesh buffer is full!");
+    }
+    const Range range{m_vertexCount, m_indexCount};
+    m_vertexCount += vertexCount;
+    m_indexCount += indexCount;
+    return range;
+  }
+
+  void ArkMeshBuffer::UploadVertices(uint32_t stream, uint32_t firstVertex, const void* data, uint32_t vertexCount)
+  {
+    assert(stream < m_vertexStreams.size() && "Mesh buffer has no such vertex stream");
+    assert(firstVertex + vertexCount <= m_vertexCount && "Vertices outside of an allocated range");
+    auto& buffer = *m_vertexStreams[stream];
+    m_arkDevice.Uploader().UploadBuffer(buffer.GetBuffer(), data, buffer.GetInstanceSize() * vertexCount,
+                                        buffer.GetAlignmentSize() * firstVertex);
+  }
+
+  void ArkMeshBuffer::UploadIndices(uint32_t firstIndex, const uint32_t* data, uint32_t indexCount)
+  {
+    assert(firstIndex + indexCount <= m_indexCount && "Indices outside of an allocated range");
+    m_arkDevice.Uploader().UploadBuffer(m_indexBuffer->GetBuffer(), data, sizeof(uint32_t) * indexCount,
+                                        sizeof(uint32_t) * firstIndex);
+  }
+
+  void ArkMeshBuffer::Bind(VkCommandBuffer commandBuffer)
+  {
+    VkBuffer buffers[2]{};
+    VkDeviceSize offsets[2]{};
+    for (size_t i = 0; i < m_vertexStreams.size(); i++)
+    {
+      buffers[i] = m_vertexStreams[i]->GetBuffer();
+    }
+    vkCmdBindVertexBuffers(commandBuffer, 0, static_cast<uint32_t>(m_vertexStreams.size()), buffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+  }
+
+  void ArkMeshBuffer::BindPositions(VkCommandBuffer commandBuffer)
+  {
+    VkBuffer buffers[] = {m_vertexStreams[0]->GetBuffer()};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+  }
+}
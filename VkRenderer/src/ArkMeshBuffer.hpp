@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ArkDevice.hpp"
+#include "ArkBuffer.hpp"
+#include "ArkModel.hpp"
+
+// std
+#include <memory>
+#include <vector>
+
+namespace Ark
+{
+  // Shared vertex and index buffers that models of one vertex layout are packed into, so draws of different models
+  // only differ in their index range and vertex offset. That is what lets a single indirect call draw all of them.
+  // Space is handed out linearly and is not reclaimed before the buffer is destroyed.
+  class ArkMeshBuffer
+  {
+  public:
+    struct Range
+    {
+      uint32_t firstVertex;
+      uint32_t firstIndex;
+    };
+
+    ArkMeshBuffer(ArkDevice& device, ArkModel::VertexLayout layout, uint32_t vertexCapacity,
+                  uint32_t indexCapacity);
+
+    ArkMeshBuffer(const ArkMeshBuffer&) = delete;
+    ArkMeshBuffer& operator=(const ArkMeshBuffer&) = delete;
+
+    Range Allocate(uint32_t vertexCount, uint32_t indexCount);
+    // Queue copies through the device's upload manager. Stream 0 holds positions, or whole vertices when
+    // interleaved, stream 1 the other attributes.
+    void UploadVertices(uint32_t stream, uint32_t firstVertex, const void* data, uint32_t vertexCount);
+    void UploadIndices(uint32_t firstIndex, const uint32_t* data, uint32_t indexCount);
+
+    // Binds every vertex stream and the index buffer
+    void Bind(VkCommandBuffer commandBuffer);
+    // Binds only the position stream and the index buffer
+    void BindPositions(VkCommandBuffer commandBuffer);
+
+    ArkModel::VertexLayout GetLayout() const { return m_layout; }
+    uint32_t GetVertexCount() const { return m_vertexCount; }
+    uint32_t GetIndexCount() const { return m_indexCount; }
+    uint32_t GetVertexCapacity() const { return m_vertexCapacity; }
+    uint32_t GetIndexCapacity() const { return m_indexCapacity; }
+
+  private:
+    ArkDevice& m_arkDevice;
+    ArkModel::VertexLayout m_layout;
+    uint32_t m_vertexCapacity;
+    uint32_t m_indexCapacity;
+    uint32_t m_vertexCount{0};
+    uint32_t m_indexCount{0};
+    std::vector<std::unique_ptr<ArkBuffer>> m_vertexStreams{};
+    std::unique_ptr<ArkBuffer> m_indexBuffer{};
+  };
+}
@@ -1,70 +1,194 @@
 #include "ArkModel.hpp"
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
+#include "ArkMeshBuffer.hpp"
+#include "ArkUploadManager.hpp"
 #include <cassert>
+#include <chrono>
 #include <iostream>
-#include <unordered_map>
+#include <limits>
 
-#include "ArkUtils.hpp"
+#include "Utils/ObjParser.hpp"
 
-namespace std
+#include <Ark/MeshOptimizer.hpp>
+#include <Ark/VertexPacking.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
 {
-  template <>
-  struct hash<Ark::ArkModel::Vertex>
+  size_t HashIndex(const Ark::ObjParser::Index& index)
   {
-    size_t operator()(Ark::ArkModel::Vertex const& vertex) const
-    {
-      size_t seed = 0;
-      Ark::HashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-      return seed;
-    }
-  };
+    // Multiplicative mix of the three attribute indices, spread over the high bits and folded back down
+    uint64_t hash = static_cast<uint32_t>(index.v) * 0x9E3779B97F4A7C15ull;
+    hash ^= static_cast<uint32_t>(index.vt) * 0xC2B2AE3D27D4EB4Full;
+    hash ^= static_cast<uint32_t>(index.vn) * 0x165667B19E3779F9ull;
+    return static_cast<size_t>(hash ^ (hash >> 32));
+  }
 }
 
 namespace Ark
 {
-  ArkModel::ArkModel(ArkDevice& device, const ArkModel::Builder& builder) : m_arkDevice(device)
+  ArkModel::ArkModel(ArkDevice& device, const ArkModel::Builder& builder, ArkMeshBuffer* meshBuffer)
+    : m_arkDevice(device), m_layout(builder.layout), m_meshBuffer(meshBuffer)
   {
+    if (!builder.vertices.empty())
+    {
+      m_boundsMin = m_boundsMax = builder.vertices[0].position;
+      for (const auto& vertex : builder.vertices)
+      {
+        m_boundsMin = glm::min(m_boundsMin, vertex.position);
+        m_boundsMax = glm::max(m_boundsMax, vertex.position);
+      }
+    }
+    if (m_meshBuffer)
+    {
+      assert(m_meshBuffer->GetLayout() == m_layout && "Model layout differs from the mesh buffer layout");
+      assert(!builder.indices.empty() && "Models in a mesh buffer have to be indexed");
+      const auto range = m_meshBuffer->Allocate(static_cast<uint32_t>(builder.vertices.size()),
+                                                static_cast<uint32_t>(builder.indices.size()));
+      m_firstIndex = range.firstIndex;
+      m_vertexOffset = static_cast<int32_t>(range.firstVertex);
+    }
     CreateVertexBuffers(builder.vertices);
     CreateIndexBuffers(builder.indices);
   }
 
   ArkModel::~ArkModel() = default;
 
-  std::unique_ptr<ArkModel> ArkModel::CreateModelFromFile(ArkDevice& device, const std::string& filePath)
+  std::unique_ptr<ArkModel> ArkModel::CreateModelFromFile(ArkDevice& device, const std::string& filePath,
+                                                         VertexLayout layout)
   {
     Builder builder{};
+    builder.layout = layout;
+    const auto start = std::chrono::high_resolution_clock::now();
     builder.LoadModel(filePath);
+    const std::chrono::duration<double, std::milli> loadTime = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Loaded " << filePath << " in " << loadTime.count() << " ms\n";
     std::cout << "Vertex count: " << builder.vertices.size() << "\n";
     return std::make_unique<ArkModel>(device, builder);
   }
 
-  void ArkModel::CreateVertexBuffers(const std::vector<Vertex>& vertices)
+  std::unique_ptr<ArkModel> ArkModel::CreateModelFromFile(ArkDevice& device, const std::string& filePath,
+                                                         ArkMeshBuffer& meshBuffer)
   {
-    m_vertexCount = static_cast<uint32_t>(vertices.size());
-    assert(m_vertexCount >= 3 && "Vertex count must be at least 3");
-    const VkDeviceSize bufferSize = sizeof(vertices[0]) * m_vertexCount;
-    uint32_t vertexSize = sizeof(vertices[0]);
-    ArkBuffer stagingBuffer{
-      m_arkDevice,
-      vertexSize,
-      m_vertexCount,
-      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-    };
-    stagingBuffer.Map();
-    stagingBuffer.WriteToBuffer((void*)vertices.data());
-
-    m_vertexBuffer = std::make_unique<ArkBuffer>(
+    Builder builder{};
+    builder.layout = meshBuffer.GetLayout();
+    builder.LoadModel(filePath);
+    std::cout << "Loaded " << filePath << " into the mesh buffer, vertex count: " << builder.vertices.size() << "\n";
+    return std::make_unique<ArkModel>(device, builder, &meshBuffer);
+  }
+
+  std::unique_ptr<ArkBuffer> ArkModel::CreateDeviceLocalBuffer(const void* data, uint32_t elementSize,
+                                                               uint32_t elementCount, VkBufferUsageFlags usage)
+  {
+    const VkDeviceSize bufferSize = static_cast<VkDeviceSize>(elementSize) * elementCount;
+    auto buffer = std::make_unique<ArkBuffer>(
       m_arkDevice,
-      vertexSize,
-      m_vertexCount,
-      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      elementSize,
+      elementCount,
+      usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
     );
-    m_arkDevice.CopyBuffer(stagingBuffer.GetBuffer(), m_vertexBuffer->GetBuffer(), bufferSize);
+    // Submitted with the next flush of the upload queue, together with the other buffers of this model
+    m_arkDevice.Uploader().UploadBuffer(buffer->GetBuffer(), data, bufferSize);
+    return buffer;
+  }
+
+  void ArkModel::CreateVertexBuffers(const std::vector<Vertex>& vertices)
+  {
+    m_vertexCount = static_cast<uint32_t>(vertices.size());
+    assert(m_vertexCount >= 3 && "Vertex count must be at least 3");
+
+    if (m_layout == VertexLayout::Interleaved)
+    {
+      CreateVertexStream(0, vertices.data(), sizeof(Vertex));
+      std::cout << "Interleaved layout: " << sizeof(Vertex) << " bytes per vertex for every pipeline\n";
+      return;
+    }
+    if (m_layout == VertexLayout::Packed)
+    {
+      CreatePackedVertexBuffers(vertices);
+      return;
+    }
+
+    std::vector<glm::vec3> positions;
+    std::vector<VertexAttributes> attributes;
+    positions.reserve(vertices.size());
+    attributes.reserve(vertices.size());
+    for (const auto& vertex : vertices)
+    {
+      positions.push_back(vertex.position);
+      attributes.push_back({vertex.color, vertex.normal, vertex.uv});
+    }
+
+    CreateVertexStream(0, positions.data(), sizeof(glm::vec3));
+    CreateVertexStream(1, attributes.data(), sizeof(VertexAttributes));
+    std::cout << "Split layout: " << sizeof(glm::vec3) << " bytes per vertex for depth-only pipelines, "
+      << sizeof(glm::vec3) + sizeof(VertexAttributes) << " for full pipelines\n";
+  }
+
+  void ArkModel::CreatePackedVertexBuffers(const std::vector<Vertex>& vertices)
+  {
+    glm::vec3 positionMin{std::numeric_limits<float>::max()}, positionMax{std::numeric_limits<float>::lowest()};
+    glm::vec2 uvMin{std::numeric_limits<float>::max()}, uvMax{std::numeric_limits<float>::lowest()};
+    for (const auto& vertex : vertices)
+    {
+      positionMin = glm::min(positionMin, vertex.position);
+      positionMax = glm::max(positionMax, vertex.position);
+      uvMin = glm::min(uvMin, vertex.uv);
+      uvMax = glm::max(uvMax, vertex.uv);
+    }
+
+    const VertexPacking::QuantizationRange<glm::vec3> positionRange{positionMin, positionMax};
+    const VertexPacking::QuantizationRange<glm::vec2> uvRange{uvMin, uvMax};
+    m_dequantize = glm::scale(glm::translate(glm::mat4{1.0f}, positionRange.offset), positionRange.extent);
+    m_uvTransform = glm::vec4{uvRange.offset, uvRange.extent};
+
+    std::vector<PackedPosition> positions;
+    std::vector<PackedVertexAttributes> attributes;
+    positions.reserve(vertices.size());
+    attributes.reserve(vertices.size());
+    for (const auto& vertex : vertices)
+    {
+      const glm::vec3 position = positionRange.Normalize(vertex.position);
+      const glm::vec2 uv = uvRange.Normalize(vertex.uv);
+      const glm::i16vec2 normal = VertexPacking::OctEncode(vertex.normal);
+      positions.push_back({
+        {
+          VertexPacking::QuantizeUnorm16(position.x),
+          VertexPacking::QuantizeUnorm16(position.y),
+          VertexPacking::QuantizeUnorm16(position.z),
+          0
+        }
+      });
+      attributes.push_back({
+        {
+          VertexPacking::QuantizeUnorm8(vertex.color.r),
+          VertexPacking::QuantizeUnorm8(vertex.color.g),
+          VertexPacking::QuantizeUnorm8(vertex.color.b),
+          255
+        },
+        {normal.x, normal.y},
+        {VertexPacking::QuantizeUnorm16(uv.x), VertexPacking::QuantizeUnorm16(uv.y)}
+      });
+    }
+
+    CreateVertexStream(0, positions.data(), sizeof(PackedPosition));
+    CreateVertexStream(1, attributes.data(), sizeof(PackedVertexAttributes));
+    constexpr size_t packedSize = sizeof(PackedPosition) + sizeof(PackedVertexAttributes);
+    std::cout << "Packed layout: " << sizeof(PackedPosition) << " bytes per vertex for depth-only pipelines, "
+      << packedSize << " for full pipelines (" << static_cast<float>(sizeof(Vertex)) / packedSize
+      << "x smaller than interleaved)\n";
+  }
+
+  void ArkModel::CreateVertexStream(uint32_t stream, const void* data, uint32_t elementSize)
+  {
+    if (m_meshBuffer)
+    {
+      m_meshBuffer->UploadVertices(stream, static_cast<uint32_t>(m_vertexOffset), data, m_vertexCount);
+      return;
+    }
+    auto buffer = CreateDeviceLocalBuffer(data, elementSize, m_vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    (stream == 0 ? m_vertexBuffer : m_attributeBuffer) = std::move(buffer);
   }
 
   void ArkModel::CreateIndexBuffers(const std::vector<uint32_t>& indices)
@@ -72,29 +196,44 @@ namespace Ark
     m_indexCount = static_cast<uint32_t>(indices.size());
     m_hasIndexBuffer = m_indexCount > 0;
     if (!m_hasIndexBuffer) return;
-    VkDeviceSize bufferSize = sizeof(indices[0]) * m_indexCount;
-    uint32_t indexSize = sizeof(indices[0]);
-    ArkBuffer stagingBuffer{
-      m_arkDevice,
-      indexSize,
-      m_indexCount,
-      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-    };
-    stagingBuffer.Map();
-    stagingBuffer.WriteToBuffer((void*)indices.data());
-    m_indexBuffer = std::make_unique<ArkBuffer>(
-      m_arkDevice,
-      indexSize,
-      m_indexCount,
-      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-    );
-    m_arkDevice.CopyBuffer(stagingBuffer.GetBuffer(), m_indexBuffer->GetBuffer(), bufferSize);
+    if (m_meshBuffer)
+    {
+      m_meshBuffer->UploadIndices(m_firstIndex, indices.data(), m_indexCount);
+      return;
+    }
+    m_indexBuffer = CreateDeviceLocalBuffer(indices.data(), sizeof(indices[0]), m_indexCount,
+                                            VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
   }
 
   void ArkModel::Bind(VkCommandBuffer commandBuffer)
   {
+    if (m_meshBuffer)
+    {
+      m_meshBuffer->Bind(commandBuffer);
+      return;
+    }
+    if (m_layout == VertexLayout::Interleaved)
+    {
+      BindPositions(commandBuffer);
+      return;
+    }
+
+    VkBuffer buffers[] = {m_vertexBuffer->GetBuffer(), m_attributeBuffer->GetBuffer()};
+    VkDeviceSize offsets[] = {0, 0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 2, buffers, offsets);
+    if (m_hasIndexBuffer)
+    {
+      vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    }
+  }
+
+  void ArkModel::BindPositions(VkCommandBuffer commandBuffer)
+  {
+    if (m_meshBuffer)
+    {
+      m_meshBuffer->BindPositions(commandBuffer);
+      return;
+    }
     VkBuffer buffers[] = {m_vertexBuffer->GetBuffer()};
     VkDeviceSize offsets[] = {0};
     vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
@@ -104,108 +243,190 @@ namespace Ark
     }
   }
 
-  void ArkModel::Draw(VkCommandBuffer commandBuffer)
+  void ArkModel::Draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance)
   {
     if (m_hasIndexBuffer)
     {
-      vkCmdDrawIndexed(commandBuffer, m_indexCount, 1, 0, 0, 0);
+      vkCmdDrawIndexed(commandBuffer, m_indexCount, instanceCount, m_firstIndex, m_vertexOffset, firstInstance);
     }
     else
     {
-      vkCmdDraw(commandBuffer, m_vertexCount, 1, 0, 0);
+      vkCmdDraw(commandBuffer, m_vertexCount, instanceCount, 0, firstInstance);
     }
   }
 
-  std::vector<VkVertexInputAttributeDescription> ArkModel::Vertex::GetAttributeDescriptions()
+  std::vector<VkVertexInputAttributeDescription> ArkModel::Vertex::GetAttributeDescriptions(VertexLayout layout)
   {
+    if (layout == VertexLayout::Packed)
+    {
+      std::vector<VkVertexInputAttributeDescription> attributeDescriptions = GetPositionAttributeDescriptions(layout);
+      attributeDescriptions.resize(4);
+      attributeDescriptions[1].binding = 1;
+      attributeDescriptions[1].location = 1;
+      attributeDescriptions[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+      attributeDescriptions[1].offset = offsetof(PackedVertexAttributes, color);
+
+      attributeDescriptions[2].binding = 1;
+      attributeDescriptions[2].location = 2;
+      attributeDescriptions[2].format = VK_FORMAT_R16G16_SNORM;
+      attributeDescriptions[2].offset = offsetof(PackedVertexAttributes, normal);
+
+      attributeDescriptions[3].binding = 1;
+      attributeDescriptions[3].location = 3;
+      attributeDescriptions[3].format = VK_FORMAT_R16G16_UNORM;
+      attributeDescriptions[3].offset = offsetof(PackedVertexAttributes, uv);
+      return attributeDescriptions;
+    }
+
+    const bool split = layout == VertexLayout::SplitPosition;
     std::vector<VkVertexInputAttributeDescription> attributeDescriptions(4);
     attributeDescriptions[0].binding = 0;
     attributeDescriptions[0].location = 0;
     attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[0].offset = offsetof(Vertex, position);
+    attributeDescriptions[0].offset = split ? 0 : offsetof(Vertex, position);
 
-    attributeDescriptions[1].binding = 0;
+    attributeDescriptions[1].binding = split ? 1 : 0;
     attributeDescriptions[1].location = 1;
     attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[1].offset = offsetof(Vertex, color);
+    attributeDescriptions[1].offset = split ? offsetof(VertexAttributes, color) : offsetof(Vertex, color);
 
-    attributeDescriptions[2].binding = 0;
+    attributeDescriptions[2].binding = split ? 1 : 0;
     attributeDescriptions[2].location = 2;
     attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[2].offset = offsetof(Vertex, normal);
+    attributeDescriptions[2].offset = split ? offsetof(VertexAttributes, normal) : offsetof(Vertex, normal);
 
-    attributeDescriptions[3].binding = 0;
+    attributeDescriptions[3].binding = split ? 1 : 0;
     attributeDescriptions[3].location = 3;
     attributeDescriptions[3].format = VK_FORMAT_R32G32_SFLOAT;
-    attributeDescriptions[3].offset = offsetof(Vertex, uv);
+    attributeDescriptions[3].offset = split ? offsetof(VertexAttributes, uv) : offsetof(Vertex, uv);
     return attributeDescriptions;
   }
 
-  std::vector<VkVertexInputBindingDescription> ArkModel::Vertex::GetBindingDescriptions()
+  std::vector<VkVertexInputBindingDescription> ArkModel::Vertex::GetBindingDescriptions(VertexLayout layout)
+  {
+    if (layout == VertexLayout::Interleaved)
+    {
+      return GetPositionBindingDescriptions(layout);
+    }
+
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions = GetPositionBindingDescriptions(layout);
+    bindingDescriptions.resize(2);
+    bindingDescriptions[1].binding = 1;
+    bindingDescriptions[1].stride = layout == VertexLayout::Packed
+                                      ? sizeof(PackedVertexAttributes)
+                                      : sizeof(VertexAttributes);
+    bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    return bindingDescriptions;
+  }
+
+  std::vector<VkVertexInputBindingDescription> ArkModel::Vertex::GetPositionBindingDescriptions(VertexLayout layout)
   {
     std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
     bindingDescriptions[0].binding = 0;
-    bindingDescriptions[0].stride = sizeof(Vertex);
+    switch (layout)
+    {
+    case VertexLayout::Interleaved:
+      bindingDescriptions[0].stride = sizeof(Vertex);
+      break;
+    case VertexLayout::Packed:
+      bindingDescriptions[0].stride = sizeof(PackedPosition);
+      break;
+    default:
+      bindingDescriptions[0].stride = sizeof(glm::vec3);
+      break;
+    }
     bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
     return bindingDescriptions;
   }
 
-  void ArkModel::Builder::LoadModel(const std::string& filePath)
+  std::vector<VkVertexInputAttributeDescription> ArkModel::Vertex::GetPositionAttributeDescriptions(VertexLayout layout)
   {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
+    // Position sits at offset 0 in every layout. Packed positions are read as a vec3, the padding is dropped.
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions(1);
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = layout == VertexLayout::Packed
+                                        ? VK_FORMAT_R16G16B16A16_UNORM
+                                        : VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[0].offset = 0;
+    return attributeDescriptions;
+  }
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filePath.c_str()))
-    {
-      throw std::runtime_error(warn + err);
-    }
+  void ArkModel::Builder::LoadModel(const std::string& filePath)
+  {
+    const auto obj = ObjParser::Parse(filePath);
 
     vertices.clear();
     indices.clear();
+    indices.reserve(obj.corners.size());
+
+    // Open addressing table of vertex ids keyed on the (v, vt, vn) triple of each corner. Corners with the same
+    // triple are the same vertex, so vertex contents never have to be hashed or compared.
+    size_t capacity = 16;
+    while (capacity < obj.corners.size() * 2) capacity <<= 1;
+    const size_t mask = capacity - 1;
+    constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+    std::vector<uint32_t> table(capacity, EMPTY_SLOT);
+    std::vector<ObjParser::Index> keys{};
 
-    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-    for (const auto& shape : shapes)
+    for (const auto& corner : obj.corners)
     {
-      for (const auto& index : shape.mesh.indices)
+      size_t slot = HashIndex(corner) & mask;
+      while (table[slot] != EMPTY_SLOT && !(keys[table[slot]] == corner))
       {
-        Vertex vertex{};
-
-        if (index.vertex_index >= 0)
-        {
-          vertex.position = {
-            attrib.vertices[3 * index.vertex_index + 0], attrib.vertices[3 * index.vertex_index + 1],
-            attrib.vertices[3 * index.vertex_index + 2],
-          };
+        slot = (slot + 1) & mask;
+      }
 
-          vertex.color = {
-            attrib.colors[3 * index.vertex_index + 0], attrib.colors[3 * index.vertex_index + 1],
-            attrib.colors[3 * index.vertex_index + 2],
-          };
-        }
+      if (table[slot] == EMPTY_SLOT)
+      {
+        Vertex vertex{};
+        vertex.position = {
+          obj.positions[3 * corner.v + 0], obj.positions[3 * corner.v + 1], obj.positions[3 * corner.v + 2],
+        };
+        vertex.color = {
+          obj.colors[3 * corner.v + 0], obj.colors[3 * corner.v + 1], obj.colors[3 * corner.v + 2],
+        };
 
-        if (index.normal_index >= 0)
+        if (corner.vn >= 0)
         {
           vertex.normal = {
-            attrib.normals[3 * index.normal_index + 0], attrib.normals[3 * index.normal_index + 1],
-            attrib.normals[3 * index.normal_index + 2],
+            obj.normals[3 * corner.vn + 0], obj.normals[3 * corner.vn + 1], obj.normals[3 * corner.vn + 2],
           };
         }
 
-        if (index.texcoord_index >= 0)
+        if (corner.vt >= 0)
         {
           vertex.uv = {
-            attrib.texcoords[2 * index.texcoord_index + 0], attrib.texcoords[2 * index.texcoord_index + 1],
+            obj.texcoords[2 * corner.vt + 0], obj.texcoords[2 * corner.vt + 1],
           };
         }
-        if (uniqueVertices.count(vertex) == 0)
-        {
-          uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-          vertices.push_back(vertex);
-        }
-        indices.push_back(uniqueVertices[vertex]);
+
+        table[slot] = static_cast<uint32_t>(vertices.size());
+        keys.push_back(corner);
+        vertices.push_back(vertex);
       }
+      indices.push_back(table[slot]);
     }
+
+    Optimize();
+  }
+
+  void ArkModel::Builder::Optimize()
+  {
+    if (indices.empty()) return;
+
+    const MeshOptimizer::CacheStats before = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+    MeshOptimizer::OptimizeVertexCache(indices, vertices.size());
+    MeshOptimizer::OptimizeOverdraw(indices, &vertices[0].position, vertices.size(), sizeof(Vertex));
+    const std::vector<uint32_t> fetchOrder = MeshOptimizer::OptimizeVertexFetch(indices, vertices.size());
+
+    std::vector<Vertex> ordered{};
+    ordered.reserve(fetchOrder.size());
+    for (const uint32_t index : fetchOrder) ordered.push_back(vertices[index]);
+    vertices = std::move(ordered);
+
+    const MeshOptimizer::CacheStats after = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+    std::cout << "Mesh Optimizer: ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr
+      << " -> " << after.atvr << "\n";
   }
 }
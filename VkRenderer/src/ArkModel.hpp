@@ -12,17 +12,43 @@
 
 namespace Ark
 {
+  class ArkMeshBuffer;
+
   class ArkModel
   {
   public:
+    // How vertex data is laid out in GPU buffers
+    enum class VertexLayout
+    {
+      // One buffer of Vertex on binding 0
+      Interleaved,
+      // Positions alone on binding 0, the other attributes on binding 1. Depth-only pipelines bind just the
+      // first stream and fetch 12 bytes per vertex instead of sizeof(Vertex).
+      SplitPosition,
+      // SplitPosition with quantized streams: unorm16 positions inside the model bounds, unorm8 colors, octahedral
+      // snorm16 normals and unorm16 UVs inside the model UV range. Needs simple_packed.vert.
+      Packed
+    };
+
+    // Layout models are loaded with unless the caller asks for another one. Render systems pick their vertex
+    // input state and shaders from it.
+    static constexpr VertexLayout DEFAULT_LAYOUT{VertexLayout::SplitPosition};
+
     struct Vertex
     {
       glm::vec3 position{};
       glm::vec3 color{};
       glm::vec3 normal{};
       glm::vec2 uv{};
-      static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions();
-      static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions();
+      static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions(
+        VertexLayout layout = DEFAULT_LAYOUT);
+      static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions(
+        VertexLayout layout = DEFAULT_LAYOUT);
+      // Position stream only, for depth-only pipelines
+      static std::vector<VkVertexInputBindingDescription> GetPositionBindingDescriptions(
+        VertexLayout layout = DEFAULT_LAYOUT);
+      static std::vector<VkVertexInputAttributeDescription> GetPositionAttributeDescriptions(
+        VertexLayout layout = DEFAULT_LAYOUT);
 
       bool operator==(const Vertex& other) const
       {
@@ -30,34 +56,102 @@ namespace Ark
       }
     };
 
+    // Element of the binding 1 stream in VertexLayout::SplitPosition
+    struct VertexAttributes
+    {
+      glm::vec3 color{};
+      glm::vec3 normal{};
+      glm::vec2 uv{};
+    };
+
+    // Element of the binding 0 stream in VertexLayout::Packed. w is padding to keep the stream 8 byte aligned.
+    struct PackedPosition
+    {
+      uint16_t position[4];
+    };
+
+    // Element of the binding 1 stream in VertexLayout::Packed
+    struct PackedVertexAttributes
+    {
+      uint8_t color[4];
+      int16_t normal[2];
+      uint16_t uv[2];
+    };
+
     struct Builder
     {
       std::vector<Vertex> vertices{};
       std::vector<uint32_t> indices{};
+      VertexLayout layout{DEFAULT_LAYOUT};
 
       void LoadModel(const std::string& filePath);
+      // Reorders indices for the vertex cache and overdraw, then vertices for fetch locality. Run by LoadModel.
+      void Optimize();
     };
 
-    static std::unique_ptr<ArkModel> CreateModelFromFile(ArkDevice& device, const std::string& filePath);
+    static std::unique_ptr<ArkModel> CreateModelFromFile(ArkDevice& device, const std::string& filePath,
+                                                         VertexLayout layout = DEFAULT_LAYOUT);
+    // Loads the model into ranges of meshBuffer, in its layout, instead of buffers of its own
+    static std::unique_ptr<ArkModel> CreateModelFromFile(ArkDevice& device, const std::string& filePath,
+                                                         ArkMeshBuffer& meshBuffer);
 
-    ArkModel(ArkDevice& device, const ArkModel::Builder& builder);
+    // With a mesh buffer, builder.layout has to match its layout and the model has to be indexed. The mesh buffer
+    // has to outlive the model.
+    ArkModel(ArkDevice& device, const ArkModel::Builder& builder, ArkMeshBuffer* meshBuffer = nullptr);
     ~ArkModel();
     ArkModel(const ArkModel&) = delete;
     ArkModel& operator=(const ArkModel&) = delete;
     void Bind(VkCommandBuffer commandBuffer);
-    void Draw(VkCommandBuffer commandBuffer);
+    // Binds only the position stream, for pipelines set up with the position descriptions
+    void BindPositions(VkCommandBuffer commandBuffer);
+    // instanceCount copies, gl_InstanceIndex starting at firstInstance
+    void Draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+
+    VertexLayout GetLayout() const { return m_layout; }
+    // Object-space bounds of the vertices
+    const glm::vec3& GetBoundsMin() const { return m_boundsMin; }
+    const glm::vec3& GetBoundsMax() const { return m_boundsMax; }
+    // VertexLayout::Packed only. Maps quantized positions back to object space, fold it into the model matrix.
+    const glm::mat4& GetDequantizeMatrix() const { return m_dequantize; }
+    // VertexLayout::Packed only. UV offset in xy and extent in zw.
+    const glm::vec4& GetUvTransform() const { return m_uvTransform; }
+
+    // Where the model lives when it was created in a mesh buffer
+    ArkMeshBuffer* GetMeshBuffer() const { return m_meshBuffer; }
+    uint32_t GetIndexCount() const { return m_indexCount; }
+    uint32_t GetFirstIndex() const { return m_firstIndex; }
+    int32_t GetVertexOffset() const { return m_vertexOffset; }
   private:
     void CreateVertexBuffers(const std::vector<Vertex>& vertices);
+    // Stream 0 goes to m_vertexBuffer and stream 1 to m_attributeBuffer, or to the mesh buffer if there is one
+    void CreateVertexStream(uint32_t stream, const void* data, uint32_t elementSize);
     void CreateIndexBuffers(const std::vector<uint32_t>& indices);
+    // Quantizes vertices into the two VertexLayout::Packed streams
+    void CreatePackedVertexBuffers(const std::vector<Vertex>& vertices);
+    // Uploads data into a new device local buffer through a staging buffer
+    std::unique_ptr<ArkBuffer> CreateDeviceLocalBuffer(const void* data, uint32_t elementSize, uint32_t elementCount,
+                                                       VkBufferUsageFlags usage);
 
     bool m_hasIndexBuffer = false;
     ArkDevice& m_arkDevice;
+    VertexLayout m_layout;
 
+    // Whole vertices when interleaved, positions only otherwise
     std::unique_ptr<ArkBuffer> m_vertexBuffer;
+    // VertexAttributes or PackedVertexAttributes, not used when interleaved
+    std::unique_ptr<ArkBuffer> m_attributeBuffer;
     uint32_t m_vertexCount;
+    glm::vec3 m_boundsMin{0.0f};
+    glm::vec3 m_boundsMax{0.0f};
+    glm::mat4 m_dequantize{1.0f};
+    glm::vec4 m_uvTransform{0.0f, 0.0f, 1.0f, 1.0f};
 
     std::unique_ptr<ArkBuffer> m_indexBuffer;
     uint32_t m_indexCount;
+
+    ArkMeshBuffer* m_meshBuffer = nullptr;
+    uint32_t m_firstIndex = 0;
+    int32_t m_vertexOffset = 0;
   };
 }
 
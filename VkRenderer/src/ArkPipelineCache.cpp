@@ -0,0 +1,168 @@
+#include "ArkPipelineCache.hpp"
+
+// std
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace Ark
+{
+  namespace
+  {
+    // FNV-1a
+    uint64_t Checksum(const std::vector<char>& data)
+    {
+      uint64_t hash = 14695981039346656037ull;
+      for (const char byte : data)
+      {
+        hash ^= static_cast<uint8_t>(byte);
+        hash *= 1099511628211ull;
+      }
+      return hash;
+    }
+  }
+
+  ArkPipelineCache::ArkPipelineCache(ArkDevice& device, std::filesystem::path path)
+    : m_arkDevice{device}, m_path{std::move(path)}
+  {
+    const std::vector<char> data = Load();
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.empty() ? nullptr : data.data();
+    if (vkCreatePipelineCache(device.Device(), &createInfo, nullptr, &m_cache) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create pipeline cache!");
+    }
+    m_stats.loadedBytes = data.size();
+    if (data.empty())
+    {
+      std::cout << "Pipeline cache: cold start\n";
+    }
+    else
+    {
+      std::cout << "Pipeline cache: warm start, " << data.size() / 1024 << " KiB loaded from " << m_path.string()
+        << "\n";
+    }
+  }
+
+  ArkPipelineCache::~ArkPipelineCache()
+  {
+    Save();
+    vkDestroyPipelineCache(m_arkDevice.Device(), m_cache, nullptr);
+  }
+
+  bool ArkPipelineCache::Save()
+  {
+    std::lock_guard lock{m_mutex};
+    if (!m_unsaved) return true;
+
+    size_t size = 0;
+    if (vkGetPipelineCacheData(m_arkDevice.Device(), m_cache, &size, nullptr) != VK_SUCCESS)
+    {
+      return false;
+    }
+    std::vector<char> data(size);
+    if (vkGetPipelineCacheData(m_arkDevice.Device(), m_cache, &size, data.data()) != VK_SUCCESS)
+    {
+      return false;
+    }
+    data.resize(size);
+
+    // Written next to the cache and renamed over it, so an interrupted save never leaves a torn file behind
+    std::filesystem::path tempPath = m_path;
+    tempPath += ".tmp";
+    {
+      std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+      if (!file.is_open())
+      {
+        std::cerr << "Pipeline cache: failed to write " << tempPath.string() << "\n";
+        return false;
+      }
+      const FileHeader header = MakeHeader(data);
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      file.write(data.data(), static_cast<std::streamsize>(data.size()));
+      if (!file)
+      {
+        std::cerr << "Pipeline cache: failed to write " << tempPath.string() << "\n";
+        return false;
+      }
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, m_path, error);
+    if (error)
+    {
+      std::cerr << "Pipeline cache: failed to replace " << m_path.string() << ": " << error.message() << "\n";
+      return false;
+    }
+    m_unsaved = false;
+    return true;
+  }
+
+  void ArkPipelineCache::RecordCreation(const std::string& name, double milliseconds)
+  {
+    std::lock_guard lock{m_mutex};
+    m_stats.pipelines++;
+    m_stats.creationMilliseconds += milliseconds;
+    m_unsaved = true;
+    std::cout << "Pipeline " << name << ": " << milliseconds << " ms\n";
+  }
+
+  ArkPipelineCache::Stats ArkPipelineCache::GetStats() const
+  {
+    std::lock_guard lock{m_mutex};
+    return m_stats;
+  }
+
+  ArkPipelineCache::FileHeader ArkPipelineCache::MakeHeader(const std::vector<char>& data) const
+  {
+    const VkPhysicalDeviceProperties& properties = m_arkDevice.properties;
+    FileHeader header{};
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION;
+    header.vendorID = properties.vendorID;
+    header.deviceID = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    std::memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.dataSize = data.size();
+    header.checksum = Checksum(data);
+    return header;
+  }
+
+  std::vector<char> ArkPipelineCache::Load() const
+  {
+    std::error_code error;
+    const auto fileSize = std::filesystem::file_size(m_path, error);
+    std::ifstream file(m_path, std::ios::binary);
+    if (error || !file.is_open())
+    {
+      return {};
+    }
+    FileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    const FileHeader expected = MakeHeader({});
+    if (!file || header.magic != expected.magic || header.version != expected.version ||
+      header.vendorID != expected.vendorID || header.deviceID != expected.deviceID ||
+      header.driverVersion != expected.driverVersion ||
+      std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+      std::cout << "Pipeline cache: " << m_path.string() << " belongs to another device or driver, ignored\n";
+      return {};
+    }
+
+    if (header.dataSize != fileSize - sizeof(header))
+    {
+      std::cout << "Pipeline cache: " << m_path.string() << " is truncated, ignored\n";
+      return {};
+    }
+    std::vector<char> data(header.dataSize);
+    file.read(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!file || Checksum(data) != header.checksum)
+    {
+      std::cout << "Pipeline cache: " << m_path.string() << " is corrupt, ignored\n";
+      return {};
+    }
+    return data;
+  }
+}
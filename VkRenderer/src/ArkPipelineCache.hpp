@@ -0,0 +1,71 @@
+#pragma once
+
+#include "ArkDevice.hpp"
+
+// std
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Ark
+{
+  // VkPipelineCache that persists across runs. The data is loaded when the device is created and written back when
+  // it is destroyed, behind a header that ties it to the device UUID and driver version and checksums it, so data
+  // from another GPU or driver, or a truncated file, is discarded instead of handed to the driver. Pipelines may be
+  // created with the cache from several threads at once.
+  class ArkPipelineCache
+  {
+  public:
+    static constexpr const char* DEFAULT_PATH = "pipeline_cache.bin";
+    static constexpr uint32_t FILE_MAGIC = 0x50435241;  // "ARCP"
+    static constexpr uint32_t FILE_VERSION = 1;
+
+    struct Stats
+    {
+      // Bytes of cache data accepted from disk, 0 on a cold start
+      size_t loadedBytes{0};
+      uint32_t pipelines{0};
+      // Sum of the per pipeline creation times, pipelines created in parallel overlap
+      double creationMilliseconds{0.0};
+    };
+
+    ArkPipelineCache(ArkDevice& device, std::filesystem::path path);
+    ~ArkPipelineCache();
+
+    ArkPipelineCache(const ArkPipelineCache&) = delete;
+    ArkPipelineCache& operator=(const ArkPipelineCache&) = delete;
+
+    VkPipelineCache GetCache() const { return m_cache; }
+    // Writes the cache to disk if pipelines were created since the last save. Returns false if writing failed.
+    bool Save();
+    // Logs how long creating the named pipeline took
+    void RecordCreation(const std::string& name, double milliseconds);
+    Stats GetStats() const;
+
+  private:
+    struct FileHeader
+    {
+      uint32_t magic;
+      uint32_t version;
+      uint32_t vendorID;
+      uint32_t deviceID;
+      uint32_t driverVersion;
+      uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+      uint64_t dataSize;
+      uint64_t checksum;
+    };
+
+    FileHeader MakeHeader(const std::vector<char>& data) const;
+    // Cache data of the file at m_path, empty if it is missing or was written for another device or driver
+    std::vector<char> Load() const;
+
+    ArkDevice& m_arkDevice;
+    std::filesystem::path m_path;
+    VkPipelineCache m_cache = VK_NULL_HANDLE;
+    mutable std::mutex m_mutex;
+    Stats m_stats{};
+    bool m_unsaved{false};
+  };
+}
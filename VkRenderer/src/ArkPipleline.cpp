@@ -1,11 +1,34 @@
 #include "ArkPipleline.hpp"
 
 #include <cassert>
+#include <chrono>
+#include <filesystem>
 #include "ArkModel.hpp"
+#include "ArkPipelineCache.hpp"
 #include "ResourceManager.hpp"
 
 namespace Ark
 {
+  namespace
+  {
+    void CreateShaderModuleFromCode(ArkDevice& device, const std::vector<char>& code, VkShaderModule* shaderModule)
+    {
+      VkShaderModuleCreateInfo createInfo{};
+      createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+      createInfo.codeSize = code.size();
+      createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+      if (vkCreateShaderModule(device.Device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS)
+      {
+        throw std::runtime_error("failed to create shader module!");
+      }
+    }
+
+    double MillisecondsSince(std::chrono::high_resolution_clock::time_point start)
+    {
+      return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+  }
+
   ArkPipeline::ArkPipeline(ArkDevice& device, const std::string& vertShaderPath,
                            const std::string& fragShaderPath,
                            const PipelineConfigInfo& configInfo) : m_arkDevice(device)
@@ -85,23 +108,21 @@ namespace Ark
     pipelineInfo.basePipelineIndex = -1;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(m_arkDevice.Device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
+    auto& pipelineCache = m_arkDevice.PipelineCache();
+    const auto start = std::chrono::high_resolution_clock::now();
+    if (vkCreateGraphicsPipelines(m_arkDevice.Device(), pipelineCache.GetCache(), 1, &pipelineInfo, nullptr,
                                   &m_graphicsPipeline) != VK_SUCCESS)
     {
       throw std::runtime_error("failed to create graphics pipeline!");
     }
+    pipelineCache.RecordCreation(
+      std::filesystem::path(vertShaderPath).filename().string() + " + " +
+      std::filesystem::path(fragShaderPath).filename().string(), MillisecondsSince(start));
   }
 
   void ArkPipeline::CreateShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule)
   {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-    if (vkCreateShaderModule(m_arkDevice.Device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS)
-    {
-      throw std::runtime_error("failed to create shader module!");
-    }
+    CreateShaderModuleFromCode(m_arkDevice, code, shaderModule);
   }
 
   void ArkPipeline::DefaultPipelineConfigInfo(PipelineConfigInfo& configInfo)
@@ -179,4 +200,42 @@ namespace Ark
     configInfo.bindingDescriptions = ArkModel::Vertex::GetBindingDescriptions();
     configInfo.attributeDescriptions = ArkModel::Vertex::GetAttributeDescriptions();
   }
+
+  ArkComputePipeline::ArkComputePipeline(ArkDevice& device, const std::string& compShaderPath,
+                                         VkPipelineLayout pipelineLayout) : m_arkDevice(device)
+  {
+    assert(pipelineLayout != VK_NULL_HANDLE && "Cannot create compute pipeline: no pipelineLayout provided");
+    auto compCode = ResourceManager::GetInstance().ReadTextFile(compShaderPath);
+    CreateShaderModuleFromCode(m_arkDevice, compCode, &m_computeShaderModule);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = m_computeShaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.basePipelineIndex = -1;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    auto& pipelineCache = m_arkDevice.PipelineCache();
+    const auto start = std::chrono::high_resolution_clock::now();
+    if (vkCreateComputePipelines(m_arkDevice.Device(), pipelineCache.GetCache(), 1, &pipelineInfo, nullptr,
+                                 &m_computePipeline) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create compute pipeline!");
+    }
+    pipelineCache.RecordCreation(std::filesystem::path(compShaderPath).filename().string(), MillisecondsSince(start));
+  }
+
+  ArkComputePipeline::~ArkComputePipeline()
+  {
+    vkDestroyShaderModule(m_arkDevice.Device(), m_computeShaderModule, nullptr);
+    vkDestroyPipeline(m_arkDevice.Device(), m_computePipeline, nullptr);
+  }
+
+  void ArkComputePipeline::Bind(VkCommandBuffer commandBuffer)
+  {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_computePipeline);
+  }
 }
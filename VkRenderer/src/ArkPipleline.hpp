@@ -46,4 +46,19 @@ namespace Ark
                                 const PipelineConfigInfo& configInfo);
     void CreateShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
   };
+
+  class ArkComputePipeline
+  {
+  public:
+    ArkComputePipeline(ArkDevice& device, const std::string& compShaderPath, VkPipelineLayout pipelineLayout);
+
+    ~ArkComputePipeline();
+    ArkComputePipeline(const ArkComputePipeline&) = delete;
+    ArkComputePipeline& operator=(const ArkComputePipeline&) = delete;
+    void Bind(VkCommandBuffer commandBuffer);
+  private:
+    ArkDevice& m_arkDevice;
+    VkPipeline m_computePipeline;
+    VkShaderModule m_computeShaderModule;
+  };
 }
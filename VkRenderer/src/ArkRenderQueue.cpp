@@ -0,0 +1,52 @@
+#include "ArkRenderQueue.hpp"
+
+namespace Ark
+{
+  void ArkRenderQueue::Clear()
+  {
+    m_packets.clear();
+    m_sorted.clear();
+    m_stats = {};
+  }
+
+  void ArkRenderQueue::Push(const Packet& packet)
+  {
+    m_packets.push_back(packet);
+    m_stats.packets++;
+  }
+
+  void ArkRenderQueue::Sort()
+  {
+    m_entries.clear();
+    m_entries.reserve(m_packets.size());
+    for (uint32_t i = 0; i < m_packets.size(); ++i)
+    {
+      const auto& packet = m_packets[i];
+      const uint64_t key = SortKey::Encode(SortKey::MapId(m_pipelineIds, packet.pipeline, SortKey::STATE_BITS),
+                                           SortKey::MapId(m_materialIds, packet.material, SortKey::MATERIAL_BITS),
+                                           SortKey::MapId(m_meshIds, packet.mesh, SortKey::MESH_BITS), packet.depth,
+                                           packet.blended);
+      m_entries.push_back({key, i});
+    }
+    SortKey::RadixSort(m_entries, m_scratch);
+
+    m_sorted.clear();
+    m_sorted.reserve(m_entries.size());
+    for (const auto& entry : m_entries)
+    {
+      m_sorted.push_back(m_packets[entry.index]);
+    }
+  }
+
+  bool ArkRenderQueue::Bind(const void*& bound, const void* next)
+  {
+    if (bound == next)
+    {
+      m_stats.bindsAvoided++;
+      return false;
+    }
+    bound = next;
+    m_stats.binds++;
+    return true;
+  }
+}
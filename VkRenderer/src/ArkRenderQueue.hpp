@@ -0,0 +1,64 @@
+#pragma once
+
+//libs
+#include <Ark/SortKey.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Ark
+{
+  // Draw packets of one pass, ordered by the keys of SortKey.hpp with the pipeline as the state field. Pipelines,
+  // materials and meshes are passed as handles and mapped to small ids, the draw loop compares the handles
+  // themselves through Bind.
+  class ArkRenderQueue
+  {
+  public:
+    struct Packet
+    {
+      const void* pipeline{nullptr};
+      const void* material{nullptr};
+      // Whatever identifies the vertex and index buffers the draw binds
+      const void* mesh{nullptr};
+      // View-space distance along the view direction, negative values count as 0
+      float depth{0.0f};
+      bool blended{false};
+      // Caller data, e.g. the index of the object to draw
+      uint32_t payload{0};
+    };
+
+    struct Stats
+    {
+      size_t packets{0};
+      // Binds the draw loop issued, and the ones it skipped because the state was already bound
+      size_t binds{0};
+      size_t bindsAvoided{0};
+    };
+
+    // Starts a new frame, the stats restart with it
+    void Clear();
+    void Push(const Packet& packet);
+    // Orders the packets pushed since Clear by key
+    void Sort();
+    // Valid after Sort
+    const std::vector<Packet>& GetSortedPackets() const { return m_sorted; }
+
+    // For the draw loop: true if next differs from bound, which is then updated and the bind must be issued. False
+    // if the bind is redundant and can be skipped.
+    bool Bind(const void*& bound, const void* next);
+    const Stats& GetStats() const { return m_stats; }
+
+  private:
+    std::vector<Packet> m_packets{};
+    std::vector<Packet> m_sorted{};
+    std::vector<SortKey::Entry> m_entries{};
+    std::vector<SortKey::Entry> m_scratch{};
+    std::unordered_map<const void*, uint32_t> m_pipelineIds{};
+    std::unordered_map<const void*, uint32_t> m_materialIds{};
+    std::unordered_map<const void*, uint32_t> m_meshIds{};
+    Stats m_stats{};
+  };
+}
@@ -56,7 +56,7 @@ namespace Ark
     {
       vkDestroyImageView(m_arkDevice.Device(), m_depthImageViews[i], nullptr);
       vkDestroyImage(m_arkDevice.Device(), m_depthImages[i], nullptr);
-      vkFreeMemory(m_arkDevice.Device(), m_depthImageMemorys[i], nullptr);
+      m_arkDevice.Allocator().Free(m_depthImageAllocations[i]);
     }
 
     for (auto framebuffer : m_swapChainFrameBuffers)
@@ -325,7 +325,7 @@ namespace Ark
     VkExtent2D swapChainExtent = GetSwapChainExtent();
 
     m_depthImages.resize(ImageCount());
-    m_depthImageMemorys.resize(ImageCount());
+    m_depthImageAllocations.resize(ImageCount());
     m_depthImageViews.resize(ImageCount());
 
     for (int i = 0; i < m_depthImages.size(); i++)
@@ -347,7 +347,7 @@ namespace Ark
       imageInfo.flags = 0;
 
       m_arkDevice.CreateImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_depthImages[i],
-                                      m_depthImageMemorys[i]);
+                                      m_depthImageAllocations[i]);
 
       VkImageViewCreateInfo viewInfo{};
       viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
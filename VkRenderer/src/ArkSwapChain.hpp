@@ -80,7 +80,7 @@ namespace Ark
     VkRenderPass m_renderPass;
 
     std::vector<VkImage> m_depthImages;
-    std::vector<VkDeviceMemory> m_depthImageMemorys;
+    std::vector<ArkAllocation> m_depthImageAllocations;
     std::vector<VkImageView> m_depthImageViews;
     std::vector<VkImage> m_swapChainImages;
     std::vector<VkImageView> m_swapChainImageViews;
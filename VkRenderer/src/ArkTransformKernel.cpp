@@ -0,0 +1,276 @@
+#include "ArkTransformKernel.hpp"
+#include "ArkGameObject.hpp"
+
+// std
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ARK_TRANSFORM_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(ARK_TRANSFORM_SSE2) && defined(__AVX2__)
+#define ARK_TRANSFORM_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace Ark
+{
+  namespace
+  {
+    // Cephes single precision sine and cosine. The argument is reduced to [-pi/4, pi/4] by the nearest multiple of
+    // pi/2, subtracted in three parts to keep the bits the float product would lose, and the quadrant of that
+    // multiple swaps and negates the two polynomials.
+    constexpr float TWO_OVER_PI = 0.636619772367581343f;
+    constexpr float PI_OVER_TWO_PART1 = 1.5703125f;
+    constexpr float PI_OVER_TWO_PART2 = 4.837512969970703125e-4f;
+    constexpr float PI_OVER_TWO_PART3 = 7.54978995489188216e-8f;
+    constexpr float SIN_C1 = -1.6666654611e-1f;
+    constexpr float SIN_C2 = 8.3321608736e-3f;
+    constexpr float SIN_C3 = -1.9515295891e-4f;
+    constexpr float COS_C1 = 4.166664568298827e-2f;
+    constexpr float COS_C2 = -1.388731625493765e-3f;
+    constexpr float COS_C3 = 2.443315711809948e-5f;
+
+#ifdef ARK_TRANSFORM_SSE2
+    struct Sse2
+    {
+      using Float = __m128;
+      using Int = __m128i;
+      static constexpr size_t WIDTH = 4;
+
+      static Float Set1(float value) { return _mm_set1_ps(value); }
+      static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+      static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+      static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+      static Float Div(Float a, Float b) { return _mm_div_ps(a, b); }
+      static Float And(Float a, Float b) { return _mm_and_ps(a, b); }
+      static Float Xor(Float a, Float b) { return _mm_xor_ps(a, b); }
+      static Float Select(Float mask, Float a, Float b)
+      {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+      }
+
+      // Rounds to nearest
+      static Int ToInt(Float value) { return _mm_cvtps_epi32(value); }
+      static Float ToFloat(Int value) { return _mm_cvtepi32_ps(value); }
+      static Int AddInt(Int value, int addend) { return _mm_add_epi32(value, _mm_set1_epi32(addend)); }
+      // All bits set in lanes where value & bit is set
+      static Float BitMask(Int value, int bit)
+      {
+        const Int bits = _mm_set1_epi32(bit);
+        return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(value, bits), bits));
+      }
+      static bool AnyAbsAbove(Float value, float limit)
+      {
+        return _mm_movemask_ps(_mm_cmpgt_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), value), _mm_set1_ps(limit))) != 0;
+      }
+
+      static Float Gather(const float* source, const uint32_t* indices)
+      {
+        return _mm_setr_ps(source[indices[0]], source[indices[1]], source[indices[2]], source[indices[3]]);
+      }
+      // x, y, z, w hold one row of the column for every lane, each lane's column is stored to its matrix
+      static void StoreColumn(Float x, Float y, Float z, Float w, const uint32_t* indices, glm::mat4* matrices,
+                              int column)
+      {
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        _mm_storeu_ps(&matrices[indices[0]][column][0], x);
+        _mm_storeu_ps(&matrices[indices[1]][column][0], y);
+        _mm_storeu_ps(&matrices[indices[2]][column][0], z);
+        _mm_storeu_ps(&matrices[indices[3]][column][0], w);
+      }
+    };
+#endif
+
+#ifdef ARK_TRANSFORM_AVX2
+    struct Avx2
+    {
+      using Float = __m256;
+      using Int = __m256i;
+      static constexpr size_t WIDTH = 8;
+
+      static Float Set1(float value) { return _mm256_set1_ps(value); }
+      static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+      static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+      static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+      static Float Div(Float a, Float b) { return _mm256_div_ps(a, b); }
+      static Float And(Float a, Float b) { return _mm256_and_ps(a, b); }
+      static Float Xor(Float a, Float b) { return _mm256_xor_ps(a, b); }
+      static Float Select(Float mask, Float a, Float b) { return _mm256_blendv_ps(b, a, mask); }
+
+      static Int ToInt(Float value) { return _mm256_cvtps_epi32(value); }
+      static Float ToFloat(Int value) { return _mm256_cvtepi32_ps(value); }
+      static Int AddInt(Int value, int addend) { return _mm256_add_epi32(value, _mm256_set1_epi32(addend)); }
+      static Float BitMask(Int value, int bit)
+      {
+        const Int bits = _mm256_set1_epi32(bit);
+        return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(value, bits), bits));
+      }
+      static bool AnyAbsAbove(Float value, float limit)
+      {
+        const Float magnitude = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), value);
+        return _mm256_movemask_ps(_mm256_cmp_ps(magnitude, _mm256_set1_ps(limit), _CMP_GT_OQ)) != 0;
+      }
+
+      static Float Gather(const float* source, const uint32_t* indices)
+      {
+        const Int offsets = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices));
+        return _mm256_i32gather_ps(source, offsets, sizeof(float));
+      }
+      // Each half goes through the SSE transpose
+      static void StoreColumn(Float x, Float y, Float z, Float w, const uint32_t* indices, glm::mat4* matrices,
+                              int column)
+      {
+        Sse2::StoreColumn(_mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z),
+                          _mm256_castps256_ps128(w), indices, matrices, column);
+        Sse2::StoreColumn(_mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1),
+                          _mm256_extractf128_ps(w, 1), indices + 4, matrices, column);
+      }
+    };
+#endif
+
+    template <class V>
+    void SinCos(typename V::Float x, typename V::Float& sine, typename V::Float& cosine)
+    {
+      using Float = typename V::Float;
+      const auto quadrant = V::ToInt(V::Mul(x, V::Set1(TWO_OVER_PI)));
+      const Float q = V::ToFloat(quadrant);
+      Float r = V::Sub(x, V::Mul(q, V::Set1(PI_OVER_TWO_PART1)));
+      r = V::Sub(r, V::Mul(q, V::Set1(PI_OVER_TWO_PART2)));
+      r = V::Sub(r, V::Mul(q, V::Set1(PI_OVER_TWO_PART3)));
+      const Float r2 = V::Mul(r, r);
+
+      // r + r^3 (S1 + r^2 (S2 + r^2 S3))
+      Float sinR = V::Add(V::Mul(r2, V::Set1(SIN_C3)), V::Set1(SIN_C2));
+      sinR = V::Add(V::Mul(sinR, r2), V::Set1(SIN_C1));
+      sinR = V::Add(V::Mul(V::Mul(sinR, r2), r), r);
+      // 1 - r^2 / 2 + r^4 (C1 + r^2 (C2 + r^2 C3))
+      Float cosR = V::Add(V::Mul(r2, V::Set1(COS_C3)), V::Set1(COS_C2));
+      cosR = V::Add(V::Mul(cosR, r2), V::Set1(COS_C1));
+      cosR = V::Add(V::Mul(V::Mul(cosR, r2), r2), V::Sub(V::Set1(1.0f), V::Mul(r2, V::Set1(0.5f))));
+
+      // Odd quadrants swap sine and cosine, the sine is negative in quadrants 2 and 3, the cosine in 1 and 2
+      const Float swap = V::BitMask(quadrant, 1);
+      const Float signBit = V::Set1(-0.0f);
+      sine = V::Xor(V::Select(swap, cosR, sinR), V::And(V::BitMask(quadrant, 2), signBit));
+      cosine = V::Xor(V::Select(swap, sinR, cosR), V::And(V::BitMask(V::AddInt(quadrant, 1), 2), signBit));
+    }
+
+    // One group of V::WIDTH objects
+    template <class V>
+    void ComputeGroup(const ArkTransformKernel::Arrays& arrays, const uint32_t* indices, glm::mat4* modelMatrices,
+                      glm::mat4* normalMatrices)
+    {
+      using Float = typename V::Float;
+      const Float rotationX = V::Gather(arrays.rotationX, indices);
+      const Float rotationY = V::Gather(arrays.rotationY, indices);
+      const Float rotationZ = V::Gather(arrays.rotationZ, indices);
+      if (V::AnyAbsAbove(rotationX, ArkTransformKernel::MAX_VECTOR_ANGLE) ||
+        V::AnyAbsAbove(rotationY, ArkTransformKernel::MAX_VECTOR_ANGLE) ||
+        V::AnyAbsAbove(rotationZ, ArkTransformKernel::MAX_VECTOR_ANGLE))
+      {
+        ArkTransformKernel::ComputeScalar(arrays, indices, V::WIDTH, modelMatrices, normalMatrices);
+        return;
+      }
+
+      // Same naming as TransformComponent::Mat4
+      Float s1, c1, s2, c2, s3, c3;
+      SinCos<V>(rotationY, s1, c1);
+      SinCos<V>(rotationX, s2, c2);
+      SinCos<V>(rotationZ, s3, c3);
+      const Float s1s2 = V::Mul(s1, s2);
+      const Float c1s2 = V::Mul(c1, s2);
+      // Columns of the rotation
+      const Float r00 = V::Add(V::Mul(c1, c3), V::Mul(s1s2, s3));
+      const Float r01 = V::Mul(c2, s3);
+      const Float r02 = V::Sub(V::Mul(c1s2, s3), V::Mul(c3, s1));
+      const Float r10 = V::Sub(V::Mul(c3, s1s2), V::Mul(c1, s3));
+      const Float r11 = V::Mul(c2, c3);
+      const Float r12 = V::Add(V::Mul(c1s2, c3), V::Mul(s1, s3));
+      const Float r20 = V::Mul(c2, s1);
+      const Float r21 = V::Sub(V::Set1(0.0f), s2);
+      const Float r22 = V::Mul(c1, c2);
+
+      const Float zero = V::Set1(0.0f);
+      const Float one = V::Set1(1.0f);
+      const Float scaleX = V::Gather(arrays.scaleX, indices);
+      const Float scaleY = V::Gather(arrays.scaleY, indices);
+      const Float scaleZ = V::Gather(arrays.scaleZ, indices);
+      V::StoreColumn(V::Mul(scaleX, r00), V::Mul(scaleX, r01), V::Mul(scaleX, r02), zero, indices, modelMatrices, 0);
+      V::StoreColumn(V::Mul(scaleY, r10), V::Mul(scaleY, r11), V::Mul(scaleY, r12), zero, indices, modelMatrices, 1);
+      V::StoreColumn(V::Mul(scaleZ, r20), V::Mul(scaleZ, r21), V::Mul(scaleZ, r22), zero, indices, modelMatrices, 2);
+      V::StoreColumn(V::Gather(arrays.translationX, indices), V::Gather(arrays.translationY, indices),
+                     V::Gather(arrays.translationZ, indices), one, indices, modelMatrices, 3);
+
+      const Float invScaleX = V::Div(one, scaleX);
+      const Float invScaleY = V::Div(one, scaleY);
+      const Float invScaleZ = V::Div(one, scaleZ);
+      V::StoreColumn(V::Mul(invScaleX, r00), V::Mul(invScaleX, r01), V::Mul(invScaleX, r02), zero, indices,
+                     normalMatrices, 0);
+      V::StoreColumn(V::Mul(invScaleY, r10), V::Mul(invScaleY, r11), V::Mul(invScaleY, r12), zero, indices,
+                     normalMatrices, 1);
+      V::StoreColumn(V::Mul(invScaleZ, r20), V::Mul(invScaleZ, r21), V::Mul(invScaleZ, r22), zero, indices,
+                     normalMatrices, 2);
+      V::StoreColumn(zero, zero, zero, one, indices, normalMatrices, 3);
+    }
+
+    template <class V>
+    void ComputeGroups(const ArkTransformKernel::Arrays& arrays, const uint32_t* indices, size_t count,
+                       glm::mat4* modelMatrices, glm::mat4* normalMatrices)
+    {
+      size_t i = 0;
+      for (; i + V::WIDTH <= count; i += V::WIDTH)
+      {
+        ComputeGroup<V>(arrays, indices + i, modelMatrices, normalMatrices);
+      }
+      if (i < count)
+      {
+        // The tail is padded with its last index, which is then computed and written more than once
+        uint32_t tail[V::WIDTH];
+        for (size_t lane = 0; lane < V::WIDTH; lane++)
+        {
+          tail[lane] = indices[std::min(i + lane, count - 1)];
+        }
+        ComputeGroup<V>(arrays, tail, modelMatrices, normalMatrices);
+      }
+    }
+  }
+
+  void ArkTransformKernel::Compute(const Arrays& arrays, const uint32_t* indices, size_t count,
+                                   glm::mat4* modelMatrices, glm::mat4* normalMatrices)
+  {
+#if defined(ARK_TRANSFORM_AVX2)
+    ComputeGroups<Avx2>(arrays, indices, count, modelMatrices, normalMatrices);
+#elif defined(ARK_TRANSFORM_SSE2)
+    ComputeGroups<Sse2>(arrays, indices, count, modelMatrices, normalMatrices);
+#else
+    ComputeScalar(arrays, indices, count, modelMatrices, normalMatrices);
+#endif
+  }
+
+  void ArkTransformKernel::ComputeScalar(const Arrays& arrays, const uint32_t* indices, size_t count,
+                                         glm::mat4* modelMatrices, glm::mat4* normalMatrices)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      const uint32_t index = indices[i];
+      TransformComponent transform{};
+      transform.translation = {arrays.translationX[index], arrays.translationY[index], arrays.translationZ[index]};
+      transform.rotation = {arrays.rotationX[index], arrays.rotationY[index], arrays.rotationZ[index]};
+      transform.scale = {arrays.scaleX[index], arrays.scaleY[index], arrays.scaleZ[index]};
+      modelMatrices[index] = transform.Mat4();
+      normalMatrices[index] = glm::mat4{transform.NormalMat()};
+    }
+  }
+
+  const char* ArkTransformKernel::GetInstructionSet()
+  {
+#if defined(ARK_TRANSFORM_AVX2)
+    return "AVX2";
+#elif defined(ARK_TRANSFORM_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+  }
+}
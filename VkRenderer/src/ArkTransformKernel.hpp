@@ -0,0 +1,49 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+
+namespace Ark
+{
+  // Computes the model and normal matrices of TransformComponent::Mat4 and NormalMat for many transforms at once,
+  // vectorized across objects: 8 at a time with AVX2, 4 with SSE2, one at a time otherwise. The instruction set is
+  // picked at compile time, AVX2 needs /arch:AVX2 (or -mavx2).
+  class ArkTransformKernel
+  {
+  public:
+    // Beyond this angle magnitude a group of objects is computed by the scalar reference, where the range reduction
+    // of the vectorized sine and cosine loses accuracy
+    static constexpr float MAX_VECTOR_ANGLE = 8192.0f;
+
+    // Structure-of-arrays source of the kernel, indexed by object
+    struct Arrays
+    {
+      const float* translationX;
+      const float* translationY;
+      const float* translationZ;
+      const float* rotationX;
+      const float* rotationY;
+      const float* rotationZ;
+      const float* scaleX;
+      const float* scaleY;
+      const float* scaleZ;
+    };
+
+    // Computes the matrices of the objects in indices[0, count), writing each one to the same index of
+    // modelMatrices and normalMatrices. Indices may repeat.
+    static void Compute(const Arrays& arrays, const uint32_t* indices, size_t count, glm::mat4* modelMatrices,
+                        glm::mat4* normalMatrices);
+    // Same through TransformComponent one object at a time, the reference the vector paths are checked against
+    static void ComputeScalar(const Arrays& arrays, const uint32_t* indices, size_t count, glm::mat4* modelMatrices,
+                              glm::mat4* normalMatrices);
+
+    // "AVX2", "SSE2" or "scalar"
+    static const char* GetInstructionSet();
+  };
+}
@@ -0,0 +1,169 @@
+#include "ArkTransformStore.hpp"
+#include "ArkGameObject.hpp"
+
+// std
+#include <cassert>
+
+namespace Ark
+{
+  uint32_t ArkTransformStore::Add(const TransformComponent& transform)
+  {
+    const auto index = static_cast<uint32_t>(Size());
+    for (auto& component : m_components)
+    {
+      component.push_back(0.0f);
+    }
+    Store(TRANSLATION, index, transform.translation);
+    Store(ROTATION, index, transform.rotation);
+    Store(SCALE, index, transform.scale);
+    m_modelMatrices.emplace_back(1.0f);
+    m_normalMatrices.emplace_back(1.0f);
+    m_dirty.push_back(0);
+    MarkDirty(index);
+    return index;
+  }
+
+  void ArkTransformStore::Remove(uint32_t index)
+  {
+    assert(index < Size() && "Transform index out of range");
+    const auto last = static_cast<uint32_t>(Size() - 1);
+    if (index != last)
+    {
+      for (auto& component : m_components)
+      {
+        component[index] = component[last];
+      }
+      m_modelMatrices[index] = m_modelMatrices[last];
+      m_normalMatrices[index] = m_normalMatrices[last];
+      m_dirty[index] = 0;
+      if (m_dirty[last])
+      {
+        MarkDirty(index);
+      }
+    }
+    for (auto& component : m_components)
+    {
+      component.pop_back();
+    }
+    m_modelMatrices.pop_back();
+    m_normalMatrices.pop_back();
+    m_dirty.pop_back();
+  }
+
+  void ArkTransformStore::Reserve(size_t count)
+  {
+    for (auto& component : m_components)
+    {
+      component.reserve(count);
+    }
+    m_modelMatrices.reserve(count);
+    m_normalMatrices.reserve(count);
+    m_dirty.reserve(count);
+  }
+
+  void ArkTransformStore::Clear()
+  {
+    for (auto& component : m_components)
+    {
+      component.clear();
+    }
+    m_modelMatrices.clear();
+    m_normalMatrices.clear();
+    m_dirty.clear();
+    m_dirtyIndices.clear();
+  }
+
+  TransformComponent ArkTransformStore::Get(uint32_t index) const
+  {
+    TransformComponent transform{};
+    transform.translation = GetTranslation(index);
+    transform.rotation = GetRotation(index);
+    transform.scale = GetScale(index);
+    return transform;
+  }
+
+  void ArkTransformStore::SetTranslation(uint32_t index, const glm::vec3& translation)
+  {
+    Store(TRANSLATION, index, translation);
+    MarkDirty(index);
+  }
+
+  void ArkTransformStore::SetRotation(uint32_t index, const glm::vec3& rotation)
+  {
+    Store(ROTATION, index, rotation);
+    MarkDirty(index);
+  }
+
+  void ArkTransformStore::SetScale(uint32_t index, const glm::vec3& scale)
+  {
+    Store(SCALE, index, scale);
+    MarkDirty(index);
+  }
+
+  void ArkTransformStore::Set(uint32_t index, const TransformComponent& transform)
+  {
+    Store(TRANSLATION, index, transform.translation);
+    Store(ROTATION, index, transform.rotation);
+    Store(SCALE, index, transform.scale);
+    MarkDirty(index);
+  }
+
+  size_t ArkTransformStore::UpdateMatrices(std::vector<uint32_t>* updated)
+  {
+    m_updateIndices.clear();
+    for (const uint32_t index : m_dirtyIndices)
+    {
+      // Skips entries left behind by Remove, and duplicates once the first one was taken
+      if (index >= Size() || !m_dirty[index]) continue;
+      m_dirty[index] = 0;
+      m_updateIndices.push_back(index);
+    }
+    m_dirtyIndices.clear();
+    if (!m_updateIndices.empty())
+    {
+      ArkTransformKernel::Compute(GetArrays(), m_updateIndices.data(), m_updateIndices.size(),
+                                  m_modelMatrices.data(), m_normalMatrices.data());
+    }
+    if (updated)
+    {
+      updated->insert(updated->end(), m_updateIndices.begin(), m_updateIndices.end());
+    }
+    return m_updateIndices.size();
+  }
+
+  ArkTransformKernel::Arrays ArkTransformStore::GetArrays() const
+  {
+    ArkTransformKernel::Arrays arrays{};
+    arrays.translationX = m_components[TRANSLATION].data();
+    arrays.translationY = m_components[TRANSLATION + 1].data();
+    arrays.translationZ = m_components[TRANSLATION + 2].data();
+    arrays.rotationX = m_components[ROTATION].data();
+    arrays.rotationY = m_components[ROTATION + 1].data();
+    arrays.rotationZ = m_components[ROTATION + 2].data();
+    arrays.scaleX = m_components[SCALE].data();
+    arrays.scaleY = m_components[SCALE + 1].data();
+    arrays.scaleZ = m_components[SCALE + 2].data();
+    return arrays;
+  }
+
+  glm::vec3 ArkTransformStore::Load(Attribute attribute, uint32_t index) const
+  {
+    return {m_components[attribute][index], m_components[attribute + 1][index], m_components[attribute + 2][index]};
+  }
+
+  void ArkTransformStore::Store(Attribute attribute, uint32_t index, const glm::vec3& value)
+  {
+    m_components[attribute][index] = value.x;
+    m_components[attribute + 1][index] = value.y;
+    m_components[attribute + 2][index] = value.z;
+  }
+
+  void ArkTransformStore::MarkDirty(uint32_t index)
+  {
+    if (!m_dirty[index])
+    {
+      m_dirty[index] = 1;
+      m_dirtyIndices.push_back(index);
+    }
+  }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ArkTransformKernel.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace Ark
+{
+  struct TransformComponent;
+
+  // Transforms of many objects in structure-of-arrays form, one float array per component, with their model and
+  // normal matrices cached. Setters only mark a transform dirty, UpdateMatrices recomputes the matrices of dirty
+  // transforms with ArkTransformKernel and leaves clean ones alone. Elements are addressed by dense index and
+  // removed by moving the last element into the gap.
+  class ArkTransformStore
+  {
+  public:
+    // Appends a dirty transform and returns its index, which is Size() - 1
+    uint32_t Add(const TransformComponent& transform);
+    // Moves the last element to index and shrinks the store by one
+    void Remove(uint32_t index);
+    void Reserve(size_t count);
+    void Clear();
+
+    size_t Size() const { return m_dirty.size(); }
+
+    glm::vec3 GetTranslation(uint32_t index) const { return Load(TRANSLATION, index); }
+    glm::vec3 GetRotation(uint32_t index) const { return Load(ROTATION, index); }
+    glm::vec3 GetScale(uint32_t index) const { return Load(SCALE, index); }
+    TransformComponent Get(uint32_t index) const;
+
+    void SetTranslation(uint32_t index, const glm::vec3& translation);
+    void SetRotation(uint32_t index, const glm::vec3& rotation);
+    void SetScale(uint32_t index, const glm::vec3& scale);
+    void Set(uint32_t index, const TransformComponent& transform);
+
+    // As of the last UpdateMatrices
+    const glm::mat4& GetModelMatrix(uint32_t index) const { return m_modelMatrices[index]; }
+    const glm::mat4& GetNormalMatrix(uint32_t index) const { return m_normalMatrices[index]; }
+    bool IsDirty(uint32_t index) const { return m_dirty[index] != 0; }
+    size_t GetDirtyCount() const { return m_dirtyIndices.size(); }
+
+    // Recomputes the matrices of every dirty transform and appends their indices to updated, if given. Returns the
+    // number of transforms updated.
+    size_t UpdateMatrices(std::vector<uint32_t>* updated = nullptr);
+
+    ArkTransformKernel::Arrays GetArrays() const;
+
+  private:
+    // First of the three components of each attribute in m_components
+    enum Attribute { TRANSLATION = 0, ROTATION = 3, SCALE = 6, COMPONENT_COUNT = 9 };
+
+    glm::vec3 Load(Attribute attribute, uint32_t index) const;
+    void Store(Attribute attribute, uint32_t index, const glm::vec3& value);
+    void MarkDirty(uint32_t index);
+
+    // x, y and z of translation, rotation and scale
+    std::array<std::vector<float>, COMPONENT_COUNT> m_components{};
+    std::vector<glm::mat4> m_modelMatrices{};
+    std::vector<glm::mat4> m_normalMatrices{};
+    std::vector<uint8_t> m_dirty{};
+    // Indices marked dirty since the last update. Entries can be stale after a Remove, the flags are authoritative.
+    std::vector<uint32_t> m_dirtyIndices{};
+    // The dirty indices without stale entries and duplicates, handed to the kernel
+    std::vector<uint32_t> m_updateIndices{};
+  };
+}
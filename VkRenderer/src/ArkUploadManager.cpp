@@ -0,0 +1,405 @@
+#include "ArkUploadManager.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Ark
+{
+  namespace
+  {
+    // Everything that reads uploaded vertex, index, uniform or texture data
+    constexpr VkPipelineStageFlags CONSUMER_STAGES = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+      VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    constexpr VkAccessFlags BUFFER_CONSUMER_ACCESS = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+      VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    constexpr VkAccessFlags IMAGE_CONSUMER_ACCESS = VK_ACCESS_SHADER_READ_BIT;
+
+    VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+      return (value + alignment - 1) / alignment * alignment;
+    }
+  }
+
+  ArkUploadManager::ArkUploadManager(ArkDevice& device) : m_arkDevice{device}
+  {
+    const QueueFamilyIndices indices = device.FindPhysicalQueueFamilies();
+    m_graphicsQueue = device.GraphicsQueue();
+    m_graphicsFamily = indices.m_graphicsFamily;
+    m_transferQueue = device.TransferQueue() != VK_NULL_HANDLE ? device.TransferQueue() : m_graphicsQueue;
+    m_transferFamily = UsesTransferQueue() ? indices.m_transferFamily : m_graphicsFamily;
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = m_transferFamily;
+    if (vkCreateCommandPool(device.Device(), &poolInfo, nullptr, &m_transferPool) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create upload command pool!");
+    }
+    if (UsesTransferQueue())
+    {
+      poolInfo.queueFamilyIndex = m_graphicsFamily;
+      if (vkCreateCommandPool(device.Device(), &poolInfo, nullptr, &m_graphicsPool) != VK_SUCCESS)
+      {
+        throw std::runtime_error("failed to create upload command pool!");
+      }
+    }
+
+    // 16 bytes covers every texel size this renderer uploads
+    m_stagingAlignment = std::max<VkDeviceSize>(16, device.properties.limits.optimalBufferCopyOffsetAlignment);
+    device.CreateBuffer(STAGING_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        m_stagingBuffer, m_stagingAllocation);
+  }
+
+  ArkUploadManager::~ArkUploadManager()
+  {
+    WaitIdle();
+
+    VkDevice device = m_arkDevice.Device();
+    for (const auto& batch : m_freeBatches)
+    {
+      vkDestroyFence(device, batch->fence, nullptr);
+      vkDestroySemaphore(device, batch->transferDone, nullptr);
+    }
+    vkDestroyCommandPool(device, m_transferPool, nullptr);
+    vkDestroyCommandPool(device, m_graphicsPool, nullptr);
+    vkDestroyBuffer(device, m_stagingBuffer, nullptr);
+    m_arkDevice.Allocator().Free(m_stagingAllocation);
+  }
+
+  void ArkUploadManager::UploadBuffer(VkBuffer dst, const void* data, VkDeviceSize size, VkDeviceSize dstOffset)
+  {
+    const auto [src, srcOffset] = Stage(data, size);
+    Batch& batch = CurrentBatch();
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = srcOffset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(batch.transferCommands, src, dst, 1, &copyRegion);
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = UsesTransferQueue() ? 0 : BUFFER_CONSUMER_ACCESS;
+    barrier.srcQueueFamilyIndex = UsesTransferQueue() ? m_transferFamily : VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = UsesTransferQueue() ? m_graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = dst;
+    barrier.offset = dstOffset;
+    barrier.size = size;
+    m_bufferBarriers.push_back(barrier);
+
+    ++m_stats.uploads;
+    m_stats.bytes += size;
+  }
+
+  void ArkUploadManager::UploadImage(VkImage image, const void* data, VkDeviceSize size, VkExtent3D extent,
+                                     uint32_t layerCount)
+  {
+    const auto [src, srcOffset] = Stage(data, size);
+    Batch& batch = CurrentBatch();
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = layerCount;
+    vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = srcOffset;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = layerCount;
+    region.imageExtent = extent;
+    vkCmdCopyBufferToImage(batch.transferCommands, src, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = UsesTransferQueue() ? 0 : IMAGE_CONSUMER_ACCESS;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcQueueFamilyIndex = UsesTransferQueue() ? m_transferFamily : VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = UsesTransferQueue() ? m_graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+    m_imageBarriers.push_back(barrier);
+
+    ++m_stats.uploads;
+    m_stats.bytes += size;
+  }
+
+  uint64_t ArkUploadManager::Flush()
+  {
+    if (!m_recording)
+    {
+      Retire(false);
+      return 0;
+    }
+    std::unique_ptr<Batch> batch = std::move(m_recording);
+
+    // One barrier for everything in the batch: makes the copies visible, or releases the destinations
+    const auto bufferBarrierCount = static_cast<uint32_t>(m_bufferBarriers.size());
+    const auto imageBarrierCount = static_cast<uint32_t>(m_imageBarriers.size());
+    vkCmdPipelineBarrier(batch->transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         UsesTransferQueue() ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : CONSUMER_STAGES, 0, 0, nullptr,
+                         bufferBarrierCount, m_bufferBarriers.data(), imageBarrierCount, m_imageBarriers.data());
+    vkEndCommandBuffer(batch->transferCommands);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch->transferCommands;
+
+    if (UsesTransferQueue())
+    {
+      submitInfo.signalSemaphoreCount = 1;
+      submitInfo.pSignalSemaphores = &batch->transferDone;
+      if (vkQueueSubmit(m_transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+      {
+        throw std::runtime_error("failed to submit upload command buffer!");
+      }
+
+      // Matching acquires on the graphics queue, which the frame's draws are ordered after
+      for (auto& barrier : m_bufferBarriers)
+      {
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = BUFFER_CONSUMER_ACCESS;
+      }
+      for (auto& barrier : m_imageBarriers)
+      {
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = IMAGE_CONSUMER_ACCESS;
+      }
+      VkCommandBufferBeginInfo beginInfo{};
+      beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+      beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+      vkBeginCommandBuffer(batch->graphicsCommands, &beginInfo);
+      vkCmdPipelineBarrier(batch->graphicsCommands, CONSUMER_STAGES, CONSUMER_STAGES, 0, 0, nullptr,
+                           bufferBarrierCount, m_bufferBarriers.data(), imageBarrierCount, m_imageBarriers.data());
+      vkEndCommandBuffer(batch->graphicsCommands);
+
+      const VkPipelineStageFlags waitStage = CONSUMER_STAGES;
+      submitInfo.waitSemaphoreCount = 1;
+      submitInfo.pWaitSemaphores = &batch->transferDone;
+      submitInfo.pWaitDstStageMask = &waitStage;
+      submitInfo.signalSemaphoreCount = 0;
+      submitInfo.pSignalSemaphores = nullptr;
+      submitInfo.pCommandBuffers = &batch->graphicsCommands;
+    }
+    if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, batch->fence) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to submit upload command buffer!");
+    }
+
+    m_bufferBarriers.clear();
+    m_imageBarriers.clear();
+    batch->ticket = m_nextTicket++;
+    batch->ringEnd = m_ringHead;
+    const uint64_t ticket = batch->ticket;
+    m_inFlight.push_back(std::move(batch));
+    ++m_stats.batches;
+
+    Retire(false);
+    return ticket;
+  }
+
+  bool ArkUploadManager::IsComplete(uint64_t ticket)
+  {
+    Retire(false);
+    return ticket <= m_retiredTicket;
+  }
+
+  void ArkUploadManager::Wait(uint64_t ticket)
+  {
+    while (!IsComplete(ticket) && !m_inFlight.empty())
+    {
+      Retire(true);
+    }
+  }
+
+  void ArkUploadManager::WaitIdle()
+  {
+    Flush();
+    while (!m_inFlight.empty())
+    {
+      Retire(true);
+    }
+  }
+
+  ArkUploadManager::Batch& ArkUploadManager::CurrentBatch()
+  {
+    if (m_recording)
+    {
+      return *m_recording;
+    }
+
+    if (m_inFlight.size() >= MAX_BATCHES_IN_FLIGHT)
+    {
+      Retire(true);
+    }
+    if (m_freeBatches.empty())
+    {
+      auto batch = std::make_unique<Batch>();
+      VkDevice device = m_arkDevice.Device();
+
+      VkCommandBufferAllocateInfo allocInfo{};
+      allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+      allocInfo.commandPool = m_transferPool;
+      allocInfo.commandBufferCount = 1;
+      vkAllocateCommandBuffers(device, &allocInfo, &batch->transferCommands);
+      if (UsesTransferQueue())
+      {
+        allocInfo.commandPool = m_graphicsPool;
+        vkAllocateCommandBuffers(device, &allocInfo, &batch->graphicsCommands);
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        vkCreateSemaphore(device, &semaphoreInfo, nullptr, &batch->transferDone);
+      }
+
+      VkFenceCreateInfo fenceInfo{};
+      fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+      if (vkCreateFence(device, &fenceInfo, nullptr, &batch->fence) != VK_SUCCESS)
+      {
+        throw std::runtime_error("failed to create upload fence!");
+      }
+      m_freeBatches.push_back(std::move(batch));
+    }
+
+    m_recording = std::move(m_freeBatches.back());
+    m_freeBatches.pop_back();
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(m_recording->transferCommands, &beginInfo);
+    return *m_recording;
+  }
+
+  std::pair<VkBuffer, VkDeviceSize> ArkUploadManager::Stage(const void* data, VkDeviceSize size)
+  {
+    // Anything this large would keep draining the ring, it gets a staging buffer of its own
+    if (size > STAGING_RING_SIZE / 2)
+    {
+      VkBuffer buffer;
+      ArkAllocation allocation;
+      m_arkDevice.CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer,
+                               allocation);
+      memcpy(allocation.mapped, data, static_cast<size_t>(size));
+      CurrentBatch().oversized.emplace_back(buffer, allocation);
+      return {buffer, 0};
+    }
+
+    const VkDeviceSize offset = AllocateStaging(size);
+    // After the allocation, which may have flushed the batch that was recording
+    CurrentBatch().stagedInRing = true;
+    memcpy(static_cast<char*>(m_stagingAllocation.mapped) + offset, data, static_cast<size_t>(size));
+    return {m_stagingBuffer, offset};
+  }
+
+  VkDeviceSize ArkUploadManager::AllocateStaging(VkDeviceSize size)
+  {
+    VkDeviceSize offset;
+    while (!TryAllocateStaging(size, offset))
+    {
+      // Submit what is staged so far, then wait for the oldest batch to hand its space back
+      Flush();
+      Retire(true);
+      ++m_stats.stalls;
+    }
+    return offset;
+  }
+
+  bool ArkUploadManager::TryAllocateStaging(VkDeviceSize size, VkDeviceSize& offset)
+  {
+    if (m_ringFull)
+    {
+      return false;
+    }
+
+    const VkDeviceSize start = AlignUp(m_ringHead, m_stagingAlignment);
+    if (m_ringHead >= m_ringTail)
+    {
+      // Free space is [head, end) and [0, tail). A wrap skips the rest of the end, it retires with this batch.
+      if (start + size <= STAGING_RING_SIZE)
+      {
+        offset = start;
+      }
+      else if (size <= m_ringTail)
+      {
+        offset = 0;
+      }
+      else
+      {
+        return false;
+      }
+    }
+    else
+    {
+      if (start + size > m_ringTail)
+      {
+        return false;
+      }
+      offset = start;
+    }
+
+    m_ringHead = offset + size;
+    m_ringFull = m_ringHead == m_ringTail;
+    return true;
+  }
+
+  void ArkUploadManager::Retire(bool waitForOldest)
+  {
+    VkDevice device = m_arkDevice.Device();
+    if (waitForOldest && !m_inFlight.empty())
+    {
+      vkWaitForFences(device, 1, &m_inFlight.front()->fence, VK_TRUE, UINT64_MAX);
+    }
+
+    // Batches finish in submission order, so the first unfinished one ends the scan
+    while (!m_inFlight.empty() && vkGetFenceStatus(device, m_inFlight.front()->fence) == VK_SUCCESS)
+    {
+      std::unique_ptr<Batch> batch = std::move(m_inFlight.front());
+      m_inFlight.pop_front();
+
+      // A batch that filled the ring up to the tail ends where the tail already is, it still frees the ring
+      if (batch->stagedInRing)
+      {
+        m_ringTail = batch->ringEnd;
+        m_ringFull = false;
+      }
+      batch->stagedInRing = false;
+      for (auto& [buffer, allocation] : batch->oversized)
+      {
+        vkDestroyBuffer(device, buffer, nullptr);
+        m_arkDevice.Allocator().Free(allocation);
+      }
+      batch->oversized.clear();
+      vkResetFences(device, 1, &batch->fence);
+      m_retiredTicket = batch->ticket;
+      m_freeBatches.push_back(std::move(batch));
+    }
+
+    // Restart from the front once drained so uploads do not needlessly wrap. Batches still in flight would move
+    // the tail back to their old ring end.
+    if (m_inFlight.empty() && !m_ringFull && m_ringHead == m_ringTail)
+    {
+      m_ringHead = 0;
+      m_ringTail = 0;
+    }
+  }
+}
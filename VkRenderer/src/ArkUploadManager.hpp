@@ -0,0 +1,109 @@
+#pragma once
+
+#include "ArkDevice.hpp"
+
+// std
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Ark
+{
+  // Batches staging copies, and the layout transitions around them, into one submission per Flush instead of one
+  // blocking single-time command buffer each. Data is staged in a persistently mapped ring buffer whose space is
+  // retired once the fence of the batch using it signals. On devices with a dedicated transfer queue the copies run
+  // there and ownership of the destinations is handed over to the graphics queue.
+  class ArkUploadManager
+  {
+  public:
+    static constexpr VkDeviceSize STAGING_RING_SIZE = 32ull * 1024 * 1024;
+    static constexpr size_t MAX_BATCHES_IN_FLIGHT = 4;
+
+    struct Stats
+    {
+      uint64_t batches{0};
+      uint64_t uploads{0};
+      uint64_t bytes{0};
+      // Uploads that had to wait for an earlier batch to free ring space
+      uint64_t stalls{0};
+    };
+
+    explicit ArkUploadManager(ArkDevice& device);
+    ~ArkUploadManager();
+
+    ArkUploadManager(const ArkUploadManager&) = delete;
+    ArkUploadManager& operator=(const ArkUploadManager&) = delete;
+
+    // Queues a copy of size bytes from data into dst at dstOffset. data can be released once this returns.
+    void UploadBuffer(VkBuffer dst, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+    // Queues a copy of tightly packed texels into mip 0 of the first layerCount layers of image, which goes from
+    // VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    void UploadImage(VkImage image, const void* data, VkDeviceSize size, VkExtent3D extent, uint32_t layerCount = 1);
+
+    // Submits everything queued since the last flush and returns its ticket, or 0 if nothing was queued. Graphics
+    // queue work submitted afterwards sees the uploaded data without waiting on the ticket.
+    uint64_t Flush();
+    bool IsComplete(uint64_t ticket);
+    void Wait(uint64_t ticket);
+    // Flushes and waits for every batch
+    void WaitIdle();
+
+    bool UsesTransferQueue() const { return m_transferQueue != m_graphicsQueue; }
+    const Stats& GetStats() const { return m_stats; }
+
+  private:
+    struct Batch
+    {
+      VkCommandBuffer transferCommands = VK_NULL_HANDLE;
+      // Acquires ownership on the graphics queue, only used with a dedicated transfer queue
+      VkCommandBuffer graphicsCommands = VK_NULL_HANDLE;
+      VkSemaphore transferDone = VK_NULL_HANDLE;
+      VkFence fence = VK_NULL_HANDLE;
+      uint64_t ticket = 0;
+      // Ring offset just past the staging data of this batch, only meaningful if it staged any there
+      VkDeviceSize ringEnd = 0;
+      bool stagedInRing = false;
+      // Staging buffers of uploads larger than the ring
+      std::vector<std::pair<VkBuffer, ArkAllocation>> oversized{};
+    };
+
+    Batch& CurrentBatch();
+    // Returns the ring offset of size free bytes, waiting for batches in flight to retire if needed
+    VkDeviceSize AllocateStaging(VkDeviceSize size);
+    bool TryAllocateStaging(VkDeviceSize size, VkDeviceSize& offset);
+    // Stages data, either in the ring or in a one-off buffer, and returns the buffer and offset to copy from
+    std::pair<VkBuffer, VkDeviceSize> Stage(const void* data, VkDeviceSize size);
+    // Releases the staging space of every finished batch, oldest first
+    void Retire(bool waitForOldest);
+
+    ArkDevice& m_arkDevice;
+    VkQueue m_graphicsQueue;
+    VkQueue m_transferQueue;
+    uint32_t m_graphicsFamily;
+    uint32_t m_transferFamily;
+    VkCommandPool m_transferPool = VK_NULL_HANDLE;
+    VkCommandPool m_graphicsPool = VK_NULL_HANDLE;
+    // Offset alignment of staged data, valid for buffer and image copies
+    VkDeviceSize m_stagingAlignment;
+
+    VkBuffer m_stagingBuffer = VK_NULL_HANDLE;
+    ArkAllocation m_stagingAllocation{};
+    // Data is written at head and retired from tail. Equal offsets mean an empty ring unless m_ringFull.
+    VkDeviceSize m_ringHead{0};
+    VkDeviceSize m_ringTail{0};
+    bool m_ringFull{false};
+
+    std::unique_ptr<Batch> m_recording{};
+    // Barriers recorded at the end of the batch being recorded. With a dedicated transfer queue they release
+    // ownership and are mirrored by acquires on the graphics queue.
+    std::vector<VkBufferMemoryBarrier> m_bufferBarriers{};
+    std::vector<VkImageMemoryBarrier> m_imageBarriers{};
+    std::deque<std::unique_ptr<Batch>> m_inFlight{};
+    std::vector<std::unique_ptr<Batch>> m_freeBatches{};
+    uint64_t m_nextTicket{1};
+    uint64_t m_retiredTicket{0};
+    Stats m_stats{};
+  };
+}
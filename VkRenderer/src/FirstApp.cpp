@@ -1,7 +1,10 @@
 #include "FirstApp.hpp"
 #include "ArkCamera.hpp"
 #include "ArkBuffer.hpp"
+#include "ArkUploadManager.hpp"
+#include "ArkPipelineCache.hpp"
 #include "systems/SimpleRenderSystem.hpp"
+#include "systems/GpuDrivenRenderSystem.hpp"
 #include "systems/PointLightSystem.hpp"
 //libs
 //#define GLM_FORCE_RADIANS
@@ -10,7 +13,13 @@
 #include <glm/gtc/constants.hpp>
 
 //std
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <iostream>
+#include <numeric>
 #include <stdexcept>
 
 #include "InputController.hpp"
@@ -19,23 +28,38 @@
 
 namespace Ark
 {
-  FirstApp::FirstApp()
+  namespace
+  {
+    enum RenderPath : size_t
+    {
+      PER_OBJECT_SETS, INSTANCED, BINDLESS, BINDLESS_INSTANCED, GPU_DRIVEN, RENDER_PATH_COUNT
+    };
+
+    const char* RENDER_PATH_NAMES[RENDER_PATH_COUNT] = {
+      "per object sets", "instanced", "bindless", "bindless instanced", "GPU driven"
+    };
+  }
+
+  FirstApp::FirstApp(uint32_t benchmarkObjectCount) : m_benchmarkObjectCount{benchmarkObjectCount}
   {
     m_globalPool = ArkDescriptorPool::Builder(m_arkDevice)
                    .SetMaxSets(ArkSwapChain::MAX_FRAMES_IN_FLIGHT)
                    .AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, ArkSwapChain::MAX_FRAMES_IN_FLIGHT)
                    .Build();
-    m_framePools.resize(ArkSwapChain::MAX_FRAMES_IN_FLIGHT);
-    auto framePoolBuilder = ArkDescriptorPool::Builder(m_arkDevice)
-                            .SetMaxSets(1000)
-                            .AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000)
-                            .AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000)
-                            .SetPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
-    for (uint32_t i = 0; i < m_framePools.size(); i++)
-    {
-      m_framePools[i] = framePoolBuilder.Build();
+    if (m_arkDevice.SupportsDescriptorIndexing())
+    {
+      m_bindlessResources = std::make_unique<ArkBindlessResources>(m_arkDevice, ArkSwapChain::MAX_FRAMES_IN_FLIGHT);
+    }
+    if (m_benchmarkObjectCount > 0)
+    {
+      LoadBenchmarkObjects(m_benchmarkObjectCount);
+    }
+    else
+    {
+      LoadGameObjects();
     }
-    LoadGameObjects();
+    // One submission for every buffer and texture the scene loaded
+    m_arkDevice.Uploader().Flush();
   }
 
   FirstApp::~FirstApp()
@@ -69,12 +93,77 @@ namespace Ark
         .Build(globalDescriptorSets[i]);
     }
 
-    SimpleRenderSystem simpleRenderSystem{
-      m_arkDevice, m_arkRenderer.GetSwapChainRenderPass(), globalSetLayout->GetDescriptorSetLayout()
-    };
-    PointLightSystem pointLightSystem{
-      m_arkDevice, m_arkRenderer.GetSwapChainRenderPass(), globalSetLayout->GetDescriptorSetLayout()
-    };
+    // Every system builds its pipelines on a worker thread of its own, through the device's pipeline cache
+    const VkRenderPass renderPass = m_arkRenderer.GetSwapChainRenderPass();
+    const VkDescriptorSetLayout globalLayout = globalSetLayout->GetDescriptorSetLayout();
+    const bool gpuDriven = m_bindlessResources && m_arkDevice.SupportsMultiDrawIndirect();
+    const auto pipelineStart = std::chrono::high_resolution_clock::now();
+    auto simpleFuture = std::async(std::launch::async, [&]()
+    {
+      return std::make_unique<SimpleRenderSystem>(m_arkDevice, renderPass, globalLayout);
+    });
+    auto instancedFuture = std::async(std::launch::async, [&]()
+    {
+      return std::make_unique<SimpleRenderSystem>(m_arkDevice, renderPass, globalLayout, nullptr, true);
+    });
+    auto bindlessFuture = std::async(std::launch::async, [&]()
+    {
+      return m_bindlessResources
+               ? std::make_unique<SimpleRenderSystem>(m_arkDevice, renderPass, globalLayout,
+                                                      m_bindlessResources.get())
+               : nullptr;
+    });
+    auto bindlessInstancedFuture = std::async(std::launch::async, [&]()
+    {
+      return m_bindlessResources
+               ? std::make_unique<SimpleRenderSystem>(m_arkDevice, renderPass, globalLayout,
+                                                      m_bindlessResources.get(), true)
+               : nullptr;
+    });
+    auto gpuDrivenFuture = std::async(std::launch::async, [&]()
+    {
+      return gpuDriven
+               ? std::make_unique<GpuDrivenRenderSystem>(m_arkDevice, renderPass, globalLayout,
+                                                         *m_bindlessResources, m_meshBuffer)
+               : nullptr;
+    });
+    auto pointLightFuture = std::async(std::launch::async, [&]()
+    {
+      return std::make_unique<PointLightSystem>(m_arkDevice, renderPass, globalLayout);
+    });
+    const std::unique_ptr<SimpleRenderSystem> simpleRenderSystem = simpleFuture.get();
+    const std::unique_ptr<SimpleRenderSystem> instancedRenderSystem = instancedFuture.get();
+    const std::unique_ptr<SimpleRenderSystem> bindlessRenderSystem = bindlessFuture.get();
+    const std::unique_ptr<SimpleRenderSystem> bindlessInstancedRenderSystem = bindlessInstancedFuture.get();
+    const std::unique_ptr<GpuDrivenRenderSystem> gpuDrivenRenderSystem = gpuDrivenFuture.get();
+    const std::unique_ptr<PointLightSystem> pointLightSystem = pointLightFuture.get();
+    const auto pipelineStats = m_arkDevice.PipelineCache().GetStats();
+    const double pipelineMilliseconds = std::chrono::duration<double, std::milli>(
+      std::chrono::high_resolution_clock::now() - pipelineStart).count();
+    std::cout << "Pipelines: " << pipelineStats.pipelines << " created in " << pipelineMilliseconds << " ms, "
+      << pipelineStats.creationMilliseconds << " ms summed over threads, "
+      << (pipelineStats.loadedBytes > 0 ? "warm" : "cold") << " cache\n";
+    // Early, so the next launch starts warm even if this one does not exit cleanly
+    m_arkDevice.PipelineCache().Save();
+
+    std::vector<RenderPath> renderPaths{PER_OBJECT_SETS, INSTANCED};
+    if (bindlessRenderSystem)
+    {
+      renderPaths.push_back(BINDLESS);
+      renderPaths.push_back(BINDLESS_INSTANCED);
+    }
+    if (gpuDrivenRenderSystem)
+    {
+      renderPaths.push_back(GPU_DRIVEN);
+    }
+    // B cycles through the available paths, starting from the last one
+    size_t activePath = renderPaths.size() - 1;
+    // Everything the scene needs is resident by now
+    m_arkDevice.Allocator().PrintReport(std::cout);
+    const auto& uploadStats = m_arkDevice.Uploader().GetStats();
+    std::cout << "Uploads: " << uploadStats.uploads << " (" << uploadStats.bytes / 1024 << " KiB) in "
+      << uploadStats.batches << " submissions, " << uploadStats.stalls << " staging stalls, "
+      << (m_arkDevice.Uploader().UsesTransferQueue() ? "transfer" : "graphics") << " queue\n";
     ArkCamera camera{
       glm::vec3(.0f, .0f, -2.5f), glm::vec3(0.f, 0.f, 0.f), glm::radians(70.0f),
       m_arkRenderer.GetAspectRatio(), 0.1f, 100.0f
@@ -85,6 +174,16 @@ namespace Ark
       hasOneSecondPassed = true;
     });
     unsigned int numFramesRendered{0};
+    // Per path totals over the benchmark frames, which run each available path in turn
+    uint32_t benchmarkFrame{0};
+    std::array<double, RENDER_PATH_COUNT> benchmarkRecordMilliseconds{};
+    std::array<double, RENDER_PATH_COUNT> benchmarkFrameSeconds{};
+    std::array<size_t, RENDER_PATH_COUNT> benchmarkSetBinds{};
+    std::array<size_t, RENDER_PATH_COUNT> benchmarkDrawCalls{};
+    if (m_benchmarkObjectCount > 0)
+    {
+      activePath = 0;
+    }
     while (!m_window.ShouldClose())
     {
       double frameTime = 0.0;
@@ -103,58 +202,265 @@ namespace Ark
       InputManager::GetInstance().Update();
       m_window.Update();
       camera.Update(dt);
+      if (renderPaths.size() > 1 && InputManager::GetInstance().IsKeyPressed(GLFW_KEY_B))
+      {
+        activePath = (activePath + 1) % renderPaths.size();
+        std::cout << "Render path: " << RENDER_PATH_NAMES[renderPaths[activePath]] << "\n";
+      }
+      // Submits uploads queued since the last frame ahead of it, and retires finished staging space
+      m_arkDevice.Uploader().Flush();
       if (auto commandBuffer = m_arkRenderer.BeginFrame())
       {
         int frameIndex = m_arkRenderer.GetFrameIndex();
-        m_framePools[frameIndex]->ResetPool();
+        m_descriptorCache.NextFrame();
         FrameInfo frameInfo{
           frameIndex,
           frameTime,
           commandBuffer,
           camera,
           globalDescriptorSets[frameIndex],
-          *m_framePools[frameIndex],
-          m_gameObjectManager.m_gameObjects
+          m_descriptorCache,
+          m_gameObjectManager.GetObjects()
         };
         // update
+        const size_t transformsUpdated = m_gameObjectManager.UpdateTransforms();
+        m_gameObjectManager.UpdateBuffer(frameIndex);
+        m_gameObjectManager.ReleaseRetiredBuffers(m_descriptorCache);
         GlobalUbo ubo{};
         ubo.projection = camera.GetProjMatrix();
         ubo.view = camera.GetViewMatrix();
         uboBuffers[frameIndex]->WriteToBuffer(&ubo);
         uboBuffers[frameIndex]->Flush();
         // render
+        const RenderPath path = renderPaths[activePath];
+        if (path == GPU_DRIVEN)
+        {
+          // Dispatches can not be recorded inside the render pass
+          gpuDrivenRenderSystem->Cull(frameInfo);
+        }
         m_arkRenderer.BeginSwapChainRenderPass(commandBuffer);
-        simpleRenderSystem.RenderGameObjects(frameInfo);
-        pointLightSystem.Render(frameInfo);
+        double recordMilliseconds;
+        size_t descriptorSetBinds;
+        size_t drawCalls;
+        if (path == GPU_DRIVEN)
+        {
+          gpuDrivenRenderSystem->Render(frameInfo);
+          const auto& renderStats = gpuDrivenRenderSystem->GetRenderStats();
+          recordMilliseconds = renderStats.recordMilliseconds;
+          descriptorSetBinds = renderStats.descriptorSetBinds;
+          drawCalls = renderStats.drawCalls;
+          if (frameTime > 0.0)
+          {
+            std::cout << "GPU culling: " << renderStats.visible << " of " << renderStats.objects << " objects visible, "
+              << renderStats.skipped << " outside the mesh buffer skipped, "
+              << (gpuDrivenRenderSystem->IsCompacting() ? "compacted" : "zero instance") << " draws\n";
+          }
+        }
+        else
+        {
+          const std::array<SimpleRenderSystem*, GPU_DRIVEN> simpleRenderSystems{
+            simpleRenderSystem.get(), instancedRenderSystem.get(), bindlessRenderSystem.get(),
+            bindlessInstancedRenderSystem.get()
+          };
+          auto& renderSystem = *simpleRenderSystems[path];
+          renderSystem.RenderGameObjects(frameInfo);
+          const auto& renderStats = renderSystem.GetRenderStats();
+          recordMilliseconds = renderStats.recordMilliseconds;
+          descriptorSetBinds = renderStats.descriptorSetBinds;
+          drawCalls = renderStats.drawCalls;
+          if (frameTime > 0.0)
+          {
+            std::cout << "Frustum culling: " << renderStats.visible << " objects visible, " << renderStats.culled
+              << " culled\n";
+            std::cout << "Render queue: " << renderStats.visible << " draws sorted, " << renderStats.vertexBufferBinds
+              << " vertex buffer binds, " << renderStats.bindsAvoided << " redundant binds skipped\n";
+          }
+        }
+        if (frameTime > 0.0)
+        {
+          std::cout << "Render path " << RENDER_PATH_NAMES[path] << ": " << descriptorSetBinds << " set binds, "
+            << drawCalls << " draw calls, " << recordMilliseconds << " ms recording\n";
+          const auto& descriptors = m_descriptorCache.GetStats();
+          std::cout << "Transforms: " << transformsUpdated << " of " << m_gameObjectManager.GetObjectCount()
+            << " objects updated\n";
+          std::cout << "Descriptor sets: " << descriptors.requests << " requested, " << descriptors.allocations
+            << " allocated, " << descriptors.updates << " updated, " << descriptors.cachedSets << " cached\n";
+        }
+        pointLightSystem->Render(frameInfo);
         m_arkRenderer.EndSwapChainRenderPass(commandBuffer);
         m_arkRenderer.EndFrame();
+
+        const uint32_t benchmarkLength = static_cast<uint32_t>(renderPaths.size()) * BENCHMARK_FRAMES;
+        if (m_benchmarkObjectCount > 0 && benchmarkFrame < benchmarkLength)
+        {
+          benchmarkRecordMilliseconds[path] += recordMilliseconds;
+          benchmarkFrameSeconds[path] += dt;
+          benchmarkSetBinds[path] += descriptorSetBinds;
+          benchmarkDrawCalls[path] += drawCalls;
+          if (++benchmarkFrame == benchmarkLength)
+          {
+            std::cout << "Benchmark, " << m_gameObjectManager.GetObjectCount() << " objects, "
+              << BENCHMARK_FRAMES << " frames per path:\n";
+            for (const RenderPath benchmarked : renderPaths)
+            {
+              std::cout << "\t" << RENDER_PATH_NAMES[benchmarked] << ": "
+                << benchmarkRecordMilliseconds[benchmarked] / BENCHMARK_FRAMES << " ms recording, "
+                << 1000.0 * benchmarkFrameSeconds[benchmarked] / BENCHMARK_FRAMES << " ms frame, "
+                << benchmarkSetBinds[benchmarked] / BENCHMARK_FRAMES << " set binds and "
+                << benchmarkDrawCalls[benchmarked] / BENCHMARK_FRAMES << " draw calls per frame\n";
+            }
+            if (renderPaths.size() < RENDER_PATH_COUNT)
+            {
+              std::cout << "\t" << RENDER_PATH_COUNT - renderPaths.size()
+                << " path(s) skipped, the device lacks descriptor indexing or multi draw indirect\n";
+            }
+          }
+          else if (benchmarkFrame % BENCHMARK_FRAMES == 0)
+          {
+            activePath++;
+          }
+        }
       }
       ++numFramesRendered;
     }
     vkDeviceWaitIdle(m_arkDevice.Device());
   }
 
+  void FirstApp::RunTransformBenchmark(uint32_t objectCount)
+  {
+    objectCount = std::max<uint32_t>(std::min<uint32_t>(objectCount, ArkGameObjectManager::MAX_GAME_OBJECTS), 1);
+    ArkTransformStore store{};
+    store.Reserve(objectCount);
+    for (uint32_t i = 0; i < objectCount; i++)
+    {
+      TransformComponent transform{};
+      transform.translation = {static_cast<float>(i % 100), static_cast<float>(i / 100), 20.0f};
+      transform.rotation = {0.003f * i, 0.007f * i, 0.0f};
+      transform.scale = glm::vec3{0.5f + 0.001f * (i % 1000)};
+      store.Add(transform);
+    }
+    std::vector<uint32_t> indices(objectCount);
+    std::iota(indices.begin(), indices.end(), 0);
+    std::vector<glm::mat4> referenceModels(objectCount), referenceNormals(objectCount);
+    std::vector<glm::mat4> kernelModels(objectCount), kernelNormals(objectCount);
+
+    auto milliseconds = [](auto&& work)
+    {
+      const auto start = std::chrono::high_resolution_clock::now();
+      work();
+      return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    };
+    auto dirtyEvery = [&](uint32_t stride)
+    {
+      for (uint32_t i = 0; i < objectCount; i += stride)
+      {
+        store.SetRotation(i, store.GetRotation(i) + glm::vec3{0.01f});
+      }
+    };
+
+    double reference = 0.0, kernel = 0.0, updateAll = 0.0, updateTenth = 0.0, updateNone = 0.0;
+    size_t tenthCount = 0;
+    for (uint32_t iteration = 0; iteration < TRANSFORM_BENCHMARK_ITERATIONS; iteration++)
+    {
+      const auto arrays = store.GetArrays();
+      reference += milliseconds([&]()
+      {
+        ArkTransformKernel::ComputeScalar(arrays, indices.data(), objectCount, referenceModels.data(),
+                                          referenceNormals.data());
+      });
+      kernel += milliseconds([&]()
+      {
+        ArkTransformKernel::Compute(arrays, indices.data(), objectCount, kernelModels.data(), kernelNormals.data());
+      });
+      dirtyEvery(1);
+      updateAll += milliseconds([&]() { store.UpdateMatrices(); });
+      dirtyEvery(10);
+      updateTenth += milliseconds([&]() { tenthCount = store.UpdateMatrices(); });
+      updateNone += milliseconds([&]() { store.UpdateMatrices(); });
+    }
+
+    float maxError = 0.0f;
+    for (uint32_t i = 0; i < objectCount; i++)
+    {
+      for (int column = 0; column < 4; column++)
+      {
+        const glm::vec4 modelError = glm::abs(referenceModels[i][column] - kernelModels[i][column]);
+        const glm::vec4 normalError = glm::abs(referenceNormals[i][column] - kernelNormals[i][column]);
+        maxError = std::max({maxError, modelError.x, modelError.y, modelError.z, modelError.w, normalError.x,
+                             normalError.y, normalError.z, normalError.w});
+      }
+    }
+
+    const double iterations = TRANSFORM_BENCHMARK_ITERATIONS;
+    auto objectsPerMillisecond = [&](double totalMilliseconds, size_t count)
+    {
+      return static_cast<double>(count) * iterations / std::max(totalMilliseconds, 1e-6);
+    };
+    std::cout << "Transform benchmark, " << objectCount << " objects, " << TRANSFORM_BENCHMARK_ITERATIONS
+      << " iterations:\n";
+    std::cout << "\tscalar reference: " << reference / iterations << " ms, "
+      << objectsPerMillisecond(reference, objectCount) << " objects/ms\n";
+    std::cout << "\t" << ArkTransformKernel::GetInstructionSet() << " kernel: " << kernel / iterations << " ms, "
+      << objectsPerMillisecond(kernel, objectCount) << " objects/ms, max difference " << maxError << "\n";
+    std::cout << "\tall dirty: " << updateAll / iterations << " ms, " << objectsPerMillisecond(updateAll, objectCount)
+      << " objects/ms\n";
+    std::cout << "\t" << tenthCount << " dirty: " << updateTenth / iterations << " ms, "
+      << objectsPerMillisecond(updateTenth, tenthCount) << " objects/ms\n";
+    std::cout << "\tnone dirty: " << updateNone / iterations << " ms\n";
+  }
+
   void FirstApp::LoadGameObjects()
   {
-    std::shared_ptr<ArkModel> arkModel = ArkModel::CreateModelFromFile(m_arkDevice, "models/smooth_vase.obj");
+    std::shared_ptr<ArkModel> arkModel = ArkModel::CreateModelFromFile(m_arkDevice, "models/smooth_vase.obj",
+                                                                            m_meshBuffer);
     auto& gameObj = m_gameObjectManager.CreateGameObject();
     gameObj.m_model = arkModel;
-    gameObj.m_transform.translation = {-0.5f, 0.5f, 0.0f};
-    gameObj.m_transform.scale = {1.5f, 1.5f, 1.5f};
+    gameObj.SetTranslation({-0.5f, 0.5f, 0.0f});
+    gameObj.SetScale({1.5f, 1.5f, 1.5f});
 
     auto& gameObj2 = m_gameObjectManager.CreateGameObject();
-    arkModel = ArkModel::CreateModelFromFile(m_arkDevice, "models/flat_vase.obj");
+    arkModel = ArkModel::CreateModelFromFile(m_arkDevice, "models/flat_vase.obj", m_meshBuffer);
     gameObj2.m_model = arkModel;
-    gameObj2.m_transform.translation = {0.5f, 0.5f, 0.0f};
-    gameObj2.m_transform.scale = {1.5f, 1.5f, 1.5f};
+    gameObj2.SetTranslation({0.5f, 0.5f, 0.0f});
+    gameObj2.SetScale({1.5f, 1.5f, 1.5f});
 
 
-    arkModel = ArkModel::CreateModelFromFile(m_arkDevice, "models/quad.obj");
+    arkModel = ArkModel::CreateModelFromFile(m_arkDevice, "models/quad.obj", m_meshBuffer);
     std::shared_ptr texture = Texture::CreateTextureFromFile(m_arkDevice, "textures/missing.png");
     auto& floor = m_gameObjectManager.CreateGameObject();;
     floor.m_model = arkModel;
     floor.m_diffuseMap = texture;
-    floor.m_transform.translation = {0.5f, 0.5f, 0.0f};
-    floor.m_transform.scale = {3.f, 1.f, 3.f};
+    floor.SetTranslation({0.5f, 0.5f, 0.0f});
+    floor.SetScale({3.f, 1.f, 3.f});
+  }
+
+  void FirstApp::LoadBenchmarkObjects(uint32_t count)
+  {
+    // Distinct textures, so the per object path really changes its sets from draw to draw
+    std::vector<std::shared_ptr<Texture>> textures(BENCHMARK_TEXTURE_COUNT);
+    for (auto& texture : textures)
+    {
+      texture = Texture::CreateTextureFromFile(m_arkDevice, "textures/missing.png");
+    }
+    std::shared_ptr<ArkModel> cube = ArkModel::CreateModelFromFile(m_arkDevice, "models/cube.obj",
+                                                                        m_meshBuffer);
+
+    count = std::min<uint32_t>(count, ArkGameObjectManager::MAX_GAME_OBJECTS);
+    const auto side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(count))));
+    const float spacing = 30.0f / side;
+    m_gameObjectManager.Reserve(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+      TransformComponent transform{};
+      transform.translation = {
+        (static_cast<float>(i % side) - 0.5f * side) * spacing, (static_cast<float>(i / side) - 0.5f * side) * spacing,
+        20.0f
+      };
+      transform.scale = glm::vec3{0.3f * spacing};
+      transform.rotation = {0.3f * i, 0.7f * i, 0.0f};
+      auto& obj = m_gameObjectManager.CreateGameObject(transform);
+      obj.m_model = cube;
+      obj.m_diffuseMap = textures[i % textures.size()];
+    }
   }
 }
@@ -4,6 +4,8 @@
 #include "ArkDevice.hpp"
 #include "ArkRenderer.hpp"
 #include "ArkDescriptors.hpp"
+#include "ArkBindless.hpp"
+#include "ArkMeshBuffer.hpp"
 #include <memory>
 
 namespace Ark
@@ -13,20 +15,41 @@ namespace Ark
   public:
     static constexpr int WIDTH = 800;
     static constexpr int HEIGHT = 600;
-    FirstApp();
+    static constexpr uint32_t BENCHMARK_TEXTURE_COUNT = 16;
+    // Frames measured per render path before the benchmark summary
+    static constexpr uint32_t BENCHMARK_FRAMES = 500;
+    // Repetitions of each case of the transform benchmark
+    static constexpr uint32_t TRANSFORM_BENCHMARK_ITERATIONS = 20;
+
+    // Capacity of the mesh buffer every model is loaded into
+    static constexpr uint32_t MESH_BUFFER_VERTICES = 512 * 1024;
+    static constexpr uint32_t MESH_BUFFER_INDICES = 2 * 1024 * 1024;
+
+    // With benchmarkObjectCount > 0, the scene is a grid of that many textured cubes and the first frames compare
+    // per object descriptor sets with instancing and the bindless and GPU driven paths
+    explicit FirstApp(uint32_t benchmarkObjectCount = 0);
     ~FirstApp();
 
     FirstApp(const FirstApp&) = delete;
     FirstApp& operator=(const FirstApp&) = delete;
     void Run();
+    // Measures transform update throughput on objectCount objects: the scalar reference against the vectorized
+    // kernel, and dirty tracked updates. Needs no window or device.
+    static void RunTransformBenchmark(uint32_t objectCount);
   private:
     void LoadGameObjects();
+    void LoadBenchmarkObjects(uint32_t count);
     WindowSystem m_window{WIDTH, HEIGHT, "Hello Vulkan!"};
     ArkDevice m_arkDevice{m_window};
     ArkRenderer m_arkRenderer{m_window, m_arkDevice};
 
     std::unique_ptr<ArkDescriptorPool> m_globalPool{};
-    std::vector<std::unique_ptr<ArkDescriptorPool>> m_framePools;
+    ArkDescriptorCache m_descriptorCache{m_arkDevice, ArkSwapChain::MAX_FRAMES_IN_FLIGHT};
+    // Declared before the game objects, whose models draw from it
+    ArkMeshBuffer m_meshBuffer{m_arkDevice, ArkModel::DEFAULT_LAYOUT, MESH_BUFFER_VERTICES, MESH_BUFFER_INDICES};
     ArkGameObjectManager m_gameObjectManager{ m_arkDevice };
+    // Only created when the device supports descriptor indexing
+    std::unique_ptr<ArkBindlessResources> m_bindlessResources{};
+    uint32_t m_benchmarkObjectCount;
   };
 }
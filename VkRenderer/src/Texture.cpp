@@ -1,4 +1,5 @@
 #include "Texture.hpp"
+#include "ArkUploadManager.hpp"
 
 // libs
 #define STB_IMAGE_IMPLEMENTATION
@@ -59,7 +60,7 @@ namespace Ark
       imageInfo,
       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
       m_textureImage,
-      m_textureImageMemory);
+      m_textureImageAllocation);
 
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -114,7 +115,7 @@ namespace Ark
     vkDestroySampler(m_arkDevice.Device(), m_textureSampler, nullptr);
     vkDestroyImageView(m_arkDevice.Device(), m_textureImageView, nullptr);
     vkDestroyImage(m_arkDevice.Device(), m_textureImage, nullptr);
-    vkFreeMemory(m_arkDevice.Device(), m_textureImageMemory, nullptr);
+    m_arkDevice.Allocator().Free(m_textureImageAllocation);
   }
 
   std::unique_ptr<Texture> Texture::CreateTextureFromFile(
@@ -146,23 +147,6 @@ namespace Ark
     // m_mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
     m_mipLevels = 1;
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-
-    m_arkDevice.CreateBuffer(
-      imageSize,
-      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-      stagingBuffer,
-      stagingBufferMemory);
-
-    void* data;
-    vkMapMemory(m_arkDevice.Device(), stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(m_arkDevice.Device(), stagingBufferMemory);
-
-    stbi_image_free(pixels);
-
     m_format = VK_FORMAT_R8G8B8A8_SRGB;
     m_extent = {static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1};
 
@@ -184,36 +168,14 @@ namespace Ark
       imageInfo,
       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
       m_textureImage,
-      m_textureImageMemory);
-    m_arkDevice.TransitionImageLayout(
-      m_textureImage,
-      VK_FORMAT_R8G8B8A8_SRGB,
-      VK_IMAGE_LAYOUT_UNDEFINED,
-      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-      m_mipLevels,
-      m_layerCount);
-    m_arkDevice.CopyBufferToImage(
-      stagingBuffer,
-      m_textureImage,
-      static_cast<uint32_t>(texWidth),
-      static_cast<uint32_t>(texHeight),
-      m_layerCount);
-
-    // comment this out if using mips
-    m_arkDevice.TransitionImageLayout(
-      m_textureImage,
-      VK_FORMAT_R8G8B8A8_SRGB,
-      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-      m_mipLevels,
-      m_layerCount);
+      m_textureImageAllocation);
+    // Leaves the image in SHADER_READ_ONLY_OPTIMAL once the upload queue is flushed
+    m_arkDevice.Uploader().UploadImage(m_textureImage, pixels, imageSize, m_extent, m_layerCount);
+    stbi_image_free(pixels);
 
     // If we generate mip maps then the final image will alerady be READ_ONLY_OPTIMAL
     // m_arkDevice.generateMipmaps(m_textureImage, m_format, texWidth, texHeight, m_mipLevels);
     m_textureLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-    vkDestroyBuffer(m_arkDevice.Device(), stagingBuffer, nullptr);
-    vkFreeMemory(m_arkDevice.Device(), stagingBufferMemory, nullptr);
   }
 
   void Texture::CreateTextureImageView(VkImageViewType viewType)
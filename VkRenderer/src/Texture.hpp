@@ -52,7 +52,7 @@ namespace Ark
 
     ArkDevice& m_arkDevice;
     VkImage m_textureImage = VK_NULL_HANDLE;
-    VkDeviceMemory m_textureImageMemory = VK_NULL_HANDLE;
+    ArkAllocation m_textureImageAllocation{};
     VkImageView m_textureImageView = VK_NULL_HANDLE;
     VkSampler m_textureSampler = VK_NULL_HANDLE;
     VkFormat m_format;
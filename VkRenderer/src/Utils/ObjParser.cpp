@@ -0,0 +1,392 @@
+#include "ObjParser.hpp"
+
+// std
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Ark
+{
+  namespace
+  {
+    // Files below this size per thread are not worth splitting further
+    constexpr size_t MIN_CHUNK_SIZE = 64 * 1024;
+
+    // Flags marking corner indices that were negative (relative to the end of the chunk-local attribute lists)
+    // and still need the number of attributes declared in earlier chunks added
+    constexpr uint8_t RELATIVE_V = 1 << 0;
+    constexpr uint8_t RELATIVE_VT = 1 << 1;
+    constexpr uint8_t RELATIVE_VN = 1 << 2;
+
+    // Read-only view of a whole file, mapped instead of copied into memory
+    class MappedFile
+    {
+    public:
+      explicit MappedFile(const std::string& path)
+      {
+#ifdef _WIN32
+        m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                             FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+        {
+          throw std::runtime_error("failed to open " + path);
+        }
+        LARGE_INTEGER size{};
+        GetFileSizeEx(m_file, &size);
+        m_size = static_cast<size_t>(size.QuadPart);
+        if (m_size == 0) return;
+
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping == nullptr)
+        {
+          CloseHandle(m_file);
+          throw std::runtime_error("failed to map " + path);
+        }
+        m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+        m_file = open(path.c_str(), O_RDONLY);
+        if (m_file < 0)
+        {
+          throw std::runtime_error("failed to open " + path);
+        }
+        struct stat info{};
+        fstat(m_file, &info);
+        m_size = static_cast<size_t>(info.st_size);
+        if (m_size == 0) return;
+
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+        m_data = data == MAP_FAILED ? nullptr : static_cast<const char*>(data);
+#endif
+        if (m_data == nullptr)
+        {
+          Close();
+          throw std::runtime_error("failed to map " + path);
+        }
+      }
+
+      ~MappedFile()
+      {
+        Close();
+      }
+
+      MappedFile(const MappedFile&) = delete;
+      MappedFile& operator=(const MappedFile&) = delete;
+
+      const char* Data() const { return m_data; }
+      size_t Size() const { return m_size; }
+
+    private:
+      void Close()
+      {
+#ifdef _WIN32
+        if (m_data) UnmapViewOfFile(m_data);
+        if (m_mapping) CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+#else
+        if (m_data) munmap(const_cast<char*>(m_data), m_size);
+        if (m_file >= 0) close(m_file);
+        m_file = -1;
+#endif
+        m_data = nullptr;
+      }
+
+#ifdef _WIN32
+      HANDLE m_file{INVALID_HANDLE_VALUE};
+      HANDLE m_mapping{nullptr};
+#else
+      int m_file{-1};
+#endif
+      const char* m_data{nullptr};
+      size_t m_size{0};
+    };
+
+    struct Chunk
+    {
+      const char* begin{nullptr};
+      const char* end{nullptr};
+      ObjParser::Result result{};
+      std::vector<uint8_t> relativeFlags{};
+      std::exception_ptr error{};
+    };
+
+    bool IsBlank(const char c)
+    {
+      return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    const char* SkipBlanks(const char* p, const char* end)
+    {
+      while (p < end && IsBlank(*p)) ++p;
+      return p;
+    }
+
+    // Parses a float at p, returns false (and leaves p alone) if there is none on this line
+    bool ParseFloat(const char*& p, const char* end, float& out)
+    {
+      p = SkipBlanks(p, end);
+      const char* start = p < end && *p == '+' ? p + 1 : p;
+      const auto [next, ec] = std::from_chars(start, end, out);
+      if (ec != std::errc{}) return false;
+      p = next;
+      return true;
+    }
+
+    // Converts a 1-based or negative OBJ index into a 0-based one. Negative indices are resolved against the
+    // attributes declared so far in this chunk and flagged so the caller can add the earlier chunks later.
+    int32_t ResolveIndex(const int32_t raw, const size_t localCount, uint8_t& flags, const uint8_t relativeBit)
+    {
+      if (raw > 0) return raw - 1;
+      if (raw == 0) throw std::runtime_error("OBJ index 0 is invalid");
+      flags |= relativeBit;
+      return static_cast<int32_t>(localCount) + raw;
+    }
+
+    // Parses "v", "v/vt", "v//vn" or "v/vt/vn"
+    bool ParseCorner(const char*& p, const char* end, const ObjParser::Result& counts, ObjParser::Index& corner,
+                     uint8_t& flags)
+    {
+      p = SkipBlanks(p, end);
+      int32_t raw = 0;
+      auto parsed = std::from_chars(p, end, raw);
+      if (parsed.ec != std::errc{}) return false;
+      p = parsed.ptr;
+      corner = {};
+      corner.v = ResolveIndex(raw, counts.positions.size() / 3, flags, RELATIVE_V);
+
+      if (p < end && *p == '/')
+      {
+        ++p;
+        if (p < end && *p != '/')
+        {
+          parsed = std::from_chars(p, end, raw);
+          if (parsed.ec != std::errc{}) return false;
+          p = parsed.ptr;
+          corner.vt = ResolveIndex(raw, counts.texcoords.size() / 2, flags, RELATIVE_VT);
+        }
+        if (p < end && *p == '/')
+        {
+          ++p;
+          parsed = std::from_chars(p, end, raw);
+          if (parsed.ec != std::errc{}) return false;
+          p = parsed.ptr;
+          corner.vn = ResolveIndex(raw, counts.normals.size() / 3, flags, RELATIVE_VN);
+        }
+      }
+      return true;
+    }
+
+    void ParseChunk(Chunk& chunk)
+    {
+      auto& result = chunk.result;
+      std::vector<ObjParser::Index> polygon;
+      std::vector<uint8_t> polygonFlags;
+
+      const char* p = chunk.begin;
+      while (p < chunk.end)
+      {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+        if (lineEnd == nullptr) lineEnd = chunk.end;
+
+        p = SkipBlanks(p, lineEnd);
+        if (lineEnd - p >= 2 && p[0] == 'v' && IsBlank(p[1]))
+        {
+          p += 2;
+          float value[6] = {0.f, 0.f, 0.f, 1.f, 1.f, 1.f};
+          for (int i = 0; i < 3; ++i) ParseFloat(p, lineEnd, value[i]);
+          // Vertex colors are an extension: either all three are there or none are
+          float color[3];
+          if (ParseFloat(p, lineEnd, color[0]) && ParseFloat(p, lineEnd, color[1]) && ParseFloat(p, lineEnd, color[2]))
+          {
+            std::copy(color, color + 3, value + 3);
+          }
+          result.positions.insert(result.positions.end(), value, value + 3);
+          result.colors.insert(result.colors.end(), value + 3, value + 6);
+        }
+        else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 't' && IsBlank(p[2]))
+        {
+          p += 3;
+          float uv[2] = {0.f, 0.f};
+          for (auto& value : uv) ParseFloat(p, lineEnd, value);
+          result.texcoords.insert(result.texcoords.end(), uv, uv + 2);
+        }
+        else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 'n' && IsBlank(p[2]))
+        {
+          p += 3;
+          float normal[3] = {0.f, 0.f, 0.f};
+          for (auto& value : normal) ParseFloat(p, lineEnd, value);
+          result.normals.insert(result.normals.end(), normal, normal + 3);
+        }
+        else if (lineEnd - p >= 2 && p[0] == 'f' && IsBlank(p[1]))
+        {
+          p += 2;
+          polygon.clear();
+          polygonFlags.clear();
+          ObjParser::Index corner;
+          uint8_t flags = 0;
+          while (ParseCorner(p, lineEnd, result, corner, flags))
+          {
+            polygon.push_back(corner);
+            polygonFlags.push_back(flags);
+            flags = 0;
+          }
+
+          // Fan triangulation, fine for the convex polygons exporters write
+          for (size_t i = 1; i + 1 < polygon.size(); ++i)
+          {
+            for (const size_t c : {size_t{0}, i, i + 1})
+            {
+              result.corners.push_back(polygon[c]);
+              chunk.relativeFlags.push_back(polygonFlags[c]);
+            }
+          }
+        }
+
+        p = lineEnd + 1;
+      }
+    }
+
+    template <typename T>
+    void Append(std::vector<T>& dst, const size_t offset, const std::vector<T>& src)
+    {
+      std::copy(src.begin(), src.end(), dst.begin() + offset);
+    }
+
+    void RunParallel(const size_t count, const std::function<void(size_t)>& task)
+    {
+      std::vector<std::thread> threads;
+      threads.reserve(count);
+      for (size_t i = 1; i < count; ++i)
+      {
+        threads.emplace_back(task, i);
+      }
+      task(0);
+      for (auto& thread : threads)
+      {
+        thread.join();
+      }
+    }
+  }
+
+  ObjParser::Result ObjParser::Parse(const std::string& filePath)
+  {
+    const MappedFile file{filePath};
+    const char* data = file.Data();
+    const size_t size = file.Size();
+
+    // Split on line boundaries so no line straddles two chunks
+    const size_t maxChunks = std::max(1u, std::thread::hardware_concurrency());
+    const size_t numChunks = std::clamp<size_t>(size / MIN_CHUNK_SIZE, 1, maxChunks);
+    std::vector<Chunk> chunks(numChunks);
+    const char* cursor = data;
+    for (size_t i = 0; i < numChunks; ++i)
+    {
+      chunks[i].begin = cursor;
+      const char* end = i + 1 == numChunks ? data + size : std::max(cursor, data + size * (i + 1) / numChunks);
+      if (end < data + size)
+      {
+        const char* newline = static_cast<const char*>(std::memchr(end, '\n', data + size - end));
+        end = newline ? newline + 1 : data + size;
+      }
+      chunks[i].end = end;
+      cursor = end;
+    }
+
+    RunParallel(numChunks, [&chunks](const size_t i)
+    {
+      try
+      {
+        ParseChunk(chunks[i]);
+      }
+      catch (...)
+      {
+        chunks[i].error = std::current_exception();
+      }
+    });
+
+    for (const auto& chunk : chunks)
+    {
+      if (chunk.error) std::rethrow_exception(chunk.error);
+    }
+
+    // Prefix sums give every chunk its place in the merged arrays and the index base for relative indices
+    struct Offsets
+    {
+      size_t positions{0}, normals{0}, texcoords{0}, corners{0};
+    };
+    std::vector<Offsets> offsets(numChunks + 1);
+    for (size_t i = 0; i < numChunks; ++i)
+    {
+      const auto& chunk = chunks[i].result;
+      offsets[i + 1].positions = offsets[i].positions + chunk.positions.size();
+      offsets[i + 1].normals = offsets[i].normals + chunk.normals.size();
+      offsets[i + 1].texcoords = offsets[i].texcoords + chunk.texcoords.size();
+      offsets[i + 1].corners = offsets[i].corners + chunk.corners.size();
+    }
+
+    Result result;
+    const auto& total = offsets[numChunks];
+    result.positions.resize(total.positions);
+    result.colors.resize(total.positions);
+    result.normals.resize(total.normals);
+    result.texcoords.resize(total.texcoords);
+    result.corners.resize(total.corners);
+
+    const auto vertexCount = static_cast<int32_t>(total.positions / 3);
+    const auto normalCount = static_cast<int32_t>(total.normals / 3);
+    const auto texcoordCount = static_cast<int32_t>(total.texcoords / 2);
+
+    RunParallel(numChunks, [&](const size_t i)
+    {
+      auto& chunk = chunks[i];
+      const auto& base = offsets[i];
+      Append(result.positions, base.positions, chunk.result.positions);
+      Append(result.colors, base.positions, chunk.result.colors);
+      Append(result.normals, base.normals, chunk.result.normals);
+      Append(result.texcoords, base.texcoords, chunk.result.texcoords);
+
+      const auto vBase = static_cast<int32_t>(base.positions / 3);
+      const auto vnBase = static_cast<int32_t>(base.normals / 3);
+      const auto vtBase = static_cast<int32_t>(base.texcoords / 2);
+      for (size_t c = 0; c < chunk.result.corners.size(); ++c)
+      {
+        auto corner = chunk.result.corners[c];
+        const auto flags = chunk.relativeFlags[c];
+        if (flags & RELATIVE_V) corner.v += vBase;
+        if (flags & RELATIVE_VN) corner.vn += vnBase;
+        if (flags & RELATIVE_VT) corner.vt += vtBase;
+
+        if (corner.v < 0 || corner.v >= vertexCount || corner.vn < -1 || corner.vn >= normalCount ||
+          corner.vt < -1 || corner.vt >= texcoordCount)
+        {
+          chunk.error = std::make_exception_ptr(std::runtime_error("OBJ face index out of range"));
+          return;
+        }
+        result.corners[base.corners + c] = corner;
+      }
+    });
+
+    for (const auto& chunk : chunks)
+    {
+      if (chunk.error) std::rethrow_exception(chunk.error);
+    }
+
+    return result;
+  }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Ark
+{
+  // Multithreaded Wavefront OBJ reader. The file is memory mapped and split into line aligned chunks that are
+  // parsed in parallel. Only geometry is read: v (with optional vertex colors), vt, vn and f with any polygon
+  // size and negative indices. Everything else (materials, groups, smoothing) is skipped.
+  class ObjParser
+  {
+  public:
+    // Zero-based attribute indices of one face corner, -1 when the attribute is absent
+    struct Index
+    {
+      int32_t v{-1};
+      int32_t vt{-1};
+      int32_t vn{-1};
+
+      bool operator==(const Index& other) const
+      {
+        return v == other.v && vt == other.vt && vn == other.vn;
+      }
+    };
+
+    struct Result
+    {
+      std::vector<float> positions{}; // xyz per v
+      std::vector<float> colors{};    // rgb per v, 1.0 when the file has no vertex colors
+      std::vector<float> normals{};   // xyz per vn
+      std::vector<float> texcoords{}; // uv per vt
+      std::vector<Index> corners{};   // three per triangle, polygons are fan triangulated
+    };
+
+    static Result Parse(const std::string& filePath);
+  };
+}
@@ -1,10 +1,53 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 #include "FirstApp.hpp"
 
-int main()
+namespace
 {
-  Ark::FirstApp app;
+  // Parses a decimal object count, rejecting anything that is not a plain non-negative number that fits in 32 bits
+  bool ParseObjectCount(const char* text, uint32_t& count)
+  {
+    if (*text < '0' || *text > '9') return false;
+
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long value = std::strtoull(text, &end, 10);
+    if (*end != '\0' || errno == ERANGE || value > UINT32_MAX) return false;
+
+    count = static_cast<uint32_t>(value);
+    return true;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  // --benchmark [objectCount] compares the render paths on a scene of many objects
+  // --transform-benchmark [objectCount] measures transform updates on the CPU only, then exits
+  uint32_t benchmarkObjectCount = 0;
+  for (int i = 1; i < argc; i++)
+  {
+    const bool benchmark = std::strcmp(argv[i], "--benchmark") == 0;
+    const bool transformBenchmark = std::strcmp(argv[i], "--transform-benchmark") == 0;
+    if (!benchmark && !transformBenchmark) continue;
+
+    uint32_t objectCount = benchmark ? 10000 : 100000;
+    if (i + 1 < argc && !ParseObjectCount(argv[++i], objectCount))
+    {
+      std::cerr << argv[i - 1] << ": object count '" << argv[i] << "' is not a number" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    if (transformBenchmark)
+    {
+      Ark::FirstApp::RunTransformBenchmark(objectCount);
+      return EXIT_SUCCESS;
+    }
+    benchmarkObjectCount = objectCount;
+  }
+  Ark::FirstApp app{benchmarkObjectCount};
 
   try
   {
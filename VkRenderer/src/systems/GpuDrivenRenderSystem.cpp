@@ -0,0 +1,283 @@
+#include "GpuDrivenRenderSystem.hpp"
+#include "ArkFrustum.hpp"
+#include "ArkSwapChain.hpp"
+//libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+//std
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <stdexcept>
+
+namespace Ark
+{
+  struct CullPushConstantData
+  {
+    std::array<glm::vec4, ArkFrustum::PLANE_COUNT> planes{};
+    uint32_t objectCount{0};
+    uint32_t compact{0};
+  };
+
+  // The draw pipeline shares the bindless vertex shaders, which add this index to gl_InstanceIndex
+  struct DrawPushConstantData
+  {
+    uint32_t objectIndex{0};
+  };
+
+  GpuDrivenRenderSystem::GpuDrivenRenderSystem(ArkDevice& device, VkRenderPass renderPass,
+                                               VkDescriptorSetLayout globalSetLayout,
+                                               ArkBindlessResources& bindless, ArkMeshBuffer& meshBuffer)
+    : m_arkDevice(device), m_bindless(bindless), m_meshBuffer(meshBuffer)
+  {
+    assert(device.SupportsMultiDrawIndirect() && "GPU driven rendering needs multi draw indirect");
+    CreateFrameResources();
+    CreatePipelineLayouts(globalSetLayout);
+    CreatePipelines(renderPass);
+  }
+
+  GpuDrivenRenderSystem::~GpuDrivenRenderSystem()
+  {
+    vkDestroyPipelineLayout(m_arkDevice.Device(), m_cullPipelineLayout, nullptr);
+    vkDestroyPipelineLayout(m_arkDevice.Device(), m_drawPipelineLayout, nullptr);
+  }
+
+  void GpuDrivenRenderSystem::Cull(FrameInfo& frameInfo)
+  {
+    const auto start = std::chrono::high_resolution_clock::now();
+    auto& frame = m_frames[frameInfo.frameIndex];
+
+    // This frame's previous commands have completed, BeginFrame waited for them
+    frame.drawCount->Invalidate();
+    m_renderStats.visible = *static_cast<const uint32_t*>(frame.drawCount->GetMappedMemory());
+
+    auto* cullData = static_cast<CullData*>(frame.cullData->GetMappedMemory());
+    m_objectCount = 0;
+    m_renderStats.skipped = 0;
+    for (auto& obj : frameInfo.gameObjects)
+    {
+      if (obj.m_model == nullptr) continue;
+      const auto& model = *obj.m_model;
+      if (model.GetMeshBuffer() != &m_meshBuffer)
+      {
+        m_renderStats.skipped++;
+        continue;
+      }
+      if (m_objectCount == ArkBindlessResources::MAX_OBJECTS)
+      {
+        throw std::runtime_error("too many objects for the bindless object buffer!");
+      }
+
+      m_bindless.WriteObject(frameInfo.frameIndex, m_objectCount, obj);
+      auto& cull = cullData[m_objectCount];
+      if (model.GetLayout() == ArkModel::VertexLayout::Packed)
+      {
+        // The object's model matrix starts from quantized positions in [0, 1]
+        cull.boundsCenter = glm::vec4{0.5f};
+        cull.boundsExtent = glm::vec4{0.5f};
+      }
+      else
+      {
+        cull.boundsCenter = glm::vec4{0.5f * (model.GetBoundsMin() + model.GetBoundsMax()), 1.0f};
+        cull.boundsExtent = glm::vec4{0.5f * (model.GetBoundsMax() - model.GetBoundsMin()), 0.0f};
+      }
+      cull.indexCount = model.GetIndexCount();
+      cull.firstIndex = model.GetFirstIndex();
+      cull.vertexOffset = model.GetVertexOffset();
+      m_objectCount++;
+    }
+    m_renderStats.objects = m_objectCount;
+    m_bindless.FlushObjectData(frameInfo.frameIndex, m_objectCount);
+    if (m_objectCount > 0)
+    {
+      frame.cullData->Flush(sizeof(CullData) * m_objectCount, 0);
+    }
+
+    const VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+    vkCmdFillBuffer(commandBuffer, frame.drawCount->GetBuffer(), 0, sizeof(uint32_t), 0);
+    VkMemoryBarrier clearBarrier{};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+    if (m_objectCount > 0)
+    {
+      const ArkFrustum frustum{frameInfo.camera.GetProjMatrix() * frameInfo.camera.GetViewMatrix()};
+      CullPushConstantData push{};
+      push.planes = frustum.GetPlanes();
+      push.objectCount = m_objectCount;
+      push.compact = IsCompacting() ? 1 : 0;
+
+      m_cullPipeline->Bind(commandBuffer);
+      vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout, 0, 1,
+                              &frame.cullDescriptorSet, 0, nullptr);
+      vkCmdPushConstants(commandBuffer, m_cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                         sizeof(CullPushConstantData), &push);
+      vkCmdDispatch(commandBuffer, (m_objectCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+    }
+
+    // The commands and count are consumed by the draw, and the count read back by the host a few frames later
+    VkMemoryBarrier cullBarrier{};
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &cullBarrier, 0,
+                         nullptr, 0, nullptr);
+
+    m_cullMilliseconds = std::chrono::duration<double, std::milli>(
+      std::chrono::high_resolution_clock::now() - start).count();
+  }
+
+  void GpuDrivenRenderSystem::Render(FrameInfo& frameInfo)
+  {
+    const auto start = std::chrono::high_resolution_clock::now();
+    const VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+    auto& frame = m_frames[frameInfo.frameIndex];
+    m_renderStats.descriptorSetBinds = 0;
+    m_renderStats.drawCalls = 0;
+    if (m_objectCount > 0)
+    {
+      m_drawPipeline->Bind(commandBuffer);
+      const VkDescriptorSet sets[] = {frameInfo.globalDescriptorSet, m_bindless.GetDescriptorSet(frameInfo.frameIndex)};
+      vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_drawPipelineLayout, 0, 2, sets, 0,
+                              nullptr);
+      m_renderStats.descriptorSetBinds = 2;
+      const DrawPushConstantData push{};
+      vkCmdPushConstants(commandBuffer, m_drawPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                         sizeof(DrawPushConstantData), &push);
+      m_meshBuffer.Bind(commandBuffer);
+      if (IsCompacting())
+      {
+        m_arkDevice.CmdDrawIndexedIndirectCount(commandBuffer, frame.drawCommands->GetBuffer(), 0,
+                                                frame.drawCount->GetBuffer(), 0, m_objectCount,
+                                                sizeof(VkDrawIndexedIndirectCommand));
+      }
+      else
+      {
+        vkCmdDrawIndexedIndirect(commandBuffer, frame.drawCommands->GetBuffer(), 0, m_objectCount,
+                                 sizeof(VkDrawIndexedIndirectCommand));
+      }
+      m_renderStats.drawCalls = 1;
+    }
+    m_renderStats.recordMilliseconds = m_cullMilliseconds + std::chrono::duration<double, std::milli>(
+      std::chrono::high_resolution_clock::now() - start).count();
+  }
+
+  void GpuDrivenRenderSystem::CreateFrameResources()
+  {
+    m_cullSetLayout = ArkDescriptorSetLayout::Builder(m_arkDevice)
+                      .AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                      .AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                      .AddBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                      .AddBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                      .Build();
+    m_cullPool = ArkDescriptorPool::Builder(m_arkDevice)
+                 .SetMaxSets(ArkSwapChain::MAX_FRAMES_IN_FLIGHT)
+                 .AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 * ArkSwapChain::MAX_FRAMES_IN_FLIGHT)
+                 .Build();
+
+    m_frames.resize(ArkSwapChain::MAX_FRAMES_IN_FLIGHT);
+    for (int i = 0; i < ArkSwapChain::MAX_FRAMES_IN_FLIGHT; i++)
+    {
+      auto& frame = m_frames[i];
+      frame.cullData = std::make_unique<ArkBuffer>(
+        m_arkDevice,
+        sizeof(CullData),
+        ArkBindlessResources::MAX_OBJECTS,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+      frame.cullData->Map();
+      frame.drawCommands = std::make_unique<ArkBuffer>(
+        m_arkDevice,
+        sizeof(VkDrawIndexedIndirectCommand),
+        ArkBindlessResources::MAX_OBJECTS,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      frame.drawCount = std::make_unique<ArkBuffer>(
+        m_arkDevice,
+        sizeof(uint32_t),
+        1,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+      frame.drawCount->Map();
+      *static_cast<uint32_t*>(frame.drawCount->GetMappedMemory()) = 0;
+      frame.drawCount->Flush();
+
+      auto objectInfo = m_bindless.GetObjectBufferInfo(i);
+      auto cullInfo = frame.cullData->DescriptorInfo();
+      auto drawInfo = frame.drawCommands->DescriptorInfo();
+      auto countInfo = frame.drawCount->DescriptorInfo();
+      if (!ArkDescriptorWriter(*m_cullSetLayout, *m_cullPool)
+           .WriteBuffer(0, &objectInfo)
+           .WriteBuffer(1, &cullInfo)
+           .WriteBuffer(2, &drawInfo)
+           .WriteBuffer(3, &countInfo)
+           .Build(frame.cullDescriptorSet))
+      {
+        throw std::runtime_error("failed to allocate culling descriptor set!");
+      }
+    }
+  }
+
+  void GpuDrivenRenderSystem::CreatePipelineLayouts(VkDescriptorSetLayout globalSetLayout)
+  {
+    VkPushConstantRange cullPushRange{};
+    cullPushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    cullPushRange.offset = 0;
+    cullPushRange.size = sizeof(CullPushConstantData);
+    const VkDescriptorSetLayout cullSetLayout = m_cullSetLayout->GetDescriptorSetLayout();
+
+    VkPipelineLayoutCreateInfo cullLayoutInfo{};
+    cullLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    cullLayoutInfo.setLayoutCount = 1;
+    cullLayoutInfo.pSetLayouts = &cullSetLayout;
+    cullLayoutInfo.pushConstantRangeCount = 1;
+    cullLayoutInfo.pPushConstantRanges = &cullPushRange;
+    if (vkCreatePipelineLayout(m_arkDevice.Device(), &cullLayoutInfo, nullptr, &m_cullPipelineLayout) !=
+      VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create pipeline layout!");
+    }
+
+    VkPushConstantRange drawPushRange{};
+    drawPushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    drawPushRange.offset = 0;
+    drawPushRange.size = sizeof(DrawPushConstantData);
+    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout, m_bindless.GetDescriptorSetLayout()};
+
+    VkPipelineLayoutCreateInfo drawLayoutInfo{};
+    drawLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    drawLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+    drawLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+    drawLayoutInfo.pushConstantRangeCount = 1;
+    drawLayoutInfo.pPushConstantRanges = &drawPushRange;
+    if (vkCreatePipelineLayout(m_arkDevice.Device(), &drawLayoutInfo, nullptr, &m_drawPipelineLayout) !=
+      VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create pipeline layout!");
+    }
+  }
+
+  void GpuDrivenRenderSystem::CreatePipelines(VkRenderPass renderPass)
+  {
+    m_cullPipeline = std::make_unique<ArkComputePipeline>(m_arkDevice, "shaders/cull.comp.spv",
+                                                          m_cullPipelineLayout);
+
+    PipelineConfigInfo pipelineConfig{};
+    ArkPipeline::DefaultPipelineConfigInfo(pipelineConfig);
+    pipelineConfig.bindingDescriptions = ArkModel::Vertex::GetBindingDescriptions(m_meshBuffer.GetLayout());
+    pipelineConfig.attributeDescriptions = ArkModel::Vertex::GetAttributeDescriptions(m_meshBuffer.GetLayout());
+    pipelineConfig.renderPass = renderPass;
+    pipelineConfig.pipelineLayout = m_drawPipelineLayout;
+    const char* vertexShader = m_meshBuffer.GetLayout() == ArkModel::VertexLayout::Packed
+                                 ? "shaders/simple_packed_bindless.vert.spv"
+                                 : "shaders/simple_bindless.vert.spv";
+    m_drawPipeline = std::make_unique<ArkPipeline>(m_arkDevice, vertexShader, "shaders/simple_bindless.frag.spv",
+                                                   pipelineConfig);
+  }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "ArkFrameInfo.hpp"
+#include "ArkPipleline.hpp"
+#include "ArkDevice.hpp"
+#include "ArkBuffer.hpp"
+#include "ArkBindless.hpp"
+#include "ArkMeshBuffer.hpp"
+#include <memory>
+
+namespace Ark
+{
+  // Draws every game object whose model lives in the mesh buffer with one indirect call. A compute pass frustum
+  // culls the objects and writes their draw commands, so recording costs the same for any object count. Uses the
+  // bindless object data and textures, so it must not share a frame with the bindless SimpleRenderSystem.
+  // Needs ArkDevice::SupportsMultiDrawIndirect; without SupportsDrawIndirectCount culled objects are drawn with
+  // zero instances instead of being compacted away.
+  class GpuDrivenRenderSystem
+  {
+  public:
+    static constexpr uint32_t CULL_WORKGROUP_SIZE = 64;
+
+    // Per object input of cull.comp
+    struct CullData
+    {
+      glm::vec4 boundsCenter{0.0f};
+      glm::vec4 boundsExtent{0.0f};
+      uint32_t indexCount{0};
+      uint32_t firstIndex{0};
+      int32_t vertexOffset{0};
+      uint32_t padding{0};
+    };
+
+    struct RenderStats
+    {
+      size_t objects{0};
+      // Objects whose model is not in the mesh buffer, which this system cannot draw
+      size_t skipped{0};
+      // Read back from the last time this frame's buffers were used, so a few frames late
+      uint32_t visible{0};
+      size_t descriptorSetBinds{0};
+      size_t drawCalls{0};
+      // CPU time spent in Cull and Render
+      double recordMilliseconds{0.0};
+    };
+
+    GpuDrivenRenderSystem(ArkDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout,
+                          ArkBindlessResources& bindless, ArkMeshBuffer& meshBuffer);
+    ~GpuDrivenRenderSystem();
+
+    GpuDrivenRenderSystem(const GpuDrivenRenderSystem&) = delete;
+    GpuDrivenRenderSystem& operator=(const GpuDrivenRenderSystem&) = delete;
+
+    // Writes the frame's object data and records the culling dispatch. Has to be recorded outside of a render
+    // pass, before Render.
+    void Cull(FrameInfo& frameInfo);
+    void Render(FrameInfo& frameInfo);
+
+    bool IsCompacting() const { return m_arkDevice.SupportsDrawIndirectCount(); }
+    const RenderStats& GetRenderStats() const { return m_renderStats; }
+
+  private:
+    struct FrameResources
+    {
+      std::unique_ptr<ArkBuffer> cullData;
+      std::unique_ptr<ArkBuffer> drawCommands;
+      // Host visible, so the visible count can be read back
+      std::unique_ptr<ArkBuffer> drawCount;
+      VkDescriptorSet cullDescriptorSet;
+    };
+
+    void CreateFrameResources();
+    void CreatePipelineLayouts(VkDescriptorSetLayout globalSetLayout);
+    void CreatePipelines(VkRenderPass renderPass);
+
+    ArkDevice& m_arkDevice;
+    ArkBindlessResources& m_bindless;
+    ArkMeshBuffer& m_meshBuffer;
+
+    std::unique_ptr<ArkDescriptorSetLayout> m_cullSetLayout;
+    std::unique_ptr<ArkDescriptorPool> m_cullPool;
+    std::vector<FrameResources> m_frames{};
+
+    VkPipelineLayout m_cullPipelineLayout;
+    VkPipelineLayout m_drawPipelineLayout;
+    std::unique_ptr<ArkComputePipeline> m_cullPipeline;
+    std::unique_ptr<ArkPipeline> m_drawPipeline;
+
+    uint32_t m_objectCount{0};
+    double m_cullMilliseconds{0.0};
+    RenderStats m_renderStats{};
+  };
+}
@@ -6,19 +6,50 @@
 #include <glm/gtc/constants.hpp>
 
 //std
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <stdexcept>
 
 namespace Ark
 {
+  // 128 bytes, the smallest maxPushConstantsSize devices have to support, so the normal matrix only sends the
+  // three columns the shaders use
   struct SimplePushConstantData
+  {
+    glm::mat4 modelMatrix{1.0f};
+    glm::mat3x4 normalMatrix{1.0f};
+    // UV offset (xy) and extent (zw) of packed models
+    glm::vec4 uvTransform{0.0f, 0.0f, 1.0f, 1.0f};
+  };
+
+  // Per instance vertex data of the instanced shaders, at locations 4 to 12
+  struct InstanceData
   {
     glm::mat4 modelMatrix{1.0f};
     glm::mat4 normalMatrix{1.0f};
+    glm::vec4 uvTransform{0.0f, 0.0f, 1.0f, 1.0f};
   };
 
+  struct BindlessPushConstantData
+  {
+    uint32_t objectIndex{0};
+  };
+
+  namespace
+  {
+    // What Bind compares to skip vertex buffer binds: models in one mesh buffer bind the same buffers
+    const void* GetBufferHandle(const ArkModel& model)
+    {
+      return model.GetMeshBuffer() ? static_cast<const void*>(model.GetMeshBuffer())
+                                   : static_cast<const void*>(&model);
+    }
+  }
+
   SimpleRenderSystem::SimpleRenderSystem(ArkDevice& device, VkRenderPass renderPass,
-                                         VkDescriptorSetLayout globalSetLayout) : m_arkDevice(device)
+                                         VkDescriptorSetLayout globalSetLayout, ArkBindlessResources* bindless,
+                                         bool instanced)
+    : m_arkDevice(device), m_bindless(bindless), m_instanced(instanced)
   {
     CreatePipelineLayout(globalSetLayout);
     CreatePipeline(renderPass);
@@ -31,6 +62,7 @@ namespace Ark
 
   void SimpleRenderSystem::RenderGameObjects(FrameInfo& frameInfo)
   {
+    const auto start = std::chrono::high_resolution_clock::now();
     m_arkPipeline->Bind(frameInfo.commandBuffer);
 
     // only need to bind once!
@@ -44,18 +76,98 @@ namespace Ark
       0,
       nullptr
     );
-    for (auto& kv : frameInfo.gameObjects)
+    m_renderStats.descriptorSetBinds = 1;
+    m_renderStats.drawCalls = 0;
+
+    CullGameObjects(frameInfo);
+    QueueGameObjects(frameInfo);
+    if (m_bindless)
+    {
+      DrawBindless(frameInfo);
+    }
+    else if (m_instanced)
+    {
+      DrawInstanced(frameInfo);
+    }
+    else
+    {
+      DrawWithObjectSets(frameInfo);
+    }
+    m_renderStats.recordMilliseconds = std::chrono::duration<double, std::milli>(
+      std::chrono::high_resolution_clock::now() - start).count();
+    m_renderStats.vertexBufferBinds = m_renderQueue.GetStats().binds;
+    m_renderStats.bindsAvoided = m_renderQueue.GetStats().bindsAvoided;
+  }
+
+  void SimpleRenderSystem::CullGameObjects(FrameInfo& frameInfo)
+  {
+    m_candidates.clear();
+    m_bounds.Clear();
+    for (auto& obj : frameInfo.gameObjects)
     {
-      auto& obj = kv.second;
       if (obj.m_model == nullptr) continue;
+      m_candidates.push_back(&obj);
+      m_bounds.Push(obj.m_model->GetBoundsMin(), obj.m_model->GetBoundsMax(), obj.GetModelMatrix());
+    }
+    const ArkFrustum frustum{frameInfo.camera.GetProjMatrix() * frameInfo.camera.GetViewMatrix()};
+    m_renderStats.visible = frustum.Cull(m_bounds, m_visibility);
+    m_renderStats.culled = m_candidates.size() - m_renderStats.visible;
+  }
+
+  void SimpleRenderSystem::QueueGameObjects(FrameInfo& frameInfo)
+  {
+    m_renderQueue.Clear();
+    const glm::mat4 view = frameInfo.camera.GetViewMatrix();
+    for (size_t i = 0; i < m_candidates.size(); ++i)
+    {
+      if (!m_visibility[i]) continue;
+      const auto& obj = *m_candidates[i];
+      const glm::vec3 center = 0.5f * (obj.m_model->GetBoundsMin() + obj.m_model->GetBoundsMax());
+      ArkRenderQueue::Packet packet{};
+      packet.pipeline = m_arkPipeline.get();
+      // Bindless draws bind no material, the texture index is part of the object data
+      packet.material = m_bindless ? nullptr : obj.m_diffuseMap.get();
+      // Instancing batches by model, so every model gets its own key even if it shares buffers with others
+      packet.mesh = m_instanced ? obj.m_model.get() : GetBufferHandle(*obj.m_model);
+      // The camera looks down -z in view space
+      packet.depth = -(view * obj.GetModelMatrix() * glm::vec4(center, 1.0f)).z;
+      packet.payload = static_cast<uint32_t>(i);
+      m_renderQueue.Push(packet);
+    }
+    m_renderQueue.Sort();
+  }
+
+  size_t SimpleRenderSystem::FindBatchEnd(size_t first) const
+  {
+    const auto& packets = m_renderQueue.GetSortedPackets();
+    size_t end = first + 1;
+    if (!m_instanced)
+    {
+      return end;
+    }
+    const auto& obj = *m_candidates[packets[first].payload];
+    while (end < packets.size())
+    {
+      const auto& next = *m_candidates[packets[end].payload];
+      // The texture index of bindless draws is per instance
+      if (next.m_model != obj.m_model || (!m_bindless && next.m_diffuseMap != obj.m_diffuseMap)) break;
+      end++;
+    }
+    return end;
+  }
 
-      auto bufferInfo = obj.GetBufferInfo(frameInfo.frameIndex);
-      auto imageInfo = obj.m_diffuseMap->GetImageInfo();
-      VkDescriptorSet gameObjectDescriptorSet;
-      ArkDescriptorWriter(*m_renderSystemLayout, frameInfo.frameDescriptorPool)
-        .WriteBuffer(0, &bufferInfo)
-        .WriteImage(1, &imageInfo)
-        .Build(gameObjectDescriptorSet);
+  void SimpleRenderSystem::DrawWithObjectSets(FrameInfo& frameInfo)
+  {
+    const void* boundMesh = nullptr;
+    for (const auto& packet : m_renderQueue.GetSortedPackets())
+    {
+      auto& obj = *m_candidates[packet.payload];
+
+      // Only allocated and written the first time an object is drawn with this buffer and texture
+      const VkDescriptorSet gameObjectDescriptorSet = frameInfo.descriptorCache.Get(
+        ArkDescriptorCache::Key(*m_renderSystemLayout)
+        .WriteBuffer(0, obj.GetBufferInfo(frameInfo.frameIndex))
+        .WriteImage(1, obj.m_diffuseMap->GetImageInfo()));
       vkCmdBindDescriptorSets(
         frameInfo.commandBuffer,
         VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -65,33 +177,163 @@ namespace Ark
         &gameObjectDescriptorSet,
         0,
         nullptr);
+      m_renderStats.descriptorSetBinds++;
       SimplePushConstantData push{};
-      push.modelMatrix = obj.m_transform.Mat4();;
-      push.normalMatrix = obj.m_transform.NormalMat();
+      push.modelMatrix = obj.GetModelMatrix();
+      push.normalMatrix = glm::mat3x4{obj.GetNormalMatrix()};
+      push.uvTransform = obj.m_model->GetUvTransform();
+      if (obj.m_model->GetLayout() == ArkModel::VertexLayout::Packed)
+      {
+        push.modelMatrix = push.modelMatrix * obj.m_model->GetDequantizeMatrix();
+      }
       vkCmdPushConstants(frameInfo.commandBuffer, m_pipelineLayout,
                          VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
                          sizeof(SimplePushConstantData), &push);
-      obj.m_model->Bind(frameInfo.commandBuffer);
+      if (m_renderQueue.Bind(boundMesh, packet.mesh))
+      {
+        obj.m_model->Bind(frameInfo.commandBuffer);
+      }
       obj.m_model->Draw(frameInfo.commandBuffer);
+      m_renderStats.drawCalls++;
     }
   }
 
+  void SimpleRenderSystem::DrawInstanced(FrameInfo& frameInfo)
+  {
+    const auto& packets = m_renderQueue.GetSortedPackets();
+    if (packets.empty()) return;
+    // The frame's previous submission has finished by now, so its buffer can be replaced
+    auto& instanceBuffer = m_instanceBuffers[frameInfo.frameIndex];
+    if (!instanceBuffer || instanceBuffer->GetInstanceCount() < packets.size())
+    {
+      const auto capacity = std::max<uint32_t>(static_cast<uint32_t>(packets.size()),
+                                               instanceBuffer ? 2 * instanceBuffer->GetInstanceCount() : 1024);
+      instanceBuffer = std::make_unique<ArkBuffer>(
+        m_arkDevice,
+        sizeof(InstanceData),
+        capacity,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+      instanceBuffer->Map();
+    }
+    auto* instances = static_cast<InstanceData*>(instanceBuffer->GetMappedMemory());
+    // Model binds only touch the bindings below m_instanceBinding, so this one stays bound for the frame
+    const VkBuffer buffer = instanceBuffer->GetBuffer();
+    const VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(frameInfo.commandBuffer, m_instanceBinding, 1, &buffer, &offset);
+
+    const void* boundMesh = nullptr;
+    for (size_t first = 0; first < packets.size();)
+    {
+      const size_t end = FindBatchEnd(first);
+      auto& obj = *m_candidates[packets[first].payload];
+      for (size_t i = first; i < end; ++i)
+      {
+        const auto& instance = *m_candidates[packets[i].payload];
+        auto& data = instances[i];
+        data.modelMatrix = instance.GetModelMatrix();
+        data.normalMatrix = instance.GetNormalMatrix();
+        data.uvTransform = instance.m_model->GetUvTransform();
+        if (instance.m_model->GetLayout() == ArkModel::VertexLayout::Packed)
+        {
+          data.modelMatrix = data.modelMatrix * instance.m_model->GetDequantizeMatrix();
+        }
+      }
+
+      // The batch shares its texture, any object's set has it. Binding 0 is not read by the instanced shaders.
+      const VkDescriptorSet gameObjectDescriptorSet = frameInfo.descriptorCache.Get(
+        ArkDescriptorCache::Key(*m_renderSystemLayout)
+        .WriteBuffer(0, obj.GetBufferInfo(frameInfo.frameIndex))
+        .WriteImage(1, obj.m_diffuseMap->GetImageInfo()));
+      vkCmdBindDescriptorSets(
+        frameInfo.commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        m_pipelineLayout,
+        1,
+        1,
+        &gameObjectDescriptorSet,
+        0,
+        nullptr);
+      m_renderStats.descriptorSetBinds++;
+      if (m_renderQueue.Bind(boundMesh, GetBufferHandle(*obj.m_model)))
+      {
+        obj.m_model->Bind(frameInfo.commandBuffer);
+      }
+      obj.m_model->Draw(frameInfo.commandBuffer, static_cast<uint32_t>(end - first), static_cast<uint32_t>(first));
+      m_renderStats.drawCalls++;
+      first = end;
+    }
+    instanceBuffer->Flush(sizeof(InstanceData) * packets.size(), 0);
+  }
+
+  void SimpleRenderSystem::DrawBindless(FrameInfo& frameInfo)
+  {
+    const VkDescriptorSet bindlessSet = m_bindless->GetDescriptorSet(frameInfo.frameIndex);
+    vkCmdBindDescriptorSets(
+      frameInfo.commandBuffer,
+      VK_PIPELINE_BIND_POINT_GRAPHICS,
+      m_pipelineLayout,
+      1,
+      1,
+      &bindlessSet,
+      0,
+      nullptr);
+    m_renderStats.descriptorSetBinds++;
+
+    const auto& packets = m_renderQueue.GetSortedPackets();
+    if (packets.size() > ArkBindlessResources::MAX_OBJECTS)
+    {
+      throw std::runtime_error("too many objects for the bindless object buffer!");
+    }
+    const void* boundMesh = nullptr;
+    for (size_t first = 0; first < packets.size();)
+    {
+      // Object data is written in draw order, so a batch reads consecutive entries through gl_InstanceIndex
+      const size_t end = FindBatchEnd(first);
+      for (size_t i = first; i < end; ++i)
+      {
+        m_bindless->WriteObject(frameInfo.frameIndex, static_cast<uint32_t>(i), *m_candidates[packets[i].payload]);
+      }
+      auto& obj = *m_candidates[packets[first].payload];
+
+      const BindlessPushConstantData push{static_cast<uint32_t>(first)};
+      vkCmdPushConstants(frameInfo.commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                         sizeof(BindlessPushConstantData), &push);
+      if (m_renderQueue.Bind(boundMesh, GetBufferHandle(*obj.m_model)))
+      {
+        obj.m_model->Bind(frameInfo.commandBuffer);
+      }
+      obj.m_model->Draw(frameInfo.commandBuffer, static_cast<uint32_t>(end - first));
+      m_renderStats.drawCalls++;
+      first = end;
+    }
+    m_bindless->FlushObjectData(frameInfo.frameIndex, static_cast<uint32_t>(packets.size()));
+  }
+
 
   void SimpleRenderSystem::CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout)
   {
     VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
     pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(SimplePushConstantData);
-    m_renderSystemLayout = ArkDescriptorSetLayout::Builder(m_arkDevice)
-                           .AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                                       VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-                           .AddBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                       VK_SHADER_STAGE_FRAGMENT_BIT)
-                           .Build();
-    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
-      globalSetLayout, m_renderSystemLayout->GetDescriptorSetLayout()
-    };
+    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
+    if (m_bindless)
+    {
+      pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+      pushConstantRange.size = sizeof(BindlessPushConstantData);
+      descriptorSetLayouts.push_back(m_bindless->GetDescriptorSetLayout());
+    }
+    else
+    {
+      pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+      pushConstantRange.size = sizeof(SimplePushConstantData);
+      m_renderSystemLayout = ArkDescriptorSetLayout::Builder(m_arkDevice)
+                             .AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                         VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+                             .AddBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                         VK_SHADER_STAGE_FRAGMENT_BIT)
+                             .Build();
+      descriptorSetLayouts.push_back(m_renderSystemLayout->GetDescriptorSetLayout());
+    }
 
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -113,7 +355,41 @@ namespace Ark
     ArkPipeline::DefaultPipelineConfigInfo(pipelineConfig);
     pipelineConfig.renderPass = renderPass;
     pipelineConfig.pipelineLayout = m_pipelineLayout;
-    m_arkPipeline = std::make_unique<ArkPipeline>(m_arkDevice, "shaders/simple.vert.spv",
-                                                  "shaders/simple.frag.spv", pipelineConfig);
+    // The vertex input state follows ArkModel::DEFAULT_LAYOUT, so the shader has to as well
+    const bool packed = ArkModel::DEFAULT_LAYOUT == ArkModel::VertexLayout::Packed;
+    const char* vertexShader;
+    const char* fragmentShader;
+    if (m_bindless)
+    {
+      vertexShader = packed ? "shaders/simple_packed_bindless.vert.spv" : "shaders/simple_bindless.vert.spv";
+      fragmentShader = "shaders/simple_bindless.frag.spv";
+    }
+    else if (m_instanced)
+    {
+      // Per instance matrices and UV transform, InstanceData in the instance buffer, one vec4 per location
+      m_instanceBinding = static_cast<uint32_t>(pipelineConfig.bindingDescriptions.size());
+      VkVertexInputBindingDescription instanceBinding{};
+      instanceBinding.binding = m_instanceBinding;
+      instanceBinding.stride = sizeof(InstanceData);
+      instanceBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+      pipelineConfig.bindingDescriptions.push_back(instanceBinding);
+      for (uint32_t column = 0; column < sizeof(InstanceData) / sizeof(glm::vec4); column++)
+      {
+        VkVertexInputAttributeDescription attribute{};
+        attribute.binding = m_instanceBinding;
+        attribute.location = 4 + column;
+        attribute.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        attribute.offset = column * sizeof(glm::vec4);
+        pipelineConfig.attributeDescriptions.push_back(attribute);
+      }
+      vertexShader = packed ? "shaders/simple_packed_instanced.vert.spv" : "shaders/simple_instanced.vert.spv";
+      fragmentShader = "shaders/simple.frag.spv";
+    }
+    else
+    {
+      vertexShader = packed ? "shaders/simple_packed.vert.spv" : "shaders/simple.vert.spv";
+      fragmentShader = "shaders/simple.frag.spv";
+    }
+    m_arkPipeline = std::make_unique<ArkPipeline>(m_arkDevice, vertexShader, fragmentShader, pipelineConfig);
   }
 }
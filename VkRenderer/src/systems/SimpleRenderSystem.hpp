@@ -5,28 +5,83 @@
 #include "ArkPipleline.hpp"
 #include "ArkGameObject.hpp"
 #include "ArkDevice.hpp"
+#include "ArkFrustum.hpp"
+#include "ArkBindless.hpp"
+#include "ArkRenderQueue.hpp"
+#include "ArkBuffer.hpp"
+#include "ArkSwapChain.hpp"
+#include <array>
 #include <memory>
 
 namespace Ark
 {
+  // Draws textured game objects. By default every object binds its own set 1 (object UBO slice and diffuse map).
+  // Given bindless resources, set 1 is their set instead: it is bound once per frame and draws push an index into
+  // the frame's object data. Visible objects go through an ArkRenderQueue, so draws sharing a model are recorded
+  // together and only the first binds its vertex buffers.
+  // Instanced, consecutive draws of one model with one material become a single draw: with object sets their
+  // matrices are written to a per frame instance buffer read as vertex attributes, bindless they are consecutive
+  // entries of the object data, and the batch is drawn with instanceCount > 1.
   class SimpleRenderSystem
   {
   public:
-    SimpleRenderSystem(ArkDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+    SimpleRenderSystem(ArkDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout,
+                       ArkBindlessResources* bindless = nullptr, bool instanced = false);
     ~SimpleRenderSystem();
 
     SimpleRenderSystem(const SimpleRenderSystem&) = delete;
     SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
+    // Culls all game objects against the camera frustum in one batch, then sorts and draws the visible ones
     void RenderGameObjects(FrameInfo& frameInfo);
 
+    bool IsBindless() const { return m_bindless != nullptr; }
+    bool IsInstanced() const { return m_instanced; }
+
+    struct RenderStats
+    {
+      size_t visible{0};
+      size_t culled{0};
+      size_t descriptorSetBinds{0};
+      // One per object, or per batch when instanced
+      size_t drawCalls{0};
+      size_t vertexBufferBinds{0};
+      // Vertex buffer binds skipped because the previous draw had already bound the same buffers
+      size_t bindsAvoided{0};
+      // CPU time spent culling and recording the draws
+      double recordMilliseconds{0.0};
+    };
+    // Counts from the last RenderGameObjects call
+    const RenderStats& GetRenderStats() const { return m_renderStats; }
+
   private:
     void CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout);
     void CreatePipeline(VkRenderPass renderPass);
+    void CullGameObjects(FrameInfo& frameInfo);
+    // Pushes the visible candidates into m_renderQueue and sorts it
+    void QueueGameObjects(FrameInfo& frameInfo);
+    // End of the batch of sorted packets starting at first, which is first + 1 unless instanced
+    size_t FindBatchEnd(size_t first) const;
+    void DrawWithObjectSets(FrameInfo& frameInfo);
+    void DrawInstanced(FrameInfo& frameInfo);
+    void DrawBindless(FrameInfo& frameInfo);
 
     ArkDevice& m_arkDevice;
+    ArkBindlessResources* m_bindless;
+    bool m_instanced;
+    // Vertex buffer binding of the instance data, after the bindings of the model layout
+    uint32_t m_instanceBinding{0};
     std::unique_ptr<ArkPipeline> m_arkPipeline;
     VkPipelineLayout m_pipelineLayout;
 
     std::unique_ptr<ArkDescriptorSetLayout> m_renderSystemLayout;
+
+    // Reused every frame to avoid reallocating
+    std::vector<ArkGameObject*> m_candidates{};
+    ArkFrustum::BoxBatch m_bounds{};
+    std::vector<uint8_t> m_visibility{};
+    ArkRenderQueue m_renderQueue{};
+    // Instanced object sets only. Per frame in flight, grown to the visible object count.
+    std::array<std::unique_ptr<ArkBuffer>, ArkSwapChain::MAX_FRAMES_IN_FLIGHT> m_instanceBuffers{};
+    RenderStats m_renderStats{};
   };
 }
@@ -0,0 +1,109 @@
+#include "BoxBatch.hpp"
+
+// std
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define ARK_BOX_BATCH_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace Ark
+{
+  void BoxBatch::Clear()
+  {
+    m_centerX.clear();
+    m_centerY.clear();
+    m_centerZ.clear();
+    m_extentX.clear();
+    m_extentY.clear();
+    m_extentZ.clear();
+  }
+
+  void BoxBatch::Push(const glm::vec3& center, const glm::vec3& extent)
+  {
+    m_centerX.push_back(center.x);
+    m_centerY.push_back(center.y);
+    m_centerZ.push_back(center.z);
+    m_extentX.push_back(extent.x);
+    m_extentY.push_back(extent.y);
+    m_extentZ.push_back(extent.z);
+  }
+
+  void BoxBatch::Push(const glm::vec3& min, const glm::vec3& max, const glm::mat4& transform)
+  {
+    // Arvo's method: the world extent is the object extent through the absolute rotation-scale part
+    const glm::vec3 center = glm::vec3(transform * glm::vec4((min + max) * 0.5f, 1.0f));
+    const glm::vec3 halfExtent = (max - min) * 0.5f;
+    glm::vec3 extent{0.0f};
+    for (int col = 0; col < 3; ++col)
+    {
+      extent += glm::abs(glm::vec3(transform[col])) * halfExtent[col];
+    }
+
+    Push(center, extent);
+  }
+
+  size_t BoxBatch::Cull(const std::array<glm::vec4, 6>& planes, std::vector<uint8_t>& visible) const
+  {
+    const size_t count = Size();
+    visible.resize(count);
+    size_t visibleCount = 0;
+    size_t i = 0;
+
+#ifdef ARK_BOX_BATCH_SSE
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4)
+    {
+      const __m128 cx = _mm_loadu_ps(&m_centerX[i]);
+      const __m128 cy = _mm_loadu_ps(&m_centerY[i]);
+      const __m128 cz = _mm_loadu_ps(&m_centerZ[i]);
+      const __m128 ex = _mm_loadu_ps(&m_extentX[i]);
+      const __m128 ey = _mm_loadu_ps(&m_extentY[i]);
+      const __m128 ez = _mm_loadu_ps(&m_extentZ[i]);
+
+      __m128 outside = _mm_setzero_ps();
+      for (const auto& plane : planes)
+      {
+        // Signed distance of the center plus the box's projected radius onto the plane normal
+        __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_set1_ps(plane.w));
+        distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.y), cy));
+        distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), cz));
+        __m128 radius = _mm_mul_ps(_mm_set1_ps(std::abs(plane.x)), ex);
+        radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(std::abs(plane.y)), ey));
+        radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(std::abs(plane.z)), ez));
+        outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+      }
+
+      const int outsideMask = _mm_movemask_ps(outside);
+      for (int lane = 0; lane < 4; ++lane)
+      {
+        const bool isVisible = ((outsideMask >> lane) & 1) == 0;
+        visible[i + lane] = isVisible ? 1 : 0;
+        visibleCount += isVisible ? 1 : 0;
+      }
+    }
+#endif
+
+    // Scalar tail, and the whole batch without SSE
+    for (; i < count; ++i)
+    {
+      bool isVisible = true;
+      for (const auto& plane : planes)
+      {
+        const float distance = plane.x * m_centerX[i] + plane.y * m_centerY[i] +
+          plane.z * m_centerZ[i] + plane.w;
+        const float radius = std::abs(plane.x) * m_extentX[i] + std::abs(plane.y) * m_extentY[i] +
+          std::abs(plane.z) * m_extentZ[i];
+        if (distance + radius < 0.0f)
+        {
+          isVisible = false;
+          break;
+        }
+      }
+      visible[i] = isVisible ? 1 : 0;
+      visibleCount += isVisible ? 1 : 0;
+    }
+    return visibleCount;
+  }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// Shared by ArkRenderer and VkRenderer, so glm is left configured however the including renderer configures it
+//libs
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ark
+{
+  // World-space boxes stored as centers and half extents in structure-of-arrays form, the layout the batch frustum
+  // test reads four boxes at a time from. Both renderers' frustums cull through it.
+  class BoxBatch
+  {
+  public:
+    void Clear();
+    // Appends a world-space box
+    void Push(const glm::vec3& center, const glm::vec3& extent);
+    // Appends the object-space box [min, max] after transforming it to world space
+    void Push(const glm::vec3& min, const glm::vec3& max, const glm::mat4& transform);
+    size_t Size() const { return m_centerX.size(); }
+
+    // Tests every box against six inward facing, normalized planes (xyz the normal, w the distance), four at a time
+    // with SSE where available. visible[i] is set to 1 for boxes at least partially inside and 0 otherwise. Returns
+    // the number of visible boxes.
+    size_t Cull(const std::array<glm::vec4, 6>& planes, std::vector<uint8_t>& visible) const;
+
+  private:
+    std::vector<float> m_centerX{}, m_centerY{}, m_centerZ{};
+    std::vector<float> m_extentX{}, m_extentY{}, m_extentZ{};
+  };
+}
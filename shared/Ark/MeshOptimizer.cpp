@@ -0,0 +1,300 @@
+#include "MeshOptimizer.hpp"
+
+//libs
+#include <glm/glm.hpp>
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Ark
+{
+  namespace
+  {
+    // Cache size the Forsyth scoring function models. Larger than the measured cache on purpose, it only shapes
+    // scores.
+    constexpr size_t FORSYTH_CACHE_SIZE = 32;
+    constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    // FIFO cache simulation using insertion timestamps: a vertex is cached while fewer than cacheSize newer
+    // vertices have been inserted after it
+    class FifoCache
+    {
+    public:
+      FifoCache(size_t vertexCount, size_t cacheSize) : m_insertTime(vertexCount, 0),
+                                                        m_cacheSize(static_cast<uint32_t>(cacheSize)),
+                                                        m_time(static_cast<uint32_t>(cacheSize) + 1)
+      {
+      }
+
+      // Returns true on a miss
+      bool Access(uint32_t vertex)
+      {
+        if (m_time - m_insertTime[vertex] <= m_cacheSize) return false;
+        m_insertTime[vertex] = m_time++;
+        return true;
+      }
+
+      bool WasEverCached(uint32_t vertex) const { return m_insertTime[vertex] != 0; }
+
+    private:
+      std::vector<uint32_t> m_insertTime;
+      uint32_t m_cacheSize;
+      uint32_t m_time;
+    };
+
+    float ForsythVertexScore(int cachePosition, uint32_t remainingValence)
+    {
+      // Vertices without triangles left to emit must never attract the next pick
+      if (remainingValence == 0) return -1.0f;
+
+      float score = 0.0f;
+      if (cachePosition >= 0)
+      {
+        // The last triangle's vertices get a fixed score so the next pick does not just strip along an edge
+        if (cachePosition < 3)
+        {
+          score = 0.75f;
+        }
+        else
+        {
+          const float scale = 1.0f / static_cast<float>(FORSYTH_CACHE_SIZE - 3);
+          score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scale, 1.5f);
+        }
+      }
+
+      // Boost vertices with few triangles left so lone triangles are not left behind for later
+      return score + 2.0f * std::pow(static_cast<float>(remainingValence), -0.5f);
+    }
+
+    glm::vec3 LoadPosition(const void* positions, size_t stride, uint32_t vertex)
+    {
+      glm::vec3 position;
+      std::memcpy(&position, static_cast<const char*>(positions) + stride * vertex, sizeof(glm::vec3));
+      return position;
+    }
+  }
+
+  MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices,
+                                                              size_t vertexCount)
+  {
+    CacheStats stats{};
+    if (indices.size() < 3) return stats;
+
+    FifoCache cache{vertexCount, MEASURE_CACHE_SIZE};
+    size_t misses = 0;
+    size_t uniqueVertices = 0;
+    for (const uint32_t index : indices)
+    {
+      uniqueVertices += cache.WasEverCached(index) ? 0 : 1;
+      misses += cache.Access(index) ? 1 : 0;
+    }
+
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+    return stats;
+  }
+
+  void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+  {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return;
+
+    // Triangles adjacent to each vertex, packed into one array. valence doubles as the remaining adjacency count,
+    // emitted triangles are swapped to the back of a vertex's range and dropped.
+    std::vector<uint32_t> valence(vertexCount, 0);
+    for (const uint32_t index : indices) ++valence[index];
+    std::vector<size_t> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) adjacencyOffset[v + 1] = adjacencyOffset[v] + valence[v];
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+      std::vector<size_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+      for (size_t t = 0; t < triangleCount; ++t)
+      {
+        for (size_t k = 0; k < 3; ++k) adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+      }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) vertexScore[v] = ForsythVertexScore(-1, valence[v]);
+    std::vector<float> triangleScore(triangleCount);
+    uint32_t bestTriangle = INVALID_INDEX;
+    float bestScore = -1.0f;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+      triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] +
+        vertexScore[indices[t * 3 + 2]];
+      if (triangleScore[t] > bestScore)
+      {
+        bestScore = triangleScore[t];
+        bestTriangle = static_cast<uint32_t>(t);
+      }
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> cache{}, nextCache{};
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+    std::vector<uint32_t> output{};
+    output.reserve(indices.size());
+    size_t scanCursor = 0;
+
+    while (output.size() < indices.size())
+    {
+      if (bestTriangle == INVALID_INDEX)
+      {
+        // Nothing adjacent to the cache is left, continue with the next triangle in input order
+        while (emitted[scanCursor]) ++scanCursor;
+        bestTriangle = static_cast<uint32_t>(scanCursor);
+      }
+
+      emitted[bestTriangle] = true;
+      const uint32_t* triangle = &indices[static_cast<size_t>(bestTriangle) * 3];
+      nextCache.clear();
+      for (size_t k = 0; k < 3; ++k)
+      {
+        const uint32_t v = triangle[k];
+        output.push_back(v);
+        if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end()) nextCache.push_back(v);
+
+        uint32_t* begin = adjacency.data() + adjacencyOffset[v];
+        uint32_t* end = begin + valence[v];
+        *std::find(begin, end, bestTriangle) = *(end - 1);
+        --valence[v];
+      }
+      for (const uint32_t v : cache)
+      {
+        if (v != triangle[0] && v != triangle[1] && v != triangle[2]) nextCache.push_back(v);
+      }
+
+      // Everything whose cache position changed needs its score, and the scores of its triangles, refreshed.
+      // Vertices past FORSYTH_CACHE_SIZE just fell out of the cache.
+      for (size_t i = 0; i < nextCache.size(); ++i)
+      {
+        const uint32_t v = nextCache[i];
+        cachePosition[v] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+        const float score = ForsythVertexScore(cachePosition[v], valence[v]);
+        const float delta = score - vertexScore[v];
+        vertexScore[v] = score;
+        for (size_t a = adjacencyOffset[v]; a < adjacencyOffset[v] + valence[v]; ++a)
+        {
+          triangleScore[adjacency[a]] += delta;
+        }
+      }
+      if (nextCache.size() > FORSYTH_CACHE_SIZE) nextCache.resize(FORSYTH_CACHE_SIZE);
+      std::swap(cache, nextCache);
+
+      // Only triangles around the cache can be the best pick, anything else scores on valence alone
+      bestTriangle = INVALID_INDEX;
+      bestScore = -1.0f;
+      for (const uint32_t v : cache)
+      {
+        for (size_t a = adjacencyOffset[v]; a < adjacencyOffset[v] + valence[v]; ++a)
+        {
+          const uint32_t t = adjacency[a];
+          if (triangleScore[t] > bestScore)
+          {
+            bestScore = triangleScore[t];
+            bestTriangle = t;
+          }
+        }
+      }
+    }
+
+    indices = std::move(output);
+  }
+
+  void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const void* positions, size_t vertexCount,
+                                       size_t stride)
+  {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2 || vertexCount == 0) return;
+
+    // Triangles that miss the cache on all three vertices start a new cluster. Moving clusters around only costs
+    // cache efficiency at those points, which already restart the cache.
+    std::vector<size_t> clusterStarts{};
+    FifoCache cache{vertexCount, MEASURE_CACHE_SIZE};
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+      int misses = 0;
+      for (size_t k = 0; k < 3; ++k) misses += cache.Access(indices[t * 3 + k]) ? 1 : 0;
+      if (misses == 3 || t == 0) clusterStarts.push_back(t);
+    }
+    if (clusterStarts.size() < 2) return;
+    clusterStarts.push_back(triangleCount);
+
+    glm::vec3 meshCentroid{0.0f};
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+      meshCentroid += LoadPosition(positions, stride, static_cast<uint32_t>(v));
+    }
+    meshCentroid /= static_cast<float>(vertexCount);
+
+    // Clusters that face away from the mesh center and sit far out are likely to occlude the rest, draw them first
+    struct Cluster
+    {
+      size_t begin;
+      size_t end;
+      float sortKey;
+    };
+    std::vector<Cluster> clusters{};
+    clusters.reserve(clusterStarts.size() - 1);
+    for (size_t c = 0; c + 1 < clusterStarts.size(); ++c)
+    {
+      glm::vec3 centroid{0.0f};
+      glm::vec3 normal{0.0f};
+      float area = 0.0f;
+      for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+      {
+        const glm::vec3 p0 = LoadPosition(positions, stride, indices[t * 3]);
+        const glm::vec3 p1 = LoadPosition(positions, stride, indices[t * 3 + 1]);
+        const glm::vec3 p2 = LoadPosition(positions, stride, indices[t * 3 + 2]);
+        const glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+        const float triangleArea = glm::length(triangleNormal);
+        centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+        normal += triangleNormal;
+        area += triangleArea;
+      }
+
+      float sortKey = 0.0f;
+      const float normalLength = glm::length(normal);
+      if (area > 0.0f && normalLength > 0.0f)
+      {
+        sortKey = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+      }
+      clusters.push_back({clusterStarts[c], clusterStarts[c + 1], sortKey});
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& lhs, const Cluster& rhs)
+    {
+      return lhs.sortKey > rhs.sortKey;
+    });
+
+    std::vector<uint32_t> output{};
+    output.reserve(indices.size());
+    for (const auto& cluster : clusters)
+    {
+      output.insert(output.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+    }
+    indices = std::move(output);
+  }
+
+  std::vector<uint32_t> MeshOptimizer::OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount)
+  {
+    std::vector<uint32_t> remap(vertexCount, INVALID_INDEX);
+    std::vector<uint32_t> fetchOrder{};
+    fetchOrder.reserve(vertexCount);
+    for (uint32_t& index : indices)
+    {
+      if (remap[index] == INVALID_INDEX)
+      {
+        remap[index] = static_cast<uint32_t>(fetchOrder.size());
+        fetchOrder.push_back(index);
+      }
+      index = remap[index];
+    }
+    return fetchOrder;
+  }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ark
+{
+  // Import-time index and vertex reordering, shared by ArkRenderer and VkRenderer. Triangles are reordered for the
+  // post-transform vertex cache and then for overdraw, and vertices are put in the order the index buffer first
+  // fetches them. Works on indices only so it does not depend on either renderer's vertex format; callers apply the
+  // returned fetch order to their vertices.
+  class MeshOptimizer
+  {
+  public:
+    // FIFO size used to measure ACMR/ATVR. Close to what current desktop GPUs behave like.
+    static constexpr size_t MEASURE_CACHE_SIZE = 16;
+
+    struct CacheStats
+    {
+      // Average cache miss ratio: vertex shader invocations per triangle. 0.5 is the lower bound, 3 the worst case.
+      float acmr{0.0f};
+      // Average transformed vertex ratio: vertex shader invocations per unique vertex. 1 is optimal.
+      float atvr{0.0f};
+    };
+
+    // Simulates a FIFO vertex cache of MEASURE_CACHE_SIZE entries over the index buffer
+    static CacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount);
+    // Tom Forsyth's linear-speed vertex cache optimization
+    static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+    // Splits the cache-optimized triangle list into clusters at cache restarts and draws outward facing clusters
+    // first (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"). positions points
+    // at the first vertex position (three floats), stride is the distance between two vertices in bytes.
+    static void OptimizeOverdraw(std::vector<uint32_t>& indices, const void* positions, size_t vertexCount,
+                                 size_t stride);
+    // Rewrites indices in first-use order. Returns the old vertex index of every new vertex, unreferenced
+    // vertices are left out.
+    static std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+  };
+}
@@ -0,0 +1,74 @@
+#include "SortKey.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace Ark
+{
+  namespace SortKey
+  {
+    uint64_t Encode(uint32_t stateId, uint32_t materialId, uint32_t meshId, float depth, bool blended)
+    {
+      constexpr uint64_t DEPTH_MASK = (1ull << DEPTH_BITS) - 1;
+      // The bits of a non-negative float order like the value, the top 24 below the sign bit keep the exponent and
+      // most of the mantissa
+      const float clamped = std::max(depth, 0.0f);
+      uint32_t depthBits;
+      std::memcpy(&depthBits, &clamped, sizeof(depthBits));
+      const uint64_t quantizedDepth = (depthBits >> (31 - DEPTH_BITS)) & DEPTH_MASK;
+
+      const uint64_t state = stateId & ((1u << STATE_BITS) - 1);
+      const uint64_t material = materialId & ((1u << MATERIAL_BITS) - 1);
+      const uint64_t mesh = meshId & ((1u << MESH_BITS) - 1);
+      const uint64_t group = state << (MATERIAL_BITS + MESH_BITS) | material << MESH_BITS | mesh;
+      if (blended)
+      {
+        return 1ull << 63 | (DEPTH_MASK - quantizedDepth) << (STATE_BITS + MATERIAL_BITS + MESH_BITS) | group;
+      }
+      return group << DEPTH_BITS | quantizedDepth;
+    }
+
+    void RadixSort(std::vector<Entry>& entries, std::vector<Entry>& scratch)
+    {
+      constexpr uint32_t PASSES = 8;
+      if (entries.size() < 2)
+      {
+        return;
+      }
+      // All histograms in one read of the keys
+      std::array<std::array<uint32_t, 256>, PASSES> counts{};
+      for (const auto& entry : entries)
+      {
+        for (uint32_t pass = 0; pass < PASSES; ++pass)
+        {
+          counts[pass][(entry.key >> (pass * 8)) & 0xFF]++;
+        }
+      }
+
+      scratch.resize(entries.size());
+      for (uint32_t pass = 0; pass < PASSES; ++pass)
+      {
+        const uint32_t shift = pass * 8;
+        auto& count = counts[pass];
+        if (count[(entries.front().key >> shift) & 0xFF] == entries.size())
+        {
+          continue;
+        }
+        uint32_t offset = 0;
+        for (auto& bucket : count)
+        {
+          const uint32_t size = bucket;
+          bucket = offset;
+          offset += size;
+        }
+        for (const auto& entry : entries)
+        {
+          scratch[count[(entry.key >> shift) & 0xFF]++] = entry;
+        }
+        entries.swap(scratch);
+      }
+    }
+  }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Ark
+{
+  // 64-bit draw sort keys and their sort, shared by ArkRenderer's RenderQueue and VkRenderer's ArkRenderQueue.
+  // Opaque keys group by state (program or pipeline), material and mesh so consecutive draws share as much state as
+  // possible, and order front-to-back within a group. Blended keys sort after every opaque one, back-to-front, with
+  // the state only breaking ties:
+  //   opaque:  [63] 0 | [62..56] state | [55..40] material | [39..24] mesh | [23..0] depth
+  //   blended: [63] 1 | [62..39] inverted depth | [38..32] state | [31..16] material | [15..0] mesh
+  namespace SortKey
+  {
+    constexpr uint32_t STATE_BITS = 7;
+    constexpr uint32_t MATERIAL_BITS = 16;
+    constexpr uint32_t MESH_BITS = 16;
+    constexpr uint32_t DEPTH_BITS = 24;
+
+    // Ids are masked to their field's width. depth is a distance from the camera, negative values count as 0.
+    uint64_t Encode(uint32_t stateId, uint32_t materialId, uint32_t meshId, float depth, bool blended);
+
+    struct Entry
+    {
+      uint64_t key;
+      uint32_t index;
+    };
+    // Stable LSD radix sort by key, 8 bits per pass. A pass is skipped when every key has the same byte there, which
+    // is common for the high bytes of small scenes.
+    void RadixSort(std::vector<Entry>& entries, std::vector<Entry>& scratch);
+
+    // Dense id of handle in ids, assigned the first time it is seen and restarted once a field's whole range has
+    // been handed out. Ids that wrap around cost state changes but never correctness, as long as the draw loop
+    // compares the handles themselves.
+    template <typename Handle>
+    uint32_t MapId(std::unordered_map<Handle, uint32_t>& ids, const Handle& handle, uint32_t bits)
+    {
+      const auto found = ids.find(handle);
+      if (found != ids.end())
+      {
+        return found->second;
+      }
+      if (ids.size() >= (1ull << bits))
+      {
+        ids.clear();
+      }
+      const auto id = static_cast<uint32_t>(ids.size());
+      ids.emplace(handle, id);
+      return id;
+    }
+  }
+}
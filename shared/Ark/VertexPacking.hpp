@@ -0,0 +1,74 @@
+#pragma once
+
+// Shared by ArkRenderer and VkRenderer, so glm is left configured however the including renderer configures it
+//libs
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+// std
+#include <cmath>
+#include <cstdint>
+
+namespace Ark
+{
+  // Helpers for the packed vertex layouts of both renderers. Positions and UVs are quantized to unorm16 inside a
+  // per-mesh range, unit vectors are stored as octahedral-mapped snorm16 pairs and colors as unorm8. Decoding lives
+  // in each renderer's packed shaders.
+  namespace VertexPacking
+  {
+    inline uint8_t QuantizeUnorm8(float value)
+    {
+      return static_cast<uint8_t>(std::lround(glm::clamp(value, 0.0f, 1.0f) * 255.0f));
+    }
+
+    inline uint16_t QuantizeUnorm16(float value)
+    {
+      return static_cast<uint16_t>(std::lround(glm::clamp(value, 0.0f, 1.0f) * 65535.0f));
+    }
+
+    inline int16_t QuantizeSnorm16(float value)
+    {
+      return static_cast<int16_t>(std::lround(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    // Projects a unit vector onto the octahedron |x| + |y| + |z| = 1 and folds the lower half over the upper one
+    inline glm::i16vec2 OctEncode(const glm::vec3& n)
+    {
+      const float l1Norm = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+      if (l1Norm == 0.0f)
+      {
+        return glm::i16vec2(0);
+      }
+
+      glm::vec2 p{n.x / l1Norm, n.y / l1Norm};
+      if (n.z < 0.0f)
+      {
+        const glm::vec2 signs{p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f};
+        p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * signs;
+      }
+      return {QuantizeSnorm16(p.x), QuantizeSnorm16(p.y)};
+    }
+
+    // Offset and extent of a set of values, stored values are (v - offset) / extent
+    template <typename Vec>
+    struct QuantizationRange
+    {
+      Vec offset{0.0f};
+      Vec extent{1.0f};
+
+      // Degenerate axes get an extent of 1 so they quantize to 0 instead of dividing by zero
+      QuantizationRange(const Vec& min, const Vec& max) : offset(min), extent(max - min)
+      {
+        for (int i = 0; i < Vec::length(); ++i)
+        {
+          if (extent[i] <= 0.0f) extent[i] = 1.0f;
+        }
+      }
+
+      Vec Normalize(const Vec& value) const
+      {
+        return (value - offset) / extent;
+      }
+    };
+  }
+}